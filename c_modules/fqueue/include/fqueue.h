@@ -13,7 +13,10 @@ extern "C" {
 #define restrict
 #endif
 
-typedef struct fqueue fqueue_t;
+typedef struct fqueue      fqueue_t;
+typedef struct fqueue_iter fqueue_iter_t;
+
+struct fq_shared;
 
 enum fqmode
 {
@@ -23,9 +26,27 @@ enum fqmode
 
 struct fqueue
 {
-    char        dirname[LFS_NAME_MAX];
-    enum fqmode mode;
-    uint32_t    cur_idx;    // index of last file read or written
+    char              dirname[LFS_NAME_MAX];
+    enum fqmode       mode;
+    uint32_t          cur_idx;    // index of last file read or written
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    uint32_t          cur_off;    // byte offset of the next record in segment cur_idx
+#endif
+    uint32_t          purges;     // purge count last seen
+    struct fq_shared *shared;     // wait objects and index shared by all users of the queue
+};
+
+struct fqueue_iter
+{
+    fqueue_t *fq;
+    uint32_t  purges;
+    uint32_t  idx;         // position of the next entry
+    uint32_t  prev_idx;    // position of the last entry returned
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    uint32_t  off;
+    uint32_t  prev_off;
+#endif
+    int       count;       // number of entries returned since fqueue_iter_begin()
 };
 
 /**
@@ -76,6 +97,44 @@ int fqueue_get(fqueue_t *restrict fq, void *restrict buf, size_t *restrict size,
  */
 int fqueue_peek(fqueue_t *restrict fq, void *restrict buf, size_t *restrict size, k_timeout_t timeout);
 
+/**
+ * Start walking the pending entries of a queue opened for reading. Nothing is removed
+ * from the queue until fqueue_iter_commit() is called.
+ * @param fq        pointer to the queue to walk
+ * @param it        the iterator to initialize
+ * @returns         0 on success, -EINVAL if the queue is not open for reading
+ */
+int fqueue_iter_begin(fqueue_t *restrict fq, fqueue_iter_t *restrict it);
+
+/**
+ * Read the next entry, without waiting
+ * @param it        the iterator
+ * @param data      pointer to the buffer where the entry will be copied
+ * @param size      on entry, a pointer to a value with the maximum number of bytes that can be
+ * read. On return, this value will be updatted to the actual number read.
+ * @returns         0 on success, negative errno on failure
+ *                  -ENOMSG     There are no more entries.
+ */
+int fqueue_iter_next(fqueue_iter_t *restrict it, void *restrict buf, size_t *restrict size);
+
+/**
+ * Step over the next count entries without copying them, as if they were read with
+ * fqueue_iter_next(). They count towards fqueue_iter_commit().
+ * @param it        the iterator
+ * @param count     number of entries to step over
+ * @returns         0 on success, negative errno on failure
+ *                  -ENOMSG     There were fewer entries.
+ */
+int fqueue_iter_skip(fqueue_iter_t *it, int count);
+
+/**
+ * Remove the first count entries returned by the iterator from the queue, in one go
+ * @param it        the iterator
+ * @param count     number of entries to remove, at most the number returned so far
+ * @returns         0 on success, negative errno on failure
+ */
+int fqueue_iter_commit(fqueue_iter_t *it, int count);
+
 /**
  * Remove all the message from an existing queue.
  * This routine discards all unreceived messages in a file queue. Any threads that
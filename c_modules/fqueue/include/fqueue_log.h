@@ -0,0 +1,70 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+#ifndef _FQUEUE_LOG_H_
+#define _FQUEUE_LOG_H_
+
+/*
+ * Segmented append-log backend for fqueue (CONFIG_FQUEUE_APPEND_LOG). Internal to the
+ * fqueue module, use the fqueue_* API instead.
+ *
+ * A queue is a ring of CONFIG_FQUEUE_MAX_SEGMENTS fixed size segment files. Each segment
+ * starts with a header carrying its sequence number and is followed by framed records
+ * (magic, length, crc32, payload). For a writer cur_idx/cur_off is the tail, for a reader
+ * it is the head. The head is persisted in a small "head" file on every dequeue, and the
+ * tail segment in a "tail" file whenever the writer moves to a new segment; the tail
+ * offset is recovered by walking the records of the tail segment.
+ */
+
+#include "fqueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * open (and for writers recover or migrate) the log in fq->dirname
+ * @returns         0 on success, negative errno on failure
+ */
+int fq_log_init(fqueue_t *fq);
+
+/**
+ * append a record at the tail
+ * @returns         0 on success, -ENOMEM if the ring or the file system is full,
+ *                  -EMSGSIZE if the record can never fit in a segment
+ */
+int fq_log_put(fqueue_t *fq, const void *data, size_t size);
+
+/**
+ * read the record at the head without waiting
+ * @returns         0 on success, -ENOMSG if there is nothing to read
+ */
+int fq_log_read(fqueue_t *fq, void *buf, size_t *size, bool do_remove);
+
+/**
+ * read the record at position seq/off without waiting, and move seq/off past it
+ * @param buf       where to copy the payload, or NULL to only skip the record. Corrupt
+ *                  records are stepped over either way, they are never returned
+ * @returns         0 on success, -ENOMSG if there is nothing to read
+ */
+int fq_log_read_at(fqueue_t *fq, uint32_t *seq, uint32_t *off, void *buf, size_t *size);
+
+/**
+ * move the head to seq/off, removing every record before it
+ */
+int fq_log_commit(fqueue_t *fq, uint32_t seq, uint32_t off);
+
+/**
+ * load the head from flash, or the start of the oldest segment if it was never saved
+ */
+int fq_log_load_head(const fqueue_t *fq, uint32_t *seq, uint32_t *off);
+
+/**
+ * reload the head from flash after the queue was purged
+ */
+int fq_log_rescan(fqueue_t *fq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
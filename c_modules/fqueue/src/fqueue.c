@@ -10,6 +10,9 @@
 #include <stdio.h>
 
 #include "fqueue.h"
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+#include "fqueue_log.h"
+#endif
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(fqueue, LOG_LEVEL_DBG);
@@ -26,22 +29,79 @@ static struct fs_mount_t *mp = &FS_FSTAB_ENTRY(PARTITION_NODE);
 typedef void (*qcb_t)(fqueue_t *fq, struct fs_dirent *);
 
 /*
- * there is a global file queue lock. Any time anything is written to any queue
- * any thread waiting on reading something from any queue will be awoken. That thread
- * must recheck the condition and re-sleep if necesary
- */
-K_SEM_DEFINE(fqueue_lock, 0, 1);
-/*
- * we poll the semaphore and also allow for signals to show that we need to rescan the
- * queue (purge or item removed)
+ * state shared by every fqueue_t opened on the same queue. Readers wait on the queue's
+ * own condition variable, so a put or purge only wakes readers of that queue. The
+ * first/next index is kept in RAM so the directory is only scanned once per queue. With
+ * the append log it is the head and tail record position, filled in once a writer has
+ * opened the queue, so a reader that has caught up sees it is empty without any flash IO.
  */
-static struct k_poll_signal fq_rescan;
-
-static struct k_poll_event fq_events[] = {
-    K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &fq_rescan, 0),
-    K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &fqueue_lock, 0),
+struct fq_shared
+{
+    char             dirname[LFS_NAME_MAX];
+    struct k_mutex   lock;
+    struct k_condvar changed;      // broadcast on put and purge
+    uint32_t         purges;       // bumped on every purge, readers then rescan
+    bool             indexed;      // first_idx/next_idx are valid
+    uint32_t         first_idx;    // oldest entry
+    uint32_t         next_idx;     // where the next entry is written
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    uint32_t         first_off;    // offset of the oldest record in segment first_idx
+    uint32_t         next_off;     // offset of the next record in segment next_idx
+#endif
 };
 
+static struct fq_shared fq_shared[CONFIG_FQUEUE_MAX_QUEUES];
+static K_MUTEX_DEFINE(fq_shared_lock);
+
+static struct fq_shared *fq_shared_get(const char *dirname)
+{
+    struct fq_shared *sh = NULL;
+
+    k_mutex_lock(&fq_shared_lock, K_FOREVER);
+    for (int i = 0; i < ARRAY_SIZE(fq_shared); i++) {
+        if (strcmp(fq_shared[i].dirname, dirname) == 0) {
+            sh = &fq_shared[i];
+            break;
+        }
+        if (sh == NULL && fq_shared[i].dirname[0] == 0) {
+            sh = &fq_shared[i];
+        }
+    }
+    if (sh && sh->dirname[0] == 0) {
+        strncpy(sh->dirname, dirname, sizeof(sh->dirname) - 1);
+        k_mutex_init(&sh->lock);
+        k_condvar_init(&sh->changed);
+    }
+    k_mutex_unlock(&fq_shared_lock);
+    return sh;
+}
+
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+// take the head and tail from a writer that has just opened the log. Call with the shared lock held
+static void fq_log_index(fqueue_t *fq)
+{
+    struct fq_shared *sh = fq->shared;
+
+    fq_log_load_head(fq, &sh->first_idx, &sh->first_off);
+    sh->next_idx = fq->cur_idx;
+    sh->next_off = fq->cur_off;
+    sh->indexed  = true;
+}
+
+// true if seq/off is the tail, i.e. there is nothing to read there yet
+static bool fq_log_at_tail(const struct fq_shared *sh, uint32_t seq, uint32_t off)
+{
+    return sh->indexed && seq == sh->next_idx && off == sh->next_off;
+}
+
+// the reader moved the head. Call with the shared lock held
+static void fq_log_index_head(fqueue_t *fq)
+{
+    fq->shared->first_idx = fq->cur_idx;
+    fq->shared->first_off = fq->cur_off;
+}
+#endif
+
 static int fq_walk(fqueue_t *fq, qcb_t cb)
 {
     int                     res = 0;
@@ -88,6 +148,7 @@ static int fq_walk(fqueue_t *fq, qcb_t cb)
     return res;
 }
 
+#ifndef CONFIG_FQUEUE_APPEND_LOG
 static int fq_find_first_and_last(fqueue_t *fq, int *first, int *last)
 {
     int                     res = 0;
@@ -154,6 +215,7 @@ static int fq_find_first_and_last(fqueue_t *fq, int *first, int *last)
     }
     return res;
 }
+#endif
 
 static void fq_del(fqueue_t *fq, struct fs_dirent *entry)
 {
@@ -162,71 +224,134 @@ static void fq_del(fqueue_t *fq, struct fs_dirent *entry)
     snprintf(fname, sizeof(fname) - 1, "%s/%s", fq->dirname, entry->name);
     LOG_INF("Delete %s", fname);
     fs_unlink(fname);
-    k_poll_signal_raise(&fq_rescan, 1);
 }
 
 int fqueue_purge(fqueue_t *fq)
 {
+    struct fq_shared *sh  = fq->shared;
+    int               ret = 0;
+
     if (fq->mode != FQ_WRITE) {
         return -EINVAL;
     }
+    k_mutex_lock(&sh->lock, K_FOREVER);
     fq_walk(fq, fq_del);
     fq->cur_idx = 0;
-    return 0;
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    fq->cur_off = 0;
+    ret         = fq_log_init(fq);
+    if (ret == 0) {
+        fq_log_index(fq);
+    }
+#else
+    sh->first_idx = 0;
+    sh->next_idx  = 0;
+#endif
+    sh->purges++;
+    fq->purges = sh->purges;
+    k_condvar_broadcast(&sh->changed);
+    k_mutex_unlock(&sh->lock);
+    return ret;
 }
 
 int fqueue_init(fqueue_t *restrict fq, const char *restrict qname, enum fqmode mode, bool do_reinitialize)
 {
     int ret = 0;
-    int first;
-    int last;
 
     memset(fq, 0, sizeof(fqueue_t));
     /* a file queue is simply a directory with one file per queued item */
     snprintf(fq->dirname, sizeof(fq->dirname) - 1, "%s/%s", mp->mnt_point, qname);
     fq->mode = mode;
+    if (mode != FQ_READ && mode != FQ_WRITE) {
+        return -EINVAL;
+    }
+    fq->shared = fq_shared_get(fq->dirname);
+    if (fq->shared == NULL) {
+        LOG_ERR("Too many file queues, increase CONFIG_FQUEUE_MAX_QUEUES");
+        return -ENOMEM;
+    }
+    struct fq_shared *sh = fq->shared;
+
+    k_mutex_lock(&sh->lock, K_FOREVER);
+    fq->purges = sh->purges;
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    /* or, a directory holding a ring of segment files with framed records */
+    if (mode == FQ_READ && sh->indexed) {
+        // a writer already found the head, no need to look for it again
+        fq->cur_idx = sh->first_idx;
+        fq->cur_off = sh->first_off;
+    } else {
+        ret = fq_log_init(fq);
+        if (ret == 0 && mode == FQ_WRITE) {
+            fq_log_index(fq);
+        }
+    }
+#else
+    int first;
+    int last;
 
-    ret = fq_find_first_and_last(fq, &first, &last);
+    if (!sh->indexed) {
+        ret = fq_find_first_and_last(fq, &first, &last);
+        if (ret == 0) {
+            sh->first_idx = first;
+            sh->next_idx  = last;
+            sh->indexed   = true;
+        }
+    }
 
     switch (mode) {
     case FQ_WRITE:
         if (ret == -EEXIST && do_reinitialize) {
             fqueue_purge(fq);
         }
-        LOG_DBG("Set current file to last entry (%d)", last);
-        fq->cur_idx = last;
-        // initialize the poll signal for rescan
-        k_poll_signal_init(&fq_rescan);
+        LOG_DBG("Set current file to last entry (%d)", sh->next_idx);
+        fq->cur_idx = sh->next_idx;
         break;
     case FQ_READ:
-        fq->cur_idx = first;
+        fq->cur_idx = sh->first_idx;
         break;
-
-    default:
-        return -EINVAL;
     }
+#endif
+    k_mutex_unlock(&sh->lock);
     return ret;
 }
 
 int fqueue_put(fqueue_t *restrict fq, const void *restrict data, size_t size)
 {
-    char              fname[FILENAME_MAX];
-    struct fs_file_t  entry;
-    struct fs_statvfs fs_stats;
-    int               ret;
+    int ret;
 
     if (fq->mode != FQ_WRITE) {
         return -EINVAL;
     }
+    struct fq_shared *sh = fq->shared;
+
+    k_mutex_lock(&sh->lock, K_FOREVER);
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    // the free space check is done when a new segment is started
+    ret = fq_log_put(fq, data, size);
+    if (ret == 0) {
+        sh->next_idx = fq->cur_idx;
+        sh->next_off = fq->cur_off;
+        k_condvar_broadcast(&sh->changed);
+    }
+    k_mutex_unlock(&sh->lock);
+#else
+    char              fname[FILENAME_MAX];
+    struct fs_file_t  entry;
+    struct fs_statvfs fs_stats;
+
     fs_statvfs(fq->dirname, &fs_stats);
     if (fs_stats.f_bfree < CONFIG_MIN_BFREE) {
         LOG_ERR("Inufficient space to store data");
+        k_mutex_unlock(&sh->lock);
         return -ENOMEM;
     }
     snprintf(fname, sizeof(fname) - 1, "%s/%03d", fq->dirname, fq->cur_idx++);
+    sh->next_idx = fq->cur_idx;
     fs_file_t_init(&entry);
     if ((ret = fs_open(&entry, fname, FS_O_CREATE | FS_O_WRITE))) {
         LOG_ERR("Unable to create fq entry %s [%d]", fname, ret);
+        k_mutex_unlock(&sh->lock);
         return ret;
     }
     LOG_DBG("Append %d bytes to queue", size);
@@ -237,7 +362,9 @@ int fqueue_put(fqueue_t *restrict fq, const void *restrict data, size_t size)
         ret = 0;
     }
     fs_close(&entry);
-    k_sem_give(&fqueue_lock);
+    k_condvar_broadcast(&sh->changed);
+    k_mutex_unlock(&sh->lock);
+#endif
 
     return ret;
 }
@@ -245,43 +372,67 @@ int fqueue_put(fqueue_t *restrict fq, const void *restrict data, size_t size)
 static int
 fqueue_read(fqueue_t *restrict fq, void *restrict buf, size_t *restrict size, k_timeout_t timeout, bool do_remove)
 {
-    char             fname[FILENAME_MAX];
-    struct fs_file_t entry;
-    int              ret;
+    int ret;
 
     if (fq->mode != FQ_READ) {
         return -EINVAL;
     }
+    struct fq_shared *sh = fq->shared;
+
+    k_mutex_lock(&sh->lock, K_FOREVER);
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    while (1) {
+        ret = fq_log_at_tail(sh, fq->cur_idx, fq->cur_off) ? -ENOMSG : fq_log_read(fq, buf, size, do_remove);
+        if (ret != -ENOMSG) {
+            break;
+        }
+        // the next record is not yet there
+        if (k_condvar_wait(&sh->changed, &sh->lock, timeout)) {
+            ret = -EAGAIN;
+            break;
+        }
+        // woken for either data ready or rescan needed
+        if (fq->purges != sh->purges) {
+            LOG_WRN("Rescan triggered!");
+            fq->purges = sh->purges;
+            if (sh->indexed) {
+                fq->cur_idx = sh->first_idx;
+                fq->cur_off = sh->first_off;
+            } else {
+                fq_log_rescan(fq);
+            }
+        }
+    }
+    if (do_remove) {
+        fq_log_index_head(fq);
+    }
+#else
+    char             fname[FILENAME_MAX];
+    struct fs_file_t entry;
+
 restart:
     snprintf(fname, sizeof(fname) - 1, "%s/%03d", fq->dirname, fq->cur_idx);
     fs_file_t_init(&entry);
     while ((ret = fs_open(&entry, fname, FS_O_READ))) {
         // the next entry is not yet there
-        if (k_poll(fq_events, ARRAY_SIZE(fq_events), timeout)) {
+        if (k_condvar_wait(&sh->changed, &sh->lock, timeout)) {
+            k_mutex_unlock(&sh->lock);
             return -EAGAIN;
         }
         // woken for either data ready or rescan needed
-        if (fq_events[0].state == K_POLL_STATE_SIGNALED) {
-            int first, last;
-
+        if (fq->purges != sh->purges) {
             LOG_WRN("Rescan triggered!");
-            ret         = fq_find_first_and_last(fq, &first, &last);
-            fq->cur_idx = first;
+            fq->purges  = sh->purges;
+            fq->cur_idx = sh->first_idx;
             goto restart;
         }
-        if (fq_events[1].state == K_POLL_STATE_SEM_AVAILABLE) {
-            if (k_sem_take(&fqueue_lock, K_NO_WAIT)) {
-                return -EAGAIN;
-            }
-            break;
-        }
     }
     struct fs_dirent stat;
     do {
         ret = fs_stat(fname, &stat);
         if (stat.size == 0) {
             // file exists, but has not yet been written to
-            ret = k_sem_take(&fqueue_lock, timeout);
+            ret = k_condvar_wait(&sh->changed, &sh->lock, timeout);
         }
     } while (ret == 0 && stat.size == 0);
 
@@ -295,10 +446,13 @@ restart:
         if (do_remove) {
             fs_unlink(fname);
             fq->cur_idx++;
+            sh->first_idx = fq->cur_idx;
         }
         *size = ret;
         ret   = 0;
     }
+#endif
+    k_mutex_unlock(&sh->lock);
     return ret;
 }
 
@@ -312,6 +466,172 @@ int fqueue_peek(fqueue_t *restrict fq, void *restrict buf, size_t *restrict size
     return fqueue_read(fq, buf, size, timeout, false);
 }
 
+int fqueue_iter_begin(fqueue_t *restrict fq, fqueue_iter_t *restrict it)
+{
+    if (fq->mode != FQ_READ) {
+        return -EINVAL;
+    }
+    memset(it, 0, sizeof(fqueue_iter_t));
+    it->fq       = fq;
+    it->purges   = fq->shared->purges;
+    it->idx      = fq->cur_idx;
+    it->prev_idx = fq->cur_idx;
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    it->off      = fq->cur_off;
+    it->prev_off = fq->cur_off;
+#endif
+    return 0;
+}
+
+int fqueue_iter_next(fqueue_iter_t *restrict it, void *restrict buf, size_t *restrict size)
+{
+    struct fq_shared *sh = it->fq->shared;
+    int               ret;
+
+    k_mutex_lock(&sh->lock, K_FOREVER);
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    uint32_t idx = it->idx;
+    uint32_t off = it->off;
+
+    if (fq_log_at_tail(sh, idx, off)) {
+        ret = -ENOMSG;
+    } else {
+        ret = fq_log_read_at(it->fq, &idx, &off, buf, size);
+    }
+    k_mutex_unlock(&sh->lock);
+    if (ret) {
+        return ret;
+    }
+    it->prev_idx = it->idx;
+    it->prev_off = it->off;
+    it->off      = off;
+#else
+    char             fname[FILENAME_MAX];
+    struct fs_file_t entry;
+
+    snprintf(fname, sizeof(fname) - 1, "%s/%03d", it->fq->dirname, it->idx);
+    fs_file_t_init(&entry);
+    if (fs_open(&entry, fname, FS_O_READ)) {
+        k_mutex_unlock(&sh->lock);
+        return -ENOMSG;
+    }
+    ret = fs_read(&entry, buf, *size);
+    fs_close(&entry);
+    k_mutex_unlock(&sh->lock);
+    if (ret <= 0) {
+        // not yet written to
+        return ret < 0 ? ret : -ENOMSG;
+    }
+    *size        = ret;
+    it->prev_idx = it->idx;
+    uint32_t idx = it->idx + 1;
+#endif
+    it->idx = idx;
+    it->count++;
+    return 0;
+}
+
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+// step seq/off over count records the way fqueue_iter_next() does, corrupt ones
+// are passed over without being counted. Call with the shared lock held
+static int fq_log_skip(fqueue_t *fq, uint32_t *seq, uint32_t *off, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int ret = fq_log_read_at(fq, seq, off, NULL, NULL);
+        if (ret) {
+            return ret;
+        }
+    }
+    return 0;
+}
+#endif
+
+int fqueue_iter_skip(fqueue_iter_t *it, int count)
+{
+    struct fq_shared *sh  = it->fq->shared;
+    int               ret = 0;
+
+    k_mutex_lock(&sh->lock, K_FOREVER);
+    for (int i = 0; i < count && ret == 0; i++) {
+        uint32_t idx = it->idx;
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+        uint32_t off = it->off;
+
+        ret = fq_log_skip(it->fq, &idx, &off, 1);
+        if (ret == 0) {
+            it->prev_off = it->off;
+            it->off      = off;
+        }
+#else
+        char             fname[FILENAME_MAX];
+        struct fs_dirent stat;
+
+        snprintf(fname, sizeof(fname) - 1, "%s/%03d", it->fq->dirname, idx);
+        if (fs_stat(fname, &stat) || stat.size == 0) {
+            ret = -ENOMSG;
+        }
+        idx++;
+#endif
+        if (ret == 0) {
+            it->prev_idx = it->idx;
+            it->idx      = idx;
+            it->count++;
+        }
+    }
+    k_mutex_unlock(&sh->lock);
+    return ret;
+}
+
+int fqueue_iter_commit(fqueue_iter_t *it, int count)
+{
+    fqueue_t         *fq  = it->fq;
+    struct fq_shared *sh  = fq->shared;
+    int               ret = 0;
+
+    if (count <= 0) {
+        return 0;
+    }
+    if (count > it->count) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&sh->lock, K_FOREVER);
+    if (it->purges != sh->purges) {
+        // the entries are gone already
+        k_mutex_unlock(&sh->lock);
+        return -ENOMSG;
+    }
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    uint32_t idx = it->idx;
+    uint32_t off = it->off;
+
+    if (count == it->count - 1) {
+        // the last entry read did not get used
+        idx = it->prev_idx;
+        off = it->prev_off;
+    } else if (count < it->count) {
+        // walk the records again from the head, skipping them the same way the
+        // iterator did so corrupt ones are not counted
+        idx = fq->cur_idx;
+        off = fq->cur_off;
+        ret = fq_log_skip(fq, &idx, &off, count);
+    }
+    if (ret == 0) {
+        ret = fq_log_commit(fq, idx, off);
+        fq_log_index_head(fq);
+    }
+#else
+    char fname[FILENAME_MAX];
+
+    for (int i = 0; i < count; i++) {
+        snprintf(fname, sizeof(fname) - 1, "%s/%03d", fq->dirname, fq->cur_idx++);
+        fs_unlink(fname);
+    }
+    sh->first_idx = fq->cur_idx;
+#endif
+    k_mutex_unlock(&sh->lock);
+    return ret;
+}
+
 //////////////////////////////////////////
 // test functions
 //////////////////////////////////////////
@@ -362,7 +682,11 @@ static int fq_print_shell(const struct shell *sh, int argc, char **argv)
     }
     shell_print(sh, "dirname: %s", test_queue.dirname);
     shell_print(sh, "mode = %d (%s)", test_queue.mode, test_queue.mode == FQ_WRITE ? "write" : "read");
+#ifdef CONFIG_FQUEUE_APPEND_LOG
+    shell_print(sh, "segment = %u, offset = %u", test_queue.cur_idx, test_queue.cur_off);
+#else
     shell_print(sh, "next file = %03d", test_queue.cur_idx);
+#endif
     fq_list(&test_queue);
     return 0;
 }
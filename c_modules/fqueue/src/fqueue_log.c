@@ -0,0 +1,517 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/crc.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fqueue_log.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(fqueue, LOG_LEVEL_DBG);
+
+#define FQ_SEG_MAGIC    0x474c5146    // "FQLG"
+#define FQ_REC_MAGIC    0x4352        // "RC"
+#define FQ_CURSOR_MAGIC 0x52435146    // "FQCR"
+
+#define FQ_SEG_SIZE     CONFIG_FQUEUE_SEGMENT_SIZE
+#define FQ_PATH_MAX     (LFS_NAME_MAX + 8)
+
+struct fq_seg_hdr
+{
+    uint32_t magic;
+    uint32_t seq;    // sequence number, the file name is seq % CONFIG_FQUEUE_MAX_SEGMENTS
+};
+
+struct fq_rec_hdr
+{
+    uint16_t magic;
+    uint16_t len;    // payload bytes following the header
+    uint32_t crc;    // crc32_ieee of the payload
+};
+
+struct fq_cursor
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t off;
+};
+
+#define FQ_MAX_RECORD (FQ_SEG_SIZE - sizeof(struct fq_seg_hdr) - sizeof(struct fq_rec_hdr))
+
+static void fq_log_seg_name(const fqueue_t *fq, uint32_t seq, char *fname, size_t len)
+{
+    snprintf(fname, len, "%s/seg%02u", fq->dirname, seq % CONFIG_FQUEUE_MAX_SEGMENTS);
+}
+
+static int fq_log_load_cursor(const fqueue_t *fq, const char *name, struct fq_cursor *cursor)
+{
+    char             fname[FQ_PATH_MAX];
+    struct fs_file_t file;
+    int              ret;
+
+    snprintf(fname, sizeof(fname), "%s/%s", fq->dirname, name);
+    fs_file_t_init(&file);
+    if ((ret = fs_open(&file, fname, FS_O_READ))) {
+        return ret;
+    }
+    ret = fs_read(&file, cursor, sizeof(*cursor));
+    fs_close(&file);
+    if (ret != sizeof(*cursor) || cursor->magic != FQ_CURSOR_MAGIC) {
+        return -ENOENT;
+    }
+    return 0;
+}
+
+static int fq_log_save_cursor(const fqueue_t *fq, const char *name, uint32_t seq, uint32_t off)
+{
+    char             fname[FQ_PATH_MAX];
+    struct fs_file_t file;
+    struct fq_cursor cursor = { .magic = FQ_CURSOR_MAGIC, .seq = seq, .off = off };
+    int              ret;
+
+    snprintf(fname, sizeof(fname), "%s/%s", fq->dirname, name);
+    fs_file_t_init(&file);
+    if ((ret = fs_open(&file, fname, FS_O_CREATE | FS_O_WRITE))) {
+        LOG_ERR("Unable to open %s [%d]", fname, ret);
+        return ret;
+    }
+    ret = fs_write(&file, &cursor, sizeof(cursor));
+    fs_close(&file);
+    if (ret != sizeof(cursor)) {
+        LOG_ERR("Unable to save %s [%d]", fname, ret);
+        return ret < 0 ? ret : -EIO;
+    }
+    return 0;
+}
+
+/*
+ * open segment seq and check that it really holds that sequence number (and is not an
+ * older lap of the ring). On success the file is positioned after the segment header.
+ */
+static int fq_log_open_seg(const fqueue_t *fq, uint32_t seq, struct fs_file_t *file, fs_mode_t flags)
+{
+    char              fname[FQ_PATH_MAX];
+    struct fq_seg_hdr hdr;
+    int               ret;
+
+    fq_log_seg_name(fq, seq, fname, sizeof(fname));
+    fs_file_t_init(file);
+    if ((ret = fs_open(file, fname, flags))) {
+        return ret;
+    }
+    ret = fs_read(file, &hdr, sizeof(hdr));
+    if (ret != sizeof(hdr) || hdr.magic != FQ_SEG_MAGIC || hdr.seq != seq) {
+        fs_close(file);
+        return -ENOENT;
+    }
+    return 0;
+}
+
+static bool fq_log_seg_valid(const fqueue_t *fq, uint32_t seq)
+{
+    struct fs_file_t file;
+
+    if (fq_log_open_seg(fq, seq, &file, FS_O_READ)) {
+        return false;
+    }
+    fs_close(&file);
+    return true;
+}
+
+// lowest sequence number held by any segment, 0 if there are none
+static uint32_t fq_log_oldest_seq(const fqueue_t *fq)
+{
+    uint32_t oldest = UINT32_MAX;
+
+    for (uint32_t idx = 0; idx < CONFIG_FQUEUE_MAX_SEGMENTS; idx++) {
+        char              fname[FQ_PATH_MAX];
+        struct fs_file_t  file;
+        struct fq_seg_hdr hdr;
+
+        fq_log_seg_name(fq, idx, fname, sizeof(fname));
+        fs_file_t_init(&file);
+        if (fs_open(&file, fname, FS_O_READ)) {
+            continue;
+        }
+        if (fs_read(&file, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == FQ_SEG_MAGIC && hdr.seq < oldest) {
+            oldest = hdr.seq;
+        }
+        fs_close(&file);
+    }
+    return oldest == UINT32_MAX ? 0 : oldest;
+}
+
+// read the header of the record at off, 0 if there is a plausible record there
+static int fq_log_rec_hdr(struct fs_file_t *file, uint32_t off, struct fq_rec_hdr *rec)
+{
+    int ret;
+
+    if (off + sizeof(*rec) > FQ_SEG_SIZE) {
+        return -ENOENT;
+    }
+    if ((ret = fs_seek(file, off, FS_SEEK_SET))) {
+        return ret;
+    }
+    ret = fs_read(file, rec, sizeof(*rec));
+    if (ret != sizeof(*rec) || rec->magic != FQ_REC_MAGIC || off + sizeof(*rec) + rec->len > FQ_SEG_SIZE) {
+        return -ENOENT;
+    }
+    return 0;
+}
+
+// crc the len payload bytes at the file position, without keeping them
+static int fq_log_rec_crc(struct fs_file_t *file, uint16_t len, uint32_t *crc)
+{
+    uint8_t chunk[64];
+
+    *crc = 0;
+    while (len > 0) {
+        int ret = fs_read(file, chunk, MIN(len, sizeof(chunk)));
+        if (ret <= 0) {
+            return ret < 0 ? ret : -EIO;
+        }
+        *crc = crc32_ieee_update(*crc, chunk, ret);
+        len -= ret;
+    }
+    return 0;
+}
+
+/*
+ * find the end of the last complete record in segment seq, and cut off anything after it
+ */
+static int fq_log_recover_tail(fqueue_t *fq, uint32_t seq)
+{
+    struct fs_file_t  file;
+    struct fq_rec_hdr rec;
+    uint32_t          off = sizeof(struct fq_seg_hdr);
+    uint32_t          size;
+
+    fq->cur_idx = seq;
+    fq->cur_off = 0;
+    if (fq_log_open_seg(fq, seq, &file, FS_O_RDWR)) {
+        // never written, the next put starts the segment
+        return 0;
+    }
+    fs_seek(&file, 0, FS_SEEK_END);
+    size = MAX(fs_tell(&file), 0);
+    while (fq_log_rec_hdr(&file, off, &rec) == 0 && off + sizeof(rec) + rec.len <= size) {
+        off += sizeof(rec) + rec.len;
+    }
+    if (off < size) {
+        LOG_WRN("Dropping %d bytes of partial record in %s", (int)(size - off), fq->dirname);
+        fs_truncate(&file, off);
+    }
+    fs_close(&file);
+    fq->cur_off = off;
+    LOG_DBG("%s tail at segment %u offset %u", fq->dirname, fq->cur_idx, fq->cur_off);
+    return 0;
+}
+
+/*
+ * start the next segment, recycling the oldest slot of the ring
+ */
+static int fq_log_roll(fqueue_t *fq)
+{
+    struct fq_cursor  head;
+    struct fs_statvfs fs_stats;
+    uint32_t          next = fq->cur_idx + 1;
+
+    if (fq_log_load_cursor(fq, "head", &head) == 0 && next - head.seq >= CONFIG_FQUEUE_MAX_SEGMENTS) {
+        LOG_ERR("Queue %s is full", fq->dirname);
+        return -ENOMEM;
+    }
+    fs_statvfs(fq->dirname, &fs_stats);
+    if (fs_stats.f_bfree < CONFIG_MIN_BFREE) {
+        LOG_ERR("Inufficient space to store data");
+        return -ENOMEM;
+    }
+    fq->cur_idx = next;
+    fq->cur_off = 0;
+    return 0;
+}
+
+int fq_log_put(fqueue_t *fq, const void *data, size_t size)
+{
+    char              fname[FQ_PATH_MAX];
+    struct fs_file_t  file;
+    struct fq_rec_hdr rec = { .magic = FQ_REC_MAGIC, .len = size };
+    bool              new_segment;
+    int               ret;
+
+    if (size == 0 || size > FQ_MAX_RECORD) {
+        LOG_ERR("Cannot queue %zu bytes (max %zu)", size, FQ_MAX_RECORD);
+        return -EMSGSIZE;
+    }
+    if (fq->cur_off > 0 && fq->cur_off + sizeof(rec) + size > FQ_SEG_SIZE) {
+        if ((ret = fq_log_roll(fq))) {
+            return ret;
+        }
+    }
+    rec.crc     = crc32_ieee(data, size);
+    new_segment = fq->cur_off == 0;
+
+    fq_log_seg_name(fq, fq->cur_idx, fname, sizeof(fname));
+    fs_file_t_init(&file);
+    if ((ret = fs_open(&file, fname, FS_O_CREATE | FS_O_RDWR))) {
+        LOG_ERR("Unable to open fq segment %s [%d]", fname, ret);
+        return ret;
+    }
+    uint32_t off = fq->cur_off;
+    if (new_segment) {
+        struct fq_seg_hdr hdr = { .magic = FQ_SEG_MAGIC, .seq = fq->cur_idx };
+
+        fs_truncate(&file, 0);
+        ret = fs_write(&file, &hdr, sizeof(hdr));
+        off = sizeof(hdr);
+    } else {
+        ret = fs_seek(&file, off, FS_SEEK_SET);
+    }
+    if (ret >= 0) {
+        ret = fs_write(&file, &rec, sizeof(rec));
+    }
+    if (ret >= 0) {
+        ret = fs_write(&file, data, size);
+    }
+    // the record only becomes visible when the file is closed, which is the one commit
+    int close_ret = fs_close(&file);
+    if (ret < 0 || close_ret < 0) {
+        LOG_ERR("Failed to append to file queue: %s [%d/%d]", fname, ret, close_ret);
+        return ret < 0 ? ret : close_ret;
+    }
+    fq->cur_off = off + sizeof(rec) + size;
+    LOG_DBG("Append %zu bytes to queue", size);
+
+    if (new_segment) {
+        fq_log_save_cursor(fq, "tail", fq->cur_idx, 0);
+    }
+    return 0;
+}
+
+int fq_log_read_at(fqueue_t *fq, uint32_t *seq, uint32_t *off, void *buf, size_t *size)
+{
+    struct fs_file_t  file;
+    struct fq_rec_hdr rec;
+    size_t            to_copy = 0;
+    int               ret;
+
+    while (1) {
+        if (fq_log_open_seg(fq, *seq, &file, FS_O_READ)) {
+            return -ENOMSG;
+        }
+        if (*off < sizeof(struct fq_seg_hdr)) {
+            *off = sizeof(struct fq_seg_hdr);
+        }
+        if (fq_log_rec_hdr(&file, *off, &rec)) {
+            fs_close(&file);
+            // nothing more in this segment, move on if the writer already has
+            if (fq_log_seg_valid(fq, *seq + 1)) {
+                (*seq)++;
+                *off = 0;
+                continue;
+            }
+            return -ENOMSG;
+        }
+        uint32_t crc;
+        if (buf == NULL) {
+            // only skipping over it, but the crc is still checked so a skip
+            // steps over the same records a read does
+            ret = fq_log_rec_crc(&file, rec.len, &crc);
+            fs_close(&file);
+            if (ret) {
+                LOG_ERR("Failed to read fq record in %s [%d]", fq->dirname, ret);
+                return ret;
+            }
+        } else {
+            to_copy = MIN(rec.len, *size);
+            ret     = fs_read(&file, buf, to_copy);
+            fs_close(&file);
+            if (ret != (int)to_copy) {
+                LOG_ERR("Failed to read fq record in %s [%d]", fq->dirname, ret);
+                return ret < 0 ? ret : -EIO;
+            }
+            if (to_copy < rec.len) {
+                LOG_WRN("fq record truncated from %d to %zu bytes", rec.len, to_copy);
+                break;
+            }
+            crc = crc32_ieee(buf, rec.len);
+        }
+        if (crc == rec.crc) {
+            break;
+        }
+        LOG_ERR("Skipping corrupt fq record in %s at %u/%u", fq->dirname, *seq, *off);
+        *off += sizeof(rec) + rec.len;
+    }
+
+    if (size) {
+        *size = to_copy;
+    }
+    *off += sizeof(rec) + rec.len;
+    return 0;
+}
+
+int fq_log_read(fqueue_t *fq, void *buf, size_t *size, bool do_remove)
+{
+    uint32_t seq = fq->cur_idx;
+    uint32_t off = fq->cur_off;
+    int      ret = fq_log_read_at(fq, &seq, &off, buf, size);
+
+    if (ret == 0 && do_remove) {
+        ret = fq_log_commit(fq, seq, off);
+    }
+    return ret;
+}
+
+int fq_log_commit(fqueue_t *fq, uint32_t seq, uint32_t off)
+{
+    fq->cur_idx = seq;
+    fq->cur_off = off;
+    return fq_log_save_cursor(fq, "head", seq, off);
+}
+
+int fq_log_load_head(const fqueue_t *fq, uint32_t *seq, uint32_t *off)
+{
+    struct fq_cursor head;
+
+    if (fq_log_load_cursor(fq, "head", &head) == 0) {
+        *seq = head.seq;
+        *off = head.off;
+    } else {
+        *seq = fq_log_oldest_seq(fq);
+        *off = 0;
+    }
+    return 0;
+}
+
+int fq_log_rescan(fqueue_t *fq)
+{
+    return fq_log_load_head(fq, &fq->cur_idx, &fq->cur_off);
+}
+
+// queues written before CONFIG_FQUEUE_APPEND_LOG hold one file per entry, named by index
+static bool fq_log_is_legacy_name(const char *name)
+{
+    if (*name == 0) {
+        return false;
+    }
+    for (; *name; name++) {
+        if (*name < '0' || *name > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * append any one-file-per-entry items, oldest first, and remove them
+ */
+static int fq_log_migrate(fqueue_t *fq)
+{
+    static uint8_t          buf[FQ_MAX_RECORD];    // a legacy entry fits in one record or not at all
+    static struct fs_dirent entry;
+    struct fs_dir_t         dirp;
+    int                     first    = INT_MAX;
+    int                     last     = -1;
+    int                     migrated = 0;
+    int                     ret;
+
+    fs_dir_t_init(&dirp);
+    if ((ret = fs_opendir(&dirp, fq->dirname))) {
+        return ret;
+    }
+    while (fs_readdir(&dirp, &entry) == 0 && entry.name[0] != 0) {
+        if (entry.type != FS_DIR_ENTRY_DIR && fq_log_is_legacy_name(entry.name)) {
+            int current = strtol(entry.name, NULL, 10);
+            first       = MIN(first, current);
+            last        = MAX(last, current);
+        }
+    }
+    fs_closedir(&dirp);
+    if (last < 0) {
+        return 0;
+    }
+
+    LOG_WRN("Migrating %s entries %d..%d to the append log", fq->dirname, first, last);
+    for (int idx = first; idx <= last; idx++) {
+        char             fname[FQ_PATH_MAX];
+        struct fs_file_t file;
+
+        snprintf(fname, sizeof(fname), "%s/%03d", fq->dirname, idx);
+        if (fs_stat(fname, &entry)) {
+            continue;
+        }
+        if (entry.size > 0 && entry.size <= sizeof(buf)) {
+            fs_file_t_init(&file);
+            if ((ret = fs_open(&file, fname, FS_O_READ)) == 0) {
+                ret = fs_read(&file, buf, entry.size);
+                fs_close(&file);
+                if (ret >= 0) {
+                    ret = ret == (int)entry.size ? fq_log_put(fq, buf, entry.size) : -EIO;
+                }
+            }
+            if (ret != 0) {
+                // keep it and everything after it for the next time the queue is opened
+                LOG_ERR("Unable to migrate %s, stopping [%d]", fname, ret);
+                break;
+            }
+            migrated++;
+        } else if (entry.size > sizeof(buf)) {
+            LOG_ERR("Dropping %s, too big to migrate (%zu bytes)", fname, entry.size);
+        }
+        fs_unlink(fname);
+    }
+    LOG_WRN("Migrated %d entries", migrated);
+    return 0;
+}
+
+static int fq_log_init_writer(fqueue_t *fq)
+{
+    struct fq_cursor cursor;
+    bool             has_head = fq_log_load_cursor(fq, "head", &cursor) == 0;
+    uint32_t         head_seq = has_head ? cursor.seq : fq_log_oldest_seq(fq);
+    uint32_t         seq      = head_seq;
+    int              ret;
+
+    if (fq_log_load_cursor(fq, "tail", &cursor) == 0) {
+        seq = cursor.seq;
+    }
+    // a reset between starting a segment and saving the tail leaves newer segments behind
+    while (fq_log_seg_valid(fq, seq + 1)) {
+        seq++;
+    }
+    if (!has_head) {
+        // the writer needs a head to know when the ring is full
+        fq_log_save_cursor(fq, "head", head_seq, 0);
+    }
+    ret = fq_log_recover_tail(fq, seq);
+    if (ret == 0) {
+        ret = fq_log_migrate(fq);
+    }
+    return ret;
+}
+
+int fq_log_init(fqueue_t *fq)
+{
+    struct fs_dir_t dirp;
+    int             ret;
+
+    fs_dir_t_init(&dirp);
+    ret = fs_opendir(&dirp, fq->dirname);
+    if (ret == 0) {
+        fs_closedir(&dirp);
+    } else if (fq->mode == FQ_WRITE) {
+        ret = fs_mkdir(fq->dirname);
+    }
+    if (ret) {
+        LOG_ERR("Unable to initialize in %s: %d", fq->dirname, ret);
+        return ret;
+    }
+
+    if (fq->mode == FQ_WRITE) {
+        return fq_log_init_writer(fq);
+    }
+    return fq_log_rescan(fq);
+}
@@ -19,6 +19,12 @@ typedef enum
     IMU_ODR_MAX_HZ,
 } output_data_rate_t;
 
+typedef enum
+{
+    IMU_UNITS_SI,       // m/s^2 and rad/s
+    IMU_UNITS_G_DPS,    // g and deg/s
+} imu_units_t;
+
 typedef struct
 {
     float    ax, ay, az;    // accelerometer
@@ -27,16 +33,28 @@ typedef struct
     uint32_t sample_count;
 } imu_sample_t;
 
-// the following is actually defined in lsm6dsv16x.h in the d1 driver
-// but redefine here for now
+#ifdef CONFIG_LSM6DSV16X_D1
+#include <drivers/sensor/lsm6dsv16x_d1.h>
+#else
+// the following is defined in lsm6dsv16x_d1.h for the d1 driver
 #define SENSOR_ATTR_SLEEP_STATE (SENSOR_ATTR_PRIV_START + 1)
+#endif
 
+// largest number of samples delivered in one batch callback
+#define IMU_MAX_BATCH (32)
 
 typedef int (*imu_output_cb_t)(imu_sample_t output, bool is_sleeping);
+// called once per wake-up with count (<= IMU_MAX_BATCH) consecutive samples, oldest first
+typedef int (*imu_batch_cb_t)(const imu_sample_t *samples, size_t count, bool is_sleeping);
+// called on every sleep / wake transition reported by motion detection
+typedef void (*imu_sleep_cb_t)(bool is_sleeping);
 
 int   imu_init(bool use_motion_detect);
 int   imu_enable(output_data_rate_t rate, imu_output_cb_t callback);
+int   imu_enable_batch(output_data_rate_t rate, size_t batch_size, imu_batch_cb_t callback);
 int   imu_enable_significant_motion(sensor_trigger_handler_t cb);
+int   imu_set_power_governor(imu_sleep_cb_t cb, uint32_t warmup_samples);
+int   imu_set_units(imu_units_t units);
 int   imu_set_threshold(uint32_t ths);
 int   imu_set_duration(uint32_t dur);
 int   imu_get_trigger_count(void);
@@ -3,6 +3,7 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
+#include <zephyr/timing/timing.h>
 #include <stdio.h>
 
 LOG_MODULE_REGISTER(imu, LOG_LEVEL_DBG);
@@ -21,19 +22,215 @@ LOG_MODULE_REGISTER(imu, LOG_LEVEL_DBG);
 
 #define ACCEL_ON (7)
 
-static imu_output_cb_t callback;    // callback for sampled data
-const struct device   *imu = DEVICE_DT_GET(DT_ALIAS(imu));
-static int             trig_cnt;
-static bool            verbose;
-static bool            is_asleep;
-static int  imu_sampling(void);
-static void motion_cb(const struct device *dev, const struct sensor_trigger *trig);
+static imu_output_cb_t    callback;          // callback for sampled data
+static imu_batch_cb_t     batch_callback;    // callback for batches of sampled data
+const struct device      *imu = DEVICE_DT_GET(DT_ALIAS(imu));
+static int                trig_cnt;
+static bool               verbose;
+static bool               is_asleep;
+static output_data_rate_t cur_rate;
+static imu_units_t        cur_units;
+static size_t             cur_batch;         // FIFO watermark, 0 for one interrupt per sample
+static imu_sleep_cb_t     sleep_callback;    // set when the power governor is on
+static uint32_t           warmup_samples;    // samples dropped after every wake-up
+static uint32_t           warmup_left;
+static int                imu_sampling(void);
+static int                imu_set_batching(size_t batch_size);
+static void               motion_cb(const struct device *dev, const struct sensor_trigger *trig);
+static void               imu_set_sleeping(bool sleeping);
+
+static const struct sensor_trigger drdy_trig = {
+    .type = SENSOR_TRIG_DATA_READY,
+    .chan = SENSOR_CHAN_ACCEL_XYZ,
+};
 
 static void trigger_handler(const struct device *dev, const struct sensor_trigger *trig)
 {
     imu_sampling();
 }
 
+/*
+ * The hot path keeps samples as raw counts. They are scaled to floats exactly once, in
+ * imu_convert(), and only rendered as text when verbose tracing is on.  The scale folds the
+ * sensitivity and the unit conversion into one multiply per axis, so asking for g and dps
+ * costs nothing over SI units.
+ */
+#ifdef CONFIG_LSM6DSV16X_D1
+static void imu_convert(const struct lsm6dsv16x_frame *frames, imu_sample_t *samples, size_t count)
+{
+    uint32_t acc_ug, gyro_udps;
+    uint64_t now = utils_get_currentmillis();
+    float    acc_scale, gyro_scale;
+
+    lsm6dsv16x_sensitivity_get(imu, &acc_ug, &gyro_udps);
+    if (cur_units == IMU_UNITS_G_DPS) {
+        acc_scale  = acc_ug / 1000000.0f;       // counts -> g
+        gyro_scale = gyro_udps / 1000000.0f;    // counts -> deg/s
+    } else {
+        acc_scale  = acc_ug * (SENSOR_G / 1000000.0f) / 1000000.0f;                // counts -> m/s^2
+        gyro_scale = gyro_udps * (SENSOR_PI / 1000000.0f) / 180.0f / 1000000.0f;    // counts -> rad/s
+    }
+    // the chip doesn't timestamp samples, so work back from now at the configured rate
+    const uint32_t period_us = 1000000 / MAX(cur_rate, 1);
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i].ax           = frames[i].acc[0] * acc_scale;
+        samples[i].ay           = frames[i].acc[1] * acc_scale;
+        samples[i].az           = frames[i].acc[2] * acc_scale;
+        samples[i].gx           = frames[i].gyro[0] * gyro_scale;
+        samples[i].gy           = frames[i].gyro[1] * gyro_scale;
+        samples[i].gz           = frames[i].gyro[2] * gyro_scale;
+        samples[i].timestamp    = now - (uint64_t)(count - 1 - i) * period_us / 1000;
+        samples[i].sample_count = trig_cnt + i;
+    }
+    trig_cnt += count;
+}
+
+static int imu_read(imu_sample_t *sample)
+{
+    struct lsm6dsv16x_frame frame;
+
+    int ret = lsm6dsv16x_sample_read(imu, &frame);
+    if (ret == 0) {
+        imu_convert(&frame, sample, 1);
+    }
+    return ret;
+}
+#else
+// single precision, the sensor only has 16 bits anyway
+static inline float imu_value(const struct sensor_value *val, float scale)
+{
+    return (val->val1 + val->val2 * 0.000001f) * scale;
+}
+
+static int imu_read(imu_sample_t *sample)
+{
+    struct sensor_value acc[3], gyro[3];
+
+    sensor_sample_fetch_chan(imu, SENSOR_CHAN_ACCEL_XYZ);
+    sensor_sample_fetch_chan(imu, SENSOR_CHAN_GYRO_XYZ);
+    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_XYZ, acc);
+    sensor_channel_get(imu, SENSOR_CHAN_GYRO_XYZ, gyro);
+
+    const float acc_scale  = cur_units == IMU_UNITS_G_DPS ? 1000000.0f / SENSOR_G : 1.0f;
+    const float gyro_scale = cur_units == IMU_UNITS_G_DPS ? 180000000.0f / SENSOR_PI : 1.0f;
+
+    sample->ax           = imu_value(&acc[0], acc_scale);
+    sample->ay           = imu_value(&acc[1], acc_scale);
+    sample->az           = imu_value(&acc[2], acc_scale);
+    sample->gx           = imu_value(&gyro[0], gyro_scale);
+    sample->gy           = imu_value(&gyro[1], gyro_scale);
+    sample->gz           = imu_value(&gyro[2], gyro_scale);
+    sample->timestamp    = utils_get_currentmillis();
+    sample->sample_count = trig_cnt++;
+    return 0;
+}
+#endif
+
+static void imu_trace(const imu_sample_t *samples, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        LOG_DBG(
+            "%08llu,%f,%f,%f,%f,%f,%f",
+            samples[i].timestamp,
+            (double)samples[i].ax,
+            (double)samples[i].ay,
+            (double)samples[i].az,
+            (double)samples[i].gx,
+            (double)samples[i].gy,
+            (double)samples[i].gz);
+    }
+}
+
+static void imu_dispatch(const imu_sample_t *samples, size_t count)
+{
+    if (warmup_left > 0) {
+        // the gyro is still settling after power up
+        size_t skip = MIN(warmup_left, count);
+        warmup_left -= skip;
+        samples += skip;
+        count -= skip;
+        if (count == 0) {
+            return;
+        }
+    }
+    if (verbose) {
+        imu_trace(samples, count);
+    }
+    if (callback != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            callback(samples[i], is_asleep);
+        }
+    }
+    if (batch_callback != NULL) {
+        batch_callback(samples, count, is_asleep);
+    }
+}
+
+#ifdef CONFIG_LSM6DSV16X_D1_FIFO
+static const struct sensor_trigger fifo_trig = {
+    .type = SENSOR_TRIG_FIFO_WTM,
+    .chan = SENSOR_CHAN_ACCEL_XYZ,
+};
+
+/*
+ * Drain the IMU FIFO and hand all samples to the batch callback in one go.
+ */
+static int imu_fifo_sampling(void)
+{
+    static struct lsm6dsv16x_frame frames[IMU_MAX_BATCH];
+    static imu_sample_t            samples[IMU_MAX_BATCH];
+
+    int count = lsm6dsv16x_fifo_read(imu, frames, ARRAY_SIZE(frames));
+    if (count <= 0) {
+        return count;
+    }
+    imu_convert(frames, samples, count);
+    imu_dispatch(samples, count);
+    return 0;
+}
+
+static void fifo_trigger_handler(const struct device *dev, const struct sensor_trigger *trig)
+{
+    imu_fifo_sampling();
+}
+#endif
+
+/*
+ * Switch between one interrupt per sample (batch_size 0) and FIFO watermark interrupts
+ */
+static int imu_set_batching(size_t batch_size)
+{
+    cur_batch = batch_size;
+#ifdef CONFIG_LSM6DSV16X_D1_FIFO
+    int ret;
+
+    if (batch_size > 0) {
+        struct sensor_value wtm = { .val1 = batch_size, .val2 = 0 };
+
+        ret = sensor_attr_set(imu, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_FIFO_WATERMARK, &wtm);
+        if (ret == 0) {
+            ret = sensor_trigger_set(imu, &drdy_trig, NULL);
+        }
+        if (ret == 0) {
+            ret = sensor_trigger_set(imu, &fifo_trig, fifo_trigger_handler);
+        }
+    } else {
+        ret = sensor_trigger_set(imu, &fifo_trig, NULL);
+        if (ret == 0) {
+            ret = sensor_trigger_set(imu, &drdy_trig, trigger_handler);
+        }
+    }
+    if (ret != 0) {
+        LOG_ERR("Cannot %s FIFO batching, ret=%d", batch_size ? "enable" : "disable", ret);
+    }
+    return ret;
+#else
+    // no FIFO, batches are delivered one sample at a time from the data ready interrupt
+    return 0;
+#endif
+}
+
 int imu_enable_significant_motion(sensor_trigger_handler_t cb)
 {
     struct sensor_trigger trig;
@@ -41,9 +238,8 @@ int imu_enable_significant_motion(sensor_trigger_handler_t cb)
     trig.type = SENSOR_TRIG_MOTION;
     trig.chan = SENSOR_CHAN_ACCEL_XYZ;
     LOG_ERR("%s significant motion", cb ? "Enable" : "Disable");
-    if (cb) {
-        is_asleep = false;
-    }
+    // with detection off nothing would report the wake-up either
+    imu_set_sleeping(false);
     return sensor_trigger_set(imu, &trig, cb);
 }
 
@@ -64,10 +260,7 @@ int imu_init(bool use_mot_det)
     }
     */
 
-    struct sensor_trigger trig;
-    trig.type = SENSOR_TRIG_DATA_READY;
-    trig.chan = SENSOR_CHAN_ACCEL_XYZ;
-    sensor_trigger_set(imu, &trig, trigger_handler);
+    sensor_trigger_set(imu, &drdy_trig, trigger_handler);
     if( use_mot_det){
         /* setup activity / inactivity */
         imu_enable_significant_motion(motion_cb);
@@ -77,66 +270,27 @@ int imu_init(bool use_mot_det)
     return 0;
 }
 
-// TODO: are we using a FIFO?
 static int imu_sampling(void)
 {
-    struct sensor_value x, y, z;
-    struct sensor_value gx, gy, gz;
-    static char         string[100];
+    imu_sample_t sample;
 
-    /* LSM6DSV accel */
-    sensor_sample_fetch_chan(imu, SENSOR_CHAN_ACCEL_XYZ);
-    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_X, &x);
-    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_Y, &y);
-    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_Z, &z);
-    int count = sprintf(
-        string,
-        "%08d,%f,%f,%f,",
-        k_uptime_get_32(),
-        sensor_value_to_double(&x),
-        sensor_value_to_double(&y),
-        sensor_value_to_double(&z));
-
-    /* LSM6DSV gyro */
-    sensor_sample_fetch_chan(imu, SENSOR_CHAN_GYRO_XYZ);
-    sensor_channel_get(imu, SENSOR_CHAN_GYRO_X, &gx);
-    sensor_channel_get(imu, SENSOR_CHAN_GYRO_Y, &gy);
-    sensor_channel_get(imu, SENSOR_CHAN_GYRO_Z, &gz);
-    sprintf(
-        &string[count], "%f,%f,%f", sensor_value_to_double(&gx), sensor_value_to_double(&gy), sensor_value_to_double(&gz));
-    if (verbose) {
-        LOG_DBG("%s", string);
+    int ret = imu_read(&sample);
+    if (ret == 0) {
+        imu_dispatch(&sample, 1);
     }
-
-    imu_sample_t sample = { 0 };
-    sample.timestamp    = utils_get_currentmillis();
-    sample.sample_count = trig_cnt;
-    sample.ax           = sensor_value_to_double(&x);
-    sample.ay           = sensor_value_to_double(&y);
-    sample.az           = sensor_value_to_double(&z);
-    sample.gx           = sensor_value_to_double(&gx);
-    sample.gy           = sensor_value_to_double(&gy);
-    sample.gz           = sensor_value_to_double(&gz);
-
-    if (callback != NULL) {
-        callback(sample, is_asleep);
-    }
-
-    trig_cnt++;
-    return 0;
+    return ret;
 }
 
-/* Enable IMU with sampling freq; 0 to disable */
-int imu_enable(output_data_rate_t rate, imu_output_cb_t cb)
+static int imu_set_rate(output_data_rate_t rate)
 {
-    int                   ret = 0;
-    struct sensor_trigger trig;
-    struct sensor_value   odr_attr;
+    int                 ret = 0;
+    struct sensor_value odr_attr;
 
     switch (rate) {
     case IMU_ODR_0_HZ:
-        // don't clear trig_cnt when stopping, clear callback
-        callback = NULL;
+        // don't clear trig_cnt when stopping, clear callbacks
+        callback       = NULL;
+        batch_callback = NULL;
         break;
     case IMU_ODR_15_HZ:
     case IMU_ODR_30_HZ:
@@ -157,9 +311,6 @@ int imu_enable(output_data_rate_t rate, imu_output_cb_t cb)
 
     LOG_DBG("setting output data rate to %d", rate);
 
-    trig.type = SENSOR_TRIG_DATA_READY;
-    trig.chan = SENSOR_CHAN_ACCEL_XYZ;
-
     odr_attr.val1 = rate;
     odr_attr.val2 = 0;    // fractional part
 
@@ -176,12 +327,117 @@ int imu_enable(output_data_rate_t rate, imu_output_cb_t cb)
         LOG_ERR("Cannot set output data rate for gyro, ret=%d", ret);
         return ret;
     }
+    cur_rate = rate;
+
+    return 0;
+}
+
+/* Enable IMU with sampling freq; 0 to disable */
+int imu_enable(output_data_rate_t rate, imu_output_cb_t cb)
+{
+    int ret = imu_set_rate(rate);
+    if (ret != 0) {
+        return ret;
+    }
+    batch_callback = NULL;
+    ret            = imu_set_batching(0);
+    if (ret != 0) {
+        return ret;
+    }
 
     callback = cb;
 
     return 0;
 }
 
+/*
+ * Enable IMU with sampling freq; 0 to disable.  Samples are collected in the IMU FIFO and
+ * delivered batch_size at a time, which saves a wake-up and bus transfers per sample.
+ */
+int imu_enable_batch(output_data_rate_t rate, size_t batch_size, imu_batch_cb_t cb)
+{
+    if (batch_size == 0 || batch_size > IMU_MAX_BATCH) {
+        LOG_ERR("invalid batch size: %zu", batch_size);
+        return -EINVAL;
+    }
+    int ret = imu_set_rate(rate);
+    if (ret != 0) {
+        return ret;
+    }
+    callback = NULL;
+    ret      = imu_set_batching(rate == IMU_ODR_0_HZ ? 0 : batch_size);
+    if (ret != 0) {
+        return ret;
+    }
+
+    batch_callback = rate == IMU_ODR_0_HZ ? NULL : cb;
+
+    return 0;
+}
+
+/*
+ * The activity engine already drops the accelerometer to 1.875Hz and powers the gyro down
+ * while the pet is still, but samples keep flowing to the host.  With the governor on, the
+ * gyro is held in sleep, the accelerometer runs in low power mode and no data interrupts
+ * are raised at all until the chip reports motion again.
+ */
+static void imu_governor_sleep(void)
+{
+    struct sensor_value mode = { .val1 = 4, .val2 = 0 };    // gyro sleep
+
+    sensor_attr_set(imu, SENSOR_CHAN_GYRO_XYZ, SENSOR_ATTR_CONFIGURATION, &mode);
+    mode.val1 = 6;    // accel low power, 8 sample average
+    sensor_attr_set(imu, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_CONFIGURATION, &mode);
+#ifdef CONFIG_LSM6DSV16X_D1_FIFO
+    sensor_trigger_set(imu, &fifo_trig, NULL);
+#endif
+    sensor_trigger_set(imu, &drdy_trig, NULL);
+    warmup_left = 0;
+}
+
+static void imu_governor_wake(void)
+{
+    struct sensor_value mode = { .val1 = 0, .val2 = 0 };    // high performance
+
+    sensor_attr_set(imu, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_CONFIGURATION, &mode);
+    sensor_attr_set(imu, SENSOR_CHAN_GYRO_XYZ, SENSOR_ATTR_CONFIGURATION, &mode);
+    warmup_left = warmup_samples;
+    imu_set_batching(cur_batch);
+}
+
+static void imu_set_sleeping(bool sleeping)
+{
+    if (sleeping == is_asleep) {
+        return;
+    }
+    is_asleep = sleeping;
+    if (sleep_callback == NULL || cur_rate == IMU_ODR_0_HZ) {
+        return;
+    }
+    if (sleeping) {
+        imu_governor_sleep();
+    } else {
+        imu_governor_wake();
+    }
+    sleep_callback(sleeping);
+}
+
+/*
+ * Turn the power governor on (cb != NULL) or off.  cb is called from the IMU interrupt
+ * thread on every sleep / wake transition; after a wake-up the first warmup samples are
+ * dropped while the gyro settles.
+ */
+int imu_set_power_governor(imu_sleep_cb_t cb, uint32_t warmup)
+{
+    if (cb == NULL && sleep_callback != NULL && is_asleep && cur_rate != IMU_ODR_0_HZ) {
+        // don't leave the sensors parked
+        imu_governor_wake();
+    }
+    warmup_samples = warmup;
+    sleep_callback = cb;
+    return 0;
+}
+
 static void motion_cb(const struct device *dev, const struct sensor_trigger *trig)
 {
     struct sensor_value sleep_state;
@@ -189,7 +445,17 @@ static void motion_cb(const struct device *dev, const struct sensor_trigger *tri
 
     sensor_attr_get(dev, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SLEEP_STATE, &sleep_state);
     LOG_WRN("Now %s", sleep_state.val1 ? "Sleeping" : "Awake");
-    is_asleep = sleep_state.val1;
+    imu_set_sleeping(sleep_state.val1 != 0);
+}
+
+/* Units of the samples handed to the callbacks, SI (the default) or g and deg/s */
+int imu_set_units(imu_units_t units)
+{
+    if (units != IMU_UNITS_SI && units != IMU_UNITS_G_DPS) {
+        return -EINVAL;
+    }
+    cur_units = units;
+    return 0;
 }
 
 int imu_get_trigger_count(void)
@@ -220,6 +486,14 @@ static int print_samples_cb(imu_sample_t data, bool is_sleeping)
 
     return 0;
 }
+static int print_batch_cb(const imu_sample_t *samples, size_t count, bool is_sleeping)
+{
+    for (size_t i = 0; i < count; i++) {
+        print_samples_cb(samples[i], is_sleeping);
+    }
+    return 0;
+}
+
 enum test_mode_e
 {
     TEST_MODE_NONE,
@@ -363,6 +637,18 @@ int imu_get_duration(uint32_t *dur)
     return 0;
 }
 
+static int imu_batch_shell(const struct shell *sh, size_t argc, char **argv)
+{
+    size_t batch_size = 15;
+
+    if (argc > 1) {
+        batch_size = strtoul(argv[1], NULL, 10);
+    }
+    shell_fprintf(sh, SHELL_NORMAL, "starting IMU, %zu samples per batch...\r\n", batch_size);
+    imu_enable_significant_motion(motion_cb);
+    return imu_enable_batch(IMU_ODR_15_HZ, batch_size, print_batch_cb);
+}
+
 static int imu_stop_shell(const struct shell *sh, size_t argc, char **argv)
 {
     imu_enable(0, NULL);
@@ -424,6 +710,102 @@ static int imu_read_sample(const struct shell *sh, size_t argc, char **argv)
     return 0;
 }
 
+#ifdef CONFIG_TIMING_FUNCTIONS
+// the original sampling path (per-channel fetch/get, text rendered on every sample), kept
+// only as the baseline for imu bench
+static void imu_bench_legacy(imu_sample_t *sample)
+{
+    struct sensor_value x, y, z;
+    struct sensor_value gx, gy, gz;
+    static char         string[100];
+
+    sensor_sample_fetch_chan(imu, SENSOR_CHAN_ACCEL_XYZ);
+    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_X, &x);
+    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_Y, &y);
+    sensor_channel_get(imu, SENSOR_CHAN_ACCEL_Z, &z);
+    int count = sprintf(
+        string,
+        "%08d,%f,%f,%f,",
+        k_uptime_get_32(),
+        sensor_value_to_double(&x),
+        sensor_value_to_double(&y),
+        sensor_value_to_double(&z));
+
+    sensor_sample_fetch_chan(imu, SENSOR_CHAN_GYRO_XYZ);
+    sensor_channel_get(imu, SENSOR_CHAN_GYRO_X, &gx);
+    sensor_channel_get(imu, SENSOR_CHAN_GYRO_Y, &gy);
+    sensor_channel_get(imu, SENSOR_CHAN_GYRO_Z, &gz);
+    sprintf(
+        &string[count], "%f,%f,%f", sensor_value_to_double(&gx), sensor_value_to_double(&gy), sensor_value_to_double(&gz));
+
+    sample->timestamp    = utils_get_currentmillis();
+    sample->sample_count = trig_cnt;
+    sample->ax           = sensor_value_to_double(&x);
+    sample->ay           = sensor_value_to_double(&y);
+    sample->az           = sensor_value_to_double(&z);
+    sample->gx           = sensor_value_to_double(&gx);
+    sample->gy           = sensor_value_to_double(&gy);
+    sample->gz           = sensor_value_to_double(&gz);
+}
+
+static int imu_bench_shell(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t     iterations = 100;
+    uint64_t     legacy     = 0;
+    uint64_t     raw        = 0;
+    int          saved_cnt  = trig_cnt;
+    timing_t     start, end;
+    imu_sample_t sample;
+
+    if (callback != NULL || batch_callback != NULL) {
+        shell_error(sh, "stop the IMU first");
+        return -EBUSY;
+    }
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+    }
+    if (iterations == 0) {
+        shell_error(sh, "usage: imu bench [iterations]");
+        return -EINVAL;
+    }
+
+    timing_init();
+    timing_start();
+    for (uint32_t i = 0; i < iterations; i++) {
+        start = timing_counter_get();
+        imu_bench_legacy(&sample);
+        end = timing_counter_get();
+        legacy += timing_cycles_get(&start, &end);
+
+        start = timing_counter_get();
+        imu_read(&sample);
+        end = timing_counter_get();
+        raw += timing_cycles_get(&start, &end);
+    }
+#ifdef CONFIG_LSM6DSV16X_D1
+    // conversion alone, without the bus transfer
+    struct lsm6dsv16x_frame frames[IMU_MAX_BATCH] = { 0 };
+    static imu_sample_t     samples[IMU_MAX_BATCH];
+
+    start = timing_counter_get();
+    imu_convert(frames, samples, ARRAY_SIZE(frames));
+    end              = timing_counter_get();
+    uint64_t convert = timing_cycles_get(&start, &end) / ARRAY_SIZE(frames);
+#endif
+    timing_stop();
+    trig_cnt = saved_cnt;
+
+    legacy /= iterations;
+    raw /= iterations;
+    shell_print(sh, "legacy: %llu cycles/sample (%llu ns)", legacy, timing_cycles_to_ns(legacy));
+    shell_print(sh, "raw:    %llu cycles/sample (%llu ns)", raw, timing_cycles_to_ns(raw));
+#ifdef CONFIG_LSM6DSV16X_D1
+    shell_print(sh, "convert: %llu cycles/sample (%llu ns)", convert, timing_cycles_to_ns(convert));
+#endif
+    return 0;
+}
+#endif
+
 #ifdef CONFIG_LSM6DSV16X_D1_ENABLE_TEMP
 static int imu_temp_shell(const struct shell *sh, size_t argc, char **argv)
 {
@@ -459,12 +841,16 @@ SYS_INIT(board_init, PRE_KERNEL_1, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
 SHELL_STATIC_SUBCMD_SET_CREATE(
     sub_imu,
     SHELL_CMD(start, NULL, "start IMU at 15Hz, print to console", imu_start_shell),
+    SHELL_CMD(batch, NULL, "start IMU at 15Hz in batches of [n] samples, print to console", imu_batch_shell),
     SHELL_CMD(stop, NULL, "stop IMU", imu_stop_shell),
     SHELL_CMD(dur, NULL, "set sleep duration", imu_dur_shell),
     SHELL_CMD(ths, NULL, "set sleep threshold", imu_ths_shell),
     SHELL_CMD(read, NULL, "stop IMU", imu_read_sample),
     SHELL_CMD(sigmot, NULL, "Turn on/off significant motion detection", imu_sigmot_shell),
     SHELL_CMD(stats, NULL, "Print number of IMU interrupts", imu_stats_shell),
+#ifdef CONFIG_TIMING_FUNCTIONS
+    SHELL_CMD(bench, NULL, "Cycles per sample, legacy vs raw pipeline [iterations]", imu_bench_shell),
+#endif
 #ifdef CONFIG_LSM6DSV16X_D1_ENABLE_TEMP
     SHELL_CMD(temp, NULL, "Read the temperature from the IMU", imu_temp_shell),
 #endif
@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <zephyr/kernel.h>
 #include <cJSON.h>
+#include "tele_writer.h"
 #include "pmic.h"
 
 #define MAX_WIFI_OBJS   32
@@ -35,12 +36,16 @@ typedef enum
 } mqtt_message_type_t;
 
 #define TELEMETRY_PROTOCOL_VERSION      (5)
+#define TELEMETRY_CBOR_PROTOCOL_VERSION (6)    // same content as 5, base64 encoded CBOR
 #define ONBOARDING_PROTOCOL_VERSION     (5)
 #define CONNECTIVITY_PROTOCOL_VERSION   (2)
 #define REALTIME_PROTOCOL_VERSION       (1)
 #define SHADOW_PROTOCOL_VERSION         (1)
 #define FOTA_LIFECYCLE_PROTOCOL_VERSION (2)
 
+#define TELEMETRY_SUB_TYPE            (4)
+#define TELEMETRY_ML_COLUMNS_SUB_TYPE (5)    // "ML" activity as columns, see ml_get_json_list()
+
 #define PAIRING_SUB_TYPE       (2)
 #define SAFE_ZONE_SUB_TYPE     (12)
 #define WHERES_MY_DOG_SUB_TYPE (22)
@@ -97,6 +102,9 @@ typedef struct
     uint32_t gps_poll_period;
     // def: 0 How often to get gps updates, 0 is off
 
+    uint8_t tele_proto;
+    // def: TELEMETRY_PROTOCOL_VERSION The telemetry "P" version the cloud accepts
+
     shadow_zone_t zones[NUM_ZONES];
 } shadow_doc_t;
 
@@ -254,6 +262,8 @@ const char *comm_dev_str(comm_device_type_t device);
 // json_telemetry()
 // Create a JSON message for the telemetry
 //
+// @param replyJson: set to the message
+// @param replyLen: set to the length of the message
 // @param MID: Machine ID
 // @param data: wifi ssid info
 // @param batt_soc: state of charge
@@ -264,10 +274,11 @@ const char *comm_dev_str(comm_device_type_t device);
 // @param ap_name: name of the access point
 // @param ap_is_safe: is the access point safe
 //
-// @return: char * to json or null on error
+// @return: 0 on success, <0 on error, >0 if more data to send
 ///////////////////////////////////////////////////
 int json_telemetry(
     char            **replyJson,
+    size_t           *replyLen,
     char             *MID,
     fuel_gauge_info_t batt_info,
     bool              charging,
@@ -280,6 +291,52 @@ int json_telemetry(
     int               chunk_num,
     int               rssi);
 
+///////////////////////////////////////////////////
+// json_telemetry_hold()
+// Call when the last json_telemetry() message has been queued. Its
+// queued data (ML records) is skipped by the following messages, but
+// stays on flash until json_telemetry_commit(). Without this the next
+// message carries the same data again.
+//
+// @return: the number of ML records in the message
+///////////////////////////////////////////////////
+int json_telemetry_hold(void);
+
+///////////////////////////////////////////////////
+// json_telemetry_commit()
+// Remove the ML records of the oldest held message from flash, once it
+// has been sent. Held messages must be sent or committed in order.
+//
+// @param recs: what json_telemetry_hold() returned for that message
+//
+// @return: 0 on success, <0 on error
+///////////////////////////////////////////////////
+int json_telemetry_commit(int recs);
+
+///////////////////////////////////////////////////
+// json_telemetry_release()
+// Give back the ML records of the newest held message when it is
+// dropped without being sent. They stay on flash and the next message
+// carries them. Only the newest held message can be released.
+//
+// @param recs: what json_telemetry_hold() returned for that message
+//
+// @return: 0 on success, -EBUSY if a later message is built but not held yet
+///////////////////////////////////////////////////
+int json_telemetry_release(int recs);
+
+///////////////////////////////////////////////////
+// json_telemetry_set_protocol()
+// Select the telemetry wire format, as negotiated with
+// the cloud through the shadow "TP" value.
+// TELEMETRY_PROTOCOL_VERSION is JSON and
+// TELEMETRY_CBOR_PROTOCOL_VERSION is CBOR (needs
+// CONFIG_D1_JSON_TELEMETRY_CBOR)
+//
+// @return: 0 on success, -ENOTSUP for an unknown version
+///////////////////////////////////////////////////
+int json_telemetry_set_protocol(int version);
+
 ///////////////////////////////////////////////////
 // json_onboarding()
 // Create a JSON message for the onboarding msg
@@ -414,4 +471,4 @@ char *json_srf_nonce(char *MID, int nonce);
 
 int   json_parse_srf(char *str, srf_data_t *data);
 char *json_srf_response_message(char *rid, char *st, char *fres, uint64_t currTime);
-int   ml_get_json_list(cJSON *jsonObj, int16_t *remaining_space);
+int   ml_get_json_list(tele_writer_t *tw);
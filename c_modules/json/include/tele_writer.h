@@ -0,0 +1,92 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Streaming telemetry writer. Maps, arrays and values are emitted straight into the
+ * caller's buffer as either JSON text or CBOR, with no intermediate tree.
+ *
+ * The writer always keeps room to close every open map/array, so the output is well
+ * formed whenever a call fails. Each call either writes the whole item or nothing and
+ * returns -ENOMEM; use tw_mark()/tw_rewind() to add a group of items all or nothing.
+ */
+
+#define TW_MAX_DEPTH 8
+
+typedef enum
+{
+    TW_FORMAT_JSON,
+    TW_FORMAT_CBOR,
+} tw_format_t;
+
+typedef struct
+{
+    uint8_t    *buf;
+    size_t      size;                       // usable bytes (JSON keeps one more for the nul)
+    size_t      len;                        // bytes written so far
+    tw_format_t format;
+    uint8_t     depth;                      // open maps/arrays, each needs one byte to close
+    char        close[TW_MAX_DEPTH];        // JSON closing character for each open container
+    bool        first[TW_MAX_DEPTH + 1];    // nothing written yet in the container at this depth
+} tele_writer_t;
+
+typedef struct
+{
+    size_t  len;
+    uint8_t depth;
+    bool    first;
+} tw_mark_t;
+
+/**
+ * start writing into buf, which holds at most size bytes (including the nul for JSON)
+ */
+void tw_init(tele_writer_t *w, void *buf, size_t size, tw_format_t format);
+
+/**
+ * bytes still free, after leaving room to close everything that is open
+ */
+size_t tw_remaining(const tele_writer_t *w);
+
+/**
+ * remember the current position, so a group of items can be dropped again
+ */
+tw_mark_t tw_mark(const tele_writer_t *w);
+void      tw_rewind(tele_writer_t *w, tw_mark_t mark);
+
+/**
+ * hold back n bytes for something that has to be written later
+ * @returns         0 on success, -ENOMEM if there is not that much space left
+ */
+int  tw_reserve(tele_writer_t *w, size_t n);
+void tw_release(tele_writer_t *w, size_t n);
+
+/**
+ * open a map or array. key is the member name, or NULL inside an array or at the top
+ * @returns         0 on success, -ENOMEM if it does not fit
+ */
+int tw_map_begin(tele_writer_t *w, const char *key);
+int tw_array_begin(tele_writer_t *w, const char *key);
+
+/**
+ * close the innermost map or array (this never runs out of space)
+ */
+int tw_end(tele_writer_t *w);
+
+/**
+ * add a value. key is the member name, or NULL inside an array
+ * @returns         0 on success, -ENOMEM if it does not fit
+ */
+int tw_int(tele_writer_t *w, const char *key, int64_t value);
+int tw_double(tele_writer_t *w, const char *key, double value);
+int tw_bool(tele_writer_t *w, const char *key, bool value);
+int tw_str(tele_writer_t *w, const char *key, const char *value);
+
+/**
+ * close everything still open (and nul terminate JSON)
+ * @returns         length of the output in bytes, not counting the nul
+ */
+size_t tw_finish(tele_writer_t *w);
@@ -13,6 +13,7 @@
 #include "radioMgr.h"
 #include <zephyr/logging/log.h>
 #include "fqueue.h"
+#include "tele_writer.h"
 #include "imu.h"
 #include "ml.h"
 #include "ml_types.h"
@@ -39,8 +40,6 @@ LOG_MODULE_REGISTER(d1_json, CONFIG_D1_JSON_LOG_LEVEL);
 #define EV_FWR "0.8.1\0"
 #define EV_TZ  "Europe/Rome\0"
 
-#define ML_MINIMUM_ELEMENTS (8)
-
 #define json_schema_ver "1.4.0"
 
 // define C structs for every part of the final JSON message
@@ -186,11 +185,71 @@ int add_ssids_to_json(cJSON *parentObj, struct k_fifo *wifi_ssids_fifo, int16_t
     return 0;
 }
 
+// SSIDs for the streaming telemetry writer, see add_ssids_to_json()
+static int tw_add_ssids(tele_writer_t *tw, struct k_fifo *wifi_ssids_fifo)
+{
+    if (!wifi_ssids_fifo || k_fifo_is_empty(wifi_ssids_fifo)) {
+        return 0;
+    }
+
+    tw_mark_t start = tw_mark(tw);
+    int       added = 0;
+    if (tw_array_begin(tw, "SSIDS")) {
+        return 1;
+    }
+    while (!k_fifo_is_empty(wifi_ssids_fifo)) {
+        wifi_obj_t *data  = k_fifo_peek_head(wifi_ssids_fifo);
+        tw_mark_t   entry = tw_mark(tw);
+        if (tw_map_begin(tw, NULL) || tw_str(tw, "macAddress", data->macstr)
+            || tw_int(tw, "signalStrength", data->rssi) || tw_int(tw, "channel", data->channel)) {
+            tw_rewind(tw, entry);
+            break;
+        }
+        tw_end(tw);
+        k_fifo_get(wifi_ssids_fifo, K_NO_WAIT);    // pop the message off the fifo
+        added++;
+    }
+    if (added == 0) {
+        tw_rewind(tw, start);
+        return 1;
+    }
+    tw_end(tw);
+    LOG_DBG("Added %d SSIDs, remaining space: %zu", added, tw_remaining(tw));
+    return k_fifo_is_empty(wifi_ssids_fifo) ? 0 : 1;    // >0 if we need to continue on the next loop
+}
+
+#if defined(CONFIG_D1_JSON_TELEMETRY_CBOR)
+// CBOR telemetry is sent base64 encoded, the DA16200 only takes text payloads
+static uint8_t cbor_message_buffer[(CONFIG_MAX_MQTT_MSG_SIZE / 4) * 3];
+#endif
+static uint8_t telemetry_protocol = TELEMETRY_PROTOCOL_VERSION;
+
+///////////////////////////////////////////////////
+// json_telemetry_set_protocol()
+int json_telemetry_set_protocol(int version)
+{
+    switch (version) {
+    case TELEMETRY_PROTOCOL_VERSION:
+#if defined(CONFIG_D1_JSON_TELEMETRY_CBOR)
+    case TELEMETRY_CBOR_PROTOCOL_VERSION:
+#endif
+        if (telemetry_protocol != version) {
+            LOG_WRN("Telemetry protocol %d -> %d", telemetry_protocol, version);
+        }
+        telemetry_protocol = version;
+        return 0;
+    default:
+        LOG_ERR("Telemetry protocol %d not supported", version);
+        return -ENOTSUP;
+    }
+}
+
 ///////////////////////////////////////////////////
 // json_telemetry()
 // Create a JSON message for the telemetry
 //
 // @param replyJson: pointer to the json message
+// @param replyLen: length of the message
 // @param MID: Machine ID
 // @param data: wifi ssid info
 // @param batt_soc: state of charge
@@ -205,6 +264,7 @@ int add_ssids_to_json(cJSON *parentObj, struct k_fifo *wifi_ssids_fifo, int16_t
 ///////////////////////////////////////////////////
 int json_telemetry(
     char            **replyJson,
+    size_t           *replyLen,
     char             *MID,
     fuel_gauge_info_t batt_info,
     bool              charging,
@@ -222,138 +282,130 @@ int json_telemetry(
     if (midlen == 0 || midlen > MAX_MID_SIZE) {
         return -EINVAL;
     }
-    struct timespec tp;
-    clock_gettime(CLOCK_REALTIME, &tp);
-    cJSON_Init();
-
-    // change to loop until all data sub-objects report 0 for success or < 0 for error. positive
-    // returns are index/counts that will need to be passed back into the same function on the
-    // next loop to get the next batch of data. calls to each sub-object will contain this index
-    // (or zero at teh start) AND a length_remaining which tells the function how much space is
-    // left in the message buffer. This means the order of calling the sub-objects determines
-    // the order of the data in the final message(s).
+    if (radio_used == RADIO_TYPE_WIFI && (ap_name == NULL || strlen(ap_name) == 0)) {
+        LOG_ERR("WIFI_TYPE is WIFI, but no ap/aps - Bail!");
+        return -EINVAL;
+    }
 
-    // Run the loop until a message has little/no space left, and queue the message for sending.
+    // The message is streamed straight into the output buffer. Every section below is
+    // added whole or not at all, and the writer always keeps room for the closing
+    // brackets, so the space accounting is exact.
 
     // return codes for sub-objects:
     // 0: success, no more data to send
-    // > 0: success, more data to send, pass this value back into the function to get the next
-    // batch of data
-    //          this can still NOT append any new values to the message if it determines there
-    //          is not enough space left for even 1 item. for this reason the index returned is
-    //          1 based, not 0 based. as 0 is an error code. (not important, just pass it back
-    //          in)
-    // < 0: error, stop processing and return NULL
-
-    // cJSON *wifiObjs[MAX_WIFI_OBJS];
-
-    cJSON *topLevel = cJSON_CreateObject();
-    cJSON_AddNumberToObject(topLevel, "P", TELEMETRY_PROTOCOL_VERSION);
-    cJSON_AddStringToObject(topLevel, "MID", MID);
-    cJSON_AddStringToObject(topLevel, "MK", CONFIG_IOT_MQTT_REGION_ID);
-    cJSON_AddNumberToObject(topLevel, "T", MQTT_MESSAGE_TYPE_INFO_TELEMETRY);
-    cJSON_AddNumberToObject(topLevel, "B", CONFIG_IOT_MQTT_BRAND_ID);
-    cJSON *mObject   = cJSON_AddObjectToObject(topLevel, "M");
-    cJSON *dviObject = cJSON_AddObjectToObject(mObject, "DVI");
-    cJSON_AddStringToObject(dviObject, "MOD", "DogCollar");
-    cJSON_AddStringToObject(dviObject, "HWR", "0.1.0");
+    // > 0: success, more data to send on the next call
+    // < 0: error
+    tele_writer_t tw;
+#if defined(CONFIG_D1_JSON_TELEMETRY_CBOR)
+    if (telemetry_protocol == TELEMETRY_CBOR_PROTOCOL_VERSION) {
+        tw_init(&tw, cbor_message_buffer, sizeof(cbor_message_buffer), TW_FORMAT_CBOR);
+    } else
+#endif
+    {
+        tw_init(&tw, json_message_buffer, CONFIG_MAX_MQTT_MSG_SIZE, TW_FORMAT_JSON);
+    }
+
+    tw_map_begin(&tw, NULL);
+    tw_int(&tw, "P", telemetry_protocol);
+    tw_str(&tw, "MID", MID);
+    tw_str(&tw, "MK", CONFIG_IOT_MQTT_REGION_ID);
+    tw_int(&tw, "T", MQTT_MESSAGE_TYPE_INFO_TELEMETRY);
+    tw_int(&tw, "B", CONFIG_IOT_MQTT_BRAND_ID);
+    tw_map_begin(&tw, "M");
+    tw_map_begin(&tw, "DVI");
+    tw_str(&tw, "MOD", "DogCollar");
+    tw_str(&tw, "HWR", "0.1.0");
     char fw_version[32];
     snprintf(fw_version, 32, "%d.%d.%d", APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_VERSION_PATCH);
-    cJSON_AddStringToObject(dviObject, "FWR", fw_version);
-    cJSON_AddStringToObject(dviObject, "TZ", "US/Pacific");
-    cJSON *xtrObject = cJSON_AddObjectToObject(dviObject, "XTR");
-    cJSON_AddStringToObject(xtrObject, "JSON_VER", json_schema_ver);
-    cJSON_AddNumberToObject(xtrObject, "SUB", 4);
-    cJSON_AddNumberToObject(xtrObject, "CRON", get_unix_time());
+    tw_str(&tw, "FWR", fw_version);
+    tw_str(&tw, "TZ", "US/Pacific");
+    tw_map_begin(&tw, "XTR");
+    tw_str(&tw, "JSON_VER", json_schema_ver);
+#if defined(CONFIG_D1_JSON_ML_COLUMNS)
+    tw_int(&tw, "SUB", TELEMETRY_ML_COLUMNS_SUB_TYPE);
+#else
+    tw_int(&tw, "SUB", TELEMETRY_SUB_TYPE);
+#endif
+    tw_int(&tw, "CRON", get_unix_time());
 
     // POWER
-    cJSON *pwrObject = cJSON_AddObjectToObject(xtrObject, "POWER");
-    cJSON_AddNumberToObject(pwrObject, "BATT_S", roundf_val(batt_info.soc, 1));
-    cJSON_AddNumberToObject(pwrObject, "BATT_V", roundf_val(batt_info.voltage, 2));
-    cJSON_AddNumberToObject(pwrObject, "BATT_T", roundf_val(batt_info.temp, 2));
-    cJSON_AddBoolToObject(pwrObject, "CHARGING", charging);
-    cJSON_AddBoolToObject(pwrObject, "PLUG", usb_connected);
+    const char *rr = check_reset_reason();
+    tw_map_begin(&tw, "POWER");
+    tw_double(&tw, "BATT_S", roundf_val(batt_info.soc, 1));
+    tw_double(&tw, "BATT_V", roundf_val(batt_info.voltage, 2));
+    tw_double(&tw, "BATT_T", roundf_val(batt_info.temp, 2));
+    tw_bool(&tw, "CHARGING", charging);
+    tw_bool(&tw, "PLUG", usb_connected);
+    if (rr != NULL) {
+        tw_str(&tw, "R_REASON", rr);
+    }
+    tw_end(&tw);
 
     // VERSIONS
-    const char *rr = check_reset_reason();
     if (rr != NULL) {
-        char   ver_str[32];
-        cJSON *verObject = cJSON_AddObjectToObject(xtrObject, "VER");
-        cJSON_AddStringToObject(pwrObject, "R_REASON", rr);
+        char ver_str[32];
+        tw_map_begin(&tw, "VER");
         snprintf(ver_str, 32, "%d.%d.%d", APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_VERSION_PATCH);
-        cJSON_AddStringToObject(verObject, "5340_VER", ver_str);
+        tw_str(&tw, "5340_VER", ver_str);
 #if !defined(CONFIG_BUILDING_MFG_SHELL)
         version_response_t *lte_ver = get_cached_version_info();
         snprintf(ver_str, 32, "%d.%d.%d", lte_ver->major, lte_ver->minor, lte_ver->patch);
 #endif
-        cJSON_AddStringToObject(verObject, "9160_VER", ver_str);
+        tw_str(&tw, "9160_VER", ver_str);
         if (da_ver != NULL) {
             snprintf(ver_str, 32, "%d.%d.%d", da_ver[0], da_ver[1], da_ver[2]);
-            cJSON_AddStringToObject(verObject, "WIFI_VER", ver_str);
+            tw_str(&tw, "WIFI_VER", ver_str);
         }
+        tw_end(&tw);
     }
 
     // DEBUG
-    cJSON *dbgObject = cJSON_AddObjectToObject(xtrObject, "DEBUG");
+    tw_map_begin(&tw, "DEBUG");
     if (chunk_num == 0) {
         int movement = imu_get_trigger_count();
-        cJSON_AddNumberToObject(dbgObject, "MOVEMENT", movement);
-        cJSON_AddNumberToObject(dbgObject, "UPTIME", k_uptime_get());
+        tw_int(&tw, "MOVEMENT", movement);
+        tw_int(&tw, "UPTIME", k_uptime_get());
     }
-    cJSON_AddNumberToObject(dbgObject, "MSG_NUM", telemetry_count);
+    tw_int(&tw, "MSG_NUM", telemetry_count);
     telemetry_count++;
-    cJSON_AddNumberToObject(dbgObject, "CHUNK", chunk_num);
+    tw_int(&tw, "CHUNK", chunk_num);
+    tw_end(&tw);
 
     // RADIO
     switch (radio_used) {
     case RADIO_TYPE_WIFI:
-    {
-        if (ap_name == NULL || strlen(ap_name) == 0) {
-            LOG_ERR("WIFI_TYPE is WIFI, but no ap/aps - Bail!");
-            finalReturn = -EINVAL;
-            goto cleanup_and_exit;
-
-        } else {
-            cJSON_AddStringToObject(xtrObject, "RADIO", "WIFI");
-            cJSON_AddStringToObject(xtrObject, "AP", ap_name);
-            cJSON_AddBoolToObject(xtrObject, "APS", ap_is_safe);
-        }
+        tw_str(&tw, "RADIO", "WIFI");
+        tw_str(&tw, "AP", ap_name);
+        tw_bool(&tw, "APS", ap_is_safe);
         if (rssi != RSSI_NOT_CONNECTED) {
-            cJSON_AddNumberToObject(xtrObject, "RSSI", rssi);
+            tw_int(&tw, "RSSI", rssi);
         }
         break;
-    };
     case RADIO_TYPE_LTE:
         if (modem_is_powered_on()) {
-            cJSON_AddStringToObject(xtrObject, "RADIO", "LTE");
+            tw_str(&tw, "RADIO", "LTE");
 #if !defined(CONFIG_BUILDING_MFG_SHELL)
-            cJSON_AddNumberToObject(xtrObject, "RSSI", modem_get_rssi());
+            tw_int(&tw, "RSSI", modem_get_rssi());
 #endif
         } else {
-            cJSON_AddStringToObject(xtrObject, "RADIO", "UNKNOWN");
+            tw_str(&tw, "RADIO", "UNKNOWN");
         }
         break;
     case RADIO_TYPE_BLE:
-        cJSON_AddStringToObject(xtrObject, "RADIO", "BLE");
+        tw_str(&tw, "RADIO", "BLE");
         break;
     default:
-        cJSON_AddStringToObject(xtrObject, "RADIO", "UNKNOWN");
+        tw_str(&tw, "RADIO", "UNKNOWN");
         break;
     }
 
-    // thats all the required data, now we can add optional data
-    // first see how much space we have left.
-    // we need to leave space for the closing brackets and commas
-    cJSON_PrintPreallocated(topLevel, json_message_buffer, D1_JSON_MESSAGE_BUFFER_SIZE, false);
-    int     A_LITTE_PADDING_TO_BE_SAFE = 10;
-    int16_t remaining_json_size = (CONFIG_MAX_MQTT_MSG_SIZE - A_LITTE_PADDING_TO_BE_SAFE) - strlen(json_message_buffer);
+    // thats all the required data, now we can add optional data with whatever space is left
 
     // PUT THE FOLLOWING CALLS IN PRIORITY ORDER, SO THE MOST IMPORTANT DATA IS SENT IN THE
     // FIRST MESSAGE
     // TODO: handle the <0 return from each of these functions
-    // LOG_WRN("TRY SSIDS");
     // SSIDS
-    if (add_ssids_to_json(xtrObject, wifi_ssids_fifo, &remaining_json_size) > 0) {
+    if (tw_add_ssids(&tw, wifi_ssids_fifo) > 0) {
         LOG_WRN("SSID data did not fit in the message");
         finalReturn = 1;    // indicate we have more to process
     }
@@ -361,25 +413,31 @@ int json_telemetry(
 #if defined(CONFIG_ML_ENABLE)
     LOG_DBG("TRY ML");
     // ML
-    if (ml_get_json_list(xtrObject, &remaining_json_size) > 0) {
+    if (ml_get_json_list(&tw) > 0) {
         LOG_WRN("ML data did not fit in the message");
         finalReturn = 1;    // indicate we have more to process
     }
 #endif
 
-    // LOG_WRN("TRY LOGS");
     //  LOGS
-    if (telem_log_get_json_list(xtrObject, &remaining_json_size) > 0) {
+    if (telem_log_get_json_list(&tw) > 0) {
         LOG_WRN("Log data did not fit in the message");
         finalReturn = 1;    // indicate we have more to process
     }
 
-    cJSON_PrintPreallocated(topLevel, json_message_buffer, D1_JSON_MESSAGE_BUFFER_SIZE, false);
+    size_t len = tw_finish(&tw);
+#if defined(CONFIG_D1_JSON_TELEMETRY_CBOR)
+    if (tw.format == TW_FORMAT_CBOR) {
+        if (base64_encode((uint8_t *)json_message_buffer, D1_JSON_MESSAGE_BUFFER_SIZE, &len, cbor_message_buffer, len)) {
+            LOG_ERR("Failed to encode CBOR telemetry");
+            return -ENOMEM;
+        }
+    }
+#endif
+    LOG_DBG("Telemetry is %zu bytes", len);
 
     *replyJson = json_message_buffer;
-
-cleanup_and_exit:
-    cJSON_Delete(topLevel);
+    *replyLen  = len;
     return finalReturn;
 }
 
@@ -447,6 +505,7 @@ char *json_shadow_report(char *MID, shadow_doc_t *doc, shadow_extra_t *extra)
     cJSON_AddNumberToObject(mObject, "THS", doc->ths);
     cJSON_AddNumberToObject(mObject, "DUR", doc->dur);
     cJSON_AddNumberToObject(mObject, "MOT_DET", doc->mot_det);
+    cJSON_AddNumberToObject(mObject, "TP", doc->tele_proto);
     char ver_str[32];
     snprintf(ver_str, 32, "%d.%d.%d", doc->mcuVer[0], doc->mcuVer[1], doc->mcuVer[2]);
     cJSON_AddStringToObject(mObject, "MV", ver_str);
@@ -521,6 +580,7 @@ int json_parse_shadow_report(char *json_buf, shadow_doc_t *doc, shadow_doc_t *ol
     doc->mcuVer[2]                 = 0;
     doc->fota_in_progress_duration = olddoc->fota_in_progress_duration;
     doc->gps_poll_period           = olddoc->gps_poll_period;
+    doc->tele_proto                = olddoc->tele_proto;
     for (int i = 0; i < NUM_ZONES; i++) {
         doc->zones[i].idx = olddoc->zones[i].idx;
         strncpy(doc->zones[i].ssid, olddoc->zones[i].ssid, 32);
@@ -678,6 +738,16 @@ int json_parse_shadow_report(char *json_buf, shadow_doc_t *doc, shadow_doc_t *ol
         doc->mot_det = cJSON_GetNumberValue(obj);
     }
 
+    if ((obj = cJSON_GetObjectItem(mObj, "TP")) != NULL) {
+        int tp = cJSON_GetNumberValue(obj);
+        if (tp == TELEMETRY_PROTOCOL_VERSION || (IS_ENABLED(CONFIG_D1_JSON_TELEMETRY_CBOR) && tp == TELEMETRY_CBOR_PROTOCOL_VERSION)) {
+            ret             = 0;
+            doc->tele_proto = tp;
+        } else {
+            LOG_WRN("Ignoring unsupported telemetry protocol %d", tp);
+        }
+    }
+
     if ((obj = cJSON_GetObjectItem(mObj, "ZONES")) != NULL) {
         ret         = 0;
         cJSON *zval = NULL;
@@ -1489,114 +1559,373 @@ char *json_srf_response_message(char *rid, char *st, char *fres, uint64_t currTi
     return json_message_buffer;
 }
 
+// the ML records added to the last telemetry message stay in the queue until
+// json_telemetry_commit(). Once json_telemetry_hold() says that message is
+// queued, later messages start after its records (ml_held of them)
+static fqueue_t      ml_fq;
+static fqueue_iter_t ml_iter;
+static int           ml_pending;
+static int           ml_held;
+static K_MUTEX_DEFINE(ml_lock);
+
+#if defined(CONFIG_D1_JSON_ML_COLUMNS)
+// Columnar ML batch (telemetry SUB 5). Instead of one object per inference, "ML" holds
+// one array per field, all the same length "N":
+//   ST     start time of the first record (s), ET end time of the last record (s)
+//   CA     activity class, run length encoded as [class, count, class, count, ...]
+//   DT     start time delta from the previous record (s), the first one is from ST
+//   TS     duration (s)
+//   PR..GS the statistics as unsigned integers, multiplied by the matching QS entry
+#define ML_COLUMNS_MAX_RECS (64)
+
+#define ML_QS_PR (10)
+#define ML_QS_PP (100)
+#define ML_QS_AM (1000)
+#define ML_QS_AS (1000)
+#define ML_QS_GM (100)
+#define ML_QS_GS (100)
+
+typedef struct
+{
+    uint32_t start;    // s
+    uint16_t dur;      // s
+    uint16_t ca;
+    uint16_t pr;
+    uint16_t pp;
+    uint16_t am;
+    uint16_t as;
+    uint16_t gm;
+    uint16_t gs;
+} ml_column_rec_t;
+
+static ml_column_rec_t ml_recs[ML_COLUMNS_MAX_RECS];
+
+static uint16_t ml_quantize(float value, int scale)
+{
+    float q = roundf(value * scale);
+    return q <= 0 ? 0 : (q >= UINT16_MAX ? UINT16_MAX : (uint16_t)q);
+}
+
+static void ml_column_rec(ml_column_rec_t *rec, const struct Inference *ml_info)
+{
+    rec->start = ml_info->_Inference_start / 1000;
+    rec->dur   = MIN((ml_info->_Inference_end - ml_info->_Inference_start) / 1000, UINT16_MAX);
+    rec->ca    = MIN(ml_info->_Inference_activity, UINT16_MAX);
+    rec->pr    = ml_quantize(ml_info->_Inference_reps, ML_QS_PR);
+    rec->pp    = ml_quantize(ml_info->_Inference_probability, ML_QS_PP);
+    rec->am    = ml_quantize(ml_info->_Inference_am, ML_QS_AM);
+    rec->as    = ml_quantize(ml_info->_Inference_as, ML_QS_AS);
+    rec->gm    = ml_quantize(ml_info->_Inference_gm, ML_QS_GM);
+    rec->gs    = ml_quantize(ml_info->_Inference_gs, ML_QS_GS);
+}
+
+// one uint16_t field of the first n records as an array
+static int tw_ml_column(tele_writer_t *tw, const char *key, int n, size_t field)
+{
+    if (tw_array_begin(tw, key)) {
+        return -ENOMEM;
+    }
+    for (int i = 0; i < n; i++) {
+        if (tw_int(tw, NULL, *(uint16_t *)((uint8_t *)&ml_recs[i] + field))) {
+            return -ENOMEM;
+        }
+    }
+    return tw_end(tw);
+}
+
+// activity classes as [class, count, class, count, ...]
+static int tw_ml_class_runs(tele_writer_t *tw, int n)
+{
+    if (tw_array_begin(tw, "CA")) {
+        return -ENOMEM;
+    }
+    for (int i = 0; i < n;) {
+        int run = 1;
+        while (i + run < n && ml_recs[i + run].ca == ml_recs[i].ca) {
+            run++;
+        }
+        if (tw_int(tw, NULL, ml_recs[i].ca) || tw_int(tw, NULL, run)) {
+            return -ENOMEM;
+        }
+        i += run;
+    }
+    return tw_end(tw);
+}
+
+// start times as deltas from the previous record
+static int tw_ml_start_deltas(tele_writer_t *tw, int n)
+{
+    if (tw_array_begin(tw, "DT")) {
+        return -ENOMEM;
+    }
+    for (int i = 0; i < n; i++) {
+        if (tw_int(tw, NULL, (int64_t)ml_recs[i].start - ml_recs[i > 0 ? i - 1 : 0].start)) {
+            return -ENOMEM;
+        }
+    }
+    return tw_end(tw);
+}
+
+// the first n records of ml_recs[] as one "ML" object, all or nothing
+static int tw_add_ml_columns(tele_writer_t *tw, int n)
+{
+    tw_mark_t mark = tw_mark(tw);
+    uint32_t  end  = ml_recs[n - 1].start + ml_recs[n - 1].dur;
+
+    if (tw_map_begin(tw, "ML") || tw_int(tw, "ST", ml_recs[0].start) || tw_int(tw, "ET", end)
+        || tw_str(tw, "MV", ml_version()) || tw_str(tw, "AV", ml_version()) || tw_str(tw, "RV", ml_version())
+        || tw_int(tw, "N", n) || tw_array_begin(tw, "QS") || tw_int(tw, NULL, ML_QS_PR) || tw_int(tw, NULL, ML_QS_PP)
+        || tw_int(tw, NULL, ML_QS_AM) || tw_int(tw, NULL, ML_QS_AS) || tw_int(tw, NULL, ML_QS_GM)
+        || tw_int(tw, NULL, ML_QS_GS) || tw_end(tw) || tw_ml_class_runs(tw, n) || tw_ml_start_deltas(tw, n)
+        || tw_ml_column(tw, "TS", n, offsetof(ml_column_rec_t, dur))
+        || tw_ml_column(tw, "PR", n, offsetof(ml_column_rec_t, pr))
+        || tw_ml_column(tw, "PP", n, offsetof(ml_column_rec_t, pp))
+        || tw_ml_column(tw, "AM", n, offsetof(ml_column_rec_t, am))
+        || tw_ml_column(tw, "AS", n, offsetof(ml_column_rec_t, as))
+        || tw_ml_column(tw, "GM", n, offsetof(ml_column_rec_t, gm))
+        || tw_ml_column(tw, "GS", n, offsetof(ml_column_rec_t, gs))) {
+        tw_rewind(tw, mark);
+        return -ENOMEM;
+    }
+    return tw_end(tw);
+}
+
 ///////////////////////////////////////////////////
 // ml_get_json_list()
+// Add as many queued ML records as fit, in the columnar SUB 5 layout
 //
-//
-int ml_get_json_list(cJSON *jsonObj, int16_t *remaining_space)
+static int ml_add_json_list(tele_writer_t *tw)
 {
-    int min_space_for_ml = 200;    // ST, AV, MV, RV, ET and at least 1 record - hand wavy math
-
     // see if there is ML data in the file system
-    fqueue_t fq;
+    ml_pending = 0;
+    fqueue_init(&ml_fq, "ml", FQ_READ, false);
+    if (fqueue_iter_begin(&ml_fq, &ml_iter) || fqueue_iter_skip(&ml_iter, ml_held)) {
+        return 0;
+    }
 
-    fqueue_init(&fq, "ml", FQ_READ, false);
+    uint8_t          cbor_buffer[sizeof(struct Inference) * 2];    // allow some overhead
+    struct Inference ml_info;
+    int              count = 0;
+    bool             more  = false;
+    while (1) {
+        size_t size = sizeof(cbor_buffer);
+        if (fqueue_iter_next(&ml_iter, cbor_buffer, &size)) {
+            break;
+        }
+        if (count == ML_COLUMNS_MAX_RECS) {
+            more = true;
+            break;
+        }
+        cbor_decode_Inference(cbor_buffer, size, &ml_info, &size);
+        ml_column_rec(&ml_recs[count++], &ml_info);
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // the usual case is that everything fits, otherwise find the most records that do
+    int fit = count;
+    if (tw_add_ml_columns(tw, count)) {
+        int lo = 1;
+        int hi = count - 1;
+        fit    = 0;
+        more   = true;
+        while (lo <= hi) {
+            int       mid  = (lo + hi) / 2;
+            tw_mark_t mark = tw_mark(tw);
+            if (tw_add_ml_columns(tw, mid) == 0) {
+                tw_rewind(tw, mark);
+                fit = mid;
+                lo  = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if (fit == 0) {
+            LOG_WRN("There is ML, but no space for it, retry next time");
+            return 1;
+        }
+        tw_add_ml_columns(tw, fit);
+    }
+    LOG_WRN("Added %d/%d records, %zu bytes left", fit, count, tw_remaining(tw));
+    ml_pending = fit;
+    return more ? 1 : 0;
+}
+#else
+// room for the trailing ,"ET":<uint64> of the ML object, in either format
+#define ML_ET_RESERVE (26)
+
+// one ML record, all or nothing
+static int tw_add_inference(tele_writer_t *tw, const struct Inference *ml_info)
+{
+    tw_mark_t mark = tw_mark(tw);
+
+    if (tw_map_begin(tw, NULL) || tw_int(tw, "CA", ml_info->_Inference_activity)
+        || tw_double(tw, "PR", roundf_val(ml_info->_Inference_reps, 3))
+        || tw_double(tw, "PP", roundf_val(ml_info->_Inference_probability, 3))
+        || tw_int(tw, "ST", ml_info->_Inference_start / 1000)
+        || tw_int(tw, "TS", (ml_info->_Inference_end - ml_info->_Inference_start) / 1000)
+        || tw_double(tw, "AM", roundf_val(ml_info->_Inference_am, 3))
+        || tw_double(tw, "AS", roundf_val(ml_info->_Inference_as, 3))
+        || tw_double(tw, "GM", roundf_val(ml_info->_Inference_gm, 3))
+        || tw_double(tw, "GS", roundf_val(ml_info->_Inference_gs, 3))) {
+        tw_rewind(tw, mark);
+        return -ENOMEM;
+    }
+    return tw_end(tw);
+}
+
+///////////////////////////////////////////////////
+// ml_get_json_list()
+//
+//
+static int ml_add_json_list(tele_writer_t *tw)
+{
+    // see if there is ML data in the file system
+    ml_pending = 0;
+    fqueue_init(&ml_fq, "ml", FQ_READ, false);
+    if (fqueue_iter_begin(&ml_fq, &ml_iter) || fqueue_iter_skip(&ml_iter, ml_held)) {
+        return 0;
+    }
 
     uint8_t          cbor_buffer[sizeof(struct Inference) * 2];    // allow some overhead
     struct Inference ml_info;
     size_t           size = sizeof(cbor_buffer);
-    if (fqueue_peek(&fq, cbor_buffer, &size, K_NO_WAIT)) {
+    if (fqueue_iter_next(&ml_iter, cbor_buffer, &size)) {
         // the queue is empty ... send nothing
         // LOG_WRN("ML queue is empty");
         return 0;
     }
     // We came here, ML quue is NOT empty
-    if (*remaining_space < min_space_for_ml) {
+    cbor_decode_Inference(cbor_buffer, size, &ml_info, &size);
+    uint64_t start_time = ml_info._Inference_start;
+    uint64_t end_time   = 0;
+
+    if (tw_reserve(tw, ML_ET_RESERVE)) {
         LOG_WRN("There is ML, but no space for it, retry next time");
         return 1;
     }
-
-    LOG_WRN("Create JSON ML");
-    cJSON   *ml_obj = cJSON_AddObjectToObject(jsonObj, "ML");
-    uint64_t start_time;
-    uint64_t end_time = 0;
-    char     tempSpace[256];
-
-    cbor_decode_Inference(cbor_buffer, size, &ml_info, &size);
-    start_time = ml_info._Inference_start;
-
-    cJSON_AddNumberToObject(ml_obj, "ST", start_time / 1000);
-    cJSON_AddStringToObject(ml_obj, "MV", ml_version());
-    cJSON_AddStringToObject(ml_obj, "AV", ml_version());
-    cJSON_AddStringToObject(ml_obj, "RV", ml_version());
-
-    cJSON *ml_array = cJSON_AddArrayToObject(ml_obj, "AT");
-    if (!ml_array) {
-        LOG_ERR("Failed to create ml array");
-        return -1;
+    tw_mark_t start = tw_mark(tw);
+    if (tw_map_begin(tw, "ML") || tw_int(tw, "ST", start_time / 1000)
+        || tw_str(tw, "MV", ml_version()) || tw_str(tw, "AV", ml_version()) || tw_str(tw, "RV", ml_version())
+        || tw_array_begin(tw, "AT") || tw_add_inference(tw, &ml_info)) {
+        LOG_WRN("There is ML, but no space for it, retry next time");
+        tw_rewind(tw, start);
+        tw_release(tw, ML_ET_RESERVE);
+        return 1;
     }
 
-    // update for the space the header used
-    cJSON_PrintPreallocated(ml_obj, tempSpace, 256, false);
-    *remaining_space -= strlen(tempSpace);
-
     int n_ml_recs = 1;
     int act_recs  = 0;
     int ret_value = 0;
     while (1) {
-        // get the ML data from the file queue object
-        cJSON *ml_inf_obj = cJSON_CreateObject();
-        cJSON_AddNumberToObject(ml_inf_obj, "CA", ml_info._Inference_activity);
-        cJSON_AddNumberToObject(ml_inf_obj, "PR", roundf_val(ml_info._Inference_reps, 3));
-        cJSON_AddNumberToObject(ml_inf_obj, "PP", roundf_val(ml_info._Inference_probability, 3));
-        cJSON_AddNumberToObject(ml_inf_obj, "ST", ml_info._Inference_start / 1000);
-        cJSON_AddNumberToObject(ml_inf_obj, "TS", (ml_info._Inference_end - ml_info._Inference_start) / 1000);
-        cJSON_AddNumberToObject(ml_inf_obj, "AM", roundf_val(ml_info._Inference_am, 3));
-        cJSON_AddNumberToObject(ml_inf_obj, "AS", roundf_val(ml_info._Inference_as, 3));
-        cJSON_AddNumberToObject(ml_inf_obj, "GM", roundf_val(ml_info._Inference_gm, 3));
-        cJSON_AddNumberToObject(ml_inf_obj, "GS", roundf_val(ml_info._Inference_gs, 3));
-
-        // Acertain if it will fit
-        cJSON_PrintPreallocated(ml_inf_obj, tempSpace, 256, false);
-        if (cJSON_GetArraySize(ml_inf_obj) < ML_MINIMUM_ELEMENTS) {
-            LOG_ERR("MHR - error condition, unknown reason..abort");
-            LOG_ERR("size is %d", cJSON_GetArraySize(ml_inf_obj));
-            cJSON_Delete(ml_inf_obj);
-            ret_value = 1;
-            goto graceful_exit;
-        }
-
-        LOG_WRN(
-            "New ML entry size %d strlen: %d remaing_space: %d",
-            cJSON_GetArraySize(ml_inf_obj),
-            strlen(tempSpace),
-            *remaining_space);
-#define MIN_SPACE_FOR_ET_FIELD (20)    // size of "ET": 1726841031 + SOME BUFFER
-        if (*remaining_space < strlen(tempSpace) + MIN_SPACE_FOR_ET_FIELD) {
-            cJSON_Delete(ml_inf_obj);
-            ret_value = 1;    // we're out of space and need to continue on the next loop
-            goto graceful_exit;
-        }
-        *remaining_space -= strlen(tempSpace);
-        // It will fit, go ahead and add it
-        fqueue_get(&fq, cbor_buffer, &size, K_NO_WAIT);    /// POP the data
-        cJSON_AddItemToArray(ml_array, ml_inf_obj);
         ++act_recs;
         // the records should be in order, so the last record is the overall end time
-        end_time    = ml_info._Inference_end;
-        size_t size = sizeof(cbor_buffer);
-        if (fqueue_peek(&fq, cbor_buffer, &size, K_NO_WAIT)) {
+        end_time = ml_info._Inference_end;
+        size     = sizeof(cbor_buffer);
+        if (fqueue_iter_next(&ml_iter, cbor_buffer, &size)) {
             LOG_WRN("Reached end of queue");
             break;
         }
         cbor_decode_Inference(cbor_buffer, size, &ml_info, &size);
         n_ml_recs++;
+        if (tw_add_inference(tw, &ml_info)) {
+            ret_value = 1;    // we're out of space and need to continue on the next loop
+            break;
+        }
     }
-graceful_exit:
-    if (act_recs > 0) {    // We have added at least 1 ml array
-        cJSON_AddNumberToObject(ml_obj, "ET", end_time / 1000);
-        *remaining_space -= MIN_SPACE_FOR_ET_FIELD;
-    }
-    LOG_WRN("Added %d/%d records, covering a %lldms time", act_recs, n_ml_recs, end_time - start_time);
+    tw_end(tw);
+    tw_release(tw, ML_ET_RESERVE);
+    tw_int(tw, "ET", end_time / 1000);
+    tw_end(tw);
+    LOG_WRN(
+        "Added %d/%d records, covering a %lldms time, %zu bytes left",
+        act_recs,
+        n_ml_recs,
+        end_time - start_time,
+        tw_remaining(tw));
+    ml_pending = act_recs;
     return ret_value;
 }
+#endif
+
+int ml_get_json_list(tele_writer_t *tw)
+{
+    k_mutex_lock(&ml_lock, K_FOREVER);
+    int ret = ml_add_json_list(tw);
+    k_mutex_unlock(&ml_lock);
+    return ret;
+}
+
+///////////////////////////////////////////////////
+// json_telemetry_hold()
+// The last json_telemetry() message was queued. Its ML records stay
+// on flash until json_telemetry_commit(), later messages skip them.
+//
+// @return: the number of ML records the message carries
+int json_telemetry_hold(void)
+{
+    k_mutex_lock(&ml_lock, K_FOREVER);
+    int recs   = ml_pending;
+    ml_pending = 0;
+    ml_held += recs;
+    k_mutex_unlock(&ml_lock);
+    return recs;
+}
+
+///////////////////////////////////////////////////
+// json_telemetry_commit()
+// Remove the ML records of the oldest held telemetry message from flash.
+// Call once that message has been sent. Held messages go out in order,
+// so its records are the first recs in the queue.
+//
+// @param recs: what json_telemetry_hold() returned for the message
+//
+// @return: 0 on success, <0 on error
+int json_telemetry_commit(int recs)
+{
+    static fqueue_t fq;
+    fqueue_iter_t   it;
+    int             ret = 0;
+
+    if (recs <= 0) {
+        return 0;
+    }
+    k_mutex_lock(&ml_lock, K_FOREVER);
+    ret = fqueue_init(&fq, "ml", FQ_READ, false);
+    if (ret == 0) {
+        ret = fqueue_iter_begin(&fq, &it);
+    }
+    if (ret == 0) {
+        ret = fqueue_iter_skip(&it, recs);
+    }
+    if (ret == 0) {
+        ret = fqueue_iter_commit(&it, recs);
+    }
+    ml_held = MAX(ml_held - recs, 0);
+    k_mutex_unlock(&ml_lock);
+    return ret;
+}
+
+///////////////////////////////////////////////////
+// json_telemetry_release()
+// The newest held telemetry message was dropped unsent. Its ML records
+// stay on flash and go out with the next message instead.
+//
+// @param recs: what json_telemetry_hold() returned for the message
+//
+// @return: 0 on success, -EBUSY if a message built after it is still
+//          waiting for json_telemetry_hold()
+int json_telemetry_release(int recs)
+{
+    int ret = 0;
+
+    k_mutex_lock(&ml_lock, K_FOREVER);
+    if (ml_pending > 0) {
+        ret = -EBUSY;
+    } else {
+        ml_held = MAX(ml_held - recs, 0);
+    }
+    k_mutex_unlock(&ml_lock);
+    return ret;
+}
@@ -0,0 +1,309 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tele_writer.h"
+
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+#include <zcbor_encode.h>
+#endif
+
+#define CBOR_MAP_INDEF   0xbf
+#define CBOR_ARRAY_INDEF 0x9f
+#define CBOR_BREAK       0xff
+
+void tw_init(tele_writer_t *w, void *buf, size_t size, tw_format_t format)
+{
+    memset(w, 0, sizeof(tele_writer_t));
+    w->buf    = buf;
+    w->size   = format == TW_FORMAT_JSON ? size - 1 : size;
+    w->format = format;
+    w->first[0] = true;
+}
+
+size_t tw_remaining(const tele_writer_t *w)
+{
+    return w->size - w->len - w->depth;
+}
+
+tw_mark_t tw_mark(const tele_writer_t *w)
+{
+    tw_mark_t mark = { .len = w->len, .depth = w->depth, .first = w->first[w->depth] };
+    return mark;
+}
+
+void tw_rewind(tele_writer_t *w, tw_mark_t mark)
+{
+    w->len               = mark.len;
+    w->depth             = mark.depth;
+    w->first[mark.depth] = mark.first;
+}
+
+int tw_reserve(tele_writer_t *w, size_t n)
+{
+    if (tw_remaining(w) < n) {
+        return -ENOMEM;
+    }
+    w->size -= n;
+    return 0;
+}
+
+void tw_release(tele_writer_t *w, size_t n)
+{
+    w->size += n;
+}
+
+static int tw_put(tele_writer_t *w, const void *data, size_t n)
+{
+    if (tw_remaining(w) < n) {
+        return -ENOMEM;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+    return 0;
+}
+
+static int tw_json_str(tele_writer_t *w, const char *str)
+{
+    int ret = tw_put(w, "\"", 1);
+
+    for (; ret == 0 && *str; str++) {
+        char esc[7];
+
+        if (*str == '"' || *str == '\\') {
+            esc[0] = '\\';
+            esc[1] = *str;
+            ret    = tw_put(w, esc, 2);
+        } else if ((uint8_t)*str < 0x20) {
+            snprintf(esc, sizeof(esc), "\\u%04x", *str);
+            ret = tw_put(w, esc, 6);
+        } else {
+            ret = tw_put(w, str, 1);
+        }
+    }
+    if (ret == 0) {
+        ret = tw_put(w, "\"", 1);
+    }
+    return ret;
+}
+
+// separator and member name in front of every JSON item
+static int tw_json_key(tele_writer_t *w, const char *key)
+{
+    int ret = 0;
+
+    if (!w->first[w->depth]) {
+        ret = tw_put(w, ",", 1);
+    }
+    if (ret == 0 && key) {
+        ret = tw_json_str(w, key);
+        if (ret == 0) {
+            ret = tw_put(w, ":", 1);
+        }
+    }
+    return ret;
+}
+
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+// start a zcbor encoder on the free space and encode the member name
+static bool tw_cbor_begin(tele_writer_t *w, zcbor_state_t *zs, const char *key)
+{
+    zcbor_new_state(zs, 1, w->buf + w->len, tw_remaining(w), 2);
+    if (key) {
+        struct zcbor_string zkey = { .value = (const uint8_t *)key, .len = strlen(key) };
+        return zcbor_tstr_encode(zs, &zkey);
+    }
+    return true;
+}
+
+static void tw_cbor_end(tele_writer_t *w, zcbor_state_t *zs)
+{
+    w->len = zs->payload - w->buf;
+}
+#endif
+
+// write the head of an item, then let the caller add its value
+static int tw_item(tele_writer_t *w, const char *key, tw_mark_t *mark)
+{
+    *mark = tw_mark(w);
+    if (w->format == TW_FORMAT_JSON) {
+        return tw_json_key(w, key);
+    }
+    return 0;
+}
+
+static int tw_item_done(tele_writer_t *w, int ret, tw_mark_t mark)
+{
+    if (ret) {
+        tw_rewind(w, mark);
+        return -ENOMEM;
+    }
+    w->first[w->depth] = false;
+    return 0;
+}
+
+static int tw_begin(tele_writer_t *w, const char *key, bool is_map)
+{
+    tw_mark_t mark;
+    int       ret;
+
+    if (w->depth >= TW_MAX_DEPTH) {
+        return -EINVAL;
+    }
+    ret = tw_item(w, key, &mark);
+    if (ret == 0 && w->format == TW_FORMAT_JSON) {
+        // one byte for the opening character, and one more held back to close it
+        ret = tw_remaining(w) >= 2 ? tw_put(w, is_map ? "{" : "[", 1) : -ENOMEM;
+    }
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+    if (ret == 0 && w->format == TW_FORMAT_CBOR) {
+        zcbor_state_t zs[1];
+        uint8_t       head = is_map ? CBOR_MAP_INDEF : CBOR_ARRAY_INDEF;
+
+        if (tw_cbor_begin(w, zs, key)) {
+            tw_cbor_end(w, zs);
+            ret = tw_remaining(w) >= 2 ? tw_put(w, &head, 1) : -ENOMEM;
+        } else {
+            ret = -ENOMEM;
+        }
+    }
+#endif
+    ret = tw_item_done(w, ret, mark);
+    if (ret == 0) {
+        w->close[w->depth] = is_map ? '}' : ']';
+        w->depth++;
+        w->first[w->depth] = true;
+    }
+    return ret;
+}
+
+int tw_map_begin(tele_writer_t *w, const char *key)
+{
+    return tw_begin(w, key, true);
+}
+
+int tw_array_begin(tele_writer_t *w, const char *key)
+{
+    return tw_begin(w, key, false);
+}
+
+int tw_end(tele_writer_t *w)
+{
+    if (w->depth == 0) {
+        return -EINVAL;
+    }
+    // the space for this was held back when the container was opened
+    w->depth--;
+    w->buf[w->len++] = w->format == TW_FORMAT_JSON ? w->close[w->depth] : CBOR_BREAK;
+    return 0;
+}
+
+int tw_int(tele_writer_t *w, const char *key, int64_t value)
+{
+    tw_mark_t mark;
+    int       ret = tw_item(w, key, &mark);
+
+    if (ret == 0 && w->format == TW_FORMAT_JSON) {
+        char num[24];
+        int  len = snprintf(num, sizeof(num), "%lld", (long long)value);
+        ret      = tw_put(w, num, len);
+    }
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+    if (ret == 0 && w->format == TW_FORMAT_CBOR) {
+        zcbor_state_t zs[1];
+
+        ret = tw_cbor_begin(w, zs, key) && zcbor_int64_put(zs, value) ? 0 : -ENOMEM;
+        if (ret == 0) {
+            tw_cbor_end(w, zs);
+        }
+    }
+#endif
+    return tw_item_done(w, ret, mark);
+}
+
+int tw_double(tele_writer_t *w, const char *key, double value)
+{
+    tw_mark_t mark;
+    int       ret;
+
+    // whole numbers go out as integers, which is also what cJSON prints for them
+    if (isfinite(value) && value == (double)(int64_t)value) {
+        return tw_int(w, key, (int64_t)value);
+    }
+    ret = tw_item(w, key, &mark);
+    if (ret == 0 && w->format == TW_FORMAT_JSON) {
+        char num[26];
+        int  len = isfinite(value) ? snprintf(num, sizeof(num), "%1.15g", value) : snprintf(num, sizeof(num), "null");
+        ret      = tw_put(w, num, len);
+    }
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+    if (ret == 0 && w->format == TW_FORMAT_CBOR) {
+        zcbor_state_t zs[1];
+
+        // telemetry values carry at most a few decimals, a single is plenty
+        ret = tw_cbor_begin(w, zs, key) && zcbor_float32_put(zs, (float)value) ? 0 : -ENOMEM;
+        if (ret == 0) {
+            tw_cbor_end(w, zs);
+        }
+    }
+#endif
+    return tw_item_done(w, ret, mark);
+}
+
+int tw_bool(tele_writer_t *w, const char *key, bool value)
+{
+    tw_mark_t mark;
+    int       ret = tw_item(w, key, &mark);
+
+    if (ret == 0 && w->format == TW_FORMAT_JSON) {
+        ret = value ? tw_put(w, "true", 4) : tw_put(w, "false", 5);
+    }
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+    if (ret == 0 && w->format == TW_FORMAT_CBOR) {
+        zcbor_state_t zs[1];
+
+        ret = tw_cbor_begin(w, zs, key) && zcbor_bool_put(zs, value) ? 0 : -ENOMEM;
+        if (ret == 0) {
+            tw_cbor_end(w, zs);
+        }
+    }
+#endif
+    return tw_item_done(w, ret, mark);
+}
+
+int tw_str(tele_writer_t *w, const char *key, const char *value)
+{
+    tw_mark_t mark;
+    int       ret = tw_item(w, key, &mark);
+
+    if (ret == 0 && w->format == TW_FORMAT_JSON) {
+        ret = tw_json_str(w, value);
+    }
+#ifdef CONFIG_D1_JSON_TELEMETRY_CBOR
+    if (ret == 0 && w->format == TW_FORMAT_CBOR) {
+        zcbor_state_t       zs[1];
+        struct zcbor_string zval = { .value = (const uint8_t *)value, .len = strlen(value) };
+
+        ret = tw_cbor_begin(w, zs, key) && zcbor_tstr_encode(zs, &zval) ? 0 : -ENOMEM;
+        if (ret == 0) {
+            tw_cbor_end(w, zs);
+        }
+    }
+#endif
+    return tw_item_done(w, ret, mark);
+}
+
+size_t tw_finish(tele_writer_t *w)
+{
+    while (w->depth > 0) {
+        tw_end(w);
+    }
+    if (w->format == TW_FORMAT_JSON) {
+        w->buf[w->len] = 0;
+    }
+    return w->len;
+}
@@ -39,6 +39,26 @@ int modem_get_time(char *buf, uint16_t len);
 //  -EINVAL: if the topic or message length is less than 1
 int modem_send_mqtt(
     char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos, uint16_t timeout_in_ms);
+
+////////////////////////////////////////////////////
+// modem_send_mqtt_start()
+// Queue a publish for the 9160 without waiting for its reply.
+// Publishes go out in the order they are started
+//
+// Returns:
+//  >=0: the handle to wait on with modem_mqtt_wait()
+//  <0: the same errors as modem_send_mqtt()
+int modem_send_mqtt_start(char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos);
+
+////////////////////////////////////////////////////
+// modem_mqtt_wait()
+// Wait for the reply to a modem_send_mqtt_start() publish
+//
+// Returns:
+//  0: success
+//  >0: the 9160 could not publish it
+//  -ETIMEDOUT: no reply within timeout_in_ms
+int modem_mqtt_wait(int handle, uint16_t timeout_in_ms);
 int modem_download_file_from_url(char *url, char *new_file_name);
 int modem_fota_from_https(char *url, uint16_t url_length);
 int modem_send_at_command(char *cmd, uint16_t cmd_length, char *response, uint16_t *response_length);
@@ -27,6 +27,7 @@ typedef enum
     MESSAGE_TYPE_CELL_INFO     = 20,    // get cell info
     MESSAGE_TYPE_CELL_TRACKING = 21,    // get cell tracking info
     MESSAGE_TYPE_FW_UPLOAD     = 22,    // upload a file to the modem
+    MESSAGE_TYPE_BATCH         = 23,    // v2 frame, see message_command_v1_t
     MESSAGE_TYPE_NULL          = 0xff
 } modem_message_type_t;
 
@@ -93,6 +94,16 @@ typedef struct
     // raw data follows
 } __attribute__((__packed__)) message_command_v1_t;
 
+// A v2 frame packs several messages into one transfer.  Its header is a message_command_v1_t
+// with version MESSAGE_VERSION_V2, messageType MESSAGE_TYPE_BATCH, handle 255 and chunkTotal
+// set to the number of records; dataLen bytes of records follow, each a complete v1 message
+// (header and data) with its own handle.  A v2 frame with no records is a no-op.
+//
+// Either side only sends v2 frames once the other side has sent it one: the 5340 always polls
+// with empty v2 frames, and the 9160 answers in v2 from then on.
+#define MESSAGE_VERSION_V1 (0x01)
+#define MESSAGE_VERSION_V2 (0x02)
+
 typedef struct version_response_t
 {
     uint8_t major;
@@ -174,6 +185,8 @@ typedef struct firmware_upload
                              // 4 = invalid data
                              // 5 = invalid state, not ready for data
                              // 6 = unknown error
+                             // 7 = already has data up to chunk_num, carry on from there (reply to chunk 0)
+                             // 8 = chunk written and the image is complete, installing
     uint32_t crc;
 } __attribute__((__packed__)) firmware_upload_t;
 
@@ -22,4 +22,5 @@ cell_info_t         modem_spi_getCellInfo();
 int                 modem_spi_stop_waiting_for_resp(int handle);
 int                 modem_spi_free_reply_data_but_not_handle(int handle);
 void                copy_modem_status(modem_status_t *src, modem_status_t *dst);
-void                clear_cell_info();
\ No newline at end of file
+void                clear_cell_info();
+void                modem_spi_get_stats(uint32_t *xfers, uint64_t *bytes, uint32_t *no_block);
\ No newline at end of file
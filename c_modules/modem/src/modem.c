@@ -114,29 +114,10 @@ int modem_get_ICCID(uint8_t *buf, uint16_t len)
     return ret;
 }
 
-////////////////////////////////////////////////////
-// modem_send_mqtt()
-// Send a message to the modem to send a message to the MQTT broker
-//
-// Arguments:
-//  topic: the topic to send the message to
-//  topic_length: the length of the topic
-//  message: the message to send
-//  message_length: the length of the message
-//  qos: the quality of service to use
-//  timeout_in_ms: the timeout in milliseconds to wait for a response
-//
-// Returns:
-//  0: success
-//  -ENOTCONN: if mqtt is not connected
-//  -ENODEV: if the modem is not powered on
-//  -ENOMEM: if memory allocation fails
-//  -ETIMEDOUT: if a response is requested and the response times out
-//  -EINVAL: if the topic or message length is less than 1
-int modem_send_mqtt(
-    char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos, uint16_t timeout_in_ms)
+// hand one publish to the 9160, returns the handle its reply comes back on
+static int modem_mqtt_send(
+    char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos, bool reply_requested)
 {
-    int ret = 0;
     if (topic_length < 1 || message_length < 1) {
         return -EINVAL;
     }
@@ -167,35 +148,79 @@ int modem_send_mqtt(
 
     // LOG_DBG("Sending to MQTT modem: topic_len=%d  payload_len=%d", mqtt_msg->topic_length,
     // mqtt_msg->msg_length);
-    bool reply_requested = false;
-    if (timeout_in_ms != 0) {
-        reply_requested = true;
-    }
-
     int my_handle = modem_send_command(
         MESSAGE_TYPE_MQTT, data, sizeof(spi_mqtt_t) + mqtt_msg->topic_length + mqtt_msg->msg_length, reply_requested);
+    k_free(data);
     if (my_handle < 0) {
         LOG_WRN("Failed to send command");
-        k_free(data);
         return -ENOTCONN;
     }
-    if (reply_requested) {
-        uint8_t  buf[32];
-        uint16_t len = 32;
-        if (modem_recv_resp(my_handle, buf, &len, timeout_in_ms) == 0) {
-            // LOG_HEXDUMP_ERR(buf, len, "Received from modem");
-            int8_t *incoming_status = (int8_t *)(&buf[0]);
-            modem_free_reply_data(my_handle);
-            ret = *incoming_status;
-        } else {
-            modem_stop_waiting_for_resp(my_handle);
-            ret = -ETIMEDOUT;
-        }
-    } else {
-        ret = my_handle;
+    return my_handle;
+}
+
+////////////////////////////////////////////////////
+// modem_send_mqtt()
+// Send a message to the modem to send a message to the MQTT broker
+//
+// Arguments:
+//  topic: the topic to send the message to
+//  topic_length: the length of the topic
+//  message: the message to send
+//  message_length: the length of the message
+//  qos: the quality of service to use
+//  timeout_in_ms: the timeout in milliseconds to wait for a response
+//
+// Returns:
+//  0: success
+//  -ENOTCONN: if mqtt is not connected
+//  -ENODEV: if the modem is not powered on
+//  -ENOMEM: if memory allocation fails
+//  -ETIMEDOUT: if a response is requested and the response times out
+//  -EINVAL: if the topic or message length is less than 1
+int modem_send_mqtt(
+    char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos, uint16_t timeout_in_ms)
+{
+    int my_handle = modem_mqtt_send(topic, topic_length, message, message_length, qos, timeout_in_ms != 0);
+    if (my_handle < 0 || timeout_in_ms == 0) {
+        return my_handle;
     }
-    k_free(data);
-    return ret;
+    return modem_mqtt_wait(my_handle, timeout_in_ms);
+}
+
+////////////////////////////////////////////////////
+// modem_send_mqtt_start()
+// Like modem_send_mqtt(), but returns as soon as the message is queued
+// for the 9160. The 9160 answers every publish on its own handle, so
+// several can be waiting at once
+//
+// Returns:
+//  >=0: the handle to pass to modem_mqtt_wait()
+//  <0: the same errors as modem_send_mqtt()
+int modem_send_mqtt_start(char *topic, uint16_t topic_length, char *message, uint16_t message_length, uint8_t qos)
+{
+    return modem_mqtt_send(topic, topic_length, message, message_length, qos, true);
+}
+
+////////////////////////////////////////////////////
+// modem_mqtt_wait()
+// Wait for the reply to a publish started with modem_send_mqtt_start()
+//
+// Returns:
+//  0: success
+//  >0: the 9160 could not publish the message
+//  -ETIMEDOUT: no reply in time, the handle is given up
+int modem_mqtt_wait(int handle, uint16_t timeout_in_ms)
+{
+    uint8_t  buf[32];
+    uint16_t len = 32;
+    if (modem_recv_resp(handle, buf, &len, timeout_in_ms) == 0) {
+        // LOG_HEXDUMP_ERR(buf, len, "Received from modem");
+        int8_t *incoming_status = (int8_t *)(&buf[0]);
+        modem_free_reply_data(handle);
+        return *incoming_status;
+    }
+    modem_stop_waiting_for_resp(handle);
+    return -ETIMEDOUT;
 }
 
 int modem_get_status(modem_status_t *status)
@@ -877,6 +902,109 @@ int modem_send_modemCellInfo(char *response, uint16_t *response_length)
     }
 }
 
+// chunks of a firmware upload that are waiting for their reply
+typedef struct
+{
+    int      handle;    // -1 when the slot is free
+    uint16_t chunk_num;
+    uint8_t  tries;
+    int64_t  sent_at;
+} fw_upload_slot_t;
+
+#define FW_UPLOAD_WINDOW     CONFIG_LTE_FOTA_UPLOAD_WINDOW
+#define FW_UPLOAD_TRIES      5
+#define FW_UPLOAD_TIMEOUT_MS 10000
+
+static int fw_upload_send_chunk(struct fs_file_t *file, fw_upload_slot_t *slot, uint16_t chunk_total)
+{
+    // modem_send_command() copies the message, so one buffer does for every chunk
+    static uint8_t     buf[sizeof(firmware_upload_t) + CONFIG_LTE_FOTA_CHUNK_SIZE_MAX];
+    firmware_upload_t *data = (firmware_upload_t *)buf;
+
+    int rc = fs_seek(file, (off_t)slot->chunk_num * CONFIG_LTE_FOTA_CHUNK_SIZE_MAX, FS_SEEK_SET);
+    if (rc == 0) {
+        rc = fs_read(file, buf + sizeof(firmware_upload_t), CONFIG_LTE_FOTA_CHUNK_SIZE_MAX);
+    }
+    if (rc < 0) {
+        LOG_ERR("FAIL: read chunk %d: %d", slot->chunk_num, rc);
+        return rc;
+    }
+    data->chunk_total = chunk_total;
+    data->chunk_num   = slot->chunk_num;
+    data->data_len    = rc;
+    data->crc         = crc32_ieee_update(0, buf + sizeof(firmware_upload_t), rc);
+    data->return_code = 0;
+
+    LOG_DBG(
+        "chunk_total: %d, chunk_num: %d, data_len: %d, crc: 0x%08x",
+        data->chunk_total,
+        data->chunk_num,
+        data->data_len,
+        data->crc);
+
+    slot->handle = modem_send_command(MESSAGE_TYPE_FW_UPLOAD, buf, sizeof(firmware_upload_t) + data->data_len, true);
+    if (slot->handle < 0) {
+        LOG_WRN("Failed to send command");
+        return -1;
+    }
+    slot->tries++;
+    slot->sent_at = k_uptime_get();
+    return 0;
+}
+
+///////////////////////////////
+///
+///     fw_upload_wait
+///
+//  Wait for the reply to a chunk.  Returns 1 when the chunk is done, 2 when it was the one
+//  that completed the image, 0 if it has to be sent again, <0 if the upload failed.
+//  *resume_at is set when the 9160 already has the image up to some chunk.
+static int fw_upload_wait(fw_upload_slot_t *slot, int *resume_at)
+{
+    firmware_upload_t resp;
+    uint16_t          response_length = sizeof(resp);
+    int               timeout         = FW_UPLOAD_TIMEOUT_MS - (int)(k_uptime_get() - slot->sent_at);
+
+    int rc = modem_recv_resp(slot->handle, (uint8_t *)&resp, &response_length, MAX(timeout, 1));
+    modem_free_reply_data(slot->handle);
+    slot->handle = -1;
+    if (rc != 0) {
+        LOG_WRN("no reply to chunk %d", slot->chunk_num);
+        return 0;
+    }
+    if (resp.return_code == 7 && slot->chunk_num == 0) {
+        // the only reply that carries another chunk number, where to carry on from
+        *resume_at = resp.chunk_num;
+        return 1;
+    }
+    if (resp.chunk_num != slot->chunk_num) {
+        LOG_WRN("reply for chunk %d while waiting for %d, resending", resp.chunk_num, slot->chunk_num);
+        return 0;
+    }
+    switch (resp.return_code) {
+    case 0:
+        return 1;
+    case 8:
+        return 2;
+    case 1:    // outside the 9160's window
+    case 3:    // bad crc
+    case 5:    // no buffer free, or not started yet
+        LOG_DBG("chunk %d refused (%d), resending", slot->chunk_num, resp.return_code);
+        return 0;
+    default:
+        LOG_ERR("Error uploading firmware: %d", resp.return_code);
+        return -1;
+    }
+}
+
+///////////////////////////////
+///
+///     modem_upload_fw
+///
+//  Chunk 0 goes first on its own, so the 9160 can start (or resume) the upgrade and
+//  say where to carry on from.  After that up to FW_UPLOAD_WINDOW chunks are kept in
+//  flight and only the ones that fail or time out are sent again.  The upload has only
+//  worked once the 9160 says the image is complete, every chunk being acked is not enough.
 int modem_upload_fw(char *fw_file)
 {
     if (!modem_is_powered_on()) {
@@ -892,106 +1020,95 @@ int modem_upload_fw(char *fw_file)
         return -1;
     }
 
-    // // get file size
-    // struct fs_dirent entry;
-    // ret = fs_stat(fw_file, &entry);
-    // if (ret != 0) {
-    //     LOG_ERR("Error getting file size: %d", ret);
-    //     fs_close(&file);
-    //     return -1;
-    // }
-    // entry.size;
-
     int rc = fs_seek(&file, 0L, FS_SEEK_END);
     if (rc < 0) {
         LOG_ERR("FAIL: seek %s: %d", fw_file, rc);
+        fs_close(&file);
         return rc;
     }
     uint32_t file_size = fs_tell(&file);
     LOG_DBG("File size: %d", file_size);
 
-    rc = fs_seek(&file, 0, FS_SEEK_SET);
-    if (rc < 0) {
-        LOG_ERR("FAIL: seek %s: %d", fw_file, rc);
-        return rc;
-    }
+    fw_upload_slot_t slots[FW_UPLOAD_WINDOW];
+    uint16_t         chunk_total = file_size / CONFIG_LTE_FOTA_CHUNK_SIZE_MAX;    // the number of the last chunk
+    int              next        = 1;
+    int              resume_at   = -1;
+    int              resends     = 0;
+    bool             complete    = false;
+    int64_t          start       = k_uptime_get();
 
-    // read the file in chunks and send to modem in CONFIG_LTE_FOTA_CHUNK_SIZE_MAX chunks
-    // wait for the response from the modem before sending the next chunk
-    uint8_t  response[sizeof(firmware_upload_t)];
-    uint16_t response_length = sizeof(response);
+    for (int i = 0; i < FW_UPLOAD_WINDOW; i++) {
+        slots[i].handle = -1;
+    }
 
-    // loop while reading the file in chunks
-    int i = 0;
-    for (;;) {
-        static uint8_t block[CONFIG_LTE_FOTA_CHUNK_SIZE_MAX];
-        rc = fs_read(&file, &block, CONFIG_LTE_FOTA_CHUNK_SIZE_MAX);
-        if (rc >= 0) {
-            // LOG_DBG("read %s: [rd:%d]", fw_file, rc);
-            uint8_t *buf = k_malloc(CONFIG_LTE_FOTA_CHUNK_SIZE_MAX + sizeof(firmware_upload_t));
-            if (buf == NULL) {
-                LOG_ERR("Failed to allocate memory for file buffer");
-                fs_close(&file);
-                return -1;
-            }
-            uint32_t          crc32 = 0;
-            firmware_upload_t data;
-            data.chunk_total = (file_size / CONFIG_LTE_FOTA_CHUNK_SIZE_MAX);
-            data.chunk_num   = i;
-            data.data_len    = rc;
-            data.crc         = crc32_ieee_update(crc32, block, rc);
-            data.return_code = 0;
-
-            memcpy(buf, &data, sizeof(firmware_upload_t));
-            memcpy(buf + sizeof(firmware_upload_t), block, rc);
-
-            LOG_DBG(
-                "chunk_total: %d, chunk_num: %d, data_len: %d, crc: 0x%08x",
-                data.chunk_total,
-                data.chunk_num,
-                data.data_len,
-                data.crc);
-
-            int my_handle = modem_send_command(
-                MESSAGE_TYPE_FW_UPLOAD, (uint8_t *)buf, sizeof(firmware_upload_t) + data.data_len, true);
-            if (my_handle < 0) {
-                LOG_WRN("Failed to send command");
-                return -1;
-            }
-            k_free(buf);
-            if (modem_recv_resp(my_handle, response, &response_length, 10000) == 0) {
-                firmware_upload_t *resp = (firmware_upload_t *)(&response[0]);
-                if (resp->return_code != 0) {
-                    LOG_ERR("Error uploading firmware: %d", resp->return_code);
-                    modem_free_reply_data(my_handle);
-                    fs_close(&file);
-                    return -1;
+    // chunk 0 first
+    slots[0].chunk_num = 0;
+    slots[0].tries     = 0;
+    do {
+        if (slots[0].tries >= FW_UPLOAD_TRIES || fw_upload_send_chunk(&file, &slots[0], chunk_total) != 0) {
+            rc = -1;
+            break;
+        }
+        rc = fw_upload_wait(&slots[0], &resume_at);
+    } while (rc == 0);
+    complete = rc == 2;
+    if (resume_at > 0) {
+        LOG_INF("9160 already has %d chunks, resuming", resume_at);
+        next     = resume_at;
+        complete = resume_at > chunk_total;
+    }
+
+    while (rc >= 0) {
+        // fill the window
+        fw_upload_slot_t *oldest = NULL;
+        for (int i = 0; i < FW_UPLOAD_WINDOW; i++) {
+            if (slots[i].handle < 0 && next <= chunk_total) {
+                slots[i].chunk_num = next++;
+                slots[i].tries     = 0;
+                if (fw_upload_send_chunk(&file, &slots[i], chunk_total) != 0) {
+                    rc = -1;
+                    break;
                 }
-                // LOG_DBG("got reply: (%d): %d/%d", resp->return_code,
-                // resp->chunk_num, resp->chunk_total);
-                modem_free_reply_data(my_handle);
-            } else {
-                LOG_ERR("Error uploading firmware: no response");
-                return -1;
             }
-            i++;
-            // LOG_DBG("sent block: %d", i);
-            if (rc < CONFIG_LTE_FOTA_CHUNK_SIZE_MAX) {
-                LOG_DBG("sent last block!");
-                break;
+            if (slots[i].handle >= 0 && (oldest == NULL || slots[i].sent_at < oldest->sent_at)) {
+                oldest = &slots[i];
             }
-        } else {
-            LOG_ERR("FAIL: read %s: [rd:%d]", fw_file, rc);
+        }
+        if (rc < 0 || oldest == NULL) {
             break;
         }
-    }
 
-    rc = fs_close(&file);
+        // the replies come back in order, so the oldest is the one to wait for
+        uint16_t chunk_num = oldest->chunk_num;
+        rc                 = fw_upload_wait(oldest, &resume_at);
+        if (rc == 0) {
+            if (oldest->tries >= FW_UPLOAD_TRIES) {
+                LOG_ERR("Error uploading firmware: chunk %d failed %d times", chunk_num, oldest->tries);
+                rc = -1;
+                break;
+            }
+            resends++;
+            rc = fw_upload_send_chunk(&file, oldest, chunk_total);
+        } else if (rc == 2) {
+            complete = true;
+        }
+    }
+    if (rc >= 0 && !complete) {
+        LOG_ERR("Error uploading firmware: every chunk was acked but the 9160 did not confirm the image");
+        rc = -1;
+    }
 
+    // anything still outstanding after a failure
+    for (int i = 0; i < FW_UPLOAD_WINDOW; i++) {
+        if (slots[i].handle >= 0) {
+            modem_free_reply_data(slots[i].handle);
+        }
+    }
+    fs_close(&file);
     if (rc < 0) {
-        LOG_ERR("FAIL: close %s: %d", fw_file, rc);
-        return rc;
+        return -1;
     }
+    LOG_INF("sent %d bytes in %lld ms, %d chunks resent", file_size, k_uptime_get() - start, resends);
 
     return 0;
 }
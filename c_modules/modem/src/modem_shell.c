@@ -1,5 +1,6 @@
 /* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
 #include "modem.h"
+#include "modem_spi.h"
 
 #include <zephyr/logging/log_ctrl.h>
 #include <zephyr/logging/log.h>
@@ -258,6 +259,17 @@ void do_modem_simulate_fail(const struct shell *sh, size_t argc, char **argv)
     do_simulate_fail = true;
 }
 
+void do_spi_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t xfers;
+    uint64_t bytes;
+    uint32_t no_block;
+
+    modem_spi_get_stats(&xfers, &bytes, &no_block);
+    shell_print(sh, "SPI transfers: %u, bytes clocked: %llu, avg: %llu", xfers, bytes, xfers ? bytes / xfers : 0);
+    shell_print(sh, "Replies dropped for lack of a rx block: %u", no_block);
+}
+
 void do_get_modem_status(const struct shell *sh, size_t argc, char **argv)
 {
     modem_status_t status;
@@ -605,6 +617,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
     SHELL_CMD(send_large_mqtt, NULL, "for Nick's testing, sends arbitrarily large mqtt message", do_send_large_mqtt),
     SHELL_CMD(send_mqtt, NULL, "send json string to the modem", do_modem_send_mqtt),
     SHELL_CMD(simulate_fail, NULL, "Pretened the modem has died", do_modem_simulate_fail),
+    SHELL_CMD(spi_stats, NULL, "print spi transfer stats", do_spi_stats),
     SHELL_CMD(status, NULL, "print modem status", do_get_modem_status),
     SHELL_CMD(turn_off, NULL, "turn off the modem", do_modem_turn_off),
     SHELL_CMD(turn_on, NULL, "turn on the modem", do_modem_turn_on),
@@ -82,7 +82,6 @@ static nrfx_spim_config_t spim_config =
     NRFX_SPIM_DEFAULT_CONFIG(APP_SPIM_SCK_PIN, APP_SPIM_MOSI_PIN, APP_SPIM_MISO_PIN, APP_SPIM_CS_PIN);
 
 #define SPIM_RX_BUFF_SIZE 3072
-static uint8_t m_rx_buf[SPIM_RX_BUFF_SIZE];
 
 static uint8_t *spim_rx_buff_ptr;    // pointer to rx buffer
 static uint8_t *spim_rx_buff;        // pointer to rx buffer
@@ -116,6 +115,51 @@ typedef struct
     uint16_t             dataLen;
 } spi_send_message_work_t;
 
+// Received messages land straight in one of these blocks and the block itself is
+// handed to spim_recv_action_work_handler(), which gives it back when done.
+// Most traffic (status, no-op, command replies) fits the small blocks.
+#define SPIM_RX_SMALL_SIZE   256
+#define SPIM_RX_SMALL_BLOCKS 8
+#define SPIM_RX_LARGE_BLOCKS 2
+
+// a reply there is no block for is clocked in here a piece at a time and thrown away
+static uint8_t spim_rx_discard[64];
+
+typedef struct
+{
+    spi_send_message_work_t msg;
+    struct k_mem_slab      *slab;
+    uint8_t                 data[];
+} spim_rx_block_t;
+
+K_MEM_SLAB_DEFINE_STATIC(
+    spim_rx_small_slab, ROUND_UP(sizeof(spim_rx_block_t) + SPIM_RX_SMALL_SIZE, 4), SPIM_RX_SMALL_BLOCKS, 4);
+K_MEM_SLAB_DEFINE_STATIC(
+    spim_rx_large_slab, ROUND_UP(sizeof(spim_rx_block_t) + SPIM_RX_BUFF_SIZE, 4), SPIM_RX_LARGE_BLOCKS, 4);
+
+static struct
+{
+    uint32_t xfers;
+    uint64_t bytes;        // bytes clocked on the bus
+    uint32_t no_block;     // messages dropped because every rx block was in use
+} spim_stats;
+
+// Outgoing messages wait here as complete v1 messages.  spi_send_work_handler() drains the
+// queue, and once the 9160 talks v2 it packs as many as fit into each transfer.
+#define SPIM_TX_BATCH_SIZE 4096    // stays below the 9160's receive buffer
+
+typedef struct
+{
+    void    *fifo_reserved;
+    uint8_t *data;
+    uint16_t dataLen;
+} spi_tx_item_t;
+
+K_FIFO_DEFINE(spi_tx_fifo);
+static struct k_work spi_tx_work;
+static atomic_t      spi_tx_status_queued;    // a status request is already waiting
+static volatile bool link_v2;                 // the 9160's last header was v2
+
 static cell_info_t current_cell_info;
 static uint64_t    last_modem_enable_time = 0;
 static uint64_t    last_msg_received_time = 0;
@@ -500,14 +544,16 @@ int process_async_message(message_command_v1_t *cmd, uint8_t *data_ptr)
     return 1;
 }
 
-static void spi_send_work_handler(struct k_work *work)
+///////////////////////////////
+///
+///     spi_tx_send
+///
+static int spi_tx_send(uint8_t *buf, uint16_t len)
 {
-    workref_t               *wr       = CONTAINER_OF(work, workref_t, work);
-    spi_send_message_work_t *msg      = (spi_send_message_work_t *)wr->reference;
-    int                      retryCnt = 0;
-    int                      ret      = -1;
+    int retryCnt = 0;
+    int ret      = -1;
     while (ret != 0) {
-        // in case there were any work items already queued when the modem was powered off, we need to check here
+        // in case there were any messages already queued when the modem was powered off, we need to check here
         if (pmic_is_9160_powered() == PMIC_LTE_POWER_OFF) {
             LOG_ERR("Modem is not powered on, cannot send message");
             // TODO: need to build a response to the message handle here, it it was not a 255
@@ -519,15 +565,15 @@ static void spi_send_work_handler(struct k_work *work)
         while (modem_ready_for_commands == false) {
             if (waitCnt > 25) {
                 LOG_ERR("Modem is not ready, giving up");
-                goto cleanup;
+                return -EAGAIN;
             }
             //LOG_DBG("Modem is not ready for commands, waiting");
             k_sleep(K_MSEC(100));
             waitCnt++;
         }
 
-        //LOG_HEXDUMP_ERR(msg->data, msg->dataLen, "Sending:");
-        ret = modem_spi_send(msg->data, msg->dataLen, NULL);
+        //LOG_HEXDUMP_ERR(buf, len, "Sending:");
+        ret = modem_spi_send(buf, len, NULL);
         if (ret != 0) {
             if (retryCnt > 20) {
                 LOG_ERR("modem_spi_send failed %d, giving up", ret);
@@ -536,21 +582,100 @@ static void spi_send_work_handler(struct k_work *work)
             k_sleep(K_MSEC(20));
             retryCnt++;
         }
+    }
+    return ret;
+}
+
+static bool is_hard_stop(const uint8_t *msg)
+{
+    return msg[1] == MESSAGE_TYPE_COMMAND && msg[sizeof(message_command_v1_t)] == COMMAND_HARD_STOP;
+}
+
+static void spi_tx_item_free(spi_tx_item_t *item)
+{
+    const message_command_v1_t *cmd = (const message_command_v1_t *)item->data;
+
+    if (cmd->messageType == MESSAGE_TYPE_DEVICE_STATUS && cmd->messageHandle == 255) {
+        atomic_clear(&spi_tx_status_queued);
+    }
+    k_free(item->data);
+    k_free(item);
+}
 
+///////////////////////////////
+///
+///     spi_send_work_handler
+///
+//  Empties the tx queue.  In v1 every message is a transfer of its own; in v2 everything
+//  that fits goes in one batch.  A poll (NO_OP) only goes out when nothing else is queued,
+//  as an empty v2 frame so a 9160 that knows v2 starts answering in it.
+static void spi_send_work_handler(struct k_work *work)
+{
+    spi_tx_item_t *item;
+
+    while ((item = k_fifo_get(&spi_tx_fifo, K_NO_WAIT)) != NULL) {
+        const message_command_v1_t *cmd       = (const message_command_v1_t *)item->data;
+        bool                        hard_stop = is_hard_stop(item->data);
+
+        if (cmd->messageType == MESSAGE_TYPE_NO_OP) {
+            if (k_fifo_is_empty(&spi_tx_fifo)) {
+                message_command_v1_t poll = {
+                    .version = MESSAGE_VERSION_V2, .messageType = MESSAGE_TYPE_BATCH, .messageHandle = 255
+                };
+                spi_tx_send((uint8_t *)&poll, sizeof(poll));
+            }
+            spi_tx_item_free(item);
+            continue;
+        }
+
+        if (!link_v2 || item->dataLen + sizeof(message_command_v1_t) > SPIM_TX_BATCH_SIZE) {
+            spi_tx_send(item->data, item->dataLen);
+            spi_tx_item_free(item);
+        } else {
+            uint8_t *batch = k_malloc(SPIM_TX_BATCH_SIZE);
+            if (batch == NULL) {
+                LOG_ERR("k_malloc failed for a %d byte batch", SPIM_TX_BATCH_SIZE);
+                spi_tx_send(item->data, item->dataLen);
+                spi_tx_item_free(item);
+                goto sent;
+            }
+            message_command_v1_t *hdr  = (message_command_v1_t *)batch;
+            uint16_t              used = sizeof(message_command_v1_t);
+
+            hdr->version       = MESSAGE_VERSION_V2;
+            hdr->messageType   = MESSAGE_TYPE_BATCH;
+            hdr->messageHandle = 255;
+            hdr->chunkNum      = 0;
+            hdr->chunkTotal    = 0;
+            while (item != NULL) {
+                hard_stop = hard_stop || is_hard_stop(item->data);
+                // the batch itself polls the 9160
+                if (((message_command_v1_t *)item->data)->messageType != MESSAGE_TYPE_NO_OP) {
+                    memcpy(batch + used, item->data, item->dataLen);
+                    used += item->dataLen;
+                    hdr->chunkTotal++;
+                }
+                spi_tx_item_free(item);
+                item = NULL;
+                // nothing goes after a hard stop
+                spi_tx_item_t *next = k_fifo_peek_head(&spi_tx_fifo);
+                if (!hard_stop && next != NULL && used + next->dataLen <= SPIM_TX_BATCH_SIZE) {
+                    item = k_fifo_get(&spi_tx_fifo, K_NO_WAIT);
+                }
+            }
+            hdr->dataLen = used - sizeof(message_command_v1_t);
+            spi_tx_send(batch, used);
+            k_free(batch);
+        }
+sent:
         // if the message is a COMMAND_HARD_STOP, then send it and call pmic_power_off_modem(false)
         // this has to be done here to ensure no race conditions with the modem being powered off and the message going out.
-        if (msg->data[1] == MESSAGE_TYPE_COMMAND && msg->data[sizeof(message_command_v1_t)] == COMMAND_HARD_STOP) {
+        if (hard_stop) {
             LOG_WRN("sent hard stop command, now powering down modem");
             modem_ready_for_commands = false;
             pmic_power_off_modem(false);
         }
     }
-cleanup:
-    if (msg->data) {
-        k_free(msg->data);
-    }
-    k_free(msg);
-    wr_put(wr);
 }
 
 
@@ -635,50 +760,45 @@ K_TIMER_DEFINE(alive_check_work_timer, alive_check_timer_handler, NULL);
 
 ///////////////////////////////
 ///
-///     spim_recv_action_work_handler
+///     spim_handle_message
 ///
-static void spim_recv_action_work_handler(struct k_work *work)
+static void spim_handle_message(message_command_v1_t *cmd, uint8_t *data)
 {
-    workref_t               *wr  = CONTAINER_OF(work, workref_t, work);
-    spi_send_message_work_t *msg = (spi_send_message_work_t *)wr->reference;
-
-    message_command_v1_t *cmd = &msg->cmd;
-
-    // LOG_WRN("spim_recv_action_work_handler: messageHandle: %u, messageType: %d, dataLen: %d", cmd->messageHandle, cmd->messageType, cmd->dataLen);
-    // LOG_HEXDUMP_ERR(msg->data, cmd->dataLen, "work_handler Received:");
-    command_type_t cmdType = (command_type_t) * (msg->data);    // only valid if cmd == MESSAGE_TYPE_COMMAND_RESP
+    // LOG_WRN("spim_handle_message: messageHandle: %u, messageType: %d, dataLen: %d", cmd->messageHandle, cmd->messageType, cmd->dataLen);
+    // LOG_HEXDUMP_ERR(data, cmd->dataLen, "work_handler Received:");
+    command_type_t cmdType = (command_type_t) * (data);    // only valid if cmd == MESSAGE_TYPE_COMMAND_RESP
 
     if (cmd->messageHandle == 255 && (cmd->messageType == MESSAGE_TYPE_NO_OP || cmd->messageType == MESSAGE_TYPE_NULL)) {
-        goto cleanup;    // handle for NO_OP, theres nothing to do here.
+        return;    // handle for NO_OP, theres nothing to do here.
     }
 
     // if the modem is shutting down, it might still send some status.  this seems to confuse everyone downstream, so we just ignore it.
     if (modem_is_powered_on() == false) {
-        goto cleanup;
+        return;
     }
 
     //LOG_ERR("spim_recv_action_work_handler: messageHandle: %d, messageType: %d, dataLen: %d", cmd->messageHandle, cmd->messageType, cmd->dataLen);
     // handle messages that are clearly async and not a response to a command
     if (cmd->messageHandle == 255) {
-        if (process_async_message(cmd, (uint8_t *)(msg->data)) <= 0) {
+        if (process_async_message(cmd, (uint8_t *)(data)) <= 0) {
             // the message was properly handled and we can return
             //LOG_DBG("async message handled: %d", cmd->messageType);
-            goto cleanup;
+            return;
         }
     } else {
         // go ahead and process these as well if they match the right types
         // even if someone asked for this, we should update any status' or info while its passing thru.
         if (cmd->messageType == MESSAGE_TYPE_DEVICE_INFO || cmd->messageType == MESSAGE_TYPE_DEVICE_STATUS
             || (cmd->messageType == MESSAGE_TYPE_COMMAND_RESP && cmdType == COMMAND_GET_VERSION)) {
-            int pam_ret = process_async_message(cmd, (uint8_t *)(msg->data));
+            int pam_ret = process_async_message(cmd, (uint8_t *)(data));
             if (pam_ret <= 0) {
                 // do NOT return as above, just pretend nothing happened, we were just peeking at the message
                 LOG_DBG("info/status message consumed");
-                goto cleanup;
+                return;
             } else if (pam_ret == -1) {
                 // this is an error
                 LOG_ERR("info/status message error");
-                goto cleanup;
+                return;
             } else {
                 // this is a message that was not handled, but not an error
                 LOG_DBG("info/status message not consumed");
@@ -687,35 +807,35 @@ static void spim_recv_action_work_handler(struct k_work *work)
     }
 
     uint16_t dataLen = cmd->dataLen;    //(m_rx_buf[3] << 8) + (m_rx_buf[4]) + 6;
-    if (msg->data[0] == NRF9160_NOT_READY && msg->data[1] == NRF9160_NOT_READY) {
+    if (data[0] == NRF9160_NOT_READY && data[1] == NRF9160_NOT_READY) {
         // commented because it breaks the passthru shell to print this all the time.  It's OK to happen
-        //LOG_ERR("spim_recv_action_work_handler: SPIS busy or ignoring - 0xcc");
-        goto cleanup;
+        //LOG_ERR("spim_handle_message: SPIS busy or ignoring - 0xcc");
+        return;
     }
-    if (msg->data[0] == NRF9160_UNKNOWN && msg->data[1] == NRF9160_UNKNOWN) {
-        LOG_ERR("spim_recv_action_work_handler: SPIS overread - 0xfe");
-        goto cleanup;
+    if (data[0] == NRF9160_UNKNOWN && data[1] == NRF9160_UNKNOWN) {
+        LOG_ERR("spim_handle_message: SPIS overread - 0xfe");
+        return;
     }
     if (dataLen > SPIM_RX_BUFF_SIZE) {
-        LOG_ERR("spim_recv_action_work_handler: SPIS overread - dataLen > SPIM_RX_BUFF_SIZE");
-        goto cleanup;
+        LOG_ERR("spim_handle_message: SPIS overread - dataLen > SPIM_RX_BUFF_SIZE");
+        return;
     }
 
     if (spim_on_rx_cb) {
-        spim_on_rx_cb(msg->data, dataLen, spim_on_rx_cb_userData);
+        spim_on_rx_cb(data, dataLen, spim_on_rx_cb_userData);
     }
 
     if (cmd->messageHandle >= MAX_MODEM_HANDLES) {
         //LOG_DBG("message handle too large: %d", cmd->messageHandle);
-        goto cleanup;
+        return;
     }
 
     //LOG_ERR("spim_recv_action_work_handler IMPORTANT: messageHandle: %d, messageType: %d, dataLen: %d", cmd->messageHandle, cmd->messageType, dataLen);
-    //LOG_HEXDUMP_ERR(msg->data, dataLen, "Received:");
+    //LOG_HEXDUMP_ERR(data, dataLen, "Received:");
     int mutex_ret = k_mutex_lock(&spi_reply_mutex, K_MSEC(1));
     if (mutex_ret != 0) {
         LOG_DBG("spim mutex lock failed try again\n");
-        goto cleanup;
+        return;
     }
 
     for (int i = 0; i < MAX_MODEM_HANDLES; i++) {
@@ -725,21 +845,55 @@ static void spim_recv_action_work_handler(struct k_work *work)
             if (modem_handles[i].data == NULL) {
                 LOG_ERR("work_handler: k_malloc failed");
                 k_mutex_unlock(&spi_reply_mutex);
-                goto cleanup;
+                return;
             }
             LOG_DBG("work_handler: alloc %d", dataLen);
-            memcpy(modem_handles[i].data, msg->data, dataLen);
+            memcpy(modem_handles[i].data, data, dataLen);
             modem_handles[i].dataLen = dataLen;
             break;
         }
     }
     k_mutex_unlock(&spi_reply_mutex);
+}
+
+///////////////////////////////
+///
+///     spim_recv_action_work_handler
+///
+static void spim_recv_action_work_handler(struct k_work *work)
+{
+    workref_t               *wr  = CONTAINER_OF(work, workref_t, work);
+    spi_send_message_work_t *msg = (spi_send_message_work_t *)wr->reference;
+
+    message_command_v1_t *cmd = &msg->cmd;
+
+    if (cmd->version != MESSAGE_VERSION_V2) {
+        spim_handle_message(cmd, msg->data);
+        goto cleanup;
+    }
+
+    // a v2 frame is a run of whole v1 messages, walk them in order
+    uint16_t used = 0;
+    for (int i = 0; i < cmd->chunkTotal; i++) {
+        message_command_v1_t rec;
+        if (cmd->dataLen - used < sizeof(rec)) {
+            LOG_ERR("batch record %d/%d header overruns frame", i, cmd->chunkTotal);
+            break;
+        }
+        memcpy(&rec, msg->data + used, sizeof(rec));
+        used += sizeof(rec);
+        if (rec.dataLen > cmd->dataLen - used) {
+            LOG_ERR("batch record %d/%d data overruns frame", i, cmd->chunkTotal);
+            break;
+        }
+        spim_handle_message(&rec, msg->data + used);
+        used += rec.dataLen;
+    }
 
 cleanup:
-    if (msg->data)
-        k_free(msg->data);
-    k_free(msg);
     wr_put(wr);
+    spim_rx_block_t *block = CONTAINER_OF(msg, spim_rx_block_t, msg);
+    k_mem_slab_free(block->slab, (void *)block);
 }
 
 ///////////////////////////////
@@ -874,6 +1028,7 @@ int modem_spi_init(void)
         K_THREAD_STACK_SIZEOF(modemSpi_send_stack_area),
         2,
         &modemSpi_send_work_q_cfg);
+    k_work_init(&spi_tx_work, spi_send_work_handler);
 
     k_work_queue_init(&modemSpi_utility_work_q);
     struct k_work_queue_config modemSpi_utility_work_q_cfg = {
@@ -899,22 +1054,39 @@ int modem_spi_init(void)
 }
 
 
+///////////////////////////////
+///
+///     modem_spi_xfer
+///
+static nrfx_err_t modem_spi_xfer(uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len)
+{
+    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TRX(tx, tx_len, rx, rx_len);
+
+    spim_stats.bytes += MAX(tx_len, rx_len);
+    return nrfx_spim_xfer(&spim, &xfer_desc, 0);
+}
+
 ///////////////////////////////
 ///
 ///     modem_spi_send
 ///
+//  One transfer is two phases with CS held low, so the 9160 sees a single transaction:
+//  first the message headers are swapped, then the rest of our message is clocked out
+//  while exactly dataLen bytes of the reply are clocked in, straight into a rx block (or
+//  into spim_rx_discard if no block is free).  Nothing is clocked past the longer of the two.
 static int modem_spi_send(uint8_t *buf, uint16_t len, uint8_t *buf2)
 {
-    int ret = 0;
+    int                  ret = 0;
+    message_command_v1_t hdr;
 
     if (modem_is_powered_on() == false) {
         LOG_ERR("Modem is not powered on, cannot send message");
         //TODO: // need to build a response to the message handle here, if it was not a 255
         return -1;
     }
-
-    memset(m_rx_buf, 0, SPIM_RX_BUFF_SIZE);
-    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TRX(buf, len, m_rx_buf, SPIM_RX_BUFF_SIZE);
+    if (len < sizeof(message_command_v1_t)) {
+        return -EINVAL;
+    }
 
     int        retries = 0;
     nrfx_err_t err_code;
@@ -922,9 +1094,11 @@ static int modem_spi_send(uint8_t *buf, uint16_t len, uint8_t *buf2)
     do {
         gpio_pin_set_dt(&spi4cs, 0);
         k_sleep(K_USEC(20));
-        err_code = nrfx_spim_xfer(&spim, &xfer_desc, 0);
+        memset(&hdr, NRF9160_UNKNOWN, sizeof(hdr));
+        err_code = modem_spi_xfer(buf, sizeof(hdr), (uint8_t *)&hdr, sizeof(hdr));
         if (err_code == NRFX_ERROR_BUSY) {
             LOG_ERR("SPI busy");
+            gpio_pin_set_dt(&spi4cs, 1);
             k_sleep(K_USEC(100));
             continue;
         } else if (err_code != NRFX_SUCCESS) {
@@ -932,7 +1106,8 @@ static int modem_spi_send(uint8_t *buf, uint16_t len, uint8_t *buf2)
             ret = -EIO;
             break;
         } else if (err_code == NRFX_SUCCESS) {
-            if (m_rx_buf[0] == NRF9160_NOT_READY && m_rx_buf[1] == NRF9160_NOT_READY) {
+            uint8_t *raw = (uint8_t *)&hdr;
+            if (raw[0] == NRF9160_NOT_READY && raw[1] == NRF9160_NOT_READY) {
                 LOG_ERR("SPIM retrying ... not ready");
                 gpio_pin_set_dt(&spi4cs, 1);
                 k_sleep(K_USEC(100));
@@ -943,64 +1118,102 @@ static int modem_spi_send(uint8_t *buf, uint16_t len, uint8_t *buf2)
         }
     } while (err_code != NRFX_SUCCESS && retries++ < 5);
 
-    nrfx_spim_abort(&spim);    //go to low power spi mode
-    gpio_pin_set_dt(&spi4cs, 1);
-    if ((m_rx_buf[0] != NRF9160_UNKNOWN) && (m_rx_buf[0] != NRF9160_OFFLINE) && (m_rx_buf[0] != NRF9160_NOT_READY)) {
-        // there is some response data ... handle it
-
-        message_command_v1_t *cmd = (message_command_v1_t *)m_rx_buf;
-        if (cmd->dataLen > SPIM_RX_BUFF_SIZE) {
-            LOG_ERR("spim_recv_action_work_handler: SPIS overread - dataLen > SPIM_RX_BUFF_SIZE");
-            return -1;
-        }
-        //LOG_DBG("modem_spi_send incoming data: messageHandle: %d, messageType: %d, dataLen: %d", cmd->messageHandle, cmd->messageType, cmd->dataLen);
-
-        spi_send_message_work_t *rx_data = k_malloc(sizeof(spi_send_message_work_t));
-        if (rx_data == NULL) {
-            LOG_ERR("k_malloc failed 1");
-            return -1;
-        }
+    if (err_code != NRFX_SUCCESS) {
+        nrfx_spim_abort(&spim);
+        gpio_pin_set_dt(&spi4cs, 1);
+        return ret ? ret : -EIO;
+    }
+    spim_stats.xfers++;
 
-        rx_data->work = wr_get(rx_data, __LINE__);
-        if (rx_data->work == NULL) {
-            LOG_ERR("Out of work items for %s", __func__);
-            k_free(rx_data);
-            return -1;
-        }
-        k_work_init(&rx_data->work->work, spim_recv_action_work_handler);
-        rx_data->data = k_malloc(cmd->dataLen);
-        if (rx_data->data == NULL) {
-            k_free(rx_data);
-            LOG_ERR("k_malloc failed 2 - len = %d", cmd->dataLen);
-            return -1;
-        }
-        rx_data->cmd.version       = cmd->version;
-        rx_data->cmd.messageType   = cmd->messageType;
-        rx_data->cmd.messageHandle = cmd->messageHandle;
-        rx_data->cmd.dataLen       = cmd->dataLen;
-        rx_data->cmd.chunkNum      = cmd->chunkNum;
-        rx_data->cmd.chunkTotal    = cmd->chunkTotal;
-
-        memcpy(rx_data->data, m_rx_buf + sizeof(message_command_v1_t), cmd->dataLen);
-
-        rx_data->dataLen       = cmd->dataLen;
-        last_msg_received_time = k_uptime_get();
-        ret                    = k_work_submit_to_queue(&modemSpi_recv_work_q, &rx_data->work->work);
-        if (ret <= 0) {
-            LOG_ERR("Could not submit receive work: %d", ret);
-            k_free(rx_data->data);
-            k_free(rx_data);
+    // is there a reply, and where does it go
+    uint8_t         *raw      = (uint8_t *)&hdr;
+    bool             has_data = raw[0] != NRF9160_UNKNOWN && raw[0] != NRF9160_OFFLINE && raw[0] != NRF9160_NOT_READY;
+    if (has_data) {
+        link_v2 = hdr.version == MESSAGE_VERSION_V2;
+    }
+    uint16_t         rx_len   = has_data ? hdr.dataLen : 0;
+    spim_rx_block_t *block    = NULL;
+    if (rx_len > SPIM_RX_BUFF_SIZE) {
+        LOG_ERR("spim_recv_action_work_handler: SPIS overread - dataLen > SPIM_RX_BUFF_SIZE");
+        has_data = false;
+        rx_len   = 0;
+    }
+    if (has_data) {
+        struct k_mem_slab *slab = rx_len <= SPIM_RX_SMALL_SIZE ? &spim_rx_small_slab : &spim_rx_large_slab;
+        if (k_mem_slab_alloc(slab, (void **)&block, K_NO_WAIT) == 0) {
+            block->slab = slab;
         } else {
-            ret = 0;
+            // the reply is still clocked out of the 9160, into spim_rx_discard
+            LOG_ERR("No spi rx block for %d bytes", rx_len);
+            spim_stats.no_block++;
+            block = NULL;
         }
     }
+
+    size_t tx_rest = len - sizeof(hdr);
+    size_t rx_now  = block != NULL ? rx_len : MIN(rx_len, sizeof(spim_rx_discard));
+    if (tx_rest > 0 || rx_now > 0) {
+        err_code = modem_spi_xfer(buf + sizeof(hdr), tx_rest, block != NULL ? block->data : spim_rx_discard, rx_now);
+    }
+    // without a block, whatever is left of the reply so the 9160 sees all of it go
+    for (size_t clocked = MAX(tx_rest, rx_now); err_code == NRFX_SUCCESS && clocked < rx_len; clocked += rx_now) {
+        rx_now   = MIN(rx_len - clocked, sizeof(spim_rx_discard));
+        err_code = modem_spi_xfer(NULL, 0, spim_rx_discard, rx_now);
+    }
+    if (err_code != NRFX_SUCCESS) {
+        LOG_ERR("Error code = 0x%x\n", err_code);
+        ret = -EIO;
+    }
+
+    nrfx_spim_abort(&spim);    //go to low power spi mode
+    gpio_pin_set_dt(&spi4cs, 1);
     if (buf2 != NULL) {
-        memcpy(buf2, m_rx_buf, len);
+        memcpy(buf2, &hdr, sizeof(hdr));
+    }
+    if (block == NULL) {
+        return ret;
+    }
+    if (ret != 0) {
+        k_mem_slab_free(block->slab, (void *)block);
+        return ret;
     }
 
+    // hand the block over as is
+    //LOG_DBG("modem_spi_send incoming data: messageHandle: %d, messageType: %d, dataLen: %d", hdr.messageHandle, hdr.messageType, hdr.dataLen);
+    spi_send_message_work_t *rx_data = &block->msg;
+    rx_data->work                    = wr_get(rx_data, __LINE__);
+    if (rx_data->work == NULL) {
+        LOG_ERR("Out of work items for %s", __func__);
+        k_mem_slab_free(block->slab, (void *)block);
+        return -1;
+    }
+    k_work_init(&rx_data->work->work, spim_recv_action_work_handler);
+    rx_data->cmd           = hdr;
+    rx_data->data          = block->data;
+    rx_data->dataLen       = rx_len;
+    last_msg_received_time = k_uptime_get();
+    ret                    = k_work_submit_to_queue(&modemSpi_recv_work_q, &rx_data->work->work);
+    if (ret <= 0) {
+        LOG_ERR("Could not submit receive work: %d", ret);
+        wr_put(rx_data->work);
+        k_mem_slab_free(block->slab, (void *)block);
+    } else {
+        ret = 0;
+    }
     return ret;
 }
 
+///////////////////////////////
+///
+///     modem_spi_get_stats
+///
+void modem_spi_get_stats(uint32_t *xfers, uint64_t *bytes, uint32_t *no_block)
+{
+    *xfers    = spim_stats.xfers;
+    *bytes    = spim_stats.bytes;
+    *no_block = spim_stats.no_block;
+}
+
 ///////////////////////////////
 ///
 ///     modem_spi_recv
@@ -1072,6 +1285,11 @@ int modem_spi_send_command(modem_message_type_t type, uint8_t *data, uint16_t da
     int newHandle = 255;
     int ret       = 0;
 
+    // a status request already queued will bring back the same status
+    bool is_status_poll = type == MESSAGE_TYPE_DEVICE_STATUS && !reply_requested && dataLen == 0;
+    if (is_status_poll && atomic_set(&spi_tx_status_queued, 1)) {
+        return 0;
+    }
     if (reply_requested) {
         newHandle = get_next_handle_id();
         if (newHandle < 0) {
@@ -1083,6 +1301,9 @@ int modem_spi_send_command(modem_message_type_t type, uint8_t *data, uint16_t da
     uint8_t *txmsg = k_malloc(dataLen + sizeof(message_command_v1_t));    // free'd in send work handler, when xfer is done
     if (!txmsg) {
         LOG_ERR("k_malloc failed  - %d", dataLen + sizeof(message_command_v1_t));
+        if (is_status_poll) {
+            atomic_clear(&spi_tx_status_queued);
+        }
         return -3;
     }
 
@@ -1100,31 +1321,24 @@ int modem_spi_send_command(modem_message_type_t type, uint8_t *data, uint16_t da
         txmsg[i + sizeof(message_command_v1_t)] = data[i];
     }
 
-    spi_send_message_work_t *tx_data = k_malloc(sizeof(spi_send_message_work_t));
+    spi_tx_item_t *tx_data = k_malloc(sizeof(spi_tx_item_t));
     if (!tx_data) {
         k_free(txmsg);
+        if (is_status_poll) {
+            atomic_clear(&spi_tx_status_queued);
+        }
         LOG_ERR("k_malloc failed 4");
         return -ENOMEM;
     }
-
-    tx_data->work = wr_get(tx_data, __LINE__);
-    if (tx_data->work == NULL) {
-        k_free(txmsg);
-        k_free(tx_data);
-        LOG_ERR("No work items");
-        return -ENOMEM;
-    }
-    k_work_init(&tx_data->work->work, spi_send_work_handler);
     tx_data->data    = txmsg;
     tx_data->dataLen = dataLen + sizeof(message_command_v1_t);
+    k_fifo_put(&spi_tx_fifo, tx_data);
 
-    ret = k_work_submit_to_queue(&modemSpi_send_work_q, &tx_data->work->work);
-    if (ret <= 0) {
+    ret = k_work_submit_to_queue(&modemSpi_send_work_q, &spi_tx_work);
+    if (ret < 0) {
         LOG_ERR("Failed to queue send work: %d", ret);
-        ret = 0;
-        k_free(txmsg);
-        k_free(tx_data);
     }
+    ret = 0;
 
     if (reply_requested) {
         return newHandle;
@@ -1,3 +1,14 @@
 #pragma once
+#include <stdint.h>
+
+struct bt_conn;
+
 int ble_init(void);
 char *ble_get_local_name(void);
+
+// the current connection, or NULL
+struct bt_conn *ble_get_conn(void);
+// ATT MTU of the current connection
+uint16_t ble_get_mtu(void);
+// request 2M PHY, data length extension and a short interval for bulk transfers
+int ble_request_fast_link(void);
@@ -37,6 +37,7 @@ int chekr_set_filehandle(file_handle_t handle);
 #define BLE_STATUS_SHOW_FRAME_LEN          (0x07)
 #define BLE_CONNECTED_SHOW_FRAME_LEN       (0x07)
 #define START_STOP_PERIODIC_DASH_FRAME_LEN (0x8)
+#define START_STOP_RAW_HARVEST_FRAME_LEN   (0x11)
 
 #define NESTLE_COMMERCIAL_PET_COLLAR (6)
 typedef enum {
@@ -121,11 +122,13 @@ int dashboard_init(void);
 int dashboard_ctrl(dashboard_ctrl_t ctrl, uint8_t interval);
 int dashboard_response(void);
 void write_to_central(uint8_t *data, int len);
+int notify_central(const uint8_t *data, uint16_t len);
 
 // recording related jump table functions in chekr_record module
 int start_stop_rec_session(char *data, int len);
 int read_rec_session_details_raw_imu(char *data, int len);
 int read_rec_session_data_raw_imu(char *data, int len);
+int start_stop_raw_data_harvesting(char *data, int len);
 int read_rec_session_details_activity(char *data, int len);
 int read_rec_session_data_activity(char *data, int len);
 
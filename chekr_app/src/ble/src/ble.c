@@ -7,6 +7,8 @@
 #include "ble.h"
 
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/logging/log.h>
@@ -70,11 +72,23 @@ void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
 	LOG_INF("Updated MTU: TX: %d RX: %d bytes", tx, rx);
 }
 
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+	LOG_INF("Updated PHY: TX: %d RX: %d", param->tx_phy, param->rx_phy);
+}
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	LOG_INF("Updated data length: TX: %d RX: %d bytes", info->tx_max_len, info->rx_max_len);
+}
+
 static struct bt_gatt_cb gatt_callbacks = {.att_mtu_updated = mtu_updated};
 
 static struct bt_conn_cb conn_callbacks = {
 	.connected = connected,
 	.disconnected = disconnected,
+	.le_phy_updated = le_phy_updated,
+	.le_data_len_updated = le_data_len_updated,
 };
 
 int ble_init(void)
@@ -146,6 +160,45 @@ int ble_shutdown(void)
 	return 0;
 }
 
+struct bt_conn *ble_get_conn(void)
+{
+	return current_conn;
+}
+
+uint16_t ble_get_mtu(void)
+{
+	if (current_conn == NULL) {
+		return BT_ATT_DEFAULT_LE_MTU;
+	}
+	return bt_gatt_get_mtu(current_conn);
+}
+
+// ask for the fastest link the central will give us, for bulk transfers. The central
+// decides, so these are requests and the results are only logged
+int ble_request_fast_link(void)
+{
+	if (current_conn == NULL) {
+		return -ENOTCONN;
+	}
+
+	int err = bt_conn_le_phy_update(current_conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (err) {
+		LOG_WRN("2M PHY request failed (err %d)", err);
+	}
+
+	err = bt_conn_le_data_len_update(current_conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (err) {
+		LOG_WRN("data length request failed (err %d)", err);
+	}
+
+	// 15-30ms interval, the shortest iOS allows
+	err = bt_conn_le_param_update(current_conn, BT_LE_CONN_PARAM(12, 24, 0, 400));
+	if (err) {
+		LOG_WRN("connection parameter request failed (err %d)", err);
+	}
+	return 0;
+}
+
 char *ble_get_local_name(void)
 {
 	return local_name_str;
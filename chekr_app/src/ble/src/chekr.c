@@ -72,7 +72,6 @@ static int set_dog_collar_position(char *data, int len);
 static int set_dog_size(char *data, int len);
 static int get_epoch_rtc(char *data, int len);
 static int set_epoch_rtc(char *data, int len);
-static int start_stop_raw_data_harvesting(char *data, int len) __attribute__((unused));
 static int start_stop_activity_data_harvesting(char *data, int len) __attribute__((unused));
 static int start_stop_periodic_dashboard_status_info(char *data, int len);
 static int ble_status_show(char *data, int len);
@@ -102,6 +101,9 @@ static cmd_jump_entry_t command_jump_table[] = {
 	 READ_REC_SESSION_DETAILS_FRAME_LEN},
 	{READ_REC_SESSION_DATA_RAW_IMU, read_rec_session_data_raw_imu,
 	 READ_REC_SESSION_DATA_FRAME_LEN},
+	// streams a whole raw IMU session instead of one record per request
+	{START_STOP_RAW_DATA_HARVESTING, start_stop_raw_data_harvesting,
+	 START_STOP_RAW_HARVEST_FRAME_LEN},
 
 	{READ_REC_SESSION_DETAILS_ACTIVITY, read_rec_session_details_activity,
 	 READ_REC_SESSION_DETAILS_FRAME_LEN},
@@ -224,6 +226,17 @@ void write_to_central(uint8_t *data, int len)
 	}
 }
 
+// send a notification, the caller must be able to block until there is a buffer for it
+int notify_central(const uint8_t *data, uint16_t len)
+{
+	struct bt_conn *conn = ble_get_conn();
+
+	if (conn == NULL || !notify_enable) {
+		return -ENOTCONN;
+	}
+	return bt_gatt_notify(conn, &chekr_service.attrs[1], data, len);
+}
+
 int chekr_service_init(void)
 {
 	// create ChekrAppLink service
@@ -536,11 +549,6 @@ static int set_epoch_rtc(char *data, int len)
 	return 0;
 }
 
-static int start_stop_raw_data_harvesting(char *data, int len)
-{
-	return 0;
-}
-
 static int start_stop_activity_data_harvesting(char *data, int len)
 {
 	return 0;
@@ -41,11 +41,12 @@ static int record_to_file(char *filename, RecordTypeE type);
 
 static file_handle_t m_handle;
 
-// we use this struct to queue samples for recording
-struct sample_queue_t {
-	struct k_work work;
-	imu_sample_t sample;
-};
+// samples are queued here by the IMU trigger and written out on the system work queue.
+// 16 samples is about a second at RECORD_SAMPLE_RATE
+#define RECORD_QUEUE_LEN (16)
+K_MSGQ_DEFINE(record_msgq, sizeof(imu_sample_t), RECORD_QUEUE_LEN, 4);
+static void record_sample_work_handler(struct k_work *work);
+K_WORK_DEFINE(record_sample_work, record_sample_work_handler);
 
 void recording_timer_work_handler(struct k_work *work)
 {
@@ -65,26 +66,20 @@ static void record_sample_work_handler(struct k_work *work)
 {
 	imu_sample_t sample;
 
-	// copy queued data, and free it asap
-	struct sample_queue_t *sample_q = CONTAINER_OF(work, struct sample_queue_t, work);
-	memcpy((uint8_t *)&sample, (uint8_t *)&sample_q->sample, sizeof(imu_sample_t));
-	k_free(sample_q);
-
-	// now process it for recording
-	chekr_record_samples(sample);
+	// one work item drains everything queued since it was submitted
+	while (k_msgq_get(&record_msgq, &sample, K_NO_WAIT) == 0) {
+		chekr_record_samples(sample);
+	}
 }
 
 static int record_samples_cb(imu_sample_t data)
 {
 	// put imu data on a work queue and process outside of trigger callback
-	struct sample_queue_t *sample_q = k_malloc(sizeof(struct sample_queue_t));
-	if (!sample_q) {
-		LOG_ERR("can't malloc sample_q!");
+	if (k_msgq_put(&record_msgq, &data, K_NO_WAIT)) {
+		LOG_ERR("record queue full, dropping sample %u", data.sample_count);
 		return -1;
 	}
-	memcpy((uint8_t *)&sample_q->sample, (uint8_t *)&data, sizeof(imu_sample_t));
-	k_work_init(&sample_q->work, record_sample_work_handler);
-	k_work_submit(&sample_q->work);
+	k_work_submit(&record_sample_work);
 	return 0;
 }
 
@@ -111,7 +106,7 @@ int chekr_record_samples(imu_sample_t data)
 		record.timestamp = sys_cpu_to_be64(data.timestamp);
 	}
 
-	// feed sample to ML module
+	// hand sample to the ML thread, this doesn't wait for inference
 	ml_feed_sample(data);
 
 	record.raw_data[index].ax = data.ax;
@@ -186,6 +181,7 @@ static int record_to_file(char *filename, RecordTypeE type)
 		k_timer_stop(&recording_timer);
 
 		imu_enable(IMU_ODR_0_HZ, NULL); // stop IMU
+		k_msgq_purge(&record_msgq);
 
 		LOG_INF("stopped IMU");
 
@@ -474,6 +470,233 @@ int read_rec_session_data_activity(char *data, int len)
 	return 0;
 }
 
+/***********************************************/
+// Streaming harvest of a raw IMU session
+/***********************************************/
+// Instead of one record per request, the whole .imu file is pushed as back to back
+// notifications on the notify characteristic:
+//   [seq (be16)][file data ...]                          one per notification
+//   [0xffff][total bytes (be32)][crc16 modbus (be16)]    trailer, crc over all file data
+// Every notification costs one credit. The central grants credits with the start request
+// and tops them up with HARVEST_CREDIT requests, and ends the harvest with HARVEST_STOP,
+// which also deletes the file if it was sent completely.
+#define HARVEST_STACK_SIZE (2048)
+#define HARVEST_PRIORITY   (8)
+
+// the file is read ahead this much at a time
+#define HARVEST_BLOCK_SIZE (8 * sizeof(raw_imu_record_t))
+
+// biggest notification, the ATT payload with data length extension (251 - 4 - 3)
+#define HARVEST_MAX_NOTIFY  (244)
+#define HARVEST_SEQ_LEN     (sizeof(uint16_t))
+#define HARVEST_TRAILER_SEQ (0xffff)
+
+// give up when the central stops granting credits
+#define HARVEST_CREDIT_TIMEOUT_S (10)
+
+typedef enum {
+	HARVEST_STOP = 0,
+	HARVEST_START,
+	HARVEST_CREDIT,
+} HarvestOpE;
+
+// active is cleared by a stop request, busy only once the thread let go of the reader
+static struct {
+	volatile bool active;
+	volatile bool busy;
+	volatile bool complete;
+	char uid_str[8 * 2 + 1];
+	storage_reader_t *reader;
+	uint32_t size;
+} m_harvest;
+
+static atomic_t m_harvest_credits;
+static K_SEM_DEFINE(harvest_start_sem, 0, 1);
+static K_SEM_DEFINE(harvest_credit_sem, 0, 1);
+
+static uint8_t m_harvest_block[HARVEST_BLOCK_SIZE];
+static uint8_t m_harvest_notify[HARVEST_MAX_NOTIFY];
+
+static uint16_t harvest_chunk_size(void)
+{
+	return MIN(ble_get_mtu() - 3, HARVEST_MAX_NOTIFY) - HARVEST_SEQ_LEN;
+}
+
+static int harvest_send(uint16_t len)
+{
+	// a stop ends the stream at once, not only when the credits run out
+	while (m_harvest.active && atomic_get(&m_harvest_credits) <= 0) {
+		if (k_sem_take(&harvest_credit_sem, K_SECONDS(HARVEST_CREDIT_TIMEOUT_S))) {
+			LOG_ERR("harvest: no credits from central for %d s", HARVEST_CREDIT_TIMEOUT_S);
+			return -ETIMEDOUT;
+		}
+	}
+	if (!m_harvest.active) {
+		return -ECANCELED;
+	}
+	atomic_dec(&m_harvest_credits);
+	return notify_central(m_harvest_notify, len);
+}
+
+static int harvest_stream(void)
+{
+	uint16_t chunk = harvest_chunk_size();
+	uint16_t crc = UTILS_CRC16_MODBUS_INIT;
+	uint16_t seq = 0;
+	uint32_t sent = 0;
+	int64_t start = k_uptime_get();
+	int ret;
+
+	while (sent < m_harvest.size) {
+		size_t want = MIN(sizeof(m_harvest_block), m_harvest.size - sent);
+		int len = storage_read_block(m_harvest.reader, m_harvest_block, want);
+		if (len <= 0) {
+			return len < 0 ? len : -EIO;
+		}
+		crc = utils_crc16_modbus_update(crc, m_harvest_block, len);
+
+		for (int off = 0; off < len; off += chunk) {
+			uint16_t n = MIN(chunk, len - off);
+
+			sys_put_be16(seq++, m_harvest_notify);
+			memcpy(&m_harvest_notify[HARVEST_SEQ_LEN], &m_harvest_block[off], n);
+			ret = harvest_send(HARVEST_SEQ_LEN + n);
+			if (ret) {
+				return ret;
+			}
+		}
+		sent += len;
+	}
+
+	sys_put_be16(HARVEST_TRAILER_SEQ, &m_harvest_notify[0]);
+	sys_put_be32(sent, &m_harvest_notify[2]);
+	sys_put_be16(crc, &m_harvest_notify[6]);
+	ret = harvest_send(8);
+
+	LOG_INF("harvested %u bytes in %u notifications, %lld ms", sent, seq,
+		k_uptime_get() - start);
+	return ret;
+}
+
+static void harvest_thread(void *p1, void *p2, void *p3)
+{
+	while (true) {
+		k_sem_take(&harvest_start_sem, K_FOREVER);
+
+		int ret = harvest_stream();
+		if (ret) {
+			LOG_ERR("harvest of %s stopped: %d", m_harvest.uid_str, ret);
+		}
+		storage_close_reader(m_harvest.reader);
+		m_harvest.reader = NULL;
+		m_harvest.complete = (ret == 0);
+		m_harvest.active = false;
+		m_harvest.busy = false;
+	}
+}
+
+K_THREAD_DEFINE(harvest_tid, HARVEST_STACK_SIZE, harvest_thread, NULL, NULL, NULL,
+		HARVEST_PRIORITY, 0, 0);
+
+int start_stop_raw_data_harvesting(char *data, int len)
+{
+	typedef struct __attribute__((__packed__)) {
+		frame_format_header_t header;
+		uint8_t op;
+		uint8_t uid[8];
+		uint16_t credits;
+		uint16_t crc;
+	} raw_harvest_req_t;
+
+	raw_harvest_req_t *req = (raw_harvest_req_t *)data;
+	uint16_t credits = sys_be16_to_cpu(req->credits);
+	error_code_t ack = ERR_NONE;
+
+	// send response
+	typedef struct __attribute__((__packed__)) {
+		frame_format_header_t header;
+		uint8_t ack;
+		uint8_t uid[8];
+		uint16_t num_records;
+		uint32_t num_bytes;
+		uint8_t chunk_size;
+		uint16_t crc;
+	} raw_harvest_resp_t;
+
+	raw_harvest_resp_t resp = {
+		.header.start_byte = SB_DEVICE_TO_MOBILE_APP,
+		.header.frame_len = sizeof(raw_harvest_resp_t),
+		.header.frame_type = FT_REPORT,
+		.header.cmd = START_STOP_RAW_DATA_HARVESTING,
+	};
+	memcpy(resp.uid, req->uid, sizeof(req->uid));
+
+	switch (req->op) {
+	case HARVEST_CREDIT:
+		// credits arrive often during a harvest, they don't get a response
+		atomic_add(&m_harvest_credits, credits);
+		k_sem_give(&harvest_credit_sem);
+		return 0;
+
+	case HARVEST_START:
+		if (m_harvest.active || m_harvest.busy) {
+			ack = ERR_CANNOT_PROCESS_OR_BUSY;
+			break;
+		}
+		if (recording_in_progress()) {
+			LOG_WRN("stopping current recording!");
+			record_to_file("active", RECORD_STOP);
+		}
+
+		for (int i = 0; i < 8; i++) {
+			sprintf(&m_harvest.uid_str[i * 2], "%02X", req->uid[i]);
+		}
+		// records are compressed on flash, so the count doesn't follow from the size
+		int record_count = storage_get_raw_imu_record_count(m_harvest.uid_str);
+		m_harvest.reader = storage_open_raw_imu_reader(m_harvest.uid_str, &m_harvest.size);
+		if (record_count < 0 || m_harvest.reader == NULL) {
+			if (m_harvest.reader) {
+				storage_close_reader(m_harvest.reader);
+			}
+			ack = ERR_NEGATIVE_ACK;
+			break;
+		}
+
+		ble_request_fast_link();
+		resp.num_records = sys_cpu_to_be16(record_count);
+		resp.num_bytes = sys_cpu_to_be32(m_harvest.size);
+		resp.chunk_size = harvest_chunk_size();
+
+		atomic_set(&m_harvest_credits, credits);
+		m_harvest.complete = false;
+		m_harvest.busy = true;
+		m_harvest.active = true;
+		k_sem_give(&harvest_start_sem);
+		LOG_INF("harvesting %s, %u bytes", m_harvest.uid_str, m_harvest.size);
+		break;
+
+	case HARVEST_STOP:
+		if (m_harvest.active) {
+			// wakes the harvest thread, which gives up at once
+			m_harvest.active = false;
+			k_sem_give(&harvest_credit_sem);
+		} else if (m_harvest.complete) {
+			storage_delete_raw_imu_file(m_harvest.uid_str);
+			m_harvest.complete = false;
+		}
+		break;
+
+	default:
+		ack = ERR_INVALID_DATA;
+		break;
+	}
+
+	resp.ack = ack;
+	resp.crc = utils_crc16_modbus((const uint8_t *)&resp, sizeof(resp) - sizeof(uint16_t));
+	write_to_central((uint8_t *)&resp, sizeof(resp));
+	return 0;
+}
+
 static int record(const struct shell *sh, size_t argc, char **argv)
 {
 	char *filename = argv[1];
@@ -1,11 +1,16 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define UTILS_CRC16_MODBUS_INIT (0xFFFF)
+
 uint16_t utils_crc16_modbus(const uint8_t *data, uint16_t length);
+// running crc over several buffers, start from UTILS_CRC16_MODBUS_INIT (result in cpu order)
+uint16_t utils_crc16_modbus_update(uint16_t crc, const uint8_t *data, size_t length);
 uint64_t utils_get_currentmillis(void);
 uint64_t utils_get_currentmicros(void);
 int util_enable_dialog(bool enable);
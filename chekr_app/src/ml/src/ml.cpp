@@ -1,4 +1,6 @@
+#include <zephyr/kernel.h>
 #include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/byteorder.h>
 
 LOG_MODULE_REGISTER(ml, LOG_LEVEL_DBG);
@@ -22,6 +24,108 @@ static PetSize m_pet_size = size_medium;
 
 static void handle_result(InferResult result);
 
+// inference runs on its own thread, below the system work queue and BLE, so a slow
+// inference only delays the next one
+#define ML_THREAD_STACK_SIZE (8192)
+#define ML_THREAD_PRIORITY   (10)
+
+// samples waiting for the ML thread, ~4s at 15Hz. Must be a power of two
+#define ML_RING_SIZE (64)
+BUILD_ASSERT((ML_RING_SIZE & (ML_RING_SIZE - 1)) == 0, "ML_RING_SIZE must be a power of two");
+
+// how long ml_start(false, ...) waits for the ML thread to catch up
+#define ML_DRAIN_TIMEOUT_MS (2000)
+
+// single producer (the record path) / single consumer (the ML thread) ring. Only the
+// producer moves head and only the consumer moves tail, so neither side takes a lock
+static IMUData m_ring[ML_RING_SIZE];
+static atomic_t m_ring_head;
+static atomic_t m_ring_tail;
+static K_SEM_DEFINE(m_ring_sem, 0, 1);
+
+// keeps initiate() and the result file handle away from an inference in progress
+static K_MUTEX_DEFINE(m_lib_lock);
+
+// producer side counters, except processed which is the consumer's
+static struct {
+	uint32_t fed;
+	uint32_t processed;
+	uint32_t dropped;   // samples lost because the ring was full
+	uint32_t overflows; // times the ring filled up
+	uint32_t max_depth;
+	bool overflowing;
+} m_ring_stats;
+
+static uint32_t ml_ring_depth(void)
+{
+	return (uint32_t)atomic_get(&m_ring_head) - (uint32_t)atomic_get(&m_ring_tail);
+}
+
+static int ml_ring_put(const IMUData *sample)
+{
+	uint32_t head = (uint32_t)atomic_get(&m_ring_head);
+	uint32_t depth = head - (uint32_t)atomic_get(&m_ring_tail);
+
+	if (depth >= ML_RING_SIZE) {
+		m_ring_stats.dropped++;
+		if (!m_ring_stats.overflowing) {
+			m_ring_stats.overflows++;
+			LOG_WRN("ML is %d samples behind, dropping samples", ML_RING_SIZE);
+		}
+		m_ring_stats.overflowing = true;
+		return -ENOMEM;
+	}
+	m_ring_stats.overflowing = false;
+
+	m_ring[head & (ML_RING_SIZE - 1)] = *sample;
+	// publish the slot only once it has been written
+	atomic_set(&m_ring_head, head + 1);
+	k_sem_give(&m_ring_sem);
+
+	m_ring_stats.fed++;
+	if (depth + 1 > m_ring_stats.max_depth) {
+		m_ring_stats.max_depth = depth + 1;
+	}
+	return 0;
+}
+
+static void ml_thread(void *p0, void *p1, void *p2)
+{
+	while (true) {
+		k_sem_take(&m_ring_sem, K_FOREVER);
+
+		uint32_t tail = (uint32_t)atomic_get(&m_ring_tail);
+		while (tail != (uint32_t)atomic_get(&m_ring_head)) {
+			IMUData sample = m_ring[tail & (ML_RING_SIZE - 1)];
+
+			k_mutex_lock(&m_lib_lock, K_FOREVER);
+			// the slot can be reused as soon as it has been copied
+			atomic_set(&m_ring_tail, ++tail);
+			processIMUData(sample);
+			k_mutex_unlock(&m_lib_lock);
+			m_ring_stats.processed++;
+		}
+	}
+}
+
+K_THREAD_DEFINE(ml_tid, ML_THREAD_STACK_SIZE, ml_thread, NULL, NULL, NULL, ML_THREAD_PRIORITY, 0,
+		0);
+
+// wait for the ML thread to finish what is queued, so no result is lost on stop
+static int ml_drain(void)
+{
+	int64_t timeout = k_uptime_get() + ML_DRAIN_TIMEOUT_MS;
+
+	while (ml_ring_depth() > 0) {
+		if (k_uptime_get() > timeout) {
+			LOG_WRN("ML thread still has %u samples queued", ml_ring_depth());
+			return -ETIMEDOUT;
+		}
+		k_msleep(10);
+	}
+	return 0;
+}
+
 int ml_init(void)
 {
 	LOG_DBG("ML Init ...");
@@ -43,16 +147,23 @@ int ml_start(bool start, file_handle_t handle)
 
 	if (start) {
 		op = "starting";
+		k_mutex_lock(&m_lib_lock, K_FOREVER);
 		m_record_num = 0;
 		bool ret = initiate(handle_result, REPETITION_CALL_INTERVAL, m_pet_size);
 		if (ret == false) {
+			k_mutex_unlock(&m_lib_lock);
 			LOG_ERR("can't start ML library!");
 			return -1;
 		}
 		m_file_handle = handle;
+		k_mutex_unlock(&m_lib_lock);
 	} else {
 		op = "stopping";
+		ml_drain();
+		// also waits for an inference that is still running
+		k_mutex_lock(&m_lib_lock, K_FOREVER);
 		m_file_handle = NULL;
+		k_mutex_unlock(&m_lib_lock);
 	}
 
 	LOG_DBG("%s stream to ML model", op);
@@ -108,7 +219,7 @@ int ml_feed_sample(imu_sample_t data)
 		imu_sample.imuValues[3] = data.gx;
 		imu_sample.imuValues[4] = data.gy;
 		imu_sample.imuValues[5] = data.gz;
-		processIMUData(imu_sample);
+		return ml_ring_put(&imu_sample);
 	}
 
 	return 0;
@@ -172,5 +283,17 @@ static int ml_version_shell(const struct shell *sh, size_t argc, char **argv)
 	return 0;
 }
 
+static int ml_stats_shell(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "fed:       %u", m_ring_stats.fed);
+	shell_print(sh, "processed: %u", m_ring_stats.processed);
+	shell_print(sh, "queued:    %u of %d (max %u)", ml_ring_depth(), ML_RING_SIZE,
+		    m_ring_stats.max_depth);
+	shell_print(sh, "dropped:   %u in %u overflows", m_ring_stats.dropped,
+		    m_ring_stats.overflows);
+	return 0;
+}
+
+SHELL_CMD_REGISTER(ml_stats, NULL, "Print ML sample queue counters", ml_stats_shell);
 SHELL_CMD_REGISTER(ml_verbose, NULL, "ML toggle verbosity", ml_verbose_shell);
 SHELL_CMD_REGISTER(ml_version, NULL, "Print version of ML library", ml_version_shell);
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "storage.h"
+
+// Compressed raw IMU session format (.imu files starting with IMU_CODEC_MAGIC)
+//
+// file:   [magic "IMZ1"][records per block][3 reserved] then one encoded record after another
+// record: [payload len (le16)][record_num (as stored)][timestamp (as stored)]
+//         [accel scale (float)][gyro scale (float)] then for each of ax, ay, az, gx, gy, gz:
+//         [bits][first count (le16)][9 zig-zag deltas of 'bits' bits each, lsb first]
+// A sample is count * scale. The scale is one sensor count, unless the record holds values
+// too large for int16 at that resolution.
+//
+// A separate index file (.imx) holds the file offset (le32) of the first record of every
+// block of IMU_CODEC_RECORDS_PER_BLOCK records, so record N can be found without decoding
+// everything in front of it.
+
+#define IMU_CODEC_MAGIC             "IMZ1"
+#define IMU_CODEC_HEADER_LEN        (8)
+#define IMU_CODEC_RECORDS_PER_BLOCK (16)
+#define IMU_CODEC_LEN_PREFIX        (sizeof(uint16_t))
+
+// worst case, every delta needing 17 bits
+#define IMU_CODEC_MAX_LEN                                                                          \
+	(IMU_CODEC_LEN_PREFIX + 4 + 8 + 2 * 4 + 6 * (1 + 2 + (17 * (RAW_FRAMES_PER_RECORD - 1) + 7) / 8))
+
+// write the file header into buf (IMU_CODEC_HEADER_LEN bytes)
+void imu_codec_header(uint8_t *buf);
+
+// true if buf (IMU_CODEC_HEADER_LEN bytes) is the header of a compressed file
+bool imu_codec_is_compressed(const uint8_t *buf);
+
+// encode a record, including its length prefix. returns the encoded length
+int imu_codec_encode(const raw_imu_record_t *record, uint8_t *buf, size_t size);
+
+// decode a record payload (after the length prefix)
+int imu_codec_decode(const uint8_t *buf, size_t len, raw_imu_record_t *record);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define RAW_FRAMES_PER_RECORD (10)
 
@@ -12,6 +13,9 @@ extern "C" {
 typedef struct file_data_t file_data_t;
 typedef struct file_data_t *file_handle_t;
 
+// opaque reader for streaming a recorded file
+typedef struct storage_reader_t storage_reader_t;
+
 typedef struct __attribute__((__packed__)) {
 	float ax, ay, az; // accelerometer
 	float gx, gy, gz; // gyro
@@ -52,6 +56,14 @@ int storage_write_raw_imu_record(file_handle_t handle, raw_imu_record_t raw_reco
 int storage_get_raw_imu_record_count(char *basename);
 int storage_read_raw_imu_record(char *basename, int record_number, raw_imu_record_t *record);
 
+// streaming reads of a raw IMU file, for harvesting it in one go. size is set to the
+// number of bytes to send: the whole file if it is compressed (see imu_codec.h), whole
+// records for older uncompressed files. storage_read_block returns bytes read, 0 at the end
+storage_reader_t *storage_open_raw_imu_reader(char *basename, uint32_t *size);
+int storage_read_block(storage_reader_t *reader, void *buf, size_t len);
+int storage_close_reader(storage_reader_t *reader);
+int storage_delete_raw_imu_file(char *basename);
+
 // activity data related interfaces
 int storage_write_activity_record(file_handle_t handle, activity_record_t raw_record);
 int storage_get_activity_record_count(char *basename);
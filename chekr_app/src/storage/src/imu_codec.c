@@ -0,0 +1,303 @@
+/*
+ * Compressed raw IMU session records, see imu_codec.h for the layout
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "imu_codec.h"
+
+#define AXES (6)
+
+// one sensor count at the ranges the board configures the LSM6DSV16X for (4g, 500dps),
+// finer steps than this only store noise. imu.c stores the frames in g and dps
+#define ACCEL_COUNT (0.122e-3f) // g
+#define GYRO_COUNT  (17.5e-3f)  // dps
+
+typedef struct {
+	uint8_t *buf;
+	size_t len;
+	uint32_t acc;
+	int bits;
+} bit_writer_t;
+
+typedef struct {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	uint32_t acc;
+	int bits;
+} bit_reader_t;
+
+// the frames are packed, so no pointers into them
+static float frame_value(const raw_imu_record_t *record, int frame, int axis)
+{
+	const raw_imu_data_frame_t *f = &record->raw_data[frame];
+
+	switch (axis) {
+	case 0:
+		return f->ax;
+	case 1:
+		return f->ay;
+	case 2:
+		return f->az;
+	case 3:
+		return f->gx;
+	case 4:
+		return f->gy;
+	default:
+		return f->gz;
+	}
+}
+
+static void set_frame_value(raw_imu_record_t *record, int frame, int axis, float value)
+{
+	raw_imu_data_frame_t *f = &record->raw_data[frame];
+
+	switch (axis) {
+	case 0:
+		f->ax = value;
+		break;
+	case 1:
+		f->ay = value;
+		break;
+	case 2:
+		f->az = value;
+		break;
+	case 3:
+		f->gx = value;
+		break;
+	case 4:
+		f->gy = value;
+		break;
+	default:
+		f->gz = value;
+		break;
+	}
+}
+
+// one sensor count, or coarser if the largest magnitude of the sensor (3 axes) in this
+// record would not fit int16 otherwise
+static float sensor_scale(const raw_imu_record_t *record, int first_axis, float count)
+{
+	float max = 0;
+
+	for (int i = 0; i < RAW_FRAMES_PER_RECORD; i++) {
+		for (int axis = first_axis; axis < first_axis + 3; axis++) {
+			float v = fabsf(frame_value(record, i, axis));
+			if (v > max) {
+				max = v;
+			}
+		}
+	}
+	return MAX(max / INT16_MAX, count);
+}
+
+static uint32_t zigzag(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int bit_width(uint32_t v)
+{
+	int bits = 0;
+
+	while (v) {
+		bits++;
+		v >>= 1;
+	}
+	return bits;
+}
+
+static void put_bits(bit_writer_t *w, uint32_t value, int bits)
+{
+	w->acc |= value << w->bits;
+	w->bits += bits;
+	while (w->bits >= 8) {
+		w->buf[w->len++] = w->acc & 0xff;
+		w->acc >>= 8;
+		w->bits -= 8;
+	}
+}
+
+static void flush_bits(bit_writer_t *w)
+{
+	if (w->bits > 0) {
+		w->buf[w->len++] = w->acc & 0xff;
+	}
+	w->acc = 0;
+	w->bits = 0;
+}
+
+static int get_bits(bit_reader_t *r, int bits, uint32_t *value)
+{
+	while (r->bits < bits) {
+		if (r->pos >= r->len) {
+			return -EINVAL;
+		}
+		r->acc |= (uint32_t)r->buf[r->pos++] << r->bits;
+		r->bits += 8;
+	}
+	*value = r->acc & ((1u << bits) - 1);
+	r->acc >>= bits;
+	r->bits -= bits;
+	return 0;
+}
+
+void imu_codec_header(uint8_t *buf)
+{
+	memset(buf, 0, IMU_CODEC_HEADER_LEN);
+	memcpy(buf, IMU_CODEC_MAGIC, 4);
+	buf[4] = IMU_CODEC_RECORDS_PER_BLOCK;
+}
+
+bool imu_codec_is_compressed(const uint8_t *buf)
+{
+	return memcmp(buf, IMU_CODEC_MAGIC, 4) == 0 && buf[4] == IMU_CODEC_RECORDS_PER_BLOCK;
+}
+
+int imu_codec_encode(const raw_imu_record_t *record, uint8_t *buf, size_t size)
+{
+	bit_writer_t w = {.buf = buf, .len = IMU_CODEC_LEN_PREFIX};
+	float scale[2] = {sensor_scale(record, 0, ACCEL_COUNT), sensor_scale(record, 3, GYRO_COUNT)};
+
+	if (size < IMU_CODEC_MAX_LEN) {
+		return -ENOMEM;
+	}
+
+	// record_num and timestamp are kept exactly as they are stored (big endian)
+	memcpy(&buf[w.len], &record->record_num, sizeof(record->record_num));
+	w.len += sizeof(record->record_num);
+	memcpy(&buf[w.len], &record->timestamp, sizeof(record->timestamp));
+	w.len += sizeof(record->timestamp);
+	memcpy(&buf[w.len], scale, sizeof(scale));
+	w.len += sizeof(scale);
+
+	for (int axis = 0; axis < AXES; axis++) {
+		int16_t counts[RAW_FRAMES_PER_RECORD];
+		uint32_t deltas[RAW_FRAMES_PER_RECORD - 1];
+		uint32_t widest = 0;
+
+		for (int i = 0; i < RAW_FRAMES_PER_RECORD; i++) {
+			counts[i] = (int16_t)lrintf(frame_value(record, i, axis) / scale[axis / 3]);
+			if (i > 0) {
+				deltas[i - 1] = zigzag((int32_t)counts[i] - counts[i - 1]);
+				widest |= deltas[i - 1];
+			}
+		}
+
+		int bits = bit_width(widest);
+		buf[w.len++] = bits;
+		buf[w.len++] = (uint16_t)counts[0] & 0xff;
+		buf[w.len++] = (uint16_t)counts[0] >> 8;
+		for (int i = 0; i < RAW_FRAMES_PER_RECORD - 1; i++) {
+			put_bits(&w, deltas[i], bits);
+		}
+		flush_bits(&w);
+	}
+
+	uint16_t payload = w.len - IMU_CODEC_LEN_PREFIX;
+	buf[0] = payload & 0xff;
+	buf[1] = payload >> 8;
+	return w.len;
+}
+
+int imu_codec_decode(const uint8_t *buf, size_t len, raw_imu_record_t *record)
+{
+	bit_reader_t r = {.buf = buf, .len = len};
+	float scale[2];
+
+	if (len < sizeof(record->record_num) + sizeof(record->timestamp) + sizeof(scale)) {
+		return -EINVAL;
+	}
+	memcpy(&record->record_num, &buf[r.pos], sizeof(record->record_num));
+	r.pos += sizeof(record->record_num);
+	memcpy(&record->timestamp, &buf[r.pos], sizeof(record->timestamp));
+	r.pos += sizeof(record->timestamp);
+	memcpy(scale, &buf[r.pos], sizeof(scale));
+	r.pos += sizeof(scale);
+
+	for (int axis = 0; axis < AXES; axis++) {
+		if (r.pos + 3 > len) {
+			return -EINVAL;
+		}
+		int bits = buf[r.pos];
+		int32_t count = (int16_t)(buf[r.pos + 1] | buf[r.pos + 2] << 8);
+		r.pos += 3;
+		if (bits > 17) {
+			return -EINVAL;
+		}
+
+		set_frame_value(record, 0, axis, count * scale[axis / 3]);
+		for (int i = 1; i < RAW_FRAMES_PER_RECORD; i++) {
+			uint32_t delta;
+
+			if (get_bits(&r, bits, &delta)) {
+				return -EINVAL;
+			}
+			count += unzigzag(delta);
+			set_frame_value(record, i, axis, count * scale[axis / 3]);
+		}
+		// each axis starts on a byte boundary
+		r.acc = 0;
+		r.bits = 0;
+	}
+	return 0;
+}
+
+// round trip a walking-like record, with one frame at the end of the sensor range, and check
+// that it is kept at one count resolution and no sample moves by more than half a count
+static int imu_codec_check(const struct shell *sh, size_t argc, char **argv)
+{
+	static raw_imu_record_t in, out;
+	static uint8_t buf[IMU_CODEC_MAX_LEN];
+	const float count[2] = {ACCEL_COUNT, GYRO_COUNT};
+	float worst[2] = {0};
+
+	in.record_num = 1234;
+	in.timestamp = 1700000000000ULL;
+	for (int i = 0; i < RAW_FRAMES_PER_RECORD; i++) {
+		float phase = i * 0.6f;
+
+		set_frame_value(&in, i, 0, 0.31f * sinf(phase));
+		set_frame_value(&in, i, 1, -0.12f + 0.08f * cosf(phase));
+		set_frame_value(&in, i, 2, 0.98f + 0.55f * sinf(phase + 0.4f));
+		set_frame_value(&in, i, 3, 180.3f * sinf(phase));
+		set_frame_value(&in, i, 4, -42.7f * cosf(phase));
+		set_frame_value(&in, i, 5, 7.9f + 3.1f * sinf(phase));
+	}
+	set_frame_value(&in, RAW_FRAMES_PER_RECORD - 1, 0, -3.99f);
+	set_frame_value(&in, RAW_FRAMES_PER_RECORD - 1, 3, 499.0f);
+
+	int len = imu_codec_encode(&in, buf, sizeof(buf));
+	if (len < 0 || imu_codec_decode(&buf[IMU_CODEC_LEN_PREFIX], len - IMU_CODEC_LEN_PREFIX, &out)) {
+		shell_error(sh, "round trip failed: %d", len);
+		return -EINVAL;
+	}
+	for (int i = 0; i < RAW_FRAMES_PER_RECORD; i++) {
+		for (int axis = 0; axis < AXES; axis++) {
+			float err = fabsf(frame_value(&out, i, axis) - frame_value(&in, i, axis));
+			worst[axis / 3] = MAX(worst[axis / 3], err / count[axis / 3]);
+		}
+	}
+	bool ok = in.record_num == out.record_num && in.timestamp == out.timestamp &&
+		  sensor_scale(&in, 0, ACCEL_COUNT) == ACCEL_COUNT &&
+		  sensor_scale(&in, 3, GYRO_COUNT) == GYRO_COUNT && worst[0] <= 0.5001f &&
+		  worst[1] <= 0.5001f;
+
+	shell_print(sh, "%d bytes for %d, worst error %.3f / %.3f counts: %s", len,
+		    (int)sizeof(raw_imu_record_t), (double)worst[0], (double)worst[1],
+		    ok ? "PASS" : "FAIL");
+	return ok ? 0 : -EINVAL;
+}
+
+SHELL_CMD_REGISTER(imu_codec_check, NULL, "round trip a record through the IMU codec",
+		   imu_codec_check);
@@ -1,3 +1,5 @@
+#include <errno.h>
+#include <string.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/logging/log_ctrl.h>
@@ -10,30 +12,73 @@
 #include <zephyr/fs/littlefs.h>
 
 #include "storage.h"
+#include "imu_codec.h"
 
 #define MAX_PATH_LEN (256)
 
 #define PARTITION_NODE DT_NODELABEL(lfs1)
 FS_FSTAB_DECLARE_ENTRY(PARTITION_NODE);
 
+#define MAX_NAME_LEN   (32)
 #define MAX_OPEN_FILES (1)
 
 struct file_data_t {
+	char basename[MAX_NAME_LEN];
 	char imu_filename[MAX_PATH_LEN];
 	char activity_filename[MAX_PATH_LEN];
+	char index_filename[MAX_PATH_LEN];
 	struct fs_file_t imu_file;      // .imu
 	struct fs_file_t activity_file; // .act
-	uint16_t imu_sample_count;
+	struct fs_file_t index_file;    // .imx, block offsets into .imu
+	uint32_t imu_offset;            // bytes written to .imu
+	uint32_t imu_sample_count;
 	uint16_t activity_sample_count;
 };
 
 static struct file_data_t m_file_data[MAX_OPEN_FILES];
 static int m_open_file_count;
 
+// a raw imu file held open for a streaming harvest
+struct storage_reader_t {
+	char filename[MAX_PATH_LEN];
+	struct fs_file_t file;
+	bool is_open;
+};
+
+static struct storage_reader_t m_reader;
+
+// files recently read record by record, kept open so reading a session through doesn't
+// reopen, stat and seek the file for every record
+#define READ_CACHE_SIZE (2)
+
+enum read_file_type {
+	READ_FILE_IMU,
+	READ_FILE_ACTIVITY,
+};
+
+struct read_cache_t {
+	char basename[MAX_NAME_LEN];
+	enum read_file_type type;
+	struct fs_file_t file;
+	struct fs_file_t index_file; // .imx, for compressed imu files only
+	bool in_use;
+	bool compressed;
+	int record_count; // -1 until counted, and again whenever the file is written
+	int next_record;  // record at the file position, -1 if not known
+	uint32_t last_used;
+};
+
+static struct read_cache_t m_read_cache[READ_CACHE_SIZE];
+static uint32_t m_read_clock;
+static K_MUTEX_DEFINE(m_read_cache_lock);
+
 static struct fs_mount_t *mp = &FS_FSTAB_ENTRY(PARTITION_NODE);
 
 static int lsdir(const char *path);
 static void erase_and_reboot(void);
+static int unlink_raw_imu(char *basename);
+static void cache_forget(const char *basename);
+static void cache_invalidate_count(const char *basename);
 
 LOG_MODULE_REGISTER(storage, LOG_LEVEL_DBG);
 
@@ -69,7 +114,15 @@ file_handle_t storage_open_file(char *fname)
 
 	struct file_data_t *file_data = &m_file_data[m_open_file_count];
 
-	// imu file
+	if (strlen(fname) >= MAX_NAME_LEN) {
+		LOG_ERR("file name too long: %s", fname);
+		return NULL;
+	}
+	strcpy(file_data->basename, fname);
+	// both files are started over, so drop anything read from them before
+	cache_forget(fname);
+
+	// imu file, compressed, see imu_codec.h
 	snprintf(file_data->imu_filename, MAX_PATH_LEN, "%s/%s.imu", mp->mnt_point, fname);
 	file_data->imu_sample_count = 0;
 	fs_file_t_init(&file_data->imu_file);
@@ -79,6 +132,33 @@ file_handle_t storage_open_file(char *fname)
 		return NULL;
 	}
 
+	uint8_t header[IMU_CODEC_HEADER_LEN];
+
+	imu_codec_header(header);
+	rc = fs_truncate(&file_data->imu_file, 0);
+	if (rc == 0) {
+		rc = fs_write(&file_data->imu_file, header, sizeof(header));
+	}
+	if (rc < 0) {
+		LOG_ERR("FAIL: write %s: %d", file_data->imu_filename, rc);
+		fs_close(&file_data->imu_file);
+		return NULL;
+	}
+	file_data->imu_offset = sizeof(header);
+
+	// block index for the imu file
+	snprintf(file_data->index_filename, MAX_PATH_LEN, "%s/%s.imx", mp->mnt_point, fname);
+	fs_file_t_init(&file_data->index_file);
+	rc = fs_open(&file_data->index_file, file_data->index_filename, FS_O_CREATE | FS_O_RDWR);
+	if (rc == 0) {
+		rc = fs_truncate(&file_data->index_file, 0);
+	}
+	if (rc < 0) {
+		LOG_ERR("FAIL: open %s: %d", file_data->index_filename, rc);
+		fs_close(&file_data->imu_file);
+		return NULL;
+	}
+
 	// activity file
 	snprintf(file_data->activity_filename, MAX_PATH_LEN, "%s/%s.act", mp->mnt_point, fname);
 	file_data->activity_sample_count = 0;
@@ -110,21 +190,94 @@ int storage_close_file(file_handle_t handle)
 		return ret;
 	}
 
+	ret = fs_close(&handle->index_file);
+
+	if (ret < 0) {
+		LOG_ERR("FAIL: close %s: %d", handle->index_filename, ret);
+		return ret;
+	}
+
+	cache_invalidate_count(handle->basename);
 	m_open_file_count--;
 	return 0;
 }
 
 int storage_write_raw_imu_record(file_handle_t handle, raw_imu_record_t raw_record)
 {
-	int rc = fs_write(&handle->imu_file, &raw_record, sizeof(raw_record));
+	uint8_t buf[IMU_CODEC_MAX_LEN];
+	int rc;
+
+	// every block starts with an index entry
+	if (handle->imu_sample_count % IMU_CODEC_RECORDS_PER_BLOCK == 0) {
+		uint32_t offset = sys_cpu_to_le32(handle->imu_offset);
+
+		rc = fs_write(&handle->index_file, &offset, sizeof(offset));
+		if (rc < 0) {
+			LOG_ERR("FAIL: write %s: %d", handle->index_filename, rc);
+			erase_and_reboot();
+			return -1;
+		}
+	}
+
+	int len = imu_codec_encode(&raw_record, buf, sizeof(buf));
+	if (len < 0) {
+		LOG_ERR("FAIL: encode record: %d", len);
+		return -1;
+	}
+
+	rc = fs_write(&handle->imu_file, buf, len);
 	if (rc < 0) {
 		LOG_ERR("FAIL: write %s: %d", handle->imu_filename, rc);
 		erase_and_reboot();
 		return -1;
 	}
+	handle->imu_offset += len;
+	handle->imu_sample_count++;
+	cache_invalidate_count(handle->basename);
 	return 0;
 }
 
+// true if the open file (positioned at 0) is compressed, leaves it after the header if so
+static bool is_compressed(struct fs_file_t *file)
+{
+	uint8_t header[IMU_CODEC_HEADER_LEN];
+
+	if (fs_read(file, header, sizeof(header)) == sizeof(header) &&
+	    imu_codec_is_compressed(header)) {
+		return true;
+	}
+	fs_seek(file, 0, FS_SEEK_SET);
+	return false;
+}
+
+// read the compressed record at the file position, or just step over it if record is NULL.
+// returns -ENODATA at the end of the file, or for a record cut short by a reset
+static int next_compressed_record(struct fs_file_t *file, raw_imu_record_t *record)
+{
+	uint8_t buf[IMU_CODEC_MAX_LEN];
+
+	int rc = fs_read(file, buf, IMU_CODEC_LEN_PREFIX);
+	if (rc < 0) {
+		return rc;
+	} else if (rc < IMU_CODEC_LEN_PREFIX) {
+		return -ENODATA;
+	}
+
+	uint16_t len = sys_get_le16(buf);
+	if (len > sizeof(buf) - IMU_CODEC_LEN_PREFIX) {
+		return -EINVAL;
+	}
+
+	// read rather than seek even when skipping, seeking past the end would not fail
+	rc = fs_read(file, buf, len);
+	if (rc < 0) {
+		return rc;
+	} else if (rc < len) {
+		return -ENODATA;
+	}
+	return record ? imu_codec_decode(buf, len, record) : 0;
+}
+
 static int storage_print(const struct shell *sh, size_t argc, char **argv)
 {
 	struct fs_file_t file;
@@ -144,18 +297,31 @@ static int storage_print(const struct shell *sh, size_t argc, char **argv)
 		return rc;
 	}
 
+	bool compressed = is_compressed(&file);
+
 	for (;;) {
 		raw_imu_record_t record;
 
-		rc = fs_read(&file, &record, sizeof(record));
-		if (rc == 0) {
-			LOG_INF("complete");
-			break;
-		}
+		if (compressed) {
+			rc = next_compressed_record(&file, &record);
+			if (rc == -ENODATA) {
+				LOG_INF("complete");
+				break;
+			} else if (rc < 0) {
+				LOG_ERR("FAIL: read %s: %d", fname, rc);
+				break;
+			}
+		} else {
+			rc = fs_read(&file, &record, sizeof(record));
+			if (rc == 0) {
+				LOG_INF("complete");
+				break;
+			}
 
-		else if (rc < 0 || rc < sizeof(record)) {
-			LOG_ERR("FAIL: read %s: [rd:%d]", fname, rc);
-			break;
+			else if (rc < 0 || rc < sizeof(record)) {
+				LOG_ERR("FAIL: read %s: [rd:%d]", fname, rc);
+				break;
+			}
 		}
 
 		LOG_INF("%d:\t record_num=%d, time=%llu", sample_count++,
@@ -201,6 +367,8 @@ static int erase_flash(unsigned int id)
 
 static int storage_erase(const struct shell *sh, size_t argc, char **argv)
 {
+	cache_forget(NULL);
+
 	int rc = erase_flash((uintptr_t)mp->storage_dev);
 	if (rc < 0) {
 		LOG_ERR("failure: erase_flash rc=%d", rc);
@@ -262,74 +430,277 @@ static int lsdir(const char *path)
 	return res;
 }
 
-// returns the number of records in 'filename'
-int storage_get_raw_imu_record_count(char *basename)
+static void cache_close(struct read_cache_t *entry)
 {
-	struct fs_dirent dirent;
-	char fname[MAX_PATH_LEN];
-
-	snprintf(fname, sizeof(fname), "%s/%s.imu", mp->mnt_point, basename);
+	fs_close(&entry->file);
+	if (entry->compressed) {
+		fs_close(&entry->index_file);
+	}
+	entry->in_use = false;
+}
 
-	int rc = fs_stat(fname, &dirent);
+// close whatever is cached for basename (NULL for everything), before its files are
+// started over or deleted
+static void cache_forget(const char *basename)
+{
+	k_mutex_lock(&m_read_cache_lock, K_FOREVER);
+	for (int i = 0; i < READ_CACHE_SIZE; i++) {
+		struct read_cache_t *entry = &m_read_cache[i];
 
-	if (rc >= 0) {
-		LOG_DBG("\tfn '%s' siz %u", dirent.name, dirent.size);
-	} else {
-		LOG_ERR("cannot stat %s", basename);
-		return -1;
+		if (entry->in_use && (basename == NULL || strcmp(entry->basename, basename) == 0)) {
+			cache_close(entry);
+		}
 	}
+	k_mutex_unlock(&m_read_cache_lock);
+}
 
-	int records = dirent.size / sizeof(raw_imu_record_t);
+static void cache_invalidate_count(const char *basename)
+{
+	k_mutex_lock(&m_read_cache_lock, K_FOREVER);
+	for (int i = 0; i < READ_CACHE_SIZE; i++) {
+		struct read_cache_t *entry = &m_read_cache[i];
 
-	LOG_DBG("%s records: %d", fname, records);
-	return records;
+		if (entry->in_use && strcmp(entry->basename, basename) == 0) {
+			entry->record_count = -1;
+		}
+	}
+	k_mutex_unlock(&m_read_cache_lock);
 }
 
-int storage_read_raw_imu_record(char *basename, int record_number, raw_imu_record_t *record)
+static int cache_open(struct read_cache_t *entry, const char *basename, enum read_file_type type)
 {
-	struct fs_file_t file;
 	char fname[MAX_PATH_LEN];
 
-	snprintf(fname, sizeof(fname), "%s/%s.imu", mp->mnt_point, basename);
-
-	fs_file_t_init(&file);
-	int rc = fs_open(&file, fname, FS_O_RDWR);
+	snprintf(fname, sizeof(fname), "%s/%s.%s", mp->mnt_point, basename,
+		 type == READ_FILE_IMU ? "imu" : "act");
+	fs_file_t_init(&entry->file);
+	int rc = fs_open(&entry->file, fname, FS_O_READ);
 	if (rc < 0) {
 		LOG_ERR("FAIL: open %s: %d", fname, rc);
 		return rc;
 	}
 
-	int seek_offset = record_number * sizeof(raw_imu_record_t);
+	// this leaves the file at the first record either way
+	entry->compressed = type == READ_FILE_IMU && is_compressed(&entry->file);
+	if (entry->compressed) {
+		snprintf(fname, sizeof(fname), "%s/%s.imx", mp->mnt_point, basename);
+		fs_file_t_init(&entry->index_file);
+		rc = fs_open(&entry->index_file, fname, FS_O_READ);
+		if (rc < 0) {
+			LOG_ERR("FAIL: open %s: %d", fname, rc);
+			fs_close(&entry->file);
+			return rc;
+		}
+	}
+
+	strcpy(entry->basename, basename);
+	entry->type = type;
+	entry->record_count = -1;
+	entry->next_record = 0;
+	entry->in_use = true;
+	return 0;
+}
 
-	rc = fs_seek(&file, seek_offset, FS_SEEK_SET);
+// the open file for basename, opened in place of the least recently used one if need be.
+// call with m_read_cache_lock held
+static struct read_cache_t *cache_get(const char *basename, enum read_file_type type)
+{
+	struct read_cache_t *lru = &m_read_cache[0];
+
+	if (strlen(basename) >= MAX_NAME_LEN) {
+		LOG_ERR("file name too long: %s", basename);
+		return NULL;
+	}
+
+	for (int i = 0; i < READ_CACHE_SIZE; i++) {
+		struct read_cache_t *entry = &m_read_cache[i];
+
+		if (entry->in_use && entry->type == type && strcmp(entry->basename, basename) == 0) {
+			entry->last_used = ++m_read_clock;
+			return entry;
+		}
+		if (lru->in_use && (!entry->in_use || entry->last_used < lru->last_used)) {
+			lru = entry;
+		}
+	}
+
+	if (lru->in_use) {
+		cache_close(lru);
+	}
+	if (cache_open(lru, basename, type) < 0) {
+		return NULL;
+	}
+	lru->last_used = ++m_read_clock;
+	return lru;
+}
+
+// file offset of the first record of a block, from the .imx index
+static int read_block_offset(struct read_cache_t *entry, int block, uint32_t *offset)
+{
+	int rc = fs_seek(&entry->index_file, block * sizeof(*offset), FS_SEEK_SET);
+	if (rc == 0) {
+		rc = fs_read(&entry->index_file, offset, sizeof(*offset));
+		rc = rc == sizeof(*offset) ? 0 : -ENODATA;
+	}
+	*offset = sys_le32_to_cpu(*offset);
+	return rc;
+}
+
+static size_t record_size(struct read_cache_t *entry)
+{
+	return entry->type == READ_FILE_IMU ? sizeof(raw_imu_record_t) : sizeof(activity_record_t);
+}
+
+// counts the records once, until the file is written again. moves the file position
+static int cache_record_count(struct read_cache_t *entry)
+{
+	if (entry->record_count >= 0) {
+		return entry->record_count;
+	}
+	entry->next_record = -1;
+
+	if (!entry->compressed) {
+		int rc = fs_seek(&entry->file, 0, FS_SEEK_END);
+		if (rc < 0) {
+			return rc;
+		}
+		entry->record_count = fs_tell(&entry->file) / record_size(entry);
+		return entry->record_count;
+	}
+
+	// compressed files: whole blocks from the index, plus what is in the last one
+	uint32_t offset;
+	int rc = fs_seek(&entry->index_file, 0, FS_SEEK_END);
 	if (rc < 0) {
-		LOG_ERR("FAIL: seek %s: %d", fname, rc);
 		return rc;
 	}
+	int blocks = fs_tell(&entry->index_file) / sizeof(offset);
+	if (blocks == 0) {
+		entry->record_count = 0;
+		return 0;
+	}
 
-	rc = fs_read(&file, record, sizeof(*record));
+	rc = read_block_offset(entry, blocks - 1, &offset);
 	if (rc == 0) {
+		rc = fs_seek(&entry->file, offset, FS_SEEK_SET);
+	}
+	if (rc < 0) {
+		return rc;
 	}
 
-	else if (rc < 0 || rc < sizeof(*record)) {
-		LOG_ERR("FAIL: read %s: [rd:%d]", fname, rc);
-		return -1;
+	int records = (blocks - 1) * IMU_CODEC_RECORDS_PER_BLOCK;
+	while ((rc = next_compressed_record(&entry->file, NULL)) == 0) {
+		records++;
 	}
+	if (rc != -ENODATA) {
+		return rc;
+	}
+	// a cut short record at the end is stepped over again on the next read, which is fine
+	entry->record_count = records;
+	return records;
+}
 
-	rc = fs_close(&file);
+// move the file position to a record, if the last read didn't leave it there already
+static int cache_seek_record(struct read_cache_t *entry, int record_number)
+{
+	int rc = 0;
+	int skip;
+
+	if (entry->next_record == record_number) {
+		return 0;
+	}
+
+	if (!entry->compressed) {
+		entry->next_record = -1;
+		return fs_seek(&entry->file, (off_t)record_number * record_size(entry), FS_SEEK_SET);
+	}
+
+	// compressed: step forward if the record is further on in the same block, otherwise
+	// seek to its block through the index and step through the records in front
+	int block = record_number / IMU_CODEC_RECORDS_PER_BLOCK;
+	if (entry->next_record >= 0 && entry->next_record < record_number &&
+	    entry->next_record / IMU_CODEC_RECORDS_PER_BLOCK == block) {
+		skip = record_number - entry->next_record;
+	} else {
+		uint32_t offset;
+
+		rc = read_block_offset(entry, block, &offset);
+		if (rc == 0) {
+			rc = fs_seek(&entry->file, offset, FS_SEEK_SET);
+		}
+		skip = record_number % IMU_CODEC_RECORDS_PER_BLOCK;
+	}
+	entry->next_record = -1;
+
+	for (int i = 0; rc == 0 && i < skip; i++) {
+		rc = next_compressed_record(&entry->file, NULL);
+	}
+	return rc;
+}
+
+// read one record of a session file, sets last if it was the last one in the file
+static int read_record(char *basename, enum read_file_type type, int record_number, void *record,
+		       bool *last)
+{
+	int rc = -1;
+
+	k_mutex_lock(&m_read_cache_lock, K_FOREVER);
+	struct read_cache_t *entry = cache_get(basename, type);
+
+	if (entry) {
+		int total_records = cache_record_count(entry);
+
+		rc = total_records < 0 ? total_records : cache_seek_record(entry, record_number);
+		if (rc == 0 && entry->compressed) {
+			rc = next_compressed_record(&entry->file, record);
+		} else if (rc == 0) {
+			rc = fs_read(&entry->file, record, record_size(entry));
+			rc = rc < 0 ? rc : (rc == record_size(entry) ? 0 : -ENODATA);
+		}
+
+		if (rc < 0) {
+			LOG_ERR("FAIL: read %s record %d: %d", basename, record_number, rc);
+			entry->next_record = -1;
+		} else {
+			entry->next_record = record_number + 1;
+			*last = record_number == total_records - 1;
+		}
+		if (*last) {
+			cache_close(entry);
+		}
+	}
+	k_mutex_unlock(&m_read_cache_lock);
+
+	return rc < 0 ? -1 : 0;
+}
+
+// returns the number of records in 'filename'
+int storage_get_raw_imu_record_count(char *basename)
+{
+	k_mutex_lock(&m_read_cache_lock, K_FOREVER);
+	struct read_cache_t *entry = cache_get(basename, READ_FILE_IMU);
+	int records = entry ? cache_record_count(entry) : -1;
+	k_mutex_unlock(&m_read_cache_lock);
+
+	LOG_DBG("%s.imu records: %d", basename, records);
+	return records < 0 ? -1 : records;
+}
+
+int storage_read_raw_imu_record(char *basename, int record_number, raw_imu_record_t *record)
+{
+	bool last = false;
+
+	int rc = read_record(basename, READ_FILE_IMU, record_number, record, &last);
 	if (rc < 0) {
-		LOG_ERR("FAIL: close %s: %d", fname, rc);
-		return -1;
+		return rc;
 	}
 
 #define ERASE_FILE_AFTER_HARVESTING (1)
 #ifdef ERASE_FILE_AFTER_HARVESTING
-	int total_records = storage_get_raw_imu_record_count(basename);
-	if (record_number == total_records - 1) {
-		LOG_INF("read last record (%d), deleting %s!", record_number, fname);
-		rc = fs_unlink(fname);
+	if (last) {
+		LOG_INF("read last record (%d), deleting %s.imu!", record_number, basename);
+		rc = unlink_raw_imu(basename);
 		if (rc < 0) {
-			LOG_ERR("error unlinking %s", fname);
 			return rc;
 		}
 	}
@@ -338,9 +709,97 @@ int storage_read_raw_imu_record(char *basename, int record_number, raw_imu_recor
 	return 0;
 }
 
+storage_reader_t *storage_open_raw_imu_reader(char *basename, uint32_t *size)
+{
+	struct fs_dirent dirent;
+
+	if (m_reader.is_open) {
+		LOG_ERR("%s is already being read", m_reader.filename);
+		return NULL;
+	}
+
+	snprintf(m_reader.filename, MAX_PATH_LEN, "%s/%s.imu", mp->mnt_point, basename);
+	int rc = fs_stat(m_reader.filename, &dirent);
+	if (rc < 0) {
+		LOG_ERR("cannot stat %s", m_reader.filename);
+		return NULL;
+	}
+
+	fs_file_t_init(&m_reader.file);
+	rc = fs_open(&m_reader.file, m_reader.filename, FS_O_READ);
+	if (rc < 0) {
+		LOG_ERR("FAIL: open %s: %d", m_reader.filename, rc);
+		return NULL;
+	}
+
+	// only whole records are handed out. compressed files go as they are, the reader
+	// drops a last record cut short by a reset
+	if (is_compressed(&m_reader.file)) {
+		*size = dirent.size;
+	} else {
+		*size = dirent.size - dirent.size % sizeof(raw_imu_record_t);
+	}
+	fs_seek(&m_reader.file, 0, FS_SEEK_SET);
+	m_reader.is_open = true;
+	return &m_reader;
+}
+
+int storage_read_block(storage_reader_t *reader, void *buf, size_t len)
+{
+	int rc = fs_read(&reader->file, buf, len);
+	if (rc < 0) {
+		LOG_ERR("FAIL: read %s: %d", reader->filename, rc);
+	}
+	return rc;
+}
+
+int storage_close_reader(storage_reader_t *reader)
+{
+	int rc = fs_close(&reader->file);
+
+	reader->is_open = false;
+	if (rc < 0) {
+		LOG_ERR("FAIL: close %s: %d", reader->filename, rc);
+	}
+	return rc;
+}
+
+// the .imu file and its index, if it has one
+static int unlink_raw_imu(char *basename)
+{
+	char fname[MAX_PATH_LEN];
+
+	cache_forget(basename);
+	snprintf(fname, sizeof(fname), "%s/%s.imu", mp->mnt_point, basename);
+	int ret = fs_unlink(fname);
+	if (ret < 0) {
+		LOG_ERR("error unlinking %s", fname);
+		return ret;
+	}
+
+	snprintf(fname, sizeof(fname), "%s/%s.imx", mp->mnt_point, basename);
+	ret = fs_unlink(fname);
+	if (ret < 0 && ret != -ENOENT) {
+		LOG_ERR("error unlinking %s", fname);
+		return ret;
+	}
+	return 0;
+}
+
+int storage_delete_raw_imu_file(char *basename)
+{
+	int ret = unlink_raw_imu(basename);
+	if (ret < 0) {
+		return ret;
+	}
+	LOG_INF("harvested %s, deleted", basename);
+	return 0;
+}
+
 int storage_delete_activity_file(char *basename)
 {
 	char fname[128];
+	cache_forget(basename);
 	snprintf(fname, sizeof(fname), "%s/%s.act", mp->mnt_point, basename);
 	int ret = fs_unlink(fname);
 	if (ret < 0) {
@@ -361,76 +820,36 @@ int storage_write_activity_record(file_handle_t handle, activity_record_t raw_re
 		erase_and_reboot();
 		return -1;
 	}
+	cache_invalidate_count(handle->basename);
 	return 0;
 }
 
 int storage_get_activity_record_count(char *basename)
 {
-	struct fs_dirent dirent;
-	char fname[MAX_PATH_LEN];
+	k_mutex_lock(&m_read_cache_lock, K_FOREVER);
+	struct read_cache_t *entry = cache_get(basename, READ_FILE_ACTIVITY);
+	int records = entry ? cache_record_count(entry) : -1;
+	k_mutex_unlock(&m_read_cache_lock);
 
-	snprintf(fname, sizeof(fname), "%s/%s.act", mp->mnt_point, basename);
-
-	int rc = fs_stat(fname, &dirent);
-
-	if (rc >= 0) {
-		LOG_DBG("\tfn '%s' siz %u", dirent.name, dirent.size);
-	} else {
-		LOG_ERR("cannot stat %s", basename);
-		return -1;
-	}
-
-	int records = dirent.size / sizeof(activity_record_t);
-
-	LOG_DBG("%s records: %d", fname, records);
-	return records;
+	LOG_DBG("%s.act records: %d", basename, records);
+	return records < 0 ? -1 : records;
 }
 
 int storage_read_activity_record(char *basename, int record_number, activity_record_t *record)
 {
-	struct fs_file_t file;
-	char fname[MAX_PATH_LEN];
-
-	snprintf(fname, sizeof(fname), "%s/%s.act", mp->mnt_point, basename);
-
-	fs_file_t_init(&file);
-	int rc = fs_open(&file, fname, FS_O_RDWR);
-	if (rc < 0) {
-		LOG_ERR("FAIL: open %s: %d", fname, rc);
-		return rc;
-	}
+	bool last = false;
 
-	int seek_offset = record_number * sizeof(activity_record_t);
-
-	rc = fs_seek(&file, seek_offset, FS_SEEK_SET);
+	int rc = read_record(basename, READ_FILE_ACTIVITY, record_number, record, &last);
 	if (rc < 0) {
-		LOG_ERR("FAIL: seek %s: %d", fname, rc);
 		return rc;
 	}
 
-	rc = fs_read(&file, record, sizeof(*record));
-	if (rc == 0) {
-	}
-
-	else if (rc < 0 || rc < sizeof(*record)) {
-		LOG_ERR("FAIL: read %s: [rd:%d]", fname, rc);
-		return -1;
-	}
-
-	rc = fs_close(&file);
-	if (rc < 0) {
-		LOG_ERR("FAIL: close %s: %d", fname, rc);
-		return -1;
-	}
-
 #define ERASE_FILE_AFTER_HARVESTING (1)
 #ifdef ERASE_FILE_AFTER_HARVESTING
-	int total_records = storage_get_activity_record_count(basename);
-	if (record_number == total_records - 1) {
-		LOG_INF("read last record (%d), deleting %s!", record_number, fname);
-		rc = fs_unlink(fname);
+	if (last) {
+		LOG_INF("read last record (%d), deleting %s.act!", record_number, basename);
+		rc = storage_delete_activity_file(basename);
 		if (rc < 0) {
-			LOG_ERR("error unlinking %s", fname);
 			return rc;
 		}
 	}
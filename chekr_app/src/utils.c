@@ -13,18 +13,15 @@
 static const struct device *gpio1 = DEVICE_DT_GET(DT_NODELABEL(gpio1));
 
 #define POLYNOMIAL    0xA001
-#define INITIAL_VALUE 0xFFFF
+#define INITIAL_VALUE UTILS_CRC16_MODBUS_INIT
 
 LOG_MODULE_REGISTER(utils, LOG_LEVEL_DBG);
 
-uint16_t utils_crc16_modbus(const uint8_t *data, uint16_t length)
+uint16_t utils_crc16_modbus_update(uint16_t crc, const uint8_t *data, size_t length)
 {
-	uint16_t crc = INITIAL_VALUE;
-	uint16_t i, j;
-
-	for (i = 0; i < length; i++) {
+	for (size_t i = 0; i < length; i++) {
 		crc ^= data[i];
-		for (j = 0; j < 8; j++) {
+		for (int j = 0; j < 8; j++) {
 			bool lsb = crc & 1;
 			crc >>= 1;
 			if (lsb) {
@@ -32,6 +29,12 @@ uint16_t utils_crc16_modbus(const uint8_t *data, uint16_t length)
 			}
 		}
 	}
+	return crc;
+}
+
+uint16_t utils_crc16_modbus(const uint8_t *data, uint16_t length)
+{
+	uint16_t crc = utils_crc16_modbus_update(INITIAL_VALUE, data, length);
 
 	// crc is always big endian
 	crc = sys_cpu_to_be16(crc);
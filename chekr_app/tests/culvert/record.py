@@ -1,11 +1,14 @@
 import struct
-from utils import pack_command, HEADER_FORMAT, CRC_FORMAT, FT_REQUEST, SB_MOBILE_APP_TO_DEVICE, WRITE_CHARACTERISTIC_UUID
-from command import send_command
+from utils import pack_command, crc16_modbus, HEADER_FORMAT, CRC_FORMAT, FT_REQUEST, SB_MOBILE_APP_TO_DEVICE, WRITE_CHARACTERISTIC_UUID
+from command import send_command, NOTIFY_CHARACTERISTIC_UUID, WRITE_NO_RESP_CHARACTERISTIC_UUID
+import asyncio
+import time
 from datetime import datetime
 import logging
 logger = logging.getLogger('d1')
 
 # commands
+START_STOP_RAW_DATA_HARVESTING = 7
 START_STOP_RECORDING_SESSION = 16
 
 READ_RECORDING_SESSION_IMU_DETAILS = 17
@@ -20,6 +23,15 @@ START_STOP_RECORDING_SESSION_FORMAT = HEADER_FORMAT + "B8s" + CRC_FORMAT
 READ_RECORDING_SESSION_IMU_DETAILS_FORMAT = HEADER_FORMAT + "8sB" + CRC_FORMAT
 READ_RECORDING_SESSION_IMU_DATA_FORMAT = HEADER_FORMAT + "8sHHB" + CRC_FORMAT
 
+# op + UID + credits
+START_STOP_RAW_DATA_HARVESTING_FORMAT = HEADER_FORMAT + "B8sH" + CRC_FORMAT
+HARVEST_STOP = 0
+HARVEST_START = 1
+HARVEST_CREDIT = 2
+HARVEST_TRAILER_SEQ = 0xffff
+# notifications the device may have in flight, topped up every half window
+HARVEST_CREDITS = 64
+
 READ_RECORDING_SESSION_ACTIVITY_DETAILS_FORMAT = HEADER_FORMAT + "8sB" + CRC_FORMAT
 READ_RECORDING_SESSION_ACTIVITY_DATA_FORMAT = HEADER_FORMAT + "8sHHB" + CRC_FORMAT
 
@@ -78,6 +90,92 @@ async def read_recording_session_imu_data(client, uid, record_num):
 
 
 
+def pack_harvest_command(op, uid, credits):
+    data = bytes([op]) + uid + struct.pack('>H', credits)
+    frame_len = struct.calcsize(START_STOP_RAW_DATA_HARVESTING_FORMAT)
+    return pack_command(SB_MOBILE_APP_TO_DEVICE, frame_len, FT_REQUEST, START_STOP_RAW_DATA_HARVESTING, data)
+
+# stream the whole raw IMU session in one go, returns the raw records
+async def harvest_recording_session_imu(client, uid):
+    RAW_IMU_RECORD_SIZE = 252
+    chunks = {}
+    trailer = asyncio.get_running_loop().create_future()
+    received = 0
+
+    async def grant(credits):
+        await client.write_gatt_char(WRITE_NO_RESP_CHARACTERISTIC_UUID, pack_harvest_command(HARVEST_CREDIT, uid, credits))
+
+    def on_notify(sender, data):
+        nonlocal received
+        seq = struct.unpack_from('>H', data, 0)[0]
+        if seq == HARVEST_TRAILER_SEQ:
+            if not trailer.done():
+                trailer.set_result(struct.unpack_from('>IH', data, 2))
+            return
+        chunks[seq] = bytes(data[2:])
+        received += 1
+        if received % (HARVEST_CREDITS // 2) == 0:
+            asyncio.ensure_future(grant(HARVEST_CREDITS // 2))
+
+    await client.start_notify(NOTIFY_CHARACTERISTIC_UUID, on_notify)
+    start = time.time()
+    response = await send_command(client, pack_harvest_command(HARVEST_START, uid, HARVEST_CREDITS))
+    logger.info(f"harvest start response: {response.hex(' ')}")
+    num_records, num_bytes, chunk_size = struct.unpack_from('>HIB', response, 13)
+    logger.info(f"harvesting {num_records} records, {num_bytes} bytes in {chunk_size} byte chunks")
+
+    total, crc = await asyncio.wait_for(trailer, timeout=60 + num_bytes / 1000)
+    await client.stop_notify(NOTIFY_CHARACTERISTIC_UUID)
+    payload = b''.join(chunks[seq] for seq in sorted(chunks))
+    elapsed = time.time() - start
+    logger.info(f"harvested {len(payload)} bytes in {elapsed:.2f}s ({len(payload) / elapsed / 1000:.1f} kB/s)")
+
+    ok = len(payload) == total and crc16_modbus(payload) == crc
+    if not ok:
+        logger.error(f"harvest failed: {len(payload)} of {total} bytes, crc {crc16_modbus(payload):04x} expected {crc:04x}")
+
+    # the device only deletes the session after a complete harvest
+    await send_command(client, pack_harvest_command(HARVEST_STOP, uid, 0))
+    if not ok:
+        return []
+    if payload.startswith(IMU_CODEC_MAGIC):
+        return [parse_raw_imu_data_record(record) for record in decode_compressed_imu_session(payload)]
+    return [parse_raw_imu_data_record(payload[i:i + RAW_IMU_RECORD_SIZE]) for i in range(0, len(payload), RAW_IMU_RECORD_SIZE)]
+
+IMU_CODEC_MAGIC = b'IMZ1'
+IMU_CODEC_HEADER_LEN = 8
+
+# turn a compressed .imu file (see imu_codec.h in the firmware) back into 252 byte raw records
+def decode_compressed_imu_session(data):
+    RAW_FRAMES_PER_RECORD = 10
+    records = []
+    pos = IMU_CODEC_HEADER_LEN
+    while pos + 2 <= len(data):
+        length = struct.unpack_from('<H', data, pos)[0]
+        payload = data[pos + 2:pos + 2 + length]
+        pos += 2 + length
+        if len(payload) < length:
+            break    # cut short by a reset on the device
+        head = payload[:12]
+        scales = struct.unpack_from('<2f', payload, 12)
+        p = 20
+        axes = []
+        for axis in range(6):
+            bits, count = struct.unpack_from('<Bh', payload, p)
+            p += 3
+            nbytes = (bits * (RAW_FRAMES_PER_RECORD - 1) + 7) // 8
+            packed = int.from_bytes(payload[p:p + nbytes], 'little')
+            p += nbytes
+            counts = [count]
+            for i in range(RAW_FRAMES_PER_RECORD - 1):
+                zz = (packed >> (i * bits)) & ((1 << bits) - 1)
+                count += (zz >> 1) ^ -(zz & 1)
+                counts.append(count)
+            axes.append([struct.unpack('<f', struct.pack('<f', c * scales[axis // 3]))[0] for c in counts])
+        frames = b''.join(struct.pack('<6f', *(axes[a][i] for a in range(6))) for i in range(RAW_FRAMES_PER_RECORD))
+        records.append(head + frames)
+    return records
+
 async def read_recording_session_activity_details(client, timestamp):
 
     data = timestamp + bytes([0])
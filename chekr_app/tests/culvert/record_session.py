@@ -4,6 +4,7 @@ import random
 import time
 from epochtime import send_epoch_time, get_epoch_time
 from record import start_recording_session, stop_recording_session, read_recording_session_imu_details, read_recording_session_imu_data
+from record import harvest_recording_session_imu
 from record import read_recording_session_activity_details, read_recording_session_activity_data
 from command import send_command
 from misc_cmds import read_dashboard_info, set_dog_collar_position, set_dog_size, pretty_print_dashboard_info
@@ -33,6 +34,7 @@ parser.add_argument("--time", "-t", help="time for recording sessions", required
 parser.add_argument("--random", "-r", help="randomize time", action="store_true")
 parser.add_argument("--device", "-d", help="device name (BLE advertisement)")
 parser.add_argument("--bypass", "-b", help="bypass Start/Stop recording to fetch in-progress recording <name>")
+parser.add_argument("--harvest", help="stream the raw IMU data instead of reading it record by record", action="store_true")
 
 # Read arguments from the command line
 args = parser.parse_args()
@@ -130,9 +132,13 @@ async def recording_session(address):
             timestamp = bytes.fromhex(filename)
 
         logger.info(f"**************** RAW IMU DATA ***********")
-        num_records = await read_recording_session_imu_details(client, timestamp)
-        for record in range(num_records):
-            await read_recording_session_imu_data(client, timestamp, record)
+        if args.harvest:
+            records = await harvest_recording_session_imu(client, timestamp)
+            logger.info(f"harvested {len(records)} records")
+        else:
+            num_records = await read_recording_session_imu_details(client, timestamp)
+            for record in range(num_records):
+                await read_recording_session_imu_data(client, timestamp, record)
 
         logger.info(f"**************** ACTIVITY DATA ***********")
         num_records = await read_recording_session_activity_details(client, timestamp)
@@ -2,6 +2,7 @@
 
 #pragma once
 #include "d1_zbus.h"
+#include "tele_writer.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -10,7 +11,7 @@
 void telem_log_clear();
 int  log_telemetry_add(const char *log_msg, int loglevel, int log_type);
 int  telem_log_count();
-int  telem_log_get_json_list(cJSON *jsonObj, int16_t *remaining_space);
+int  telem_log_get_json_list(tele_writer_t *tw);
 
 // TODO: put Heather's list here
 enum telemLogTypes
@@ -38,6 +38,7 @@
 #ifdef CONFIG_ML_ENABLE
 #include "ml.h"
 #endif
+#include "fqueue.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(comm_mgr, CONFIG_COMM_MGR_LOG_LEVEL);
@@ -129,16 +130,309 @@ typedef struct mqtt_msg
     struct k_work *work;
     char          *msg;
     int            len;
+    int16_t        sent_at;    // offset of the SENT_AT value in msg, -1 if there isn't one
     uint8_t        topic;
     uint8_t        qos;
     uint8_t        priority;
+    uint16_t       ml_recs;    // ML records in a telemetry msg, removed from flash once it is sent
 } mqtt_msg_t;
-K_MSGQ_DEFINE(mqttq, sizeof(mqtt_msg_t), 30, 4);
 // MQTT telemetry message are often around 1k. There is a 2k limit. Alerts and such are < 200 bytes
 // Telemetry message can be tossed if not sent timely.  Alerts mostly can't.
 // So the mqtt msg heap should be around 20k to hold a decent number of messages
 K_HEAP_DEFINE(mqtt_heap, 20 * 1024);
 
+// The outbound queue, oldest first. Messages go out by priority (lowest number first),
+// and in order within a priority. When the queue or the heap is full the highest
+// numbered messages make room. Messages at or below CONFIG_COMM_MQTT_PERSIST_PRIORITY
+// are never dropped for that, they move to the "mqtt" fqueue on flash instead and come
+// back once there is room again, so they also survive a reboot.
+// Telemetry is dropped by its priority like anything else. The ML records it carries
+// are only removed from flash once it is sent, in the order the messages were built,
+// so only the newest telemetry holding records can be dropped. Its records go back to
+// the ML queue and out with the next telemetry.
+static mqtt_msg_t mqttq[CONFIG_COMM_MQTT_QUEUE_LEN];
+static int        mqttq_used;
+K_MUTEX_DEFINE(mqttq_lock);
+
+typedef struct
+{
+    uint8_t topic;
+    uint8_t qos;
+    uint8_t priority;
+    uint8_t reserved;
+} mqtt_spill_hdr_t;
+
+static fqueue_t mqttq_spill_wr;
+static fqueue_t mqttq_spill_rd;
+static bool     mqttq_spill_open;
+static uint8_t  mqttq_spill_buf[sizeof(mqtt_spill_hdr_t) + CONFIG_COMM_MQTT_SPILL_MAX_LEN];
+
+static struct
+{
+    uint32_t coalesced;
+    uint32_t evicted;
+    uint32_t spilled;
+    uint32_t reloaded;
+    uint32_t refused;
+} mqttq_stats;
+
+static bool mqttq_spill_init(void)
+{
+    if (!mqttq_spill_open) {
+        int ret = fqueue_init(&mqttq_spill_wr, "mqtt", FQ_WRITE, false);
+        if (ret == 0) {
+            ret = fqueue_init(&mqttq_spill_rd, "mqtt", FQ_READ, false);
+        }
+        if (ret != 0) {
+            LOG_ERR("'%s'(%d) opening the mqtt spill queue", wstrerr(-ret), ret);
+            return false;
+        }
+        mqttq_spill_open = true;
+    }
+    return true;
+}
+
+// write one message to the flash queue. Call with mqttq_lock held
+static int mqttq_spill_data(const void *data, int len, uint8_t topic, uint8_t qos, uint8_t priority)
+{
+    if (len > CONFIG_COMM_MQTT_SPILL_MAX_LEN) {
+        return -EFBIG;
+    }
+    if (!mqttq_spill_init()) {
+        return -ENODEV;
+    }
+    mqtt_spill_hdr_t hdr = { .topic = topic, .qos = qos, .priority = priority };
+    memcpy(mqttq_spill_buf, &hdr, sizeof(hdr));
+    memcpy(mqttq_spill_buf + sizeof(hdr), data, len);
+    int ret = fqueue_put(&mqttq_spill_wr, mqttq_spill_buf, sizeof(hdr) + len);
+    if (ret == 0) {
+        mqttq_stats.spilled++;
+        LOG_WRN("Queued %s mqtt msg on flash", msg_name(topic));
+    }
+    return ret;
+}
+
+// move a message to flash, the RAM copy is freed either way. Call with mqttq_lock held
+static int mqttq_spill(mqtt_msg_t *msg)
+{
+    int ret = mqttq_spill_data(msg->msg, msg->len, msg->topic, msg->qos, msg->priority);
+    if (ret != 0) {
+        LOG_ERR("'%s'(%d) moving %s mqtt msg to flash, dropping it", wstrerr(-ret), ret, msg_name(msg->topic));
+    }
+    k_heap_free(&mqtt_heap, msg->msg);
+    return ret;
+}
+
+// find the SENT_AT value the json writer left a placeholder for, so
+// it can be set just before the message goes out. -1 if there isn't one
+static int16_t mqtt_find_sent_at(const char *msg)
+{
+    const char *p = strstr(msg, "\"SENT_AT\":");
+
+    return p == NULL ? -1 : (p - msg) + strlen("\"SENT_AT\":");
+}
+
+static void mqttq_remove(int idx)
+{
+    mqttq_used--;
+    memmove(&mqttq[idx], &mqttq[idx + 1], (mqttq_used - idx) * sizeof(mqtt_msg_t));
+}
+
+static void mqttq_insert(int idx, const mqtt_msg_t *msg)
+{
+    memmove(&mqttq[idx + 1], &mqttq[idx], (mqttq_used - idx) * sizeof(mqtt_msg_t));
+    mqttq[idx] = *msg;
+    mqttq_used++;
+}
+
+// pick the message mqttq_evict() frees, -1 if none. Call with mqttq_lock held
+static int mqttq_victim(bool with_ml)
+{
+    int victim = -1;
+    int newest = -1;
+
+    for (int i = 0; i < mqttq_used; i++) {
+        if (mqttq[i].ml_recs > 0) {
+            newest = i;
+        }
+    }
+    for (int i = 0; i < mqttq_used; i++) {
+        // ML records can only be given back from the newest message holding them
+        if (mqttq[i].ml_recs > 0 && (!with_ml || i != newest)) {
+            continue;
+        }
+        // the oldest of the highest numbered priority goes first, telemetry
+        // that carries no ML records before the one that does
+        if (victim < 0 || mqttq[i].priority > mqttq[victim].priority
+            || (mqttq[i].priority == mqttq[victim].priority && mqttq[victim].ml_recs > 0)) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// Call with mqttq_lock held
+static bool mqttq_can_evict(int victim, uint8_t priority)
+{
+    return victim >= 0 && mqttq[victim].priority >= priority
+           && (mqttq[victim].priority > priority || priority > CONFIG_COMM_MQTT_PERSIST_PRIORITY);
+}
+
+// free one queued message that matters less than priority. Call with mqttq_lock held
+static bool mqttq_evict(uint8_t priority)
+{
+    int victim = mqttq_victim(true);
+
+    if (mqttq_can_evict(victim, priority) && mqttq[victim].ml_recs > 0
+        && json_telemetry_release(mqttq[victim].ml_recs) != 0) {
+        // a telemetry message built after it is waiting to hold the records that follow
+        victim = mqttq_victim(false);
+    }
+    if (!mqttq_can_evict(victim, priority)) {
+        return false;
+    }
+    mqtt_msg_t msg = mqttq[victim];
+    mqttq_remove(victim);
+    if (msg.priority <= CONFIG_COMM_MQTT_PERSIST_PRIORITY && msg.ml_recs == 0) {
+        mqttq_spill(&msg);
+    } else {
+        LOG_WRN("Dropping queued %s mqtt msg (priority %d) to make room", msg_name(msg.topic), msg.priority);
+        mqttq_stats.evicted++;
+        k_heap_free(&mqtt_heap, msg.msg);
+    }
+    return true;
+}
+
+// a newer message of these types replaces the queued ones. Telemetry that
+// carries ML records is kept, they aren't in any other message
+static bool mqttq_supersedes(uint8_t topic)
+{
+    return topic == MQTT_MESSAGE_TYPE_SHADOW_PROXY || topic == MQTT_MESSAGE_TYPE_INFO_TELEMETRY;
+}
+
+// get the next message to send. topic < 0 takes any topic
+static int mqttq_get(mqtt_msg_t *msg, int topic)
+{
+    int best = -1;
+
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    for (int i = 0; i < mqttq_used; i++) {
+        if ((topic < 0 || mqttq[i].topic == topic) && (best < 0 || mqttq[i].priority < mqttq[best].priority)) {
+            best = i;
+        }
+    }
+    if (best >= 0) {
+        *msg = mqttq[best];
+        mqttq_remove(best);
+    }
+    k_mutex_unlock(&mqttq_lock);
+    return best >= 0 ? 0 : -ENOMSG;
+}
+
+// the msg is gone from the queue, remove the ML records it carried from flash
+static void mqttq_commit_ml(const mqtt_msg_t *msg)
+{
+    if (msg->ml_recs > 0) {
+        int ret = json_telemetry_commit(msg->ml_recs);
+        if (ret != 0) {
+            LOG_ERR("'%s'(%d) removing %d sent ML records", wstrerr(-ret), ret, msg->ml_recs);
+        }
+    }
+}
+
+// put a message that could not be sent back where it came from
+static void mqttq_put_back(mqtt_msg_t *msg)
+{
+    // telemetry makes room with anything else, it is older than any telemetry still queued
+    uint8_t priority = msg->topic == MQTT_MESSAGE_TYPE_INFO_TELEMETRY ? 0 : msg->priority;
+
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    if (mqttq_used == CONFIG_COMM_MQTT_QUEUE_LEN && !mqttq_evict(priority)) {
+        if (msg->priority <= CONFIG_COMM_MQTT_PERSIST_PRIORITY) {
+            mqttq_spill(msg);
+        } else {
+            LOG_WRN("No room to put back %s mqtt msg, dropping it", msg_name(msg->topic));
+            mqttq_stats.evicted++;
+            // its ML records are the oldest held, they go too so later messages stay in step
+            mqttq_commit_ml(msg);
+            k_heap_free(&mqtt_heap, msg->msg);
+        }
+    } else {
+        mqttq_insert(0, msg);
+    }
+    k_mutex_unlock(&mqttq_lock);
+}
+
+static int mqttq_num_used(void)
+{
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    int used = mqttq_used;
+    k_mutex_unlock(&mqttq_lock);
+    return used;
+}
+
+static int mqttq_add(uint8_t *msgbuf, uint16_t msg_len, uint8_t topic_num, uint8_t qos, uint8_t priority, bool hold_ml);
+
+static int mqttq_peek_at(mqtt_msg_t *msg, int idx)
+{
+    int ret = -ENOMSG;
+
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    if (idx < mqttq_used) {
+        *msg = mqttq[idx];
+        ret  = 0;
+    }
+    k_mutex_unlock(&mqttq_lock);
+    return ret;
+}
+
+// bring messages moved to flash back into RAM, ahead of everything queued since
+static void mqttq_reload(void)
+{
+    fqueue_iter_t it;
+    int           count = 0;    // records taken off flash, skipped ones included
+    int           added = 0;    // where the next one goes in the RAM queue
+
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    if (!mqttq_spill_init() || fqueue_iter_begin(&mqttq_spill_rd, &it) != 0) {
+        goto reload_exit;
+    }
+    while (mqttq_used < CONFIG_COMM_MQTT_QUEUE_LEN) {
+        size_t size = sizeof(mqttq_spill_buf);
+        if (fqueue_iter_next(&it, mqttq_spill_buf, &size) != 0) {
+            break;
+        }
+        if (size < sizeof(mqtt_spill_hdr_t)) {
+            count++;    // not ours, skip it
+            continue;
+        }
+        mqtt_spill_hdr_t hdr;
+        mqtt_msg_t       msg = { 0 };
+        memcpy(&hdr, mqttq_spill_buf, sizeof(hdr));
+        msg.len = size - sizeof(hdr);
+        msg.msg = k_heap_alloc(&mqtt_heap, msg.len + 1, K_NO_WAIT);
+        if (msg.msg == NULL) {
+            break;
+        }
+        memcpy(msg.msg, mqttq_spill_buf + sizeof(hdr), msg.len);
+        msg.msg[msg.len] = 0;
+        msg.sent_at      = mqtt_find_sent_at(msg.msg);
+        msg.topic        = hdr.topic;
+        msg.qos          = hdr.qos;
+        msg.priority     = hdr.priority;
+        mqttq_insert(added++, &msg);
+        count++;
+        mqttq_stats.reloaded++;
+    }
+    if (count > 0) {
+        fqueue_iter_commit(&it, count);
+        LOG_INF("Moved %d queued mqtt msgs back from flash", added);
+    }
+
+reload_exit:
+    k_mutex_unlock(&mqttq_lock);
+}
+
 void WMD_work_handler(struct k_work *work);
 typedef struct WMD_work_info
 {
@@ -158,14 +452,17 @@ typedef struct FMD_work_info
 
 FMD_work_info_t my_FMD_work_info;
 
+// Only the latest 9160 status matters, so a status that arrives before the
+// last one was handled replaces it and its change bits are or'ed in
 typedef struct nrfstatus_work_info
 {
-    workref_t     *nrfstatus_work;
-    uint32_t       what_changed;
-    modem_status_t status;
+    struct k_work     nrfstatus_work;
+    struct k_spinlock lock;
+    bool              pending;
+    uint32_t          what_changed;
+    modem_status_t    status;
 } nrfstatus_work_info_t;
-// nrfstatus_work_info_t my_nrfstatus_work_info;
-struct k_work nrfstatus_work;
+nrfstatus_work_info_t my_nrfstatus_work_info;
 
 typedef struct fotastatus_work_info
 {
@@ -196,17 +493,27 @@ typedef struct bluetooth_adv_work_info
 } bluetooth_adv_work_info_t;
 bluetooth_adv_work_info_t my_bluetooth_adv_work_info;
 
-typedef struct da_state_work_info
-{
-    workref_t *da_state_work;
-    da_event_t evt;
-} da_state_work_info_t;
-
-typedef struct mqtt_work_info
-{
-    workref_t      *work;
-    mqtt_payload_t *mqtt_msg;
-} mqtt_work_info_t;
+// Every DA event and cloud message has to be handled, so they wait in a
+// bounded queue that one work item drains.  DA events that don't fit are
+// or'ed into cm_da_pending, the handler only needs the event bits and
+// da_state, except for HTTP_COMPLETE which carries the download result
+#define CM_DA_EVENT_QUEUE_LEN 8
+K_MSGQ_DEFINE(cm_da_event_q, sizeof(da_event_t), CM_DA_EVENT_QUEUE_LEN, 4);
+K_MSGQ_DEFINE(cm_mqtt_rx_q, sizeof(mqtt_payload_t), CONFIG_COMM_MQTT_RX_QUEUE_LEN, 4);
+struct k_work            cm_da_event_work;
+struct k_work            cm_mqtt_rx_work;
+static struct k_spinlock cm_da_pending_lock;
+static uint32_t          cm_da_pending;
+
+enum
+{
+    CM_CHAN_MQTT_RX,
+    CM_CHAN_LTE_STATUS,
+    CM_CHAN_DA_STATE,
+    CM_CHAN_FOTA_STATE,
+    CM_CHAN_COUNT
+};
+static zbus_listener_stats_t cm_chan_stats[CM_CHAN_COUNT];
 
 // FMD variables
 static uint64_t fmd_start_time       = 0;
@@ -227,12 +534,15 @@ shadow_doc_t shadow_doc = { .S_Norm                    = CONFIG_IOT_S_NORM_DEFAU
                             .dur                       = CONFIG_LSM6DSV16X_D1_SLEEP_DURATION,
                             .fota_in_progress_duration = 60,
                             .gps_poll_period           = 0,
+                            .tele_proto                = TELEMETRY_PROTOCOL_VERSION,
                             .zones                     = { { .idx = 0, .ssid = "", .safe = 0 },
                                                            { .idx = 1, .ssid = "", .safe = 0 },
                                                            { .idx = 2, .ssid = "", .safe = 0 },
                                                            { .idx = 3, .ssid = "", .safe = 0 },
                                                            { .idx = 4, .ssid = "", .safe = 0 } } };
 void         da_state_work_handler(struct k_work *item);
+void         mqtt_rx_work_handler(struct k_work *item);
+void         handle_9160_status_update(struct k_work *item);
 ////////////////////////////////////////////////////
 
 int write_shadow_doc()
@@ -275,6 +585,7 @@ static int read_shadow_doc()
                 if (ret != 0) {
                     LOG_ERR("Failed to parse shadow doc: %s", wstrerr(-ret));
                 }
+                json_telemetry_set_protocol(shadow_doc.tele_proto);
                 k_free(shadow_json);
                 // Storing versions in shadow is what we have to do to minimize
                 // changes to the code but since the source of the version info is
@@ -590,12 +901,14 @@ int commMgr_queue_telemetry(bool include_ssids)
     }
 
     // Send telemetry uses cached results
-    char *json       = NULL;
-    int   loop_count = 0;
-    int   more_data  = 1;    // just wait, you'll see
+    char  *json       = NULL;
+    size_t json_len   = 0;
+    int    loop_count = 0;
+    int    more_data  = 1;    // just wait, you'll see
     while (more_data > 0) {
         more_data = json_telemetry(
             &json,
+            &json_len,
             machine_id,
             batt_info,
             get_charging_active(),
@@ -612,12 +925,13 @@ int commMgr_queue_telemetry(bool include_ssids)
             LOG_ERR("Failed to create telemetry json");
             goto tele_exit;
         }
-        ret = commMgr_queue_mqtt_message(json, strlen(json), MQTT_MESSAGE_TYPE_INFO_TELEMETRY, 0, 20);
+        ret = mqttq_add(json, json_len, MQTT_MESSAGE_TYPE_INFO_TELEMETRY, 0, 20, true);
         if (ret != 0) {
+            // leave the queued data for the next telemetry
             LOG_ERR("'%s'(%d) queueing telemetry", wstrerr(-ret), ret);
-        } else {
-            LOG_INF("Telemetry queued");
+            goto tele_exit;
         }
+        LOG_INF("Telemetry queued");
     }
 
 tele_exit:
@@ -1279,6 +1593,13 @@ int handle_shadow_message(char *payload, radio_t radio)
         ret         = fota_set_in_progress_timer(new_doc.fota_in_progress_duration, true);
     }
 
+    if (new_doc.tele_proto != shadow_doc.tele_proto) {
+        if (json_telemetry_set_protocol(new_doc.tele_proto) == 0) {
+            doc_changed           = true;
+            shadow_doc.tele_proto = new_doc.tele_proto;
+        }
+    }
+
     for (int i = 0; i < NUM_ZONES; i++) {
         if (strncmp(new_doc.zones[i].ssid, shadow_doc.zones[i].ssid, 32) != 0) {
             if (new_doc.zones[i].ssid[0] == 0) {
@@ -1534,6 +1855,28 @@ int handle_srf_func_message(cJSON *m)
     return 0;
 }
 
+////////////////////////////////////////////////////
+// mqtt_payload_free()
+//  free what an incoming mqtt message points to
+//
+//  @param msg the message, which itself is not freed
+//
+//  @return void
+static void mqtt_payload_free(const mqtt_payload_t *msg)
+{
+    if (msg->radio == COMM_DEVICE_DA16200) {
+        wifi_msg_free((wifi_msg_t *)(msg->user_data));
+        k_free(msg->user_data);
+    } else {
+        if (msg->payload) {
+            k_free(msg->payload);
+        }
+        if (msg->topic) {
+            k_free(msg->topic);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////
 // handle_mqtt_cloud_to_dev_message()
 //  process incoming mqtt messages from cloud
@@ -1543,11 +1886,8 @@ int handle_srf_func_message(cJSON *m)
 //  @return void
 char hmcstart[256];
 char hmcend[512];
-void handle_mqtt_cloud_to_dev_message(struct k_work *work)
+static void handle_mqtt_cloud_to_dev_message(mqtt_payload_t *msg)
 {
-    workref_t        *wr   = CONTAINER_OF(work, workref_t, work);
-    mqtt_work_info_t *info = (mqtt_work_info_t *)wr->reference;
-    mqtt_payload_t   *msg  = info->mqtt_msg;
     // log_panic();
     // printk("Received message %p from cloud(%d): %s\n", msg->user_data, msg->payload_length,
     // msg->payload); int offset = 450; snprintf(hmcstart, 128, "%s", msg->payload);
@@ -1608,24 +1948,21 @@ cleanup:
     if (root) {
         cJSON_Delete(root);
     }
+    mqtt_payload_free(msg);
+}
 
-    if (msg) {
-        if (msg->radio == COMM_DEVICE_DA16200) {
-            wifi_msg_free((wifi_msg_t *)(msg->user_data));
-            k_free(msg->user_data);
-        } else {
-            if (msg->payload) {
-                k_free(msg->payload);
-            }
-            if (msg->topic) {
-                k_free(msg->topic);
-            }
-        }
+////////////////////////////////////////////////////
+// mqtt_rx_work_handler()
+//  handle the cloud messages the listener queued
+//
+//  @return void
+void mqtt_rx_work_handler(struct k_work *item)
+{
+    mqtt_payload_t msg;
 
-        k_free(msg);
+    while (k_msgq_get(&cm_mqtt_rx_q, &msg, K_NO_WAIT) == 0) {
+        handle_mqtt_cloud_to_dev_message(&msg);
     }
-    k_free(info);
-    wr_put(wr);
 }
 
 ////////////////////////////////////////////////////
@@ -1645,44 +1982,88 @@ cleanup:
 //
 //  @return 0 on success, <0 on failure
 int commMgr_queue_mqtt_message(uint8_t *msgbuf, uint16_t msg_len, uint8_t topic_num, uint8_t qos, uint8_t priority)
+{
+    return mqttq_add(msgbuf, msg_len, topic_num, qos, priority, false);
+}
+
+// queue a message, with hold_ml the ML records of the last json_telemetry() go with it
+static int mqttq_add(uint8_t *msgbuf, uint16_t msg_len, uint8_t topic_num, uint8_t qos, uint8_t priority, bool hold_ml)
 {
     if (msg_len > WIFI_MSG_SIZE) {
         LOG_ERR("Message too long: %d", msg_len);
         return -EINVAL;
     }
-    mqtt_msg_t msg;
-    msg.msg = (uint8_t *)k_heap_alloc(&mqtt_heap, msg_len + 1, K_MSEC(10));
-    if (msg.msg == NULL) {
-        LOG_ERR("Failed to allocate memory for message");
-        return -ENOMEM;
-    }
-    memcpy(msg.msg, msgbuf, msg_len);
-    msg.msg[msg_len] = 0;    // make sure it is null terminated
-    msg.len          = msg_len;
-    msg.topic        = topic_num;
-    msg.qos          = qos;
-    msg.priority     = priority;
-    int ret          = k_msgq_put(&mqttq, &msg, K_MSEC(20));
+    mqtt_msg_t msg = { 0 };
+    int        ret = 0;
+
+    k_mutex_lock(&mqttq_lock, K_FOREVER);
+    if (mqttq_supersedes(topic_num)) {
+        for (int i = mqttq_used - 1; i >= 0; i--) {
+            if (mqttq[i].topic == topic_num && mqttq[i].ml_recs == 0) {
+                LOG_DBG("Replacing queued %s mqtt msg", msg_name(topic_num));
+                k_heap_free(&mqtt_heap, mqttq[i].msg);
+                mqttq_remove(i);
+                mqttq_stats.coalesced++;
+            }
+        }
+    }
+    while (mqttq_used == CONFIG_COMM_MQTT_QUEUE_LEN && mqttq_evict(priority)) {
+    }
+    if (mqttq_used < CONFIG_COMM_MQTT_QUEUE_LEN) {
+        msg.msg = k_heap_alloc(&mqtt_heap, msg_len + 1, K_NO_WAIT);
+        while (msg.msg == NULL && mqttq_evict(priority)) {
+            msg.msg = k_heap_alloc(&mqtt_heap, msg_len + 1, K_NO_WAIT);
+        }
+    }
+    if (msg.msg != NULL) {
+        memcpy(msg.msg, msgbuf, msg_len);
+        msg.msg[msg_len] = 0;    // make sure it is null terminated
+        msg.len          = msg_len;
+        msg.sent_at      = mqtt_find_sent_at(msg.msg);
+        msg.topic        = topic_num;
+        msg.qos          = qos;
+        msg.priority     = priority;
+        if (hold_ml) {
+            // while mqttq_lock is held, so the msg can't be sent before its records are held
+            msg.ml_recs = json_telemetry_hold();
+        }
+        mqttq_insert(mqttq_used, &msg);
+    } else if (priority <= CONFIG_COMM_MQTT_PERSIST_PRIORITY) {
+        // no room in RAM, straight to flash
+        ret = mqttq_spill_data(msgbuf, msg_len, topic_num, qos, priority);
+    } else {
+        ret = -ENOMEM;
+    }
     if (ret != 0) {
+        mqttq_stats.refused++;
         LOG_ERR("'%s'(%d) when queueing message", wstrerr(-ret), ret);
-        k_heap_free(&mqtt_heap, msg.msg);
     }
+    k_mutex_unlock(&mqttq_lock);
     return ret;
 }
 
+#define MQTT_LTE_ACK_MS 15000    // how long the 9160 can take to answer a publish
+
 ////////////////////////////////////////////////////
-// send_mqtt_message()
-//  send a message to the cloud
+// mqtt_publish()
+//  publish one message on a radio the caller already holds.
+// The message is handed to the radio as it is, only the
+// SENT_AT value at sent_at is rewritten
 //
-//  @param msg the message to send
-//  @param msg_len length of the message
-//  @param topic the topic to send the message to
-//  @param topic_len length of the topic
-//  @param qos the quality of service to use
-//  @param send_immidiately send the message now, or save till next connection
+//  @param sent_at offset of the SENT_AT value in msg, -1 if none
+//  @param handle if not NULL, an LTE publish is only started and the
+//      modem handle its ack comes back on is put here, see
+//      modem_mqtt_wait(). Left alone for a publish that is done
 //
-//  @return 0 on success, -1 on failure
-int send_mqtt_message(uint8_t *msg, uint16_t msg_len, uint8_t topic_num, uint8_t qos, bool send_immidiately)
+//  @return 0 on success, <0 on failure
+static int mqtt_publish(
+    comm_device_type_t active_radio,
+    uint8_t           *msg,
+    uint16_t           msg_len,
+    int16_t            sent_at,
+    uint8_t            topic_num,
+    uint8_t            qos,
+    int               *handle)
 {
     char *machine_id  = uicr_serial_number_get();
     char  topicBase[] = "messages/%d/%d/%d_%s/d2c";
@@ -1695,29 +2076,28 @@ int send_mqtt_message(uint8_t *msg, uint16_t msg_len, uint8_t topic_num, uint8_t
         topic_num,
         CONFIG_IOT_MQTT_BRAND_ID,
         machine_id);
-    int                ret          = 0;
-    comm_device_type_t active_radio = rm_get_active_mqtt_radio();
-
-    if (rm_prepare_radio_for_use(active_radio, true, K_SECONDS(3)) == false) {
-        return -ENOTCONN;
-    }
+    int ret = 0;
 
-    // update the SENT_AT field if present
-    // search string for 19191919191 and replace with current time
-    char *p = strstr(msg, "\"SENT_AT\":");    // "SENT_AT"
-    if (p != NULL) {
-        LOG_DBG("Found SENT_AT in message");
-        char     time_str[32];
-        uint64_t currTime = get_unix_time();
-        snprintf(time_str, 10, "%llu", currTime);
-        memcpy(p + strlen("\"SENT_AT:\""), time_str, strlen(time_str));
+    // update the SENT_AT field if present, the placeholder 1919191919
+    // has as many digits as the current time so it is written in place
+    if (sent_at >= 0) {
+        char *p      = msg + sent_at;
+        int   digits = strspn(p, "0123456789");
+        char  time_str[24];
+        if (snprintf(time_str, sizeof(time_str), "%0*llu", digits, (unsigned long long)get_unix_time()) == digits) {
+            memcpy(p, time_str, digits);
+        }
     }
 
     LOG_DBG("Sending message to cloud via %s: %s", comm_dev_str(active_radio), msg);
 
     if (active_radio == COMM_DEVICE_NRF9160) {
-        int timeout_ms = 15000;
-        if ((ret = modem_send_mqtt(topic, topicLen, msg, msg_len, qos, timeout_ms)) == 0) {
+        if (handle != NULL) {
+            if ((ret = modem_send_mqtt_start(topic, topicLen, msg, msg_len, qos)) >= 0) {
+                *handle = ret;
+                ret     = 0;
+            }
+        } else if ((ret = modem_send_mqtt(topic, topicLen, msg, msg_len, qos, MQTT_LTE_ACK_MS)) == 0) {
             LOG_DBG("LTE mqtt sent");
         } else {
             LOG_DBG("Failed to send LTE mqtt message (%d) %s", ret, wstrerr(-ret));
@@ -1731,7 +2111,7 @@ int send_mqtt_message(uint8_t *msg, uint16_t msg_len, uint8_t topic_num, uint8_t
         if (tok != NULL) {
             type = atoi(tok);
         }
-        if ((ret = wifi_mqtt_publish(type, msg, true, K_SECONDS(6))) == 0) {
+        if ((ret = wifi_mqtt_publish(type, msg, msg_len, true, K_SECONDS(6))) == 0) {
             LOG_DBG("Wifi mqtt sent");
         } else {
             LOG_ERR("'%s'(%d) sending Wifi mqtt", wstrerr(-ret), ret);
@@ -1740,6 +2120,31 @@ int send_mqtt_message(uint8_t *msg, uint16_t msg_len, uint8_t topic_num, uint8_t
     }
 
 send_exit:
+    return ret;
+}
+
+////////////////////////////////////////////////////
+// send_mqtt_message()
+//  send a message to the cloud
+//
+//  @param msg the message to send
+//  @param msg_len length of the message
+//  @param topic the topic to send the message to
+//  @param topic_len length of the topic
+//  @param qos the quality of service to use
+//  @param send_immidiately send the message now, or save till next connection
+//
+//  @return 0 on success, -1 on failure
+int send_mqtt_message(uint8_t *msg, uint16_t msg_len, uint8_t topic_num, uint8_t qos, bool send_immidiately)
+{
+    comm_device_type_t active_radio = rm_get_active_mqtt_radio();
+
+    if (rm_prepare_radio_for_use(active_radio, true, K_SECONDS(3)) == false) {
+        return -ENOTCONN;
+    }
+
+    int ret = mqtt_publish(active_radio, msg, msg_len, mqtt_find_sent_at(msg), topic_num, qos, NULL);
+
     LOG_DBG("done with radio for use %s", comm_dev_str(active_radio));
     rm_done_with_radio(active_radio);
     k_sleep(K_MSEC(1000));    // EAS XXX check for race in sleep
@@ -1849,13 +2254,91 @@ bool commMgr_fota_in_progress()
     return g_DA_fota_in_progress || g_5340_fota_in_progress || g_9160_fota_in_progress;
 }
 
+// radio-on time of the mqttQ_work_handler() send sessions
+static struct
+{
+    uint32_t sessions;
+    uint32_t sent;
+    uint32_t failed;
+    uint64_t radio_ms;
+    uint32_t last_sent;
+    uint32_t last_ms;
+} mqtt_drain;
+
+// release the radio at the end of a send session and account for it
+static void mqtt_drain_end(comm_device_type_t active_radio, int64_t session_start, int sent)
+{
+    int64_t radio_ms = k_uptime_get() - session_start;
+
+    rm_done_with_radio(active_radio);
+    mqtt_drain.sessions++;
+    mqtt_drain.sent     += sent;
+    mqtt_drain.radio_ms += radio_ms;
+    mqtt_drain.last_sent = sent;
+    mqtt_drain.last_ms   = radio_ms;
+    if (sent > 0) {
+        LOG_INF("Sent %d queued mqtt messages over %s in %lldms", sent, comm_dev_str(active_radio), radio_ms);
+    }
+}
+
+// a publish waiting for its ack from the 9160
+typedef struct
+{
+    mqtt_msg_t msg;
+    int        handle;
+} mqtt_out_t;
+
+// what a send session does after one publish
+typedef enum
+{
+    MQTT_DRAIN_NEXT,      // sent, or dropped for good
+    MQTT_DRAIN_RETRY,     // put it back and try again next session
+    MQTT_DRAIN_SWITCH,    // put it back, the 9160 has to come back first
+} mqtt_drain_step_t;
+
+// deal with the result of publishing one queued message. The caller puts
+// msg back on the queue for anything but MQTT_DRAIN_NEXT
+static mqtt_drain_step_t mqtt_drain_result(comm_device_type_t active_radio, mqtt_msg_t *msg, int ret)
+{
+    if (ret == 0) {
+        LOG_INF("Sent queued %s mqtt message over %s", msg_name(msg->topic), comm_dev_str(active_radio));
+        mqttq_commit_ml(msg);
+        k_heap_free(&mqtt_heap, msg->msg);
+        return MQTT_DRAIN_NEXT;
+    }
+    // Some errors are transient and we can try again, others are problems with
+    // the msg and we should drop the message or it will never go away
+    if (ret == -ENODEV && active_radio == COMM_DEVICE_NRF9160 && !rm_is_switching_radios()) {
+        // The 9160 is off but we thought it was on, so re-enable it
+        LOG_WRN("'%s'(%d) sending %s mqtt msg, re-enabling 9160", wstrerr(-ret), ret, msg_name(msg->topic));
+        return MQTT_DRAIN_SWITCH;
+    }
+    if (ret == -634) {    // MQTT not connected
+        // No MQTT, so we can't send any more messages
+        return MQTT_DRAIN_SWITCH;
+    }
+    if (ret == -EFBIG || ret == -EINVAL) {
+        LOG_ERR("'%s'(%d) sending msg, dropping if from the queue", wstrerr(-ret), ret);
+        // it will never go, so its ML records can't either
+        mqttq_commit_ml(msg);
+        k_heap_free(&mqtt_heap, msg->msg);
+        return MQTT_DRAIN_NEXT;
+    }
+    LOG_DBG("'%s'(%d) sending queued %s mqtt msg, will try later", wstrerr(-ret), ret, msg_name(msg->topic));
+    mqtt_drain.failed++;
+    return MQTT_DRAIN_RETRY;
+}
+
 ////////////////////////////////////////////////////
 //  mqttQ_work_handler()
-//  Check if we can send queued mqtt messages
+//  Check if we can send queued mqtt messages. Everything that is queued
+//  goes out in one session: the radio is held once, the messages are
+//  published back to back, and the radio is released at the end.
 void mqttQ_work_handler(struct k_work *work)
 {
     mqtt_msg_t msg;
-    int        num_msgs = k_msgq_num_used_get(&mqttq);
+    int        num_msgs;
+    int        sent = 0;
 
     if (work) {
         workref_t *wr = CONTAINER_OF(work, workref_t, work);
@@ -1879,6 +2362,8 @@ void mqttQ_work_handler(struct k_work *work)
         return;
     }
 
+    mqttq_reload();
+    num_msgs = mqttq_num_used();
     if (num_msgs == 0) {
         return;
     }
@@ -1886,6 +2371,7 @@ void mqttQ_work_handler(struct k_work *work)
     if (rm_prepare_radio_for_use(active_radio, true, K_SECONDS(3)) == false) {
         return;
     }
+    int64_t session_start = k_uptime_get();
     if (active_radio == COMM_DEVICE_DA16200) {
         k_sleep(K_MSEC(75));    // Allow the MQTT client time to fully wake up
         int ret = wifi_get_wfstat(K_MSEC(800));
@@ -1903,53 +2389,91 @@ void mqttQ_work_handler(struct k_work *work)
             }
         }
     }
-    for (int n = 0; n < num_msgs; n++) {
-        int ret = k_msgq_get(&mqttq, &msg, K_NO_WAIT);
-        if (ret != 0) {
-            LOG_ERR("'%s'(%d) getting message from queue", wstrerr(-ret), ret);
-            break;
-        }
-        if (da_state.onboarded != DA_STATE_KNOWN_TRUE && msg.topic != MQTT_MESSAGE_TYPE_ONBOARDING) {
-            LOG_WRN("Not onboarded, not sending %s mqtt message", msg_name(msg.topic));
-            k_msgq_put(&mqttq, &msg, K_NO_WAIT);
-            continue;
+    // The 9160 answers each publish on its own modem handle, so a window of them
+    // goes out back to back and the acks are taken oldest first. The DA's
+    // +NWMQMSGSND carries no message id, there it is one publish at a time.
+    // ML records are committed in the order they were held, so only one message
+    // carrying them is waiting for its ack at any time
+    mqtt_out_t        out[CONFIG_COMM_MQTT_LTE_WINDOW];
+    mqtt_msg_t        back[CONFIG_COMM_MQTT_LTE_WINDOW];
+    int               window   = active_radio == COMM_DEVICE_NRF9160 ? CONFIG_COMM_MQTT_LTE_WINDOW : 1;
+    int               n_out    = 0;
+    int               ml_out   = 0;
+    int               n_back   = 0;
+    bool              have_msg = false;
+    mqtt_drain_step_t step     = MQTT_DRAIN_NEXT;
+
+    num_msgs = MIN(num_msgs, CONFIG_COMM_MQTT_DRAIN_MAX_MSGS);
+    for (int n = 0;;) {
+        if (!have_msg && step == MQTT_DRAIN_NEXT && n < num_msgs) {
+            // until we are onboarded, only the onboarding message can go
+            bool onboarded = da_state.onboarded == DA_STATE_KNOWN_TRUE;
+            if (mqttq_get(&msg, onboarded ? -1 : MQTT_MESSAGE_TYPE_ONBOARDING) == 0) {
+                have_msg = true;
+                n++;
+            } else {
+                if (!onboarded) {
+                    LOG_WRN("Not onboarded, not sending queued mqtt messages");
+                }
+                n = num_msgs;
+            }
         }
-        // EAS XXX Put priority handling here
-        ret = send_mqtt_message(msg.msg, msg.len, msg.topic, msg.qos, true);
-        if (ret == 0) {
-            LOG_INF("Sent queued %s mqtt message over %s", msg_name(msg.topic), comm_dev_str(active_radio));
-            k_heap_free(&mqtt_heap, msg.msg);
-            continue;
-        } else {
-            // Some errors are transient and we can try again, others are problems with
-            // the msg and we should drop the message or it will never go away
-            if (ret == -ENODEV && active_radio == COMM_DEVICE_NRF9160 && !rm_is_switching_radios()) {
-                // The 9160 is off but we thought it was on, so re-enable it
-                LOG_WRN("'%s'(%d) sending %s mqtt msg, re-enabling 9160", wstrerr(-ret), ret, msg_name(msg.topic));
-                rm_switch_to(COMM_DEVICE_NRF9160, false, false);
-                return;
+        if (have_msg && step == MQTT_DRAIN_NEXT && n_out < window && (msg.ml_recs == 0 || ml_out == 0)) {
+            int handle = -1;
+            int ret    = mqtt_publish(
+                active_radio, msg.msg, msg.len, msg.sent_at, msg.topic, msg.qos, window > 1 ? &handle : NULL);
+            have_msg = false;
+            if (ret == 0 && handle >= 0) {
+                out[n_out].msg    = msg;
+                out[n_out].handle = handle;
+                n_out++;
+                ml_out += msg.ml_recs > 0;
+                continue;
             }
-            if (ret == -634) {    // MQTT not connected
-                k_msgq_put(&mqttq, &msg, K_NO_WAIT);
-                rm_done_with_radio(active_radio);    // might need to happen before switch
-                rm_switch_to(COMM_DEVICE_NRF9160, false, false);
-                // No MQTT, so we can't send any more messages
-                return;
+            sent += ret == 0;
+            step  = mqtt_drain_result(active_radio, &msg, ret);
+            if (step != MQTT_DRAIN_NEXT) {
+                // the newest one out, everything still in flight goes back in front of it
+                mqttq_put_back(&msg);
             }
-            if (ret == -EFBIG || ret == -EINVAL) {
-                LOG_ERR("'%s'(%d) sending msg, dropping if from the queue", wstrerr(-ret), ret);
-                k_heap_free(&mqtt_heap, msg.msg);
-                continue;
-            } else {
-                LOG_DBG("'%s'(%d) sending queued %s mqtt msg, will try later", wstrerr(-ret), ret, msg_name(msg.topic));
-                // put it back on the queue and stop trying
-                k_msgq_put(&mqttq, &msg, K_NO_WAIT);
-                break;
+            continue;
+        }
+        if (n_out == 0) {
+            break;
+        }
+        // the window is full, or nothing more can start, take the oldest ack
+        int        ret  = modem_mqtt_wait(out[0].handle, MQTT_LTE_ACK_MS);
+        mqtt_msg_t done = out[0].msg;
+        n_out--;
+        memmove(&out[0], &out[1], n_out * sizeof(out[0]));
+        ml_out -= done.ml_recs > 0;
+        sent   += ret == 0;
+
+        mqtt_drain_step_t done_step = mqtt_drain_result(active_radio, &done, ret);
+        if (done_step != MQTT_DRAIN_NEXT) {
+            back[n_back++] = done;
+            if (step != MQTT_DRAIN_SWITCH) {
+                step = done_step;
             }
         }
     }
+    if (have_msg) {
+        mqttq_put_back(&msg);
+    }
+    // newest first, so they end up in the order they were sent
+    while (n_back > 0) {
+        mqttq_put_back(&back[--n_back]);
+    }
 
-    rm_done_with_radio(active_radio);
+    mqtt_drain_end(active_radio, session_start, sent);    // might need to happen before switch
+    if (step == MQTT_DRAIN_SWITCH) {
+        // the 9160 is off, or MQTT is gone on this radio
+        rm_switch_to(COMM_DEVICE_NRF9160, false, false);
+        return;
+    }
+    if (sent > 0) {
+        k_sleep(K_MSEC(1000));    // EAS XXX check for race in sleep
+    }
 }
 
 void send_queued_mqtt_msgs()
@@ -2070,11 +2594,19 @@ cleanup:
 //  @return void
 void handle_9160_status_update(struct k_work *item)
 {
-    workref_t             *wr              = CONTAINER_OF(item, workref_t, work);
-    nrfstatus_work_info_t *new_status_info = (nrfstatus_work_info_t *)wr->reference;
+    nrfstatus_work_info_t *info = CONTAINER_OF(item, nrfstatus_work_info_t, nrfstatus_work);
+    modem_status_t         status;
+    uint32_t               what_changed;
+
+    k_spinlock_key_t key = k_spin_lock(&info->lock);
+    status               = info->status;
+    what_changed         = info->what_changed;
+    info->what_changed   = 0;
+    info->pending        = false;
+    k_spin_unlock(&info->lock, key);
+
     lte_status_count++;
-    uint32_t what_changed = new_status_info->what_changed;
-    uint32_t status_flags = new_status_info->status.status_flags;
+    uint32_t status_flags = status.status_flags;
     int      ret;
 
     // LOG_DBG("9160 status flags: %u", status_flags);
@@ -2123,8 +2655,8 @@ void handle_9160_status_update(struct k_work *item)
         }
     }
 
-    // LOG_ERR("9160 uptime: %llu, %llu", new_status_info->status.uptime, last_9160_uptime);
-    if (last_9160_uptime > new_status_info->status.uptime && modem_is_powered_on()) {
+    // LOG_ERR("9160 uptime: %llu, %llu", status.uptime, last_9160_uptime);
+    if (last_9160_uptime > status.uptime && modem_is_powered_on()) {
         LOG_WRN("9160 reset");
         subscribe_to_topics_9160();
         if (is_in_fmd_mode) {
@@ -2134,7 +2666,7 @@ void handle_9160_status_update(struct k_work *item)
             }
         }
     }
-    last_9160_uptime = new_status_info->status.uptime;
+    last_9160_uptime = status.uptime;
 
     if (what_changed & UPDATE_STATUS_MQTT_INITIALIZED) {
         // MQTT connected status changed
@@ -2163,9 +2695,9 @@ void handle_9160_status_update(struct k_work *item)
 
     // fota_status_update(status.fota_state, status.fota_percentage, COMM_DEVICE_NRF9160);  //
     // if nothing is doing fota, this will do nothing
-    if (new_status_info->status.fota_state != 0) {
-        fota_status_t evt = { .status      = new_status_info->status.fota_state,
-                              .percentage  = new_status_info->status.fota_percentage,
+    if (status.fota_state != 0) {
+        fota_status_t evt = { .status      = status.fota_state,
+                              .percentage  = status.fota_percentage,
                               .device_type = COMM_DEVICE_NRF9160 };
         zbus_chan_pub(&FOTA_STATE_UPDATE, &evt, K_MSEC(100));
     }
@@ -2178,8 +2710,6 @@ void handle_9160_status_update(struct k_work *item)
     }
 
     // LOG_DBG("9160 shadow status update: %d", status.status_flags);
-    k_free(new_status_info);
-    wr_put(wr);
 }
 
 int clear_fmd_states()
@@ -2471,6 +3001,9 @@ void commMgr_init()
     k_work_init(&my_gps_work_info.gps_work, gps_handler);
     k_work_init(&my_SRF_nonce_work_info.srf_nonce_work, handle_disconnect_from_mqtt);
     k_work_init(&my_bluetooth_adv_work_info.bluetooth_adv_work, bluetooth_work_handler);
+    k_work_init(&my_nrfstatus_work_info.nrfstatus_work, handle_9160_status_update);
+    k_work_init(&cm_da_event_work, da_state_work_handler);
+    k_work_init(&cm_mqtt_rx_work, mqtt_rx_work_handler);
     // Start the S work timer to handle SSID scans, telemetry, etc.
     // We wait until at least 10 seconds after 5340 boots to start the S work
     // THe value of S_var can change based on mode and other factors
@@ -2503,101 +3036,59 @@ void commMgr_init()
 static void comm_mgr_listener(const struct zbus_channel *chan)
 {
     if (&MQTT_CLOUD_TO_DEV_MESSAGE == chan) {
-        mqtt_work_info_t *info = k_malloc(sizeof(mqtt_work_info_t));
-        if (info == NULL) {
-            LOG_ERR("Out of memory for handling incoming work");
-            return;
-        }
-        info->work = wr_get(info, __LINE__);
-        if (info->work == NULL) {
-            LOG_ERR("Out of work items for handling incoming payload");
-            k_free(info);
-            return;
-        }
-        mqtt_payload_t *msg = k_malloc(sizeof(mqtt_payload_t));
-        if (msg == NULL) {
-            LOG_ERR("Out of memory for handling incoming payload");
-            wr_put(info->work);
-            k_free(info);
-            return;
-        }
         const mqtt_payload_t *cmsg = zbus_chan_const_msg(chan);    // Direct message access
-        memcpy(msg, cmsg, sizeof(mqtt_payload_t));
-        info->mqtt_msg = msg;
-        k_work_init(&info->work->work, handle_mqtt_cloud_to_dev_message);
-        int err = k_work_submit_to_queue(&commMgr_work_q, &(info->work->work));
-        if (err <= 0) {
-            LOG_ERR("Could not submit incoming work %d", err);
-            wr_put(info->work);
-            k_free(info);
-            if (cmsg->payload) {
-                k_free(cmsg->payload);
-            }
-            if (cmsg->topic) {
-                k_free(cmsg->topic);
-            }
-            k_free(msg);
-            msg = NULL;
+        cm_chan_stats[CM_CHAN_MQTT_RX].published++;
+        if (k_msgq_put(&cm_mqtt_rx_q, cmsg, K_NO_WAIT) != 0) {
+            // We own the payload now, so it has to go with the message
+            LOG_ERR("Incoming cloud message queue full, dropping message");
+            cm_chan_stats[CM_CHAN_MQTT_RX].dropped++;
+            mqtt_payload_free(cmsg);
         }
+        k_work_submit_to_queue(&commMgr_work_q, &cm_mqtt_rx_work);
     }
 
     if (&LTE_STATUS_UPDATE == chan) {
-        modem_status_update_t        status_update;
         const modem_status_update_t *cstatus = zbus_chan_const_msg(chan);    // Direct message access
-        memcpy(&status_update, cstatus, sizeof(modem_status_update_t));
+        nrfstatus_work_info_t       *info    = &my_nrfstatus_work_info;
 
-        nrfstatus_work_info_t *new_nrfstatus_work_info = k_malloc(sizeof(nrfstatus_work_info_t));
-        if (new_nrfstatus_work_info == NULL) {
-            LOG_ERR("Out of memory!");
-            return;
-        }
-        new_nrfstatus_work_info->nrfstatus_work = wr_get(new_nrfstatus_work_info, __LINE__);
-        if (new_nrfstatus_work_info->nrfstatus_work == NULL) {
-            LOG_ERR("Out of workrefs!");
-            k_free(new_nrfstatus_work_info);
-            return;
+        k_spinlock_key_t key = k_spin_lock(&info->lock);
+        if (info->pending) {
+            cm_chan_stats[CM_CHAN_LTE_STATUS].coalesced++;
         }
+        info->what_changed |= cstatus->change_bits;
+        info->status        = cstatus->status;
+        info->pending       = true;
+        k_spin_unlock(&info->lock, key);
 
-        k_work_init(&new_nrfstatus_work_info->nrfstatus_work->work, handle_9160_status_update);
-        new_nrfstatus_work_info->what_changed = status_update.change_bits;
-        new_nrfstatus_work_info->status       = status_update.status;
+        cm_chan_stats[CM_CHAN_LTE_STATUS].published++;
         lte_zbus_status_count++;
-        int err = k_work_submit_to_queue(&commMgr_work_q, &new_nrfstatus_work_info->nrfstatus_work->work);
-        if (err <= 0) {
-            LOG_ERR("Failed to submit nrfstatus work: %d", err);
-            wr_put(new_nrfstatus_work_info->nrfstatus_work);
-            k_free(new_nrfstatus_work_info);
-        }
+        k_work_submit_to_queue(&commMgr_work_q, &info->nrfstatus_work);
     }
 
     if (chan == &da_state_chan) {
-        da_state_work_info_t *work_item = k_malloc(sizeof(da_state_work_info_t));
-        if (work_item == NULL) {
-            LOG_ERR("Error allocating memory for da_state_work_info_t");
-            return;
-        }
-        work_item->da_state_work = wr_get(work_item, __LINE__);
-        if (work_item->da_state_work == NULL) {
-            LOG_ERR("Error allocating workref for da_state_work_info_t");
-            k_free(work_item);
-            return;
-        }
-        k_work_init(&(work_item->da_state_work->work), da_state_work_handler);
         const da_event_t *evt = zbus_chan_const_msg(chan);    // Direct message access
-        memcpy(&(work_item->evt), evt, sizeof(da_event_t));
-
-        int ret = k_work_submit_to_queue(&commMgr_work_q, &(work_item->da_state_work->work));
-        if (ret != 1) {
-            LOG_ERR("Error submitting work to queue: %d", ret);
-            wr_put(work_item->da_state_work);
-            k_free(work_item);
+        cm_chan_stats[CM_CHAN_DA_STATE].published++;
+        if (k_msgq_put(&cm_da_event_q, evt, K_NO_WAIT) != 0) {
+            k_spinlock_key_t key = k_spin_lock(&cm_da_pending_lock);
+            cm_da_pending |= evt->events & ~DA_EVENT_TYPE_HTTP_COMPLETE;
+            k_spin_unlock(&cm_da_pending_lock, key);
+            if (evt->events & DA_EVENT_TYPE_HTTP_COMPLETE) {
+                LOG_ERR("DA event queue full, dropping HTTP complete");
+                cm_chan_stats[CM_CHAN_DA_STATE].dropped++;
+            } else {
+                cm_chan_stats[CM_CHAN_DA_STATE].coalesced++;
+            }
         }
+        k_work_submit_to_queue(&commMgr_work_q, &cm_da_event_work);
     }
 
     if (&FOTA_STATE_UPDATE == chan) {
         const fota_status_t *cstatus = zbus_chan_const_msg(chan);    // Direct message access
         memcpy(&(my_fotastatus_work_info.status), cstatus, sizeof(fota_status_t));
-        k_work_submit_to_queue(&commMgr_work_q, &(my_fotastatus_work_info.fotastatus_work));
+        cm_chan_stats[CM_CHAN_FOTA_STATE].published++;
+        if (k_work_submit_to_queue(&commMgr_work_q, &(my_fotastatus_work_info.fotastatus_work)) == 0) {
+            cm_chan_stats[CM_CHAN_FOTA_STATE].coalesced++;
+        }
     }
 
     if (&BATTERY_PERCENTAGE_UPDATE == chan) {
@@ -2637,15 +3128,18 @@ static void comm_mgr_listener(const struct zbus_channel *chan)
     }
 }
 
-void da_state_work_handler(struct k_work *work)
+////////////////////////////////////////////////////
+// handle_da_event()
+//  act on one DA state change
+//
+//  @return void
+static void handle_da_event(const da_event_t *evt)
 {
-    workref_t            *wr                = CONTAINER_OF(work, workref_t, work);
-    da_state_work_info_t *da_state_work_obj = (da_state_work_info_t *)wr->reference;
-    if (da_state_work_obj->evt.events & DA_EVENT_TYPE_HTTP_COMPLETE) {
-        fota_handle_da_event(da_state_work_obj->evt);
+    if (evt->events & DA_EVENT_TYPE_HTTP_COMPLETE) {
+        fota_handle_da_event(*evt);
     }
 
-    if (da_state_work_obj->evt.events & DA_EVENT_TYPE_AP_CONNECT) {
+    if (evt->events & DA_EVENT_TYPE_AP_CONNECT) {
         if (da_state.ap_connected == DA_STATE_KNOWN_TRUE) {
             // We have connected to an AP, reset the number of retries after a
             // disconnect we will do
@@ -2710,13 +3204,13 @@ void da_state_work_handler(struct k_work *work)
         }
     }
 
-    if (da_state_work_obj->evt.events & DA_EVENT_TYPE_AP_SAFE) {
+    if (evt->events & DA_EVENT_TYPE_AP_SAFE) {
         if (da_state.ap_safe == DA_STATE_KNOWN_TRUE) {
             disable_fmd_mode(FMD_SAFE);
         }
     }
 
-    if (da_state_work_obj->evt.events & DA_EVENT_TYPE_MQTT_BROKER_CONNECT) {
+    if (evt->events & DA_EVENT_TYPE_MQTT_BROKER_CONNECT) {
         if ((da_state.mqtt_broker_connected != DA_STATE_KNOWN_TRUE)
             && (rm_get_active_mqtt_radio() == COMM_DEVICE_DA16200)) {
             // lost connection to MQTT
@@ -2724,8 +3218,29 @@ void da_state_work_handler(struct k_work *work)
             k_work_submit_to_queue(&commMgr_work_q, &(my_SRF_nonce_work_info.srf_nonce_work));
         }
     }
-    k_free(da_state_work_obj);
-    wr_put(wr);
+}
+
+////////////////////////////////////////////////////
+// da_state_work_handler()
+//  handle the DA events the listener queued
+//
+//  @return void
+void da_state_work_handler(struct k_work *work)
+{
+    da_event_t evt;
+
+    while (k_msgq_get(&cm_da_event_q, &evt, K_NO_WAIT) == 0) {
+        handle_da_event(&evt);
+    }
+
+    // then the ones that overflowed the queue, all at once
+    k_spinlock_key_t key = k_spin_lock(&cm_da_pending_lock);
+    evt                  = (da_event_t){ .timestamp = k_uptime_get(), .events = cm_da_pending };
+    cm_da_pending        = 0;
+    k_spin_unlock(&cm_da_pending_lock, key);
+    if (evt.events != 0) {
+        handle_da_event(&evt);
+    }
 }
 
 K_THREAD_DEFINE(comm_mgr_task_id, 4092, commMgr_init, NULL, NULL, NULL, CONFIG_MAIN_THREAD_PRIORITY - 1, 0, 0);
@@ -2865,7 +3380,7 @@ void do_dump_queued_msgs(const struct shell *sh, size_t argc, char **argv)
     int        idx = 0;
 
     while (true) {
-        int ret = k_msgq_peek_at(&mqttq, &msg, idx);
+        int ret = mqttq_peek_at(&msg, idx);
         if (ret != 0) {
             break;
         }
@@ -2874,6 +3389,20 @@ void do_dump_queued_msgs(const struct shell *sh, size_t argc, char **argv)
     }
 }
 
+void do_drain_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    shell_print(sh, "MQTT send sessions: %u", mqtt_drain.sessions);
+    shell_print(sh, "   Messages sent: %u, send failures: %u", mqtt_drain.sent, mqtt_drain.failed);
+    shell_print(sh, "   Radio on time: %llums", mqtt_drain.radio_ms);
+    if (mqtt_drain.sent > 0) {
+        shell_print(sh, "   Radio on time per message: %llums", mqtt_drain.radio_ms / mqtt_drain.sent);
+    }
+    if (mqtt_drain.radio_ms > 0) {
+        shell_print(sh, "   Drain rate: %llu msgs/min", (uint64_t)mqtt_drain.sent * 60000 / mqtt_drain.radio_ms);
+    }
+    shell_print(sh, "   Last session: %u messages in %ums", mqtt_drain.last_sent, mqtt_drain.last_ms);
+}
+
 void do_send_telemetry(const struct shell *sh, size_t argc, char **argv)
 {
     commMgr_queue_telemetry(true);
@@ -2905,10 +3434,29 @@ void do_cm_status(const struct shell *sh, size_t argc, char **argv)
     shell_print(sh, "   Calculated T, based on Calculated S: %d", gT_val);
     shell_print(sh, "   Seconds to next SSID scan (from now): %d", k_timer_remaining_get(&S_work_timer) / 1000);
     shell_print(sh, "   Number of SSID Scans to next telemetry(from now): %d", gT_val - gT_count);
-    shell_print(sh, "   Number of message in send queue: %d", k_msgq_num_used_get(&mqttq));
+    shell_print(sh, "   Number of message in send queue: %d", mqttq_num_used());
+    shell_print(
+        sh,
+        "   Send queue replaced: %u, dropped: %u, to flash: %u, from flash: %u, refused: %u",
+        mqttq_stats.coalesced,
+        mqttq_stats.evicted,
+        mqttq_stats.spilled,
+        mqttq_stats.reloaded,
+        mqttq_stats.refused);
     shell_print(sh, "   SSID Scans disabled: %s", g_comm_mgr_disable_S_work ? "True" : "False");
     shell_print(sh, "   MQTT sends disabled: %s", g_comm_mgr_disable_Q_work ? "True" : "False");
     shell_print(sh, "   FMD mode: %s", is_in_fmd_mode ? "True" : "False");
+
+    static const char *const chan_names[CM_CHAN_COUNT] = { "cloud msg", "9160 status", "DA event", "FOTA state" };
+    for (int i = 0; i < CM_CHAN_COUNT; i++) {
+        shell_print(
+            sh,
+            "   zbus %s: received %u, merged %u, dropped %u",
+            chan_names[i],
+            cm_chan_stats[i].published,
+            cm_chan_stats[i].coalesced,
+            cm_chan_stats[i].dropped);
+    }
 }
 
 void do_ssid_scan(const struct shell *sh, size_t argc, char **argv)
@@ -2954,6 +3502,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
     sub_commMgr,
     SHELL_CMD(alert, NULL, "Queue an alert to staging. " ALERT_SEND_PARAMS, do_alert_send),
     SHELL_CMD(conn_test, NULL, "Queue a connectivity msg. " CONNTIVITY_PARAMS, do_connectivity),
+    SHELL_CMD(drain_stats, NULL, "Show mqtt queue send session stats.", do_drain_stats),
     SHELL_CMD(dump_queued_msgs, NULL, "print the contents of the mqtt msg queue. ", do_dump_queued_msgs),
     SHELL_CMD(enable, NULL, "Enable or disable commMgr work. " ENABLE_PARAMS, do_cm_enable),
     SHELL_CMD(fmd, NULL, "Enable or disable fmd. " ENABLE_FMD_PARAMS, do_fmd_enable),
@@ -88,24 +88,19 @@ int format_telem_log_string(char *log_str, telemetry_log_data_t *telem_log_info,
     return 0;
 }
 
-// get gps list as json
-int telem_log_get_json_list(cJSON *jsonObj, int16_t *remaining_space)
+// add the queued logs to the telemetry as a "LOGS" array
+int telem_log_get_json_list(tele_writer_t *tw)
 {
     if (k_fifo_is_empty(&telemetry_log_data_fifo)) {
         return -ENOENT;
     }
 
-    if (*remaining_space < 64) {
-        return -ENOMEM;
-    }
-    cJSON *log_array = cJSON_AddArrayToObject(jsonObj, "LOGS");
-    if (!log_array) {
-        LOG_ERR("Failed to create log array");
-        return -1;
+    tw_mark_t start = tw_mark(tw);
+    if (tw_array_begin(tw, "LOGS") != 0) {
+        return 1;
     }
-    *remaining_space -= sizeof("LOGS") + 5;    // for 2x" 2x[ and 1x:
 
-    char tempSpace[CONFIG_MAX_TELEMETRY_LOG_MSG_SIZE + 100];
+    int added = 0;
     while (!k_fifo_is_empty(&telemetry_log_data_fifo)) {
         telemetry_log_data_t *telem_log_info = k_fifo_peek_head(&telemetry_log_data_fifo);
         if (telem_log_info) {
@@ -113,18 +108,16 @@ int telem_log_get_json_list(cJSON *jsonObj, int16_t *remaining_space)
             int  ret = format_telem_log_string(logFmtString, telem_log_info, CONFIG_MAX_TELEMETRY_LOG_MSG_SIZE + 100);
             if (ret != 0) {
                 LOG_ERR("Failed to format log string");
+                tw_end(tw);
                 return ret;
             }
-            cJSON *j_str = cJSON_CreateString(logFmtString);
-            if (!j_str) {
-                LOG_ERR("Failed to create log string");
-                return ret;
-            }
-            // math to determine if we have enough space to add this log
-            cJSON_PrintPreallocated(j_str, tempSpace, CONFIG_MAX_TELEMETRY_LOG_MSG_SIZE + 100, false);
-            if (*remaining_space < strlen(tempSpace)) {
-                cJSON_Delete(j_str);
+            if (tw_str(tw, NULL, logFmtString) != 0) {
                 LOG_DBG("log_print telemetry log to list: %d", telemetry_log_data_fifo_count);
+                if (added == 0) {
+                    tw_rewind(tw, start);    // don't leave an empty array behind
+                } else {
+                    tw_end(tw);
+                }
                 return 1;    // we're out of space and need to continue on the next
                              // loop
             }
@@ -132,14 +125,14 @@ int telem_log_get_json_list(cJSON *jsonObj, int16_t *remaining_space)
             telemetry_log_data_t *telem_log_info2 = k_fifo_get(
                 &telemetry_log_data_fifo,
                 K_NO_WAIT);    // pop the message off the fifo
-            cJSON_AddItemToArray(log_array, j_str);
-            *remaining_space -= strlen(tempSpace);
+            added++;
             telemetry_log_data_fifo_count--;
             if (telem_log_info2) {
                 free_log_msg(telem_log_info2);
             }
         }
     }
+    tw_end(tw);
 
     telem_log_clear();
     return 0;
@@ -11,7 +11,6 @@
 #include "d1_zbus.h"
 #include "d1_json.h"
 #include "modem_interface_types.h"
-#include "wi.h"
 
 LOG_MODULE_REGISTER(radio_mgr, CONFIG_RADIO_MGR_LOG_LEVEL);
 
@@ -68,27 +67,48 @@ typedef enum
 
 typedef struct switch_radios_info_struct
 {
-    struct k_work         SR_work;
-    switch_radios_state_t currOp;
-    uint64_t              currOpStart;
-    comm_device_type_t    target_radio;
-    int                   op_failures;
-    int                   max_retrys;
-    int                   timeout;
-    bool                  radio_enabled;
-    bool                  radio_disabled;
+    struct k_work_delayable SR_work;
+    switch_radios_state_t   currOp;
+    uint64_t                currOpStart;
+    comm_device_type_t      target_radio;
+    int                     op_failures;
+    int                     max_retrys;
+    int                     timeout;
+    int                     step;    // first entry of switch_steps[] not done yet
+    uint64_t                stepStart;
 } switch_radios_info_t;
 
-switch_radios_info_t switch_radios_info = { .SR_work        = { .handler = switch_radios_work_handler },
-                                            .currOp         = SRS_IDLE,
-                                            .currOpStart    = 0,
-                                            .target_radio   = COMM_DEVICE_NRF9160,
-                                            .op_failures    = 0,
-                                            .radio_enabled  = false,
-                                            .radio_disabled = false };
+switch_radios_info_t switch_radios_info = { .currOp       = SRS_IDLE,
+                                            .currOpStart  = 0,
+                                            .target_radio = COMM_DEVICE_NRF9160,
+                                            .op_failures  = 0,
+                                            .step         = 0 };
 
-void queue_switching_handler(struct k_timer *dummy);
-K_TIMER_DEFINE(continue_switching_timer, queue_switching_handler, NULL);
+// A DA or 9160 event moves the switch on after this long, so a burst of them runs it once
+#define RM_EVENT_SETTLE_MS 20
+
+// Handover latency buckets, each twice the one before: < 0.5s, < 1s ... < 32s, longer
+#define RM_LATENCY_BUCKETS 8
+#define RM_LATENCY_FIRST   500
+
+typedef enum
+{
+    RM_RADIO_WIFI,
+    RM_RADIO_LTE,
+    RM_RADIO_COUNT
+} rm_radio_t;
+
+static struct
+{
+    uint32_t switches[RM_RADIO_COUNT];
+    uint32_t latency[RM_RADIO_COUNT][RM_LATENCY_BUCKETS];    // by target radio
+    uint32_t worst_ms[RM_RADIO_COUNT];
+    uint32_t step_worst_ms[4];                               // one per switch_steps[] entry
+    uint64_t on_ms[RM_RADIO_COUNT];                          // DA awake, 9160 powered
+    bool     was_on[RM_RADIO_COUNT];
+    uint64_t last_sample;
+} rm_stats;
+static struct k_spinlock rm_stats_lock;
 
 typedef struct connect_to_ap_struct
 {
@@ -99,17 +119,34 @@ typedef struct connect_to_ap_struct
 
 connect_to_ap_t g_ap_to_attempt;
 
-typedef struct zbus_work_info
+// The listener copies into these instead of allocating.  Only the latest
+// 9160 status matters, so a newer one replaces one not yet handled and
+// its change bits are or'ed in.  DA events wait in a bounded queue, and
+// the ones that don't fit are or'ed into rm_da_pending, rm_da_event()
+// only needs the event bits.
+#define RM_DA_EVENT_QUEUE_LEN 8
+
+static struct
+{
+    struct k_work         work;
+    struct k_spinlock     lock;
+    bool                  pending;
+    modem_status_update_t update;
+} rm_9160_status;
+
+K_MSGQ_DEFINE(rm_da_event_q, sizeof(da_event_t), RM_DA_EVENT_QUEUE_LEN, 4);
+struct k_work            rm_da_event_work;
+static struct k_spinlock rm_da_pending_lock;
+static uint32_t          rm_da_pending;
+
+enum
 {
-    workref_t                 *zbus_work;
-    const struct zbus_channel *chan;
-    union
-    {
-        da_event_t            evt;
-        modem_status_update_t modem_status;
-        bool                  connected;
-    } msg;
-} zbus_work_info_t;
+    RM_CHAN_LTE_STATUS,
+    RM_CHAN_DA_STATE,
+    RM_CHAN_USB_BT,
+    RM_CHAN_COUNT
+};
+static zbus_listener_stats_t rm_chan_stats[RM_CHAN_COUNT];
 
 static void   connecting_to_ap_work_handler(struct k_work *item);
 struct k_work connecting_to_ap_work;
@@ -174,10 +211,57 @@ static inline bool is_lte_mqtt_connected()
 
 ////////////////////////////////////////////////////
 // queue_switching_handler()
-//  Called to check if we can continue switching radios
-void queue_switching_handler(struct k_timer *dummy)
+//  Run the switch state machine after delay, or sooner
+// if it is already due.  A deadline is only ever brought
+// forward, so a burst of events can't keep putting it off
+static void queue_switching_handler(k_timeout_t delay)
+{
+    struct k_work_delayable *dwork = &switch_radios_info.SR_work;
+    int                      busy  = k_work_delayable_busy_get(dwork);
+
+    if (busy & K_WORK_QUEUED) {
+        return;    // about to run anyway
+    }
+    if ((busy & K_WORK_DELAYED) && k_work_delayable_remaining_get(dwork) <= delay.ticks) {
+        return;
+    }
+    k_work_reschedule_for_queue(&radioMgr_work_q, dwork, delay);
+}
+
+////////////////////////////////////////////////////
+// rm_radio_time_update()
+//  Add the time since the last call to each radio
+// that was on then.  Called on every DA and 9160
+// event, which is when their power can change
+static void rm_radio_time_update(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&rm_stats_lock);
+    uint64_t         now = k_uptime_get();
+
+    for (int i = 0; i < RM_RADIO_COUNT; i++) {
+        if (rm_stats.was_on[i]) {
+            rm_stats.on_ms[i] += now - rm_stats.last_sample;
+        }
+    }
+    rm_stats.last_sample           = now;
+    rm_stats.was_on[RM_RADIO_WIFI] = da_state.powered_on != DA_STATE_KNOWN_FALSE && da_state.is_sleeping != DA_STATE_KNOWN_TRUE;
+    rm_stats.was_on[RM_RADIO_LTE]  = modem_is_powered_on();
+    k_spin_unlock(&rm_stats_lock, key);
+}
+
+static void rm_record_switch(comm_device_type_t radio, uint64_t took)
 {
-    k_work_submit_to_queue(&radioMgr_work_q, &switch_radios_info.SR_work);
+    rm_radio_t       r      = radio == COMM_DEVICE_DA16200 ? RM_RADIO_WIFI : RM_RADIO_LTE;
+    int              bucket = 0;
+    k_spinlock_key_t key    = k_spin_lock(&rm_stats_lock);
+
+    for (uint64_t limit = RM_LATENCY_FIRST; bucket < RM_LATENCY_BUCKETS - 1 && took >= limit; limit *= 2) {
+        bucket++;
+    }
+    rm_stats.switches[r]++;
+    rm_stats.latency[r][bucket]++;
+    rm_stats.worst_ms[r] = MAX(rm_stats.worst_ms[r], (uint32_t)took);
+    k_spin_unlock(&rm_stats_lock, key);
 }
 
 static int lte_set_mqtt_enable(bool on, k_timeout_t timeout)
@@ -900,8 +984,8 @@ int rm_switch_to(comm_device_type_t radio, bool clear_existing_radio, bool force
         return -1;
     }
 
-    switch_radios_info.radio_disabled = false;
-    switch_radios_info.radio_enabled  = false;
+    switch_radios_info.step      = 0;
+    switch_radios_info.stepStart = k_uptime_get();
     if (force_switch) {
         g_active_radio           = radio;
         g_switching_radios       = false;
@@ -928,9 +1012,10 @@ int rm_switch_to(comm_device_type_t radio, bool clear_existing_radio, bool force
         g_switching_radios = true;
         // Switching radios may need to wait until the radios
         // complete some operations that may take unknown amounts
-        // of time, so we periodically check the status of the switch
-        // and kick off the next step when the previous step is done
-        queue_switching_handler(NULL);
+        // of time.  Each step says how long it can wait before
+        // it is checked again, and any DA or 9160 event checks
+        // it straight away
+        queue_switching_handler(K_NO_WAIT);
     }
     return 0;
 }
@@ -1468,6 +1553,30 @@ static int enable_lte(switch_radios_info_t *info)
     return 0;
 }
 
+////////////////////////////////////////////////////
+// switch_steps
+//  What a switch has to get done, in order.  An
+// enable step runs when its radio is the target, a
+// disable step when it isn't.  Each returns 0 when
+// its radio is in the right state, otherwise the most
+// time to wait before checking it again.  The wait is
+// cut short by any DA or 9160 event.
+typedef struct
+{
+    const char        *name;
+    comm_device_type_t radio;
+    bool               enable;
+    int (*run)(switch_radios_info_t *info);
+} switch_step_t;
+
+static const switch_step_t switch_steps[] = {
+    { "enable wifi", COMM_DEVICE_DA16200, true, enable_wifi },
+    { "enable lte", COMM_DEVICE_NRF9160, true, enable_lte },
+    { "disable wifi", COMM_DEVICE_DA16200, false, disable_wifi },
+    { "disable lte", COMM_DEVICE_NRF9160, false, disable_lte },
+};
+BUILD_ASSERT(ARRAY_SIZE(switch_steps) == ARRAY_SIZE(rm_stats.step_worst_ms));
+
 ////////////////////////////////////////////////////
 // switch_radios_work_handler()
 //  Called when we need to stop one radio and maybe
@@ -1481,14 +1590,16 @@ static int enable_lte(switch_radios_info_t *info)
 //  @return void
 void switch_radios_work_handler(struct k_work *item)
 {
-    int                   time_to_wait = 1000, ret;
-    switch_radios_info_t *info         = CONTAINER_OF(item, switch_radios_info_t, SR_work);
+    int                      time_to_wait = 1000, ret;
+    struct k_work_delayable *dwork        = k_work_delayable_from_work(item);
+    switch_radios_info_t    *info         = CONTAINER_OF(dwork, switch_radios_info_t, SR_work);
     if (uicr_shipping_flag_get() == false) {
         // Don't print or do anything
         return;
     }
     ret = k_mutex_lock(&RM_mutex, K_NO_WAIT);
     if (ret != 0) {
+        queue_switching_handler(K_MSEC(100));
         return;
     }
 
@@ -1498,7 +1609,7 @@ void switch_radios_work_handler(struct k_work *item)
 
     if (k_uptime_get() < 8000) {
         // We need to wait a little bit before we start switching radios
-        time_to_wait = 5000;
+        time_to_wait = 8000 - k_uptime_get();
         goto unlock_and_return;
     }
 
@@ -1509,41 +1620,26 @@ void switch_radios_work_handler(struct k_work *item)
     // to be done next and shouldn't assume that the radio we are targetting
     // is the same as the last time we got called
     // This allows the target to change based on outside conditions in mid switch
-    // Allowable targets are 9160, 16200 and NONE
-
-    // If we are are switching to Wifi, enable it
-    if (info->target_radio == COMM_DEVICE_DA16200 && info->radio_enabled == false) {
-        time_to_wait = enable_wifi(info);    // Returns 0 if already on
-        if (time_to_wait > 0) {
-            goto unlock_and_return;
-        }
-    }
-
-    // If we are are switching to LTE, make sure its enabled
-    if (info->target_radio == COMM_DEVICE_NRF9160 && info->radio_enabled == false) {
-        time_to_wait = enable_lte(info);    // Returns 0 if already on
-        if (time_to_wait > 0) {
-            goto unlock_and_return;
-        }
-    }
-    info->radio_enabled = true;
-
-    // If we are aren't switching to Wifi, make sure its MQTT is off
-    if (info->target_radio != COMM_DEVICE_DA16200 && info->radio_disabled == false) {
-        time_to_wait = disable_wifi(info);    // Returns 0 if already off
-        if (time_to_wait > 0) {
-            goto unlock_and_return;
+    // Allowable targets are 9160, 16200 and NONE.  A new target starts the steps
+    // over, see rm_switch_to()
+    while (info->step < ARRAY_SIZE(switch_steps)) {
+        const switch_step_t *step = &switch_steps[info->step];
+        int                  at   = info->step;
+
+        if ((info->target_radio == step->radio) == step->enable) {
+            time_to_wait = step->run(info);
+            if (time_to_wait > 0) {
+                goto unlock_and_return;
+            }
         }
-    }
-
-    // If we are aren't switching to LTE, make sure its MQTT is off
-    if (info->target_radio != COMM_DEVICE_NRF9160 && info->radio_disabled == false) {
-        time_to_wait = disable_lte(info);    // Returns 0 if already off
-        if (time_to_wait > 0) {
-            goto unlock_and_return;
+        if (info->step != at) {
+            continue;    // the step changed the target, start over
         }
+        uint64_t now               = k_uptime_get();
+        rm_stats.step_worst_ms[at] = MAX(rm_stats.step_worst_ms[at], (uint32_t)(now - info->stepStart));
+        info->stepStart            = now;
+        info->step++;
     }
-    info->radio_disabled = true;
 
     // At this point, the right radio is on and the other radio is off
     // Mark the correct radio as active so that MQTT messages stop going
@@ -1555,6 +1651,7 @@ void switch_radios_work_handler(struct k_work *item)
         time_to_wait              = 0;
         switch_radios_info.currOp = SRS_IDLE;
         g_switching_radios        = false;
+        rm_record_switch(COMM_DEVICE_DA16200, k_uptime_get() - g_switching_radios_start);
         LOG_WRN("Switched to DA16200");
         commMgr_switched_to_wifi();
         goto unlock_and_return;
@@ -1566,6 +1663,7 @@ void switch_radios_work_handler(struct k_work *item)
         time_to_wait              = 0;
         switch_radios_info.currOp = SRS_IDLE;
         g_switching_radios        = false;
+        rm_record_switch(COMM_DEVICE_NRF9160, k_uptime_get() - g_switching_radios_start);
         LOG_WRN("Switched to NRF9160");
         commMgr_switched_to_lte();
         // We are confirmed to be on LTE, make sure the DA is off
@@ -1575,47 +1673,45 @@ void switch_radios_work_handler(struct k_work *item)
     }
 
     // EAS XXX At this point we know that the state of the radios is correct
-    // We normally stop the timer so that this function stops being called
+    // We normally cancel the work so that this function stops being called
     // However an option is to keep call this periodically to make sure the
-    // radios stay in the correct state. We can enable this not stopping the
-    // timer and setting time_to_wait to a non-zero value
+    // radios stay in the correct state. We can enable this not cancelling the
+    // work and setting time_to_wait to a non-zero value
 
 unlock_and_return:
     if (g_do_one_step == false && time_to_wait > 0) {
-        k_timer_start(&continue_switching_timer, K_MSEC(time_to_wait), K_NO_WAIT);
+        queue_switching_handler(K_MSEC(time_to_wait));
     } else {
         if (g_do_one_step == true) {
             LOG_DBG("One step switch, wants to be called again in %d ms", time_to_wait);
             g_do_one_step = false;
         } else {
-            k_timer_stop(&continue_switching_timer);
+            k_work_cancel_delayable(&info->SR_work);
         }
     }
     k_mutex_unlock(&RM_mutex);
 }
 
 ////////////////////////////////////////////////////
-// rm_da_work_handler()
+// rm_da_event()
 //  Called when the DA state changes, and we need to
 // switch radios
 //
 //  @return void
-static void rm_da_work_handler(struct k_work *item)
+static void rm_da_event(const da_event_t *evt)
 {
-    workref_t        *wr        = CONTAINER_OF(item, workref_t, work);
-    zbus_work_info_t *work_info = (zbus_work_info_t *)wr->reference;
-    int               ret       = 0;
+    int ret = 0;
 
     if (uicr_shipping_flag_get() == false) {
         // Don't print or do anything
-        goto free_and_exit;
+        return;
     }
     if (g_radio_mgmt == false) {
         LOG_DBG("Radio mgmr off, Skipping DA status update");
-        goto free_and_exit;
+        return;
     }
 
-    if (work_info->msg.evt.events & DA_EVENT_TYPE_AP_CONNECT) {
+    if (evt->events & DA_EVENT_TYPE_AP_CONNECT) {
         if (da_state.ap_connected == DA_STATE_KNOWN_FALSE) {
             // AP_CONNECT + not connected = disconnected or failed to connect
 
@@ -1638,7 +1734,7 @@ static void rm_da_work_handler(struct k_work *item)
         }
     }
 
-    if (work_info->msg.evt.events & DA_EVENT_TYPE_MQTT_ENABLED) {
+    if (evt->events & DA_EVENT_TYPE_MQTT_ENABLED) {
         if (da_state.mqtt_enabled == DA_STATE_KNOWN_FALSE) {
             if (g_active_radio == COMM_DEVICE_DA16200) {
                 LOG_DBG(
@@ -1649,7 +1745,7 @@ static void rm_da_work_handler(struct k_work *item)
         }
     }
 
-    if (work_info->msg.evt.events & DA_EVENT_TYPE_MQTT_BROKER_CONNECT) {
+    if (evt->events & DA_EVENT_TYPE_MQTT_BROKER_CONNECT) {
         if (da_state.mqtt_broker_connected == DA_STATE_KNOWN_TRUE) {
             if (g_active_radio == COMM_DEVICE_NRF9160 && rm_wifi_is_connecting() == false) {
                 LOG_ERR(
@@ -1659,18 +1755,44 @@ static void rm_da_work_handler(struct k_work *item)
             }
         }
     }
-free_and_exit:
-    k_free(work_info);
-    wr_put(wr);
+}
+
+////////////////////////////////////////////////////
+// rm_da_work_handler()
+//  Handle the DA events the listener queued
+//
+//  @return void
+static void rm_da_work_handler(struct k_work *item)
+{
+    da_event_t evt;
+
+    while (k_msgq_get(&rm_da_event_q, &evt, K_NO_WAIT) == 0) {
+        rm_da_event(&evt);
+    }
+
+    // then the ones that overflowed the queue, all at once
+    k_spinlock_key_t key = k_spin_lock(&rm_da_pending_lock);
+    evt                  = (da_event_t){ .timestamp = k_uptime_get(), .events = rm_da_pending };
+    rm_da_pending        = 0;
+    k_spin_unlock(&rm_da_pending_lock, key);
+    if (evt.events != 0) {
+        rm_da_event(&evt);
+    }
 }
 
 static void rm_9160_work_handler(struct k_work *item)
 {
-    workref_t        *wr        = CONTAINER_OF(item, workref_t, work);
-    zbus_work_info_t *work_info = (zbus_work_info_t *)wr->reference;
+    modem_status_update_t update;
+
+    k_spinlock_key_t key              = k_spin_lock(&rm_9160_status.lock);
+    update                            = rm_9160_status.update;
+    rm_9160_status.update.change_bits = 0;
+    rm_9160_status.pending            = false;
+    k_spin_unlock(&rm_9160_status.lock, key);
+
     if (g_radio_mgmt == false) {
         LOG_DBG("Radio mgmr off, Skipping 9160 status update");
-        goto free_and_exit_9160;
+        return;
     }
 
     // unlike the Wifi, if the LTE is disconnected or the MQTT is disconnected, we don't
@@ -1678,17 +1800,16 @@ static void rm_9160_work_handler(struct k_work *item)
     // error prone, until we are told not to or a Wifi AP is detected and connected to.
 
     // One exception is when there is no active radio and the nrf9160 connects to a cell tower
-    if (work_info->msg.modem_status.change_bits & STATUS_LTE_CONNECTED
-        || work_info->msg.modem_status.change_bits & STATUS_MQTT_CONNECTED) {
+    if (update.change_bits & STATUS_LTE_CONNECTED || update.change_bits & STATUS_MQTT_CONNECTED) {
         LOG_DBG("LTE connected or MQTT connected");
     }
 
-    if (work_info->msg.modem_status.change_bits & STATUS_MQTT_ENABLED) {
+    if (update.change_bits & STATUS_MQTT_ENABLED) {
         // MQTT connected status changed
         LOG_WRN(
             "9160 MQTT enabled: %s",
-            status_getBit(work_info->msg.modem_status.status.status_flags, UPDATE_STATUS_MQTT_ENABLED) ? "yes" : "no");
-        if (!status_getBit(work_info->msg.modem_status.status.status_flags, STATUS_MQTT_ENABLED)) {
+            status_getBit(update.status.status_flags, UPDATE_STATUS_MQTT_ENABLED) ? "yes" : "no");
+        if (!status_getBit(update.status.status_flags, STATUS_MQTT_ENABLED)) {
             if (rm_get_active_mqtt_radio() == COMM_DEVICE_NRF9160 && !rm_is_switching_radios()) {
                 LOG_WRN(
                     "LTE MQTT disabled, LTE is active radio, turning MQTT "
@@ -1701,18 +1822,12 @@ static void rm_9160_work_handler(struct k_work *item)
             }
         }
     }
-
-free_and_exit_9160:
-    k_free(work_info);
-    wr_put(wr);
 }
 
 static void usb_bt_connection_work_handler(struct k_work *item)
 {
-    workref_t        *wr                 = CONTAINER_OF(item, workref_t, work);
-    zbus_work_info_t *work_info          = (zbus_work_info_t *)wr->reference;
-    static bool       last_usb_connected = false;    // The last known state of the USB connection
-    static bool       last_bt_connected  = false;    // The last known state of the BT connection
+    static bool last_usb_connected = false;    // The last known state of the USB connection
+    static bool last_bt_connected  = false;    // The last known state of the BT connection
 
     // If there was a change in the USB or BT state
     if (last_usb_connected != g_usb_connected || last_bt_connected != g_bt_connected) {
@@ -1726,7 +1841,6 @@ static void usb_bt_connection_work_handler(struct k_work *item)
             int ret = wifi_get_mutex(K_SECONDS(5), __func__);
             if (ret != 0) {
                 LOG_ERR("'%s'(%d) getting wifi mutex for usb_bt connection work", wstrerr(-ret), ret);
-                wr_put(wr);
                 return;
             }
             g_use_sleep = false;
@@ -1750,7 +1864,6 @@ static void usb_bt_connection_work_handler(struct k_work *item)
             // free
             int ret = wifi_get_mutex(K_SECONDS(5), "usb_bt_connection_work_handler2");
             if (ret != 0) {
-                wr_put(wr);
                 LOG_ERR("'%s'(%d) getting wifi mutex for usb_bt connection work", wstrerr(-ret), ret);
                 return;
             }
@@ -1774,8 +1887,6 @@ static void usb_bt_connection_work_handler(struct k_work *item)
         last_usb_connected = g_usb_connected;
         last_bt_connected  = g_bt_connected;
     }
-    k_free(work_info);
-    wr_put(wr);
 }
 
 ////////////////////////////////////////////////////
@@ -1792,56 +1903,64 @@ void radioMgr_init()
 
     k_work_queue_start(
         &radioMgr_work_q, radioMgr_stack_area, K_THREAD_STACK_SIZEOF(radioMgr_stack_area), 5, &radioMgr_work_q_cfg);
-    k_work_init(&switch_radios_info.SR_work, switch_radios_work_handler);
+    k_work_init_delayable(&switch_radios_info.SR_work, switch_radios_work_handler);
     k_work_init(&connecting_to_ap_work, connecting_to_ap_work_handler);
+    k_work_init(&rm_9160_status.work, rm_9160_work_handler);
+    k_work_init(&rm_da_event_work, rm_da_work_handler);
+    k_work_init(&usb_bt_connection_work, usb_bt_connection_work_handler);
 }
 
 void radio_mgr_listener(const struct zbus_channel *chan)
 {
-    zbus_work_info_t *work_info = k_malloc(sizeof(zbus_work_info_t));
-    if (work_info == NULL) {
-        LOG_ERR("Failed to allocate memory for zbus_work_info_t");
-        return;
-    }
-    work_info->zbus_work = wr_get(work_info, __LINE__);
-    if (work_info->zbus_work == NULL) {
-        LOG_ERR("Out of workrefs");
-        k_free(work_info);
-        return;
+    if (&LTE_STATUS_UPDATE == chan || &da_state_chan == chan) {
+        rm_radio_time_update();
+        // the switch runs after the settle time, by when the event work
+        // queued below has updated the state it looks at
+        if (g_switching_radios && g_radio_mgmt) {
+            queue_switching_handler(K_MSEC(RM_EVENT_SETTLE_MS));
+        }
     }
-    work_info->chan = chan;
 
     if (&LTE_STATUS_UPDATE == chan) {
         const modem_status_update_t *cstatus = zbus_chan_const_msg(chan);    // Direct message access
-        memcpy(&work_info->msg.modem_status, cstatus, sizeof(modem_status_update_t));
-        k_work_init(
-            &(work_info->zbus_work->work),
-            rm_9160_work_handler);    // radioMgr_9160_status_update(&status_update);
-    }
 
-    if (&BT_CONN_STATE_UPDATE == chan) {
-        const bool *cconnected = zbus_chan_const_msg(chan);    // Direct message access
-        g_bt_connected         = *cconnected;
-        k_work_init(&(work_info->zbus_work->work), usb_bt_connection_work_handler);
+        k_spinlock_key_t key = k_spin_lock(&rm_9160_status.lock);
+        if (rm_9160_status.pending) {
+            rm_chan_stats[RM_CHAN_LTE_STATUS].coalesced++;
+        }
+        rm_9160_status.update.change_bits |= cstatus->change_bits;
+        rm_9160_status.update.status       = cstatus->status;
+        rm_9160_status.pending             = true;
+        k_spin_unlock(&rm_9160_status.lock, key);
+
+        rm_chan_stats[RM_CHAN_LTE_STATUS].published++;
+        k_work_submit_to_queue(&radioMgr_work_q, &rm_9160_status.work);
     }
 
-    if (&USB_POWER_STATE_UPDATE == chan) {
+    if (&BT_CONN_STATE_UPDATE == chan || &USB_POWER_STATE_UPDATE == chan) {
         const bool *cconnected = zbus_chan_const_msg(chan);    // Direct message access
-        g_usb_connected        = *cconnected;
-        k_work_init(&(work_info->zbus_work->work), usb_bt_connection_work_handler);
+        if (&BT_CONN_STATE_UPDATE == chan) {
+            g_bt_connected = *cconnected;
+        } else {
+            g_usb_connected = *cconnected;
+        }
+        // The handler works from the globals, so one pending run covers both
+        rm_chan_stats[RM_CHAN_USB_BT].published++;
+        if (k_work_submit_to_queue(&radioMgr_work_q, &usb_bt_connection_work) == 0) {
+            rm_chan_stats[RM_CHAN_USB_BT].coalesced++;
+        }
     }
 
     if (&da_state_chan == chan) {
         const da_event_t *cevt = zbus_chan_const_msg(chan);    // Direct message access
-        memcpy(&work_info->msg.evt, cevt, sizeof(da_event_t));
-        k_work_init(&(work_info->zbus_work->work), rm_da_work_handler);
-    }
-
-    int ret = k_work_submit_to_queue(&radioMgr_work_q, &(work_info->zbus_work->work));
-    if (ret < 0) {
-        LOG_ERR("Failed to submit work to radioMgr_work_q: %d", ret);
-        wr_put(work_info->zbus_work);
-        k_free(work_info);
+        rm_chan_stats[RM_CHAN_DA_STATE].published++;
+        if (k_msgq_put(&rm_da_event_q, cevt, K_NO_WAIT) != 0) {
+            k_spinlock_key_t key = k_spin_lock(&rm_da_pending_lock);
+            rm_da_pending |= cevt->events;
+            k_spin_unlock(&rm_da_pending_lock, key);
+            rm_chan_stats[RM_CHAN_DA_STATE].coalesced++;
+        }
+        k_work_submit_to_queue(&radioMgr_work_q, &rm_da_event_work);
     }
 }
 
@@ -1900,7 +2019,7 @@ void do_step(const struct shell *sh, size_t argc, char **argv)
         return;
     }
     g_do_one_step = true;
-    queue_switching_handler(NULL);    // If it does a step it will set g_do_one_step to false
+    queue_switching_handler(K_NO_WAIT);    // If it does a step it will set g_do_one_step to false
 }
 
 #define STATUS_PARAMS ""
@@ -1921,6 +2040,50 @@ void do_status(const struct shell *sh, size_t argc, char **argv)
         da_state.ap_connected ? "true" : "false");
 }
 
+#define STATS_PARAMS ""
+void do_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    static const char *const radio_names[RM_RADIO_COUNT] = { "wifi", "lte" };
+
+    rm_radio_time_update();
+    shell_print(sh, "Handover latency, by target radio:");
+    shell_fprintf(sh, SHELL_NORMAL, "%-6s", "");
+    for (int b = 0, limit = RM_LATENCY_FIRST; b < RM_LATENCY_BUCKETS; b++, limit *= 2) {
+        if (b < RM_LATENCY_BUCKETS - 1) {
+            shell_fprintf(sh, SHELL_NORMAL, " <%5dms", limit);
+        } else {
+            shell_fprintf(sh, SHELL_NORMAL, " >=%4ds", limit / 2000);
+        }
+    }
+    shell_fprintf(sh, SHELL_NORMAL, "  switches  worst\n");
+    for (int r = 0; r < RM_RADIO_COUNT; r++) {
+        shell_fprintf(sh, SHELL_NORMAL, "%-6s", radio_names[r]);
+        for (int b = 0; b < RM_LATENCY_BUCKETS; b++) {
+            shell_fprintf(sh, SHELL_NORMAL, " %8u", rm_stats.latency[r][b]);
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "  %8u  %ums\n", rm_stats.switches[r], rm_stats.worst_ms[r]);
+    }
+    for (int i = 0; i < ARRAY_SIZE(switch_steps); i++) {
+        shell_print(sh, "Longest '%s' step: %ums", switch_steps[i].name, rm_stats.step_worst_ms[i]);
+    }
+    shell_print(
+        sh,
+        "On time since boot: DA awake %llus, 9160 powered %llus",
+        rm_stats.on_ms[RM_RADIO_WIFI] / 1000,
+        rm_stats.on_ms[RM_RADIO_LTE] / 1000);
+
+    static const char *const chan_names[RM_CHAN_COUNT] = { "9160 status", "DA event", "USB/BT" };
+    for (int i = 0; i < RM_CHAN_COUNT; i++) {
+        shell_print(
+            sh,
+            "zbus %s: received %u, merged %u, dropped %u",
+            chan_names[i],
+            rm_chan_stats[i].published,
+            rm_chan_stats[i].coalesced,
+            rm_chan_stats[i].dropped);
+    }
+}
+
 #define USE_SLEEP_PARAMS "<on|1|off|0>"
 void do_use_sleep(const struct shell *sh, size_t argc, char **argv)
 {
@@ -1955,6 +2118,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
     SHELL_CMD(change_radio, NULL, "change the active radios. " CHANGE_RADIO_PARAMS, do_change_radio),
     SHELL_CMD(one_step, NULL, "Do one call to the RM switch state machine. " STEP_PARAMS, do_step),
     SHELL_CMD(status, NULL, "Show radio manager status. " STATUS_PARAMS, do_status),
+    SHELL_CMD(stats, NULL, "Show handover latency and radio on time. " STATS_PARAMS, do_stats),
     SHELL_CMD(use_sleep, NULL, "Set if the radio mgr puts the da to sleep when not in use. " USE_SLEEP_PARAMS, do_use_sleep),
     SHELL_CMD(
         use_wifi,
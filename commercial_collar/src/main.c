@@ -102,7 +102,6 @@ bool initDevices()
 
 extern struct k_heap _system_heap;
 extern struct k_heap log_heap;
-extern struct k_heap wifi_heap;
 extern struct k_heap mqtt_heap;
 extern struct k_heap gps_heap;
 
@@ -112,7 +111,6 @@ static struct
     struct k_heap *heap;
 } heaps[] = { { "system_heap", &_system_heap },
               { "log_heap", &log_heap },
-              { "wifi_heap", &wifi_heap },
               { "mqtt_heap", &mqtt_heap },
               { "gps_heap", &gps_heap } };
 
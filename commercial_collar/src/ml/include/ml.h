@@ -20,8 +20,8 @@ typedef enum
 // the amount by which we have to downsample RECORD_SAMPLE_RATE to equal 15Hz.
 #define ML_15HZ_DOWNSAMPLE_RATE (1)
 
-#define MS2_TO_G(x)                   (x / 9.80665)
-#define RAD_PER_SEC_TO_DEG_PER_SEC(x) (x * 57.29578)
+// samples collected in the IMU FIFO per wake-up, i.e. one batch a second at 15Hz
+#define ML_IMU_BATCH_SIZE (15)
 
 int         ml_init(void);
 int         ml_set_dog_size(pet_size_t pet_size);
@@ -29,8 +29,9 @@ int         ml_start(void);
 int         ml_stop(void);
 const char *ml_version(void);
 
-// called from record callback
+// called from record callback, samples in g and deg/s (IMU_UNITS_G_DPS)
 int ml_feed_sample(imu_sample_t data, bool is_sleeping);
+int ml_feed_batch(const imu_sample_t *samples, size_t count, bool is_sleeping);
 
 #ifdef __cplusplus
 }
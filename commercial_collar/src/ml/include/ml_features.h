@@ -0,0 +1,24 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// accel / gyro magnitude statistics over the last CONFIG_ML_FEATURE_WINDOW samples
+typedef struct
+{
+    float    accel_mean, accel_sd;    // g
+    float    gyro_mean, gyro_sd;      // deg/s
+    uint32_t count;                   // samples in the window
+} ml_features_t;
+
+void ml_features_reset(void);
+void ml_features_add(const float accel[3], const float gyro[3]);
+void ml_features_get(ml_features_t *features);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,6 +16,7 @@ LOG_MODULE_REGISTER(ml);
 #include "pmic_leds.h"
 #include "ml_encode.h"
 #include "ml_decode.h"
+#include "ml_features.h"
 #include "ml_types.h"
 #include "ml.h"
 #include "utils.h"
@@ -32,7 +33,26 @@ static fqueue_t ml_queue;
 
 static fqueue_t *m_file_queue;    // file handle for writing Activity data
 static bool      m_is_stopping;
-K_MSGQ_DEFINE(ml_mesgq, sizeof(IMUData), 10, 4);
+static int64_t   m_last_sample_time = -1;
+static atomic_t  m_reset_window;    // set by the IMU thread, acted on by the ML thread
+
+// time spent in each IMU power state while ML runs, and the inferences that were not run
+// because the IMU was parked
+static struct k_spinlock m_power_lock;
+static struct
+{
+    bool     is_sleeping;
+    int64_t  since;        // uptime the current state started
+    uint64_t awake_ms;
+    uint64_t asleep_ms;
+    uint32_t sleeps;
+    uint32_t skipped;
+    uint32_t infer_ms;     // inference period, learned from the results
+    uint64_t last_end;     // end of the last result, 0 after a wake-up
+} m_power;
+
+// room for two IMU batches, so the ML thread can lag by a batch without dropping samples
+K_MSGQ_DEFINE(ml_mesgq, sizeof(IMUData), 2 * ML_IMU_BATCH_SIZE, 4);
 static struct k_thread ml_thread_data;
 K_THREAD_STACK_DEFINE(ml_stack_area, 4096);
 static k_tid_t ml_tid;
@@ -97,38 +117,80 @@ const char *ml_version(void)
  */
 int ml_feed_sample(imu_sample_t data, bool is_sleeping)
 {
-    static bool    was_sleeping     = false;
-    static int64_t last_sample_time = -1;
-
-    if (is_sleeping && !was_sleeping) {
-        // just gone to sleep ... discard any partial samples fed till now
-        resetActivityWindowCounter();
-        last_sample_time = -1;
-        LOG_DBG("IMU has switched to 1.875Hz sampling(asleep)");
-    }
-    was_sleeping = is_sleeping;
     if (!is_sleeping && data.sample_count % ML_15HZ_DOWNSAMPLE_RATE == 0) {
         // feed ML model
 
+        // the IMU already scaled the counts to the library's units
         IMUData imu_sample      = { 0 };
         imu_sample.timestamp    = data.timestamp;
-        imu_sample.imuValues[0] = MS2_TO_G(data.ax);
-        imu_sample.imuValues[1] = MS2_TO_G(data.ay);
-        imu_sample.imuValues[2] = MS2_TO_G(data.az);
-        imu_sample.imuValues[3] = RAD_PER_SEC_TO_DEG_PER_SEC(data.gx);
-        imu_sample.imuValues[4] = RAD_PER_SEC_TO_DEG_PER_SEC(data.gy);
-        imu_sample.imuValues[5] = RAD_PER_SEC_TO_DEG_PER_SEC(data.gz);
+        imu_sample.imuValues[0] = data.ax;
+        imu_sample.imuValues[1] = data.ay;
+        imu_sample.imuValues[2] = data.az;
+        imu_sample.imuValues[3] = data.gx;
+        imu_sample.imuValues[4] = data.gy;
+        imu_sample.imuValues[5] = data.gz;
         k_msgq_put(&ml_mesgq, &imu_sample, K_NO_WAIT);
         // at 15Hz, we should get a sample every 67ms or so (66.666)
-        if (last_sample_time > 0 && (data.timestamp - last_sample_time) > 68) {
-            LOG_WRN("Intra sample time is %lldms, > 68ms",data.timestamp-last_sample_time);
-            LOG_WRN("As if %lld Sample(s) were dropped", (data.timestamp - last_sample_time) / 67);
+        if (m_last_sample_time > 0 && (data.timestamp - m_last_sample_time) > 68) {
+            LOG_WRN("Intra sample time is %lldms, > 68ms", data.timestamp - m_last_sample_time);
+            LOG_WRN("As if %lld Sample(s) were dropped", (data.timestamp - m_last_sample_time) / 67);
         }
-        last_sample_time = data.timestamp;
+        m_last_sample_time = data.timestamp;
     }
 
     return 0;
 }
+
+/*
+ * Called from the IMU thread when the IMU parks itself (no samples at all) or wakes up on
+ * significant motion.  The ML thread simply stays blocked while the IMU is parked.
+ */
+static void ml_sleep_changed(bool is_sleeping)
+{
+    k_spinlock_key_t key = k_spin_lock(&m_power_lock);
+    int64_t          now = k_uptime_get();
+    uint64_t         ms  = now - m_power.since;
+
+    if (is_sleeping == m_power.is_sleeping) {
+        k_spin_unlock(&m_power_lock, key);
+        return;
+    }
+    if (is_sleeping) {
+        m_power.awake_ms += ms;
+        m_power.sleeps++;
+    } else {
+        m_power.asleep_ms += ms;
+        if (m_power.infer_ms > 0) {
+            m_power.skipped += ms / m_power.infer_ms;
+        }
+        m_power.last_end = 0;
+    }
+    m_power.is_sleeping = is_sleeping;
+    m_power.since       = now;
+    k_spin_unlock(&m_power_lock, key);
+
+    if (is_sleeping) {
+        // discard any partial window fed till now
+        atomic_set(&m_reset_window, 1);
+        LOG_DBG("IMU parked (asleep)");
+    } else {
+        // the gap since the last sample is expected
+        m_last_sample_time = -1;
+        LOG_DBG("IMU back to %dHz (awake)", IMU_ODR_15_HZ);
+    }
+}
+
+/*
+ * Recv a batch of samples drained from the IMU FIFO
+ */
+int ml_feed_batch(const imu_sample_t *samples, size_t count, bool is_sleeping)
+{
+    for (size_t i = 0; i < count; i++) {
+        ml_feed_sample(samples[i], is_sleeping);
+    }
+    return 0;
+}
+
 #define INCR(index)  ({ index = (index + 1) & 0x0F; })
 #define OLDEST_IDX() (index > 0) ? (index - 1) : 15
 #define NEWEST_IDX() (index)
@@ -137,6 +199,7 @@ static void ml_thread(void *p0, void *p1, void *p2)
 {
     initiate(handle_result, false);
     resetActivityWindowCounter();
+    ml_features_reset();
 #ifdef CONFIG_ML_CAPTURE_IMU_DATA
     struct fs_file_t imu_raw_data;
     float            correlator_a[16] = { 0 };
@@ -155,8 +218,16 @@ static void ml_thread(void *p0, void *p1, void *p2)
     while (!m_is_stopping) {
         IMUData imu_sample;
 
-        if (k_msgq_get(&ml_mesgq, &imu_sample, K_SECONDS(1)) == 0) {
+        // nothing arrives while the IMU is parked, ml_start_stop() posts a sample to stop
+        if (k_msgq_get(&ml_mesgq, &imu_sample, K_FOREVER) == 0 && !m_is_stopping) {
+            if (atomic_clear(&m_reset_window)) {
+                resetActivityWindowCounter();
+                ml_features_reset();    // the library's window starts over too
+            }
             if (m_verbose) {
+                // the library works out the same stats for itself and takes nothing but raw
+                // samples, these are only kept to watch them between inferences
+                ml_features_add(&imu_sample.imuValues[0], &imu_sample.imuValues[3]);
                 LOG_INF(
                     "feeding sample at %llu.%03llu %f, %f, %f, %f, %f, %f",
                     imu_sample.timestamp / 1000,
@@ -275,6 +346,15 @@ static void handle_result(InferResult result)
     // by element ...
     struct Inference inference;
 
+    k_spinlock_key_t key = k_spin_lock(&m_power_lock);
+    if (m_power.last_end) {
+        m_power.infer_ms = result.end_timestamp - m_power.last_end;
+    } else if (m_power.infer_ms == 0) {
+        m_power.infer_ms = result.end_timestamp - result.start_timestamp;
+    }
+    m_power.last_end = result.end_timestamp;
+    k_spin_unlock(&m_power_lock, key);
+
     inference._Inference_activity    = result.pred_class;
     inference._Inference_probability = result.pred_probability;
     inference._Inference_reps        = result.pred_reps;
@@ -310,6 +390,18 @@ static void handle_result(InferResult result)
         result.accel_mag_sd_val,
         result.gyro_mag_mean_val,
         result.gyro_mag_sd_val);
+    if (m_verbose) {
+        ml_features_t features;
+
+        ml_features_get(&features);
+        LOG_INF(
+            "ML: running %u: Accel Mean %f, SD %f; Gyro Mean %f, SD %f",
+            features.count,
+            (double)features.accel_mean,
+            (double)features.accel_sd,
+            (double)features.gyro_mean,
+            (double)features.gyro_sd);
+    }
     // write the file
     fqueue_put(m_file_queue, cbor_buffer, len);
 }
@@ -327,6 +419,11 @@ static int ml_start_stop(bool start, fqueue_t *handle)
         op            = "starting";
         m_record_num  = 0;
         m_is_stopping = false;
+        k_msgq_purge(&ml_mesgq);
+        atomic_clear(&m_reset_window);
+        memset(&m_power, 0, sizeof(m_power));
+        m_power.since      = k_uptime_get();
+        m_last_sample_time = -1;
 
         ml_tid = k_thread_create(
             &ml_thread_data,
@@ -346,6 +443,9 @@ static int ml_start_stop(bool start, fqueue_t *handle)
         op            = "stopping";
         m_file_queue  = NULL;
         m_is_stopping = true;
+        // the thread may be parked on an empty queue; if the queue is full it isn't
+        IMUData wake = { 0 };
+        k_msgq_put(&ml_mesgq, &wake, K_NO_WAIT);
         LOG_DBG("Waiting for ML thread to terminate ...");
         k_thread_join(&ml_thread_data, K_FOREVER);
         is_running = false;
@@ -363,7 +463,9 @@ int ml_start(void)
     if (ret) {
         return ret;
     }
-    ret = imu_enable(IMU_ODR_15_HZ, ml_feed_sample);
+    imu_set_units(IMU_UNITS_G_DPS);
+    imu_set_power_governor(ml_sleep_changed, CONFIG_ML_WAKE_WARMUP_SAMPLES);
+    ret = imu_enable_batch(IMU_ODR_15_HZ, ML_IMU_BATCH_SIZE, ml_feed_batch);
     if (ret) {
         LOG_ERR("Unable to start IMU (%d); no ML", ret);
     } else {
@@ -376,7 +478,9 @@ int ml_stop(void)
 {
     int ret = ml_start_stop(false, NULL);
     if (ret == 0) {
+        imu_set_power_governor(NULL, 0);
         ret = imu_enable(IMU_ODR_0_HZ, NULL);
+        imu_set_units(IMU_UNITS_SI);
     }
     if (ret) {
         LOG_ERR("Unable to stop IMU (%d); no ML", ret);
@@ -488,10 +592,50 @@ static int ml_stop_shell(const struct shell *sh, size_t argc, char **argv)
 static int ml_verbose_shell(const struct shell *sh, size_t argc, char **argv)
 {
     m_verbose = !m_verbose;
+    if (m_verbose) {
+        ml_features_reset();    // don't mix in samples from the last time it was on
+    }
     shell_print(sh, "Verbose %s", m_verbose ? "On" : "Off");
     return 0;
 }
 
+static int ml_stats_shell(const struct shell *sh, size_t argc, char **argv)
+{
+    k_spinlock_key_t key       = k_spin_lock(&m_power_lock);
+    uint64_t         ms        = k_uptime_get() - m_power.since;
+    uint64_t         awake_ms  = m_power.awake_ms + (m_power.is_sleeping ? 0 : ms);
+    uint64_t         asleep_ms = m_power.asleep_ms + (m_power.is_sleeping ? ms : 0);
+    uint32_t         skipped   = m_power.skipped;
+    uint32_t         sleeps    = m_power.sleeps;
+    uint32_t         infer_ms  = m_power.infer_ms;
+    bool             sleeping  = m_power.is_sleeping;
+    k_spin_unlock(&m_power_lock, key);
+
+    if (sleeping && infer_ms > 0) {
+        skipped += ms / infer_ms;
+    }
+    shell_print(sh, "IMU %s", sleeping ? "asleep" : "awake");
+    shell_print(sh, "awake   %llu.%llu min", awake_ms / 60000, awake_ms % 60000 / 6000);
+    shell_print(sh, "asleep  %llu.%llu min, %u times", asleep_ms / 60000, asleep_ms % 60000 / 6000, sleeps);
+    shell_print(sh, "inferences skipped %u (every %ums)", skipped, infer_ms);
+
+    if (!m_verbose) {
+        shell_print(sh, "accel / gyro stats are kept while 'ml verbose' is on");
+        return 0;
+    }
+    ml_features_t features;
+    ml_features_get(&features);
+    shell_print(
+        sh,
+        "last %u samples: accel mean %f SD %f g, gyro mean %f SD %f dps",
+        features.count,
+        (double)features.accel_mean,
+        (double)features.accel_sd,
+        (double)features.gyro_mean,
+        (double)features.gyro_sd);
+    return 0;
+}
+
 static int ml_version_shell(const struct shell *sh, size_t argc, char **argv)
 {
     shell_fprintf(sh, SHELL_NORMAL, "version: %s\r\n", getVersion());
@@ -515,6 +659,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
     SHELL_CMD(init, NULL, "Initialize ml subsystem", ml_init_shell),
     SHELL_CMD(print, NULL, "Print (and drain) the ml queue", ml_print_shell),
     SHELL_CMD(start, NULL, "Start ml subsystem", ml_start_shell),
+    SHELL_CMD(stats, NULL, "Time spent awake / asleep and inferences skipped", ml_stats_shell),
     SHELL_CMD(stop, NULL, "Stop ml subsystem", ml_stop_shell),
     SHELL_CMD(test, NULL, "Feed test vectors to library", ml_test_shell),
     SHELL_CMD(verbose, NULL, "ML toggle verbosity", ml_verbose_shell),
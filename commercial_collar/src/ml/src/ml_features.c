@@ -0,0 +1,99 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+/*
+ * Running accel / gyro magnitude statistics, the same ones the ML library reports with
+ * every inference.  Each sample costs one square root per sensor and a handful of integer
+ * adds; the magnitudes are kept in fixed point so the sums can be added to and taken away
+ * from forever without drifting, and the mean and SD are only worked out when asked for.
+ * The ML thread only feeds them while 'ml verbose' is on.
+ */
+
+#include <zephyr/kernel.h>
+#include <math.h>
+#include <string.h>
+
+#include "ml_features.h"
+
+#define ACCEL_Q (1000.0f)    // milli-g
+#define GYRO_Q  (10.0f)      // 0.1 deg/s
+
+#define WINDOW CONFIG_ML_FEATURE_WINDOW
+
+typedef struct
+{
+    uint32_t mag[WINDOW];
+    uint64_t sum;
+    uint64_t sum_sq;
+} mag_window_t;
+
+static struct k_spinlock lock;
+static mag_window_t      accel_win;
+static mag_window_t      gyro_win;
+static uint32_t          head;
+static uint32_t          count;
+
+static inline uint32_t magnitude(const float v[3], float q)
+{
+    return (uint32_t)(sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) * q + 0.5f);
+}
+
+// replace the oldest magnitude once the window is full
+static inline void window_push(mag_window_t *w, uint32_t mag)
+{
+    if (count == WINDOW) {
+        uint32_t old = w->mag[head];
+        w->sum -= old;
+        w->sum_sq -= (uint64_t)old * old;
+    }
+    w->mag[head] = mag;
+    w->sum += mag;
+    w->sum_sq += (uint64_t)mag * mag;
+}
+
+static void window_stats(const mag_window_t *w, uint32_t n, float q, float *mean, float *sd)
+{
+    // n * sum_sq - sum^2 is exact in integers and can't go negative
+    uint64_t var_n2 = n * w->sum_sq - w->sum * w->sum;
+
+    *mean = (float)w->sum / n / q;
+    *sd   = sqrtf((float)var_n2) / n / q;
+}
+
+void ml_features_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    memset(&accel_win, 0, sizeof(accel_win));
+    memset(&gyro_win, 0, sizeof(gyro_win));
+    head  = 0;
+    count = 0;
+    k_spin_unlock(&lock, key);
+}
+
+void ml_features_add(const float accel[3], const float gyro[3])
+{
+    uint32_t         accel_mag = magnitude(accel, ACCEL_Q);
+    uint32_t         gyro_mag  = magnitude(gyro, GYRO_Q);
+    k_spinlock_key_t key       = k_spin_lock(&lock);
+
+    window_push(&accel_win, accel_mag);
+    window_push(&gyro_win, gyro_mag);
+    head = (head + 1) % WINDOW;
+    if (count < WINDOW) {
+        count++;
+    }
+    k_spin_unlock(&lock, key);
+}
+
+void ml_features_get(ml_features_t *features)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    memset(features, 0, sizeof(ml_features_t));
+    features->count = count;
+    if (count > 0) {
+        window_stats(&accel_win, count, ACCEL_Q, &features->accel_mean, &features->accel_sd);
+        window_stats(&gyro_win, count, GYRO_Q, &features->gyro_mean, &features->gyro_sd);
+    }
+    k_spin_unlock(&lock, key);
+}
@@ -23,6 +23,10 @@
 // so it needs to be at least sizeof(wifi_msg_t)
 #define WIFI_MSG_SIZE 2100
 
+// Incoming messages are read straight into a ring of this size and
+// parsed where they are, see wifi_init_new_msg()
+#define WIFI_RX_RING_SIZE (WIFI_MSG_SIZE * 7)
+
 // When the receive queue has old messages in them that aren't yet
 // processed, they take memory.  We clear out old messages when we
 // can't get memory for a new message.  Messages younger then
@@ -43,6 +47,7 @@ typedef struct wifi_msg
     uint64_t timestamp;    // When the message was created
     int32_t  ref_count;
     uint8_t  incoming;    // 1 if from the DA, 0 if to the DA
+    uint16_t cmd_seq;     // the command that was in flight when it arrived
     uint16_t data_len;
     uint8_t *data;
 } wifi_msg_t;
@@ -140,6 +145,15 @@ int wifi_inc_ref_count(wifi_msg_t *msg);
 //              or what was returned by wifi_msg_alloc()
 void wifi_msg_free(wifi_msg_t *msg);
 
+// One piece of a command sent with wifi_sendv_timeout()
+typedef struct wifi_iov
+{
+    const void *data;
+    size_t      len;
+} wifi_iov_t;
+
+#define WIFI_MAX_IOV 6
+
 //////////////////////////////////////////////////////////
 // wifi_send_timeout
 //
@@ -153,6 +167,23 @@ void wifi_msg_free(wifi_msg_t *msg);
 //			  -errno if 1 on error or timeout
 int wifi_send_timeout(char *data, k_timeout_t timeout);
 
+//////////////////////////////////////////////////////////
+// wifi_sendv_timeout
+//
+// Write an AT command to the DA16200 that is made of
+// several pieces, without putting them together first.
+// The pieces go out one after the other in the same SPI
+// transfer.  The tx callbacks only see the first piece.
+//
+//  @param iov - the pieces of the command, in order
+//  @param iov_cnt - number of pieces, at most WIFI_MAX_IOV
+//  @param timeout - timeout for the write
+//
+//  @return - 0 on success,
+//            -EBUSY if mutex is taken
+//			  -errno if 1 on error or timeout
+int wifi_sendv_timeout(const wifi_iov_t *iov, int iov_cnt, k_timeout_t timeout);
+
 //////////////////////////////////////////////////////////
 //  wifi_flush_msgs()
 //
@@ -188,6 +219,46 @@ void wifi_rem_tx_rx_cb(int id);
 // Internal function - not used outside of wifi_spi or uart.c
 int wifi_notify_cbs(wifi_msg_t *msg);
 
+// A handler for an unsolicited result code (URC) from the DA.
+// urc points at the "\r\n+NAME" that matched, inside msg->data.
+// Like the tx_rx callbacks it runs in the receive thread, so
+// anything slow should be handed off to a work queue.
+typedef void (*wifi_urc_handler_t)(wifi_msg_t *msg, char *urc);
+
+typedef struct wifi_urc
+{
+    const char        *name;          // "+WFJAP", matched up to the ':' or end of line
+    wifi_urc_handler_t handler;
+    bool               takes_rest;    // the rest of the message is this URC's data
+} wifi_urc_t;
+
+//////////////////////////////////////////////////////////
+// wifi_set_urc_table()
+//
+// Set the table incoming messages are dispatched through.
+// Every "\r\n+NAME" line in a message is looked up by its
+// name and handed to the matching handler, before the
+// tx_rx callbacks see the message.
+//
+// @param table - the handlers, must stay valid
+// @param count - number of entries in table
+void wifi_set_urc_table(const wifi_urc_t *table, int count);
+
+typedef struct wifi_rx_stats
+{
+    uint32_t ring_used;       // bytes of the receive ring in use
+    uint32_t ring_peak;       // most bytes ever in use
+    uint32_t dropped;         // messages dropped for lack of space
+    uint32_t evicted;         // queued messages dropped to make space
+    uint32_t stale;           // responses to older commands thrown away
+} wifi_rx_stats_t;
+
+//////////////////////////////////////////////////////////
+// wifi_get_rx_stats()
+//
+// Get the state of the receive ring
+void wifi_get_rx_stats(wifi_rx_stats_t *stats);
+
 //////////////////////////////////////////////////////////
 //	Requeue a message that was recv'd
 //
@@ -202,12 +273,13 @@ void wifi_requeue(wifi_msg_t *msg);
 
 typedef struct wifi_wait_array
 {
-    uint8_t num_msgs;
-    char   *msgs[WIFI_MAX_WAIT_MSGS];
-    uint8_t num_params_per_msg[WIFI_MAX_WAIT_MSGS];
-    char   *param_ptrs[WIFI_MAX_WAIT_MSGS][WIFI_MAX_WAIT_MSG_PARAMS];
-    bool    stop_waiting[WIFI_MAX_WAIT_MSGS];
-    int     num_matched[WIFI_MAX_WAIT_MSGS];
+    uint8_t  num_msgs;
+    char    *msgs[WIFI_MAX_WAIT_MSGS];
+    uint8_t  num_params_per_msg[WIFI_MAX_WAIT_MSGS];
+    char    *param_ptrs[WIFI_MAX_WAIT_MSGS][WIFI_MAX_WAIT_MSG_PARAMS];
+    bool     stop_waiting[WIFI_MAX_WAIT_MSGS];
+    int      num_matched[WIFI_MAX_WAIT_MSGS];
+    uint16_t cmd_seq;    // the command being waited on, set by wifi_wait_for()
 } wifi_wait_array_t;
 
 //////////////////////////////////////////////////////////
@@ -231,6 +303,11 @@ void wifi_add_wait_msg(wifi_wait_array_t *wait_msgs, char *msg, bool stop_waitin
 //	Wait for one of a few message to arrive, capturing
 //  parameters
 //
+// The wait belongs to the last command sent. Messages that
+// arrived while an earlier command was being waited on are
+// that command's and are dropped, anything else that doesn't
+// match stays queued.
+//
 // @param wait_msgs - pointer to the wifi_wait_array_t
 //                    holding what messager to wait for
 // @param timeout - timeout for the read
@@ -96,6 +96,14 @@ int wifi_refresh_ssid_list(bool skip_hidden, int max_age_sec, k_timeout_t timeou
 // Get the list of SSID gathered in a previous scan
 wifi_arr_t *wifi_get_last_ssid_list();
 
+/////////////////////////////////////////////////////////
+// wifi_scan_reindex()
+//
+// Rebuild the lookups into the list returned by
+// wifi_get_last_ssid_list().  Call this after changing
+// the list other than through a scan.
+void wifi_scan_reindex();
+
 ///////////////////////////////////////////////////////////////////////
 // wifi_send_ok_err_atcmd()
 //  Send a command to the DA and wait for a OK or ERROR response.
@@ -120,6 +128,7 @@ int wifi_send_ok_err_atcmd(char *cmd, char *errstr, k_timeout_t timeout);
 //
 //  @param message_type - the type of the message 1-999
 //  @param msg - the message to publishS
+//  @param msglen - length of msg, it does not need to be null terminated
 //  @param wait_for_snd_conf - wait for the send confirmation
 //  @param timeout - timeout for the entire operation
 //
@@ -133,7 +142,7 @@ int wifi_send_ok_err_atcmd(char *cmd, char *errstr, k_timeout_t timeout);
 //				errors in the message that are not transiant
 //			    -EINVAL if message_type is invalid
 //				-EFBIG if the message is too large
-int wifi_mqtt_publish(uint16_t message_type, char *msg, bool wait_for_send_conf, k_timeout_t timeout);
+int wifi_mqtt_publish(uint16_t message_type, const char *msg, int msglen, bool wait_for_send_conf, k_timeout_t timeout);
 
 ///////////////////////////////////////////////////////////////////////
 // wifi_set_otp_register()
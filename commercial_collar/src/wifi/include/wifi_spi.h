@@ -32,6 +32,19 @@ int  wifi_spi_recv(wifi_msg_t *msg, k_timeout_t timeout);
 //           -errno on error
 int wifi_spi_send(char *data);
 
+//////////////////////////////////////////////////////////
+// wifi_spi_sendv
+//
+// Write an AT command made of several pieces to the
+// DA16200 in one transfer.
+//
+//  @param iov - the pieces of the command, in order
+//  @param iov_cnt - number of pieces, at most WIFI_MAX_IOV
+//
+//  @return - 0 on success,
+//           -errno on error
+int wifi_spi_sendv(const wifi_iov_t *iov, int iov_cnt);
+
 //////////////////////////////////////////////////////////
 //	Requeue a message that was recv'd
 //
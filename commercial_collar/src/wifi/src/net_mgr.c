@@ -346,35 +346,6 @@ void send_zbus_string_event(uint32_t event, char *new, char *var, int maxsize)
     }
 }
 
-////////////////////////////////////////////////////////////////////
-// net_mgr_init()
-//
-// Initialize the net application layer
-//
-// @return - 0 on success, -1 on error
-int net_mgr_init()
-{
-    // Once we are communicating to the DA or the 9160 via SPI, they
-    // notifies us when their state changes such as when they reboots,
-    // or goes to sleep, wakes up, connects to an AP, etc.
-    // We want to monitor the message we get and keep track of the
-    // state of the DA so we can easily check if we can do a
-    // function or need to do a function again
-    wifi_add_tx_rx_cb(net_monitor_DA, NULL);
-
-    k_work_init(&(my_ota_info.work), net_ota_fn);
-    // Start a work thread to process net_mgr work
-    struct k_work_queue_config cfg;
-    cfg.no_yield = 1;
-    cfg.name     = "net_mgr";
-    k_work_queue_start(
-        &net_mgr_work_q, net_stack, K_THREAD_STACK_SIZEOF(net_stack), CONFIG_SYSTEM_WORKQUEUE_PRIORITY, &cfg);
-
-    send_zbus_tri_event(DA_EVENT_TYPE_WIFI_INIT, DA_STATE_KNOWN_TRUE, &(da_state.initialized));
-
-    return 0;
-}
-
 ///////////////////////////////////////////////////
 // tristate_str()
 // Get the name of the comm device type
@@ -1110,119 +1081,217 @@ void net_handle_DA_MQTT_Msg(wifi_msg_t *msg, char *msgPtr)
 //
 void net_handle_DA_DPM(wifi_msg_t *msg, char *msgPtr)
 {
-    if (strstr(msg->data, "\r\n+DPM:1") != NULL) {
+    if (strncmp(msgPtr, "\r\n+DPM:1", 8) == 0) {
         send_zbus_tri_event(DA_EVENT_TYPE_DPM_MODE, DA_STATE_KNOWN_TRUE, &(da_state.dpm_mode));
-    } else if (strstr(msg->data, "\r\n+DPM:0") != NULL) {
+    } else if (strncmp(msgPtr, "\r\n+DPM:0", 8) == 0) {
         send_zbus_tri_event(DA_EVENT_TYPE_DPM_MODE, DA_STATE_KNOWN_FALSE, &(da_state.dpm_mode));
-    } else if (strstr(msg->data, "\r\n+DPM_ABNORM_SLEEP") != NULL) {
+    } else if (strncmp(msgPtr, "\r\n+DPM_ABNORM_SLEEP", 19) == 0) {
         LOG_DBG("Got Abnormal Sleep");
         send_zbus_tri_event(DA_EVENT_TYPE_DPM_MODE, DA_STATE_KNOWN_TRUE, &(da_state.dpm_mode));
         send_zbus_tri_event(DA_EVENT_TYPE_IS_SLEEPING, DA_STATE_KNOWN_TRUE, &(da_state.is_sleeping));
     }
 }
 
+//////////////////////////////////////////////////////////
+// URC handlers
+//
+// These are called by wifi.c, through net_urcs[] below, for
+// each unsolicited message the DA sends us.  urc points at
+// the "\r\n+NAME" in msg->data.  They manage the shadow state
+// variables and kick off work items based on what happened
+static void net_urc_init(wifi_msg_t *msg, char *urc)
+{
+    //LOG_DBG("Got %20s message", msg->data);
+    // We want to call net_handle_DA_Init() if we have shipped (1) or
+    // if the uicr is invalid and neds restoring (<0)
+    if (uicr_shipping_flag_get() || !uicr_in_factory_flag_get()) {
+        net_handle_DA_Init(msg, urc);
+    }
+}
+
+static void net_urc_wfjap(wifi_msg_t *msg, char *urc)
+{
+    if (strncmp(urc, "\r\n+WFJAP:1", 10) == 0) {
+        net_handle_DA_APConn(msg, urc);
+    } else if (strncmp(urc, "\r\n+WFJAP:0", 10) == 0) {
+        net_handle_DA_APDiscon(msg, urc);
+    }
+}
+
+static void net_urc_time(wifi_msg_t *msg, char *urc)
+{
+    d1_set_5340_time(urc, false);
+}
+
+static void net_urc_rssi(wifi_msg_t *msg, char *urc)
+{
+    int rssi = RSSI_NOT_CONNECTED;
+    if (urc[8] == '-' || isdigit(urc[8])) {
+        rssi = strtol(urc + 8, NULL, 10);
+    }
+    send_zbus_int_event(DA_EVENT_TYPE_RSSI, rssi, &(da_state.rssi), false);
+}
+
+static void net_urc_mqtt_conn(wifi_msg_t *msg, char *urc)
+{
+    if (urc[10] == '1') {
+        queue_get_time_work();
+        send_zbus_tri_event(DA_EVENT_TYPE_MQTT_ENABLED, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_enabled));
+        send_zbus_tri_event(DA_EVENT_TYPE_MQTT_BROKER_CONNECT, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_broker_connected));
+    } else if (urc[10] == '0') {
+        // Broker not connected, doesn't mean not enabled
+        send_zbus_tri_event(DA_EVENT_TYPE_MQTT_BROKER_CONNECT, DA_STATE_KNOWN_FALSE, &(da_state.mqtt_broker_connected));
+    }
+}
+
+static void net_urc_mqtt_sent(wifi_msg_t *msg, char *urc)
+{
+    send_zbus_timestamp_event(DA_EVENT_TYPE_MQTT_MSG_SENT, k_uptime_get(), &(da_state.mqtt_last_msg_time));
+    queue_get_time_work();
+}
+
+static void net_urc_certs(wifi_msg_t *msg, char *urc)
+{
+    int flags = atoi(urc + 10);
+    if (flags & 0x07) {
+        send_zbus_tri_event(DA_EVENT_TYPE_MQTT_CERTS, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_certs_installed));
+    } else {
+        send_zbus_tri_event(DA_EVENT_TYPE_MQTT_CERTS, DA_STATE_KNOWN_FALSE, &(da_state.mqtt_certs_installed));
+    }
+}
+
+static void net_urc_mqtt_msg(wifi_msg_t *msg, char *urc)
+{
+    net_handle_DA_MQTT_Msg(msg, urc);
+    queue_get_time_work();
+}
+
+static void net_urc_mqtt_auto(wifi_msg_t *msg, char *urc)
+{
+    int state = atoi(urc + 12);
+    send_zbus_tri_event(DA_EVENT_TYPE_BOOT_MQTT_STATE, state == 1, &(da_state.mqtt_on_boot));
+}
+
+static void net_urc_wfdis(wifi_msg_t *msg, char *urc)
+{
+    int nv = (urc[9] == '1');
+    send_zbus_tri_event(DA_EVENT_TYPE_AP_PROFILE_USE, nv, &(da_state.ap_profile_disabled));
+}
+
+static void net_urc_http_status(wifi_msg_t *msg, char *urc)
+{
+    wifi_at_http_status(msg);
+}
+
+static void net_urc_http_data(wifi_msg_t *msg, char *urc)
+{
+    wifi_at_http_write(msg);
+}
+
+static void net_urc_ota_start(wifi_msg_t *msg, char *urc)
+{
+    strncpy(ota_last_start_result, urc + strlen("\r\n+NWOTADWSTART:"), 4);
+    ota_last_start_result[4] = 0;
+}
+
+static void net_urc_ssid_list(wifi_msg_t *msg, char *urc)
+{
+    char *list = k_calloc(msg->data_len + 2, 1);
+    if (list != NULL) {
+        memcpy(list, msg->data, msg->data_len);
+        char *sub = list + (urc - (char *)msg->data);
+        char *pos;
+        char *line = strtok_r(sub, "\n", &pos);
+        while (line != NULL && (line - list) < msg->data_len) {
+            wifi_add_SSID_to_cached_list(line);
+            line = strtok_r(NULL, "\n", &pos);
+        }
+        k_free(list);
+    }
+}
+
+static void net_urc_version(wifi_msg_t *msg, char *urc)
+{
+    //\r\n+VER:FRTOS-GEN01-01-TDEVER_ABC-YYMMDD
+    const char prefix[] = "\r\n+VER:FRTOS-GEN01-01-TDEVER_";
+    int        off      = sizeof(prefix) - 1;
+    uint8_t    ver[3]   = { 0, 0, 0 };
+
+    if (strncmp(urc, prefix, off) != 0) {
+        return;
+    }
+    ver[0] = urc[off + 0] - '0';    // EAS TODO allow for 2 digit version numbers
+    ver[1] = urc[off + 1] - '0';    // EAS TODO allow for 2 digit version numbers
+    ver[2] = urc[off + 2] - '0';    // EAS TODO allow for 2 digit version numbers
+    send_zbus_version_event(ver);
+}
+
+// The messages the DA sends that we track.  The http data and
+// the MQTT and ssid list payloads can hold anything, so nothing
+// after them in the message is looked at.
+static const wifi_urc_t net_urcs[] = {
+    { "+INIT", net_urc_init, false },
+    { "+WFJAP", net_urc_wfjap, false },
+    { "+WFDAP", net_handle_DA_APDiscon, false },
+    { "+DPM", net_handle_DA_DPM, false },
+    { "+DPM_ABNORM_SLEEP", net_handle_DA_DPM, false },
+    { "+TIME", net_urc_time, false },
+    { "+RSSI", net_urc_rssi, false },
+    { "+NWMQCL", net_urc_mqtt_conn, false },
+    { "+NWMQMSGSND", net_urc_mqtt_sent, false },
+    { "+NWMQTS", net_handle_DA_SubTopic, false },
+    { "+NWCCRT", net_urc_certs, false },
+    { "+NWMQMSG", net_urc_mqtt_msg, true },
+    { "+NWMQAUTO", net_urc_mqtt_auto, false },
+    { "+WFDIS", net_urc_wfdis, false },
+    { "+NWHTCSTATUS", net_urc_http_status, false },
+    { "+NWHTCDATA", net_urc_http_data, true },
+    { "+NWOTADWSTART", net_urc_ota_start, false },
+    { "+SSIDLIST", net_urc_ssid_list, true },
+    { "+VER", net_urc_version, false },
+};
+
+////////////////////////////////////////////////////////////////////
+// net_mgr_init()
+//
+// Initialize the net application layer
+//
+// @return - 0 on success, -1 on error
+int net_mgr_init()
+{
+    // Once we are communicating to the DA or the 9160 via SPI, they
+    // notifies us when their state changes such as when they reboots,
+    // or goes to sleep, wakes up, connects to an AP, etc.
+    // We want to monitor the message we get and keep track of the
+    // state of the DA so we can easily check if we can do a
+    // function or need to do a function again
+    wifi_set_urc_table(net_urcs, ARRAY_SIZE(net_urcs));
+    wifi_add_tx_rx_cb(net_monitor_DA, NULL);
+
+    k_work_init(&(my_ota_info.work), net_ota_fn);
+    // Start a work thread to process net_mgr work
+    struct k_work_queue_config cfg;
+    cfg.no_yield = 1;
+    cfg.name     = "net_mgr";
+    k_work_queue_start(
+        &net_mgr_work_q, net_stack, K_THREAD_STACK_SIZEOF(net_stack), CONFIG_SYSTEM_WORKQUEUE_PRIORITY, &cfg);
+
+    send_zbus_tri_event(DA_EVENT_TYPE_WIFI_INIT, DA_STATE_KNOWN_TRUE, &(da_state.initialized));
+
+    return 0;
+}
+
 //////////////////////////////////////////////////////////
 // net_monitor_DA
 //		This is a callback function called by wifi.c when
-// a packet is received from the DA.
-//
-// This manages the shadown state variables and kicks off
-// work items based on what happened
+// a packet is sent to the DA.  What comes back is handled
+// by net_urcs[] above.
 static void net_monitor_DA(wifi_msg_t *msg, void *user_data)
 {
-    char *sub;
-    if (msg->incoming == 1) {
-        if ((sub = strstr(msg->data, "\r\n+INIT:")) != NULL) {
-            //LOG_DBG("Got %20s message", msg->data);
-            // We want to call net_handle_DA_Init() if we have shipped (1) or
-            // if the uicr is invalid and neds restoring (<0)
-            if (uicr_shipping_flag_get() || !uicr_in_factory_flag_get()) {
-                net_handle_DA_Init(msg, sub);
-            }
-        } else if ((sub = strstr(msg->data, "\r\n+WFJAP:")) != NULL) {
-            if ((sub = strstr(msg->data, "\r\n+WFJAP:1")) != NULL) {
-                net_handle_DA_APConn(msg, sub);
-            }
-            if ((sub = strstr(msg->data, "\r\n+WFJAP:0")) != NULL) {
-                net_handle_DA_APDiscon(msg, sub);
-            }
-        } else if ((sub = strstr(msg->data, "\r\n+WFDAP")) != NULL) {
-            net_handle_DA_APDiscon(msg, sub);
-        } else if ((sub = strstr(msg->data, "\r\n+DPM")) != NULL) {
-            net_handle_DA_DPM(msg, sub);
-        } else if ((sub = strstr(msg->data, "\r\n+TIME")) != NULL) {
-            d1_set_5340_time(sub, false);
-        } else if ((sub = strstr(msg->data, "\r\n+RSSI:")) != NULL) {
-            int rssi = RSSI_NOT_CONNECTED;
-            if (sub[8] == '-' || isdigit(sub[8])) {
-                rssi = strtol(sub + 8, NULL, 10);
-            }
-            send_zbus_int_event(DA_EVENT_TYPE_RSSI, rssi, &(da_state.rssi), false);
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQCL:1")) != NULL) {
-            queue_get_time_work();
-            send_zbus_tri_event(DA_EVENT_TYPE_MQTT_ENABLED, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_enabled));
-            send_zbus_tri_event(
-                DA_EVENT_TYPE_MQTT_BROKER_CONNECT, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_broker_connected));
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQCL:0")) != NULL) {
-            // Broker not connected, doesn't mean not enabled
-            send_zbus_tri_event(
-                DA_EVENT_TYPE_MQTT_BROKER_CONNECT, DA_STATE_KNOWN_FALSE, &(da_state.mqtt_broker_connected));
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQMSGSND")) != NULL) {
-            send_zbus_timestamp_event(DA_EVENT_TYPE_MQTT_MSG_SENT, k_uptime_get(), &(da_state.mqtt_last_msg_time));
-            queue_get_time_work();
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQTS:")) != NULL) {
-            net_handle_DA_SubTopic(msg, sub);
-        } else if ((sub = strstr(msg->data, "\r\n+NWCCRT:")) != NULL) {
-            int flags = atoi(sub + 10);
-            if (flags & 0x07) {
-                send_zbus_tri_event(DA_EVENT_TYPE_MQTT_CERTS, DA_STATE_KNOWN_TRUE, &(da_state.mqtt_certs_installed));
-            } else {
-                send_zbus_tri_event(DA_EVENT_TYPE_MQTT_CERTS, DA_STATE_KNOWN_FALSE, &(da_state.mqtt_certs_installed));
-            }
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQMSG:")) != NULL) {
-            net_handle_DA_MQTT_Msg(msg, sub);
-            queue_get_time_work();
-        } else if ((sub = strstr(msg->data, "\r\n+NWMQAUTO:")) != NULL) {
-            int state = atoi(sub + 12);
-            send_zbus_tri_event(DA_EVENT_TYPE_BOOT_MQTT_STATE, state == 1, &(da_state.mqtt_on_boot));
-        } else if ((sub = strstr(msg->data, "\r\n+WFDIS:")) != NULL) {
-            int nv = (sub[9] == '1');
-            send_zbus_tri_event(DA_EVENT_TYPE_AP_PROFILE_USE, nv, &(da_state.ap_profile_disabled));
-        } else if ((sub = strstr(msg->data, "\r\n+NWHTCSTATUS:")) != NULL) {
-            wifi_at_http_status(msg);
-        } else if ((sub = strstr(msg->data, "\r\n+NWHTCDATA:")) != NULL) {
-            wifi_at_http_write(msg);
-        } else if ((sub = strstr(msg->data, "\r\n+NWOTADWSTART:")) != NULL) {
-            strncpy(ota_last_start_result, sub + strlen("\r\n+NWOTADWSTART:"), 4);
-            ota_last_start_result[4] = 0;
-        } else if ((sub = strstr(msg->data, "\r\n+SSIDLIST:")) != NULL) {
-            char *list = k_calloc(msg->data_len + 2, 1);
-            if (list != NULL) {
-                memcpy(list, msg->data, msg->data_len);
-                sub = strstr(list, "\r\n+SSIDLIST:");
-                char *pos;
-                char *line = strtok_r(sub, "\n", &pos);
-                if (line != NULL) {
-                    while (line != NULL && (line - list) < msg->data_len) {
-                        wifi_add_SSID_to_cached_list(line);
-                        line = strtok_r(NULL, "\n", &pos);
-                    }
-                }
-                k_free(list);
-            }
-        } else if ((sub = strstr(msg->data, "\r\n+VER:FRTOS-GEN01-01-TDEVER_")) != NULL) {
-            //\r\n+VER:FRTOS-GEN01-01-TDEVER_ABC-YYMMDD
-            uint8_t ver[3] = { 0, 0, 0 };
-            int     off    = sizeof("\r\n+VER:FRTOS-GEN01-01-TDEVER_") - 1;
-            ver[0]         = sub[off + 0] - '0';    // EAS TODO allow for 2 digit version numbers
-            ver[1]         = sub[off + 1] - '0';    // EAS TODO allow for 2 digit version numbers
-            ver[2]         = sub[off + 2] - '0';    // EAS TODO allow for 2 digit version numbers
-            send_zbus_version_event(ver);
-        }
-    } else {
-        // Outgoing messages
-        strncpy(da_state.last_cmd, msg->data, LAST_CMD_LEN - 1);
-        da_state.last_cmd[LAST_CMD_LEN - 1] = 0;
+    if (msg->incoming == 0) {
+        int len = MIN(msg->data_len, LAST_CMD_LEN - 1);
+        memcpy(da_state.last_cmd, msg->data, len);
+        da_state.last_cmd[len] = 0;
         // NOTE: Do not publish from here because outgoing messages
         // may be sent from withing a observer
     }
@@ -1550,7 +1619,7 @@ static void net_do_da_init_work_fn()
 
             if (da_state.mqtt_certs_installed == -1) {
                 // Sending this query will cause the DA to send back its status which will
-                // be processed by net_monitor_DA() above
+                // be processed by net_urc_certs() above
                 wifi_send_ok_err_atcmd("AT+NWCCRT", NULL, K_MSEC(300));
             }
 
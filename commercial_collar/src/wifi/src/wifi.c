@@ -17,17 +17,54 @@
 #include "wifi_spi.h"
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
-#include "pmic.h"
 
 static int num_of_heap_elements = 0;
 
 LOG_MODULE_REGISTER(d1_wifi, CONFIG_D1_WIFI_LOG_LEVEL);
 
 // A queue to stores wifi_msg_t elements.  The data buffer
-// should be k_heap_free()d when done with the message
+// should be wifi_msg_free()d when done with the message
 #define WIFI_MSG_Q_SIZE 40
 K_MSGQ_DEFINE(wifi_msgq, sizeof(wifi_msg_t), WIFI_MSG_Q_SIZE, 4);
-K_HEAP_DEFINE(wifi_heap, WIFI_MSG_SIZE * 7);
+
+// Incoming messages are placed one after the other in the receive
+// ring, each behind a small header, and parsed where they are.  They
+// can be freed in any order, the space is reused once everything
+// older than it has been freed too.
+typedef struct
+{
+    uint16_t len;    // bytes taken in the ring, header included
+    uint16_t in_use;
+} ring_hdr_t;
+
+static uint8_t __aligned(4) rx_ring[WIFI_RX_RING_SIZE];
+static size_t            ring_head;    // where the next message goes
+static size_t            ring_tail;    // the oldest message not freed yet
+static size_t            ring_used;
+static struct k_spinlock ring_lock;
+static wifi_rx_stats_t   rx_stats;
+
+// The URCs net_mgr (or whoever) wants to hear about
+static const wifi_urc_t *urc_table;
+static int               urc_count;
+
+// The command/response correlator.  Every command sent bumps
+// cmd_seq and every incoming message is stamped with it.  A wait
+// is stamped with the command it is for, and a message from an
+// earlier command is only dropped if that command was waited on
+// itself, otherwise nobody owns it and it can still match.  While
+// a wait is in progress, messages are matched as they arrive
+// instead of going through the queue.
+static uint16_t           cmd_seq;
+static uint32_t           waited_seqs;    // bit n set if command cmd_seq - n was waited on
+static wifi_wait_array_t *waiter;
+static int                waiter_ret;
+static K_SEM_DEFINE(waiter_sem, 0, 1);
+static K_MUTEX_DEFINE(waiter_lock);
+
+static int  match_message(wifi_msg_t *msg, wifi_wait_array_t *wait_msgs);
+static bool waiter_take(wifi_msg_t *msg);
+static bool owned_by_other(const wifi_msg_t *msg, const wifi_wait_array_t *wait_msgs);
 
 // We want to serialize access to the DA so that two threads can't
 // step on each others toes.  This mutex is used to do that.
@@ -158,6 +195,49 @@ void wifi_rem_tx_rx_cb(int id)
     }
 }
 
+//////////////////////////////////////////////////////////
+// wifi_set_urc_table
+//
+// Set the table incoming messages are dispatched through
+//
+// @param table - the handlers, must stay valid
+// @param count - number of entries in table
+void wifi_set_urc_table(const wifi_urc_t *table, int count)
+{
+    urc_table = table;
+    urc_count = count;
+}
+
+//////////////////////////////////////////////////////////
+// dispatch_urcs
+//
+// Hand every "\r\n+NAME" line of an incoming message to
+// the handler for NAME, if there is one.  This walks the
+// message once, in place.
+static void dispatch_urcs(wifi_msg_t *msg)
+{
+    char *end = (char *)msg->data + msg->data_len;
+    char *urc = (char *)msg->data;
+
+    while (urc_count > 0 && (urc = strstr(urc, "\r\n+")) != NULL && urc < end) {
+        char *name = urc + 2;
+        int   len  = strcspn(name, ":,\r\n");
+
+        for (int i = 0; i < urc_count; i++) {
+            const wifi_urc_t *entry = &urc_table[i];
+
+            if (strncmp(name, entry->name, len) == 0 && entry->name[len] == 0) {
+                entry->handler(msg, urc);
+                if (entry->takes_rest || msg->ref_count <= 0) {
+                    return;
+                }
+                break;
+            }
+        }
+        urc = name + len;
+    }
+}
+
 //////////////////////////////////////////////////////////
 // wifi_notify_cbs
 //
@@ -184,6 +264,10 @@ int wifi_notify_cbs(wifi_msg_t *msg)
 {
     int ret;
 
+    if (msg->incoming == 1) {
+        dispatch_urcs(msg);
+    }
+
     for (int i = 0; i < WIFI_NUM_RX_CB; i++) {
         if (wifi_tx_rx_cb[i] != NULL) {
             // If the callback has consumed the message it will return
@@ -201,8 +285,16 @@ int wifi_notify_cbs(wifi_msg_t *msg)
         }
     }
     if (msg->ref_count > 0 && msg->incoming == 1) {
+        k_mutex_lock(&waiter_lock, K_FOREVER);
+        // Someone is waiting on a response, see if this is it
+        if (waiter != NULL && waiter_take(msg)) {
+            k_mutex_unlock(&waiter_lock);
+            wifi_msg_free(msg);
+            return 0;
+        }
         // Copy the wifi_msg_t into the msg response queue
         ret = k_msgq_put(&wifi_msgq, msg, K_NO_WAIT);
+        k_mutex_unlock(&waiter_lock);
         if (ret != 0) {
             LOG_ERR("Failed to put data on queue");
             return ret;
@@ -223,6 +315,7 @@ int wifi_notify_cbs(wifi_msg_t *msg)
 // @return - none
 void wifi_wake_DA(int ms_delay)
 {
+    // Not a command, what the DA says to it belongs to whoever waits next
     g_last_wake_time = k_uptime_get();
     gpio_pin_set(gpio_p1, WIFI_WAKEUP_PIN, 1);    // Pulse high
     k_sleep(K_MSEC(ms_delay));
@@ -339,6 +432,26 @@ bool wifi_get_power_key()
 //            -EBUSY if mutex is taken
 //			  -errno if 1 on error or timeout
 int wifi_send_timeout(char *buf, k_timeout_t timeout)
+{
+    wifi_iov_t iov = { .data = buf, .len = strlen(buf) };
+
+    return wifi_sendv_timeout(&iov, 1, timeout);
+}
+
+//////////////////////////////////////////////////////////
+// wifi_sendv_timeout
+//
+// Write an AT command made of several pieces to the
+// DA16200
+//
+//  @param iov - the pieces of the command, in order
+//  @param iov_cnt - number of pieces, at most WIFI_MAX_IOV
+//  @param timeout - timeout for the write
+//
+//  @return - 0 on success,
+//            -EBUSY if mutex is taken
+//			  -errno if 1 on error or timeout
+int wifi_sendv_timeout(const wifi_iov_t *iov, int iov_cnt, k_timeout_t timeout)
 {
     int ret = 0;
     if (wifi_get_mutex(timeout, __func__) != 0) {
@@ -346,13 +459,19 @@ int wifi_send_timeout(char *buf, k_timeout_t timeout)
         return -EBUSY;
     }
 
-    wifi_msg_t msg = { .timestamp = k_uptime_get(), .incoming = 0, .data = buf, .data_len = strlen(buf), .ref_count = 1 };
+    // The callbacks get the head of the command, which says what it is
+    wifi_msg_t msg = {
+        .timestamp = k_uptime_get(), .incoming = 0, .data = (uint8_t *)iov[0].data, .data_len = iov[0].len, .ref_count = 1
+    };
 
     // Notify the callbacks that we are about to send a message
     // to allow them to track the DA state or prevent the message
     wifi_notify_cbs(&msg);    // There isn't an error it can return that affects us
 
-    ret = wifi_spi_send(buf);
+    // Anything that arrives from here on is in response to this command
+    cmd_seq++;
+    waited_seqs <<= 1;
+    ret = wifi_spi_sendv(iov, iov_cnt);
     wifi_release_mutex();
     return ret;
 }
@@ -387,73 +506,112 @@ int wifi_recv(wifi_msg_t *msg, k_timeout_t timeout)
     return ret;
 }
 
+//////////////////////////////////////////////////////////
+// ring_alloc()
+//
+// Take amount bytes from the receive ring, NULL if there
+// isn't that much room in one piece
+static void *ring_alloc(size_t amount)
+{
+    size_t           need = ROUND_UP(sizeof(ring_hdr_t) + amount, sizeof(ring_hdr_t));
+    ring_hdr_t      *hdr  = NULL;
+    size_t           room;
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    if (ring_used == 0) {
+        ring_head = 0;
+        ring_tail = 0;
+    }
+    if (ring_head < ring_tail || (ring_head == ring_tail && ring_used > 0)) {
+        room = ring_tail - ring_head;
+    } else {
+        room = WIFI_RX_RING_SIZE - ring_head;
+        if (room < need && ring_tail >= need) {
+            // It doesn't fit at the end, skip that bit and start over at the front
+            hdr         = (ring_hdr_t *)&rx_ring[ring_head];
+            hdr->len    = room;
+            hdr->in_use = 0;
+            ring_used += room;
+            ring_head = 0;
+            room      = ring_tail;
+        }
+    }
+
+    hdr = NULL;
+    if (room >= need) {
+        hdr         = (ring_hdr_t *)&rx_ring[ring_head];
+        hdr->len    = need;
+        hdr->in_use = 1;
+        ring_head   = (ring_head + need) % WIFI_RX_RING_SIZE;
+        ring_used += need;
+        rx_stats.ring_peak = MAX(rx_stats.ring_peak, ring_used);
+    }
+    k_spin_unlock(&ring_lock, key);
+    return hdr ? hdr + 1 : NULL;
+}
+
+//////////////////////////////////////////////////////////
+// ring_free()
+//
+// Give back a message from the receive ring, along with
+// everything behind it that was freed already
+static void ring_free(void *data)
+{
+    ring_hdr_t      *hdr = (ring_hdr_t *)data - 1;
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    hdr->in_use = 0;
+    while (ring_used > 0) {
+        ring_hdr_t *oldest = (ring_hdr_t *)&rx_ring[ring_tail];
+        if (oldest->in_use) {
+            break;
+        }
+        ring_used -= oldest->len;
+        ring_tail = (ring_tail + oldest->len) % WIFI_RX_RING_SIZE;
+    }
+    k_spin_unlock(&ring_lock, key);
+}
+
 //////////////////////////////////////////////////////////
 // wifi_msg_alloc()
 //
-// Alloc memory from the wifi heap
-static int   alloc_fails_in_a_row = 0;
+// Alloc memory from the receive ring.  If there is no room,
+// messages left on the queue for longer than WIFI_FLUSH_AGE
+// are dropped, oldest first, as they are probably what is
+// holding the ring up.
 static void *wifi_msg_alloc(int amount)
 {
-    void      *data = NULL;
     wifi_msg_t msg;
     uint64_t   now = k_uptime_get();
-    int        ret, qsize = k_msgq_num_used_get(&wifi_msgq);
 
-    for (int i = 0; i < WIFI_MSG_Q_SIZE; i++) {
-        data = k_heap_alloc(&wifi_heap, amount, K_NO_WAIT);
+    while (1) {
+        void *data = ring_alloc(amount);
         if (data != NULL) {
 #if CONFIG_DEBUG_WIFI_HEAP == 1
-            LOG_DBG("[%d]Allocated %d bytes at %p, qsize = %d", num_of_heap_elements, amount, data, qsize);
+            LOG_DBG("[%d]Allocated %d bytes at %p, qsize = %d", num_of_heap_elements, amount, data, wifi_msg_cnt());
 #endif
-            alloc_fails_in_a_row = 0;
             num_of_heap_elements++;
             return data;
         }
-        // No heap, flush message in msg q until we have room
-        if (qsize <= 0) {
-            LOG_ERR("No heap but nothing in the msgq");
-            alloc_fails_in_a_row++;
-            if (alloc_fails_in_a_row > 5) {
-                LOG_ERR("Too many alloc fails in a row, rebooting");
-                pmic_reboot("wifi_msg_alloc");
-            }
-            return NULL;
-        }
-        ret = k_msgq_peek(&wifi_msgq, &msg);
-        if (ret != 0) {
-            LOG_ERR("Failed to peek at wifi msgq (cnt = %d)", qsize);
-            alloc_fails_in_a_row++;
-            if (alloc_fails_in_a_row > 5) {
-                LOG_ERR("Too many alloc fails in a row, rebooting");
-                pmic_reboot("wifi_msg_alloc");
-            }
-            return NULL;
-        }
-
-        if (now - msg.timestamp <= WIFI_FLUSH_AGE) {
-            LOG_ERR("No heap and eveything in the msgq is recent, msgq cnt = %d", qsize);
-            alloc_fails_in_a_row++;
-            if (alloc_fails_in_a_row > 5) {
-                LOG_ERR("Too many alloc fails in a row, rebooting");
-                pmic_reboot("wifi_msg_alloc");
-            }
-            return NULL;
-        }
-
-        ret = k_msgq_get(&wifi_msgq, &msg, K_NO_WAIT);
-        if (ret != 0) {
-            LOG_ERR("Failed to grab msg from wifi msgq, cnt = %d", qsize);
-            alloc_fails_in_a_row++;
-            if (alloc_fails_in_a_row > 5) {
-                LOG_ERR("Too many alloc fails in a row, rebooting");
-                pmic_reboot("wifi_msg_alloc");
-            }
+        if (k_msgq_peek(&wifi_msgq, &msg) != 0 || now - msg.timestamp <= WIFI_FLUSH_AGE
+            || k_msgq_get(&wifi_msgq, &msg, K_NO_WAIT) != 0) {
+            rx_stats.dropped++;
+            LOG_ERR("No room for a %d byte message, %d bytes of the ring in use", amount, ring_used);
             return NULL;
         }
-        qsize--;
+        rx_stats.evicted++;
         wifi_msg_free(&msg);
     }
-    return data;
+}
+
+//////////////////////////////////////////////////////////
+// wifi_get_rx_stats()
+//
+// Get the state of the receive ring
+void wifi_get_rx_stats(wifi_rx_stats_t *stats)
+{
+    *stats           = rx_stats;
+    stats->ring_used = ring_used;
 }
 
 //////////////////////////////////////////////////////////
@@ -473,6 +631,7 @@ int wifi_init_new_msg(wifi_msg_t *msg, bool incoming, int buf_size)
     msg->ref_count = 1;
     msg->incoming  = incoming;
     msg->timestamp = k_uptime_get();
+    msg->cmd_seq   = cmd_seq;
     msg->data      = wifi_msg_alloc(buf_size);
     if (msg->data == NULL) {
         msg->ref_count = 0;
@@ -523,11 +682,15 @@ void wifi_msg_free(wifi_msg_t *msg)
         LOG_ERR("msg at %p data is null", msg);
         return;
     }
+    if (msg->data < rx_ring || msg->data >= rx_ring + sizeof(rx_ring)) {
+        LOG_ERR("msg at %p data %p is not from the receive ring", msg, msg->data);
+        return;
+    }
     num_of_heap_elements--;
 #if CONFIG_DEBUG_WIFI_HEAP == 1
     LOG_DBG("[%d]Freeing %p", num_of_heap_elements, msg->data);
 #endif
-    k_heap_free(&wifi_heap, msg->data);
+    ring_free(msg->data);
     msg->data = NULL;
 }
 
@@ -763,6 +926,7 @@ int wifi_wait_for(wifi_wait_array_t *wait_msgs, k_timeout_t timeout)
 {
     k_timepoint_t timepoint = sys_timepoint_calc(timeout);
     wifi_msg_t    msg;
+    int           ret;
 
     if (wait_msgs->num_msgs > WIFI_MAX_WAIT_MSGS) {
         LOG_ERR("exceeded max messages that can be waited for");
@@ -773,33 +937,90 @@ int wifi_wait_for(wifi_wait_array_t *wait_msgs, k_timeout_t timeout)
         return -EBUSY;
     }
 
-    int ret = -EAGAIN;
-    while (1) {
-        timeout = sys_timepoint_timeout(timepoint);
-        if (sys_timepoint_expired(timepoint) || K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
-            LOG_ERR("Timeout expired waiting for message");
-            break;
-        }
-        ret = wifi_recv(&msg, timeout);
-        if (ret == -ENOMSG) {
-            continue;
-        }
-        if (ret != 0) {
+    k_mutex_lock(&waiter_lock, K_FOREVER);
+    k_sem_reset(&waiter_sem);
+    waiter     = wait_msgs;
+    waiter_ret = -EAGAIN;
+
+    // We hold the DA mutex, so the last command sent is ours
+    wait_msgs->cmd_seq = cmd_seq;
+    waited_seqs |= BIT(0);
+
+    // Go through what arrived before the wait started.  Responses
+    // to earlier commands that were waited on are dropped, anything
+    // else that doesn't match is put back, in the same order
+    for (int n = k_msgq_num_used_get(&wifi_msgq); n > 0; n--) {
+        if (k_msgq_get(&wifi_msgq, &msg, K_NO_WAIT) != 0) {
             break;
         }
-        ret = match_message(&msg, wait_msgs);
-        wifi_msg_free(&msg);
-        // This msg matches something and that match stops the search
-        if (ret > -1 && wait_msgs->stop_waiting[ret]) {
-            break;
+        if (owned_by_other(&msg, wait_msgs)) {
+            rx_stats.stale++;
+            wifi_msg_free(&msg);
+        } else if (waiter != NULL && waiter_take(&msg)) {
+            wifi_msg_free(&msg);
+        } else {
+            k_msgq_put(&wifi_msgq, &msg, K_NO_WAIT);
         }
-        // else we didn't match what the caller is
-        // is looking for, so check the next msg
     }
+    bool waiting = waiter != NULL;
+    k_mutex_unlock(&waiter_lock);
+
+    // The receive thread matches whatever comes in now
+    if (waiting) {
+        k_sem_take(&waiter_sem, sys_timepoint_timeout(timepoint));
+    }
+
+    k_mutex_lock(&waiter_lock, K_FOREVER);
+    ret    = waiter == NULL ? waiter_ret : -EAGAIN;
+    waiter = NULL;
+    k_mutex_unlock(&waiter_lock);
+    if (ret == -EAGAIN) {
+        LOG_ERR("Timeout expired waiting for message");
+    }
+
     wifi_release_mutex();
     return ret;
 }
 
+//////////////////////////////////////////////////////////
+// owned_by_other()
+//
+// True if a message arrived while another command than the
+// one being waited on was in flight, and that command was
+// waited on itself. Commands too far back to track count as
+// waited on. Called with waiter_lock held
+static bool owned_by_other(const wifi_msg_t *msg, const wifi_wait_array_t *wait_msgs)
+{
+    uint16_t age = cmd_seq - msg->cmd_seq;
+
+    if (msg->cmd_seq == wait_msgs->cmd_seq) {
+        return false;
+    }
+    return age >= 32 || (waited_seqs & BIT(age)) != 0;
+}
+
+//////////////////////////////////////////////////////////
+// waiter_take()
+//
+// Match a message against the wait in progress, called
+// with waiter_lock held
+//
+// @return - true if the message matched and was used
+static bool waiter_take(wifi_msg_t *msg)
+{
+    int ret = match_message(msg, waiter);
+
+    if (ret < 0) {
+        return false;
+    }
+    waiter_ret = ret;
+    if (waiter->stop_waiting[ret]) {
+        waiter = NULL;
+        k_sem_give(&waiter_sem);
+    }
+    return true;
+}
+
 //////////////////////////////////////////////////////////
 //	wifi_send_and_wait_for()
 //  Send an cmd and wait for one of a few messages to
@@ -683,48 +683,213 @@ static int freq_to_channel(int freq)
 
 uint64_t   g_last_ssid_scan_time = 0;
 wifi_arr_t g_last_ssid_list      = { .count = 0 };
+
+// The known SSIDs saved on the DA, see wifi_get_ap_list()
+static shadow_zone_t cached_zones[MAX_SAVED_SSIDS];
+static bool          cached_zones_valid = false;
+
+// The scan results are kept from one scan to the next.  Each
+// AP is updated in place when it shows up again and dropped once
+// it has been missing from more than CONFIG_WIFI_SCAN_MAX_MISSES
+// scans.  Two hash tables, by BSSID and by SSID, index into
+// g_last_ssid_list, and each AP knows which known SSID it is, so
+// finding the known SSIDs in a scan doesn't search anything.
+#define SCAN_HASH_SLOTS 64    // a power of 2, at least twice MAX_WIFI_OBJS
+
+typedef struct
+{
+    uint32_t bssid_hash;
+    uint32_t ssid_hash;
+    uint8_t  misses;    // scans in a row this AP was not in
+    int8_t   zone;      // index in cached_zones, -1 if not a known SSID
+} scan_meta_t;
+
+static scan_meta_t scan_meta[MAX_WIFI_OBJS];
+static uint8_t     bssid_slots[SCAN_HASH_SLOTS];    // index + 1 into g_last_ssid_list, 0 if empty
+static uint8_t     ssid_slots[SCAN_HASH_SLOTS];     // the strongest AP with that SSID
+static bool        scan_zones_valid = false;
+
+static uint32_t scan_hash(const char *str)
+{
+    uint32_t hash = 2166136261u;    // FNV-1a
+
+    while (*str) {
+        hash = (hash ^ (uint8_t)*str++) * 16777619u;
+    }
+    return hash;
+}
+
+// Find the slot for a key, either the one holding it or the
+// empty one it would go in
+static int scan_slot(const uint8_t *slots, uint32_t hash, const char *key, bool by_ssid)
+{
+    int slot = hash & (SCAN_HASH_SLOTS - 1);
+
+    while (slots[slot] != 0) {
+        int          idx  = slots[slot] - 1;
+        scan_meta_t *meta = &scan_meta[idx];
+        if (by_ssid) {
+            if (meta->ssid_hash == hash && strcmp(g_last_ssid_list.wifi[idx].ssid, key) == 0) {
+                break;
+            }
+        } else if (meta->bssid_hash == hash && strcmp(g_last_ssid_list.wifi[idx].macstr, key) == 0) {
+            break;
+        }
+        slot = (slot + 1) & (SCAN_HASH_SLOTS - 1);
+    }
+    return slot;
+}
+
+static int scan_find_bssid(const char *macstr, uint32_t hash)
+{
+    return bssid_slots[scan_slot(bssid_slots, hash, macstr, false)] - 1;
+}
+
+// Work out which known SSID each AP in the scan is
+static void scan_match_zones(void)
+{
+    for (int i = 0; i < g_last_ssid_list.count; i++) {
+        scan_meta[i].zone = -1;
+    }
+    for (int z = 0; cached_zones_valid && z < MAX_SAVED_SSIDS; z++) {
+        if (cached_zones[z].ssid[0] == 0) {
+            continue;
+        }
+        uint32_t hash = scan_hash(cached_zones[z].ssid);
+        int      slot = scan_slot(ssid_slots, hash, cached_zones[z].ssid, true);
+        for (int i = ssid_slots[slot] - 1; i >= 0 && i < g_last_ssid_list.count; i++) {
+            // APs with the same SSID can be anywhere after the strongest.
+            // If a name is saved twice, the first one counts, like wifi_find_saved_ssid()
+            if (scan_meta[i].zone < 0 && scan_meta[i].ssid_hash == hash
+                && strcmp(g_last_ssid_list.wifi[i].ssid, cached_zones[z].ssid) == 0) {
+                scan_meta[i].zone = z;
+            }
+        }
+    }
+    scan_zones_valid = cached_zones_valid;
+}
+
+//////////////////////////////////////////////////////////////
+// wifi_scan_reindex()
+//
+// Rebuild the lookups into g_last_ssid_list.  Call this after
+// changing the list other than through a scan.
+void wifi_scan_reindex()
+{
+    memset(bssid_slots, 0, sizeof(bssid_slots));
+    memset(ssid_slots, 0, sizeof(ssid_slots));
+    for (int i = 0; i < g_last_ssid_list.count; i++) {
+        wifi_obj_t  *entry = &g_last_ssid_list.wifi[i];
+        scan_meta_t *meta  = &scan_meta[i];
+
+        meta->bssid_hash = scan_hash(entry->macstr);
+        meta->ssid_hash  = scan_hash(entry->ssid);
+        bssid_slots[scan_slot(bssid_slots, meta->bssid_hash, entry->macstr, false)] = i + 1;
+        if (entry->ssid[0] != 0) {
+            // The list is strongest first, so the first one in is the strongest
+            int slot = scan_slot(ssid_slots, meta->ssid_hash, entry->ssid, true);
+            if (ssid_slots[slot] == 0) {
+                ssid_slots[slot] = i + 1;
+            }
+        }
+    }
+    scan_match_zones();
+}
+
+// Split off the next tab separated field of a line, NULL if there isn't one
+static char *next_field(char **pos)
+{
+    char *field = *pos;
+    char *tab;
+
+    if (field == NULL) {
+        return NULL;
+    }
+    tab = strchr(field, '\t');
+    if (tab != NULL) {
+        *tab = 0;
+        *pos = tab + 1;
+    } else {
+        *pos = NULL;
+    }
+    return field;
+}
+
+typedef struct
+{
+    char *mac;
+    char *freq;
+    char *rssi;
+    char *flags;
+    char *ssid;
+} scan_line_t;
+
+static void scan_set(int idx, const scan_line_t *line)
+{
+    wifi_obj_t *entry = &g_last_ssid_list.wifi[idx];
+
+    strncpy(entry->ssid, line->ssid, 32);
+    entry->rssi    = strtol(line->rssi, NULL, 10);
+    entry->channel = freq_to_channel(strtol(line->freq, NULL, 10));
+    strncpy(entry->flags, line->flags, 99);
+    entry->flags[99]      = 0;
+    scan_meta[idx].misses = 0;
+}
+
+//////////////////////////////////////////////////////////////
+// parse_wfscan()
+//
+// Merge a +WFSCAN response into the scan results.  Each
+// line is <bssid>\t<freq>\t<rssi>\t<flags>\t<ssid>, the
+// ssid is everything after the last tab, spaces and all,
+// and is missing for hidden APs.
+//
+// @return - the number of APs in this scan
 static int parse_wfscan(char *sub, bool skip_hidden)
 {
-    char  flagstr[100];
-    int   rssi;
-    int   freq;
-    char *nsub;
+    static scan_line_t new_aps[MAX_WIFI_OBJS];    // only used with the wifi mutex held
+    bool               seen[MAX_WIFI_OBJS] = { false };
+    int                num_new             = 0;
+    int                found               = 0;
+    char              *nsub;
     // sub points to \r\n+WFSCAN:...
 
+    // APs we already have are updated in place, the new ones
+    // are added once the ones that went away are gone
     sub += 10;
-    g_last_ssid_list.count = 0;
-    wifi_obj_t *entry      = &g_last_ssid_list.wifi[g_last_ssid_list.count];
-
     while (strlen(sub) > 10) {
-        nsub = strstr(sub, "\n");
+        nsub = strchr(sub, '\n');
         if (nsub != NULL) {
             *nsub = 0;
         }
-        if (sscanf(sub, "%s\t%d\t%d\t%s\t%s", entry->macstr, &freq, &rssi, flagstr, entry->ssid) == 5) {
-            // Need to catch names with spaces at the end and beginning, since the last entry is a ssid
-            char *end = strrchr(sub, 9);    // search from the end backwards for a tab (9), everything after is the ssid
-            if (end != NULL) {
-                end += 1;
-                strncpy(entry->ssid, end, 32);
-            }
-            entry->rssi    = rssi;
-            entry->channel = freq_to_channel(freq);
-            strncpy(entry->flags, flagstr, 99);
-            entry->flags[99] = 0;
-            g_last_ssid_list.count++;
-            entry = &g_last_ssid_list.wifi[g_last_ssid_list.count];
-        } else if (sscanf(sub, "%s\t%d\t%d\t%s\t", entry->macstr, &freq, &rssi, flagstr) == 4) {
-            if (skip_hidden == false) {
-                entry->ssid[0] = 0;
-                strncpy(entry->flags, flagstr, 99);
-                entry->flags[99] = 0;
-                entry->channel   = freq_to_channel(freq);
-                g_last_ssid_list.count++;
-                entry = &g_last_ssid_list.wifi[g_last_ssid_list.count];
-            }
-        } else {
+        char *end = sub + strlen(sub);
+        if (end > sub && end[-1] == '\r') {
+            end[-1] = 0;
+        }
+
+        char       *pos  = sub;
+        scan_line_t line = {
+            .mac   = next_field(&pos),
+            .freq  = next_field(&pos),
+            .rssi  = next_field(&pos),
+            .flags = next_field(&pos),
+        };
+        line.ssid = pos != NULL ? pos : "";
+
+        if (line.flags == NULL || line.mac[0] == 0) {
             LOG_ERR("Failed to parse:");
             LOG_HEXDUMP_DBG(sub, strlen(sub), "data");
+        } else if (line.ssid[0] != 0 || skip_hidden == false) {
+            int idx = scan_find_bssid(line.mac, scan_hash(line.mac));
+            if (idx >= 0) {
+                if (!seen[idx]) {
+                    scan_set(idx, &line);
+                    seen[idx] = true;
+                    found++;
+                }
+            } else if (num_new < MAX_WIFI_OBJS) {
+                new_aps[num_new++] = line;
+            }
         }
         if (nsub == NULL) {
             break;
@@ -732,7 +897,42 @@ static int parse_wfscan(char *sub, bool skip_hidden)
         sub = nsub + 1;
     }
 
-    return g_last_ssid_list.count;
+    // Age out the APs that weren't there, keeping the order
+    int count = 0;
+    for (int i = 0; i < g_last_ssid_list.count; i++) {
+        if (!seen[i] && ++scan_meta[i].misses > CONFIG_WIFI_SCAN_MAX_MISSES) {
+            continue;
+        }
+        if (count != i) {
+            g_last_ssid_list.wifi[count] = g_last_ssid_list.wifi[i];
+            scan_meta[count]             = scan_meta[i];
+        }
+        count++;
+    }
+    for (int i = 0; i < num_new && count < MAX_WIFI_OBJS; i++) {
+        wifi_obj_t *entry = &g_last_ssid_list.wifi[count];
+        strncpy(entry->macstr, new_aps[i].mac, sizeof(entry->macstr) - 1);
+        entry->macstr[sizeof(entry->macstr) - 1] = 0;
+        scan_set(count++, &new_aps[i]);
+        found++;
+    }
+
+    // Strongest first.  Most APs are where they were last scan, so
+    // this is close to a single pass
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && g_last_ssid_list.wifi[j].rssi > g_last_ssid_list.wifi[j - 1].rssi; j--) {
+            wifi_obj_t  tmp              = g_last_ssid_list.wifi[j];
+            scan_meta_t tmeta            = scan_meta[j];
+            g_last_ssid_list.wifi[j]     = g_last_ssid_list.wifi[j - 1];
+            scan_meta[j]                 = scan_meta[j - 1];
+            g_last_ssid_list.wifi[j - 1] = tmp;
+            scan_meta[j - 1]             = tmeta;
+        }
+    }
+    g_last_ssid_list.count = count;
+    wifi_scan_reindex();
+
+    return found;
 }
 
 //////////////////////////////////////////////////////////////
@@ -744,14 +944,17 @@ wifi_arr_t *wifi_get_last_ssid_list()
     return &g_last_ssid_list;
 }
 
+//////////////////////////////////////////////////////////////
+// wifi_find_ssid_in_scan()
+//
+// @return - index in the last scan of the strongest AP
+//           with this SSID, -1 if it wasn't seen
 int wifi_find_ssid_in_scan(char *ssid)
 {
-    for (int i = 0; i < g_last_ssid_list.count; i++) {
-        if (strcmp(ssid, g_last_ssid_list.wifi[i].ssid) == 0) {
-            return i;
-        }
+    if (ssid[0] == 0) {
+        return -1;
     }
-    return -1;
+    return ssid_slots[scan_slot(ssid_slots, scan_hash(ssid), ssid, true)] - 1;
 }
 
 /////////////////////////////////////////////////////////
@@ -1089,6 +1292,7 @@ int  wifi_set_mqtt_sub_topics_by_type(int types[], int cnt, k_timeout_t timeout)
 //
 //  @param message_type - the type of the message 1-999
 //  @param msg - the message to publishS
+//  @param msglen - length of msg, it does not need to be null terminated
 //  @param wait_for_snd_conf - wait for the send confirmation
 //  @param timeout - timeout for the entire operation
 //
@@ -1102,15 +1306,14 @@ int  wifi_set_mqtt_sub_topics_by_type(int types[], int cnt, k_timeout_t timeout)
 //				errors in the message that are not transiant
 //			    -EINVAL if message_type is invalid
 //				-EFBIG if the message is too large
-int wifi_mqtt_publish(uint16_t message_type, char *msg, bool wait_for_send_conf, k_timeout_t timeout)
+int wifi_mqtt_publish(uint16_t message_type, const char *msg, int msglen, bool wait_for_send_conf, k_timeout_t timeout)
 {
     char              pub_topic[90];
     char              errorstr[25];
+    char              sndstr[21];
     wifi_wait_array_t wait_msgs;
-    char             *buf       = NULL;
     int               result    = -EINVAL;
     k_timepoint_t     timepoint = sys_timepoint_calc(timeout);
-    int               msglen    = strlen(msg);
 
     if (message_type > 999) {
         LOG_ERR("message_type must be less than 1000");
@@ -1167,31 +1370,24 @@ int wifi_mqtt_publish(uint16_t message_type, char *msg, bool wait_for_send_conf,
 
 #define MQTT_PUB_HEAD "AT+NWMQMSG='"
 #define MQTT_PUB_MID  "',"
-    int buflen = sizeof(MQTT_PUB_HEAD) + msglen + sizeof(MQTT_PUB_MID) + strlen(pub_topic) + 1;
-    buf        = k_calloc(buflen, 1);
-    if (buf == NULL) {
-        result = -ENOMEM;
-        goto mqtt_pub_exit;
-    }
-
-    strncpy(buf, MQTT_PUB_HEAD, buflen);
-    buflen -= sizeof(MQTT_PUB_HEAD);
-    strncat(buf, msg, buflen);
-    buflen -= msglen;
-    strncat(buf, MQTT_PUB_MID, buflen);
-    buflen -= sizeof(MQTT_PUB_MID);
-    strncat(buf, pub_topic, buflen);
+    // The message goes to the DA straight from the caller's buffer
+    const wifi_iov_t iov[] = {
+        { MQTT_PUB_HEAD, sizeof(MQTT_PUB_HEAD) - 1 },
+        { msg, msglen },
+        { MQTT_PUB_MID, sizeof(MQTT_PUB_MID) - 1 },
+        { pub_topic, strlen(pub_topic) },
+    };
 
     timeout = sys_timepoint_timeout(timepoint);
-    if ((result = wifi_send_timeout(buf, timeout)) != 0) {
+    if ((result = wifi_sendv_timeout(iov, ARRAY_SIZE(iov), timeout)) != 0) {
         goto mqtt_pub_exit;
     }
 
-    buf[0]             = 0;    // This will hold the data we receive
+    sndstr[0]          = 0;    // This will hold the data we receive
     wait_msgs.num_msgs = 0;    // Initialize the structure
     wifi_add_wait_msg(&wait_msgs, "\r\nOK\r\n", true, 0);
     wifi_add_wait_msg(&wait_msgs, "\r\nERROR:%19s\r\n", true, 1, errorstr);
-    wifi_add_wait_msg(&wait_msgs, "+NWMQMSGSND:%20s", true, 1, buf);
+    wifi_add_wait_msg(&wait_msgs, "+NWMQMSGSND:%20s", true, 1, sndstr);
     while (!OUT_OF_TIME(timeout, timepoint)) {
         int ret = wifi_wait_for(&wait_msgs, timeout);
         if (ret < 0) {
@@ -1215,12 +1411,12 @@ int wifi_mqtt_publish(uint16_t message_type, char *msg, bool wait_for_send_conf,
             break;
         }
         if (ret == 2) {
-            if (buf[0] == '1') {
+            if (sndstr[0] == '1') {
                 // success
                 result = 0;
             } else {
                 // "0,<errcode>"
-                result = strtol(buf + 2, NULL, 10);
+                result = strtol(sndstr + 2, NULL, 10);
                 if (result > 0) {
                     result = -result;
                 }
@@ -1230,9 +1426,6 @@ int wifi_mqtt_publish(uint16_t message_type, char *msg, bool wait_for_send_conf,
     }
 
 mqtt_pub_exit:
-    if (buf != NULL) {
-        k_free(buf);
-    }
     wifi_release_mutex();
     return result;
 }
@@ -2578,29 +2771,6 @@ int wifi_initiate_connect_to_ssid(char *ssid, char *key, int sec, int keyidx, in
     return ret;
 }
 
-typedef struct
-{
-    int scan_idx;
-    int comparison_score;
-} qsort_ssids_t;
-#define NO_SCORE (-300)
-
-static qsort_ssids_t sorted_ssids[MAX_SAVED_SSIDS + 1];
-static wifi_arr_t   *wifis;
-// This is a comparison function for qsort.  It will sort
-// the elements based on their comparison_score.
-static int comp(const void *elem1, const void *elem2)
-{
-    qsort_ssids_t *f = (qsort_ssids_t *)elem1;
-    qsort_ssids_t *s = (qsort_ssids_t *)elem2;
-
-    if (f->comparison_score > s->comparison_score)
-        return -1;
-    if (f->comparison_score < s->comparison_score)
-        return 1;
-    return 0;
-}
-
 /////////////////////////////////////////////////////////
 // wifi_check_for_known_ssid
 //
@@ -2617,52 +2787,33 @@ static int comp(const void *elem1, const void *elem2)
 int wifi_check_for_known_ssid()
 {
     shadow_zone_t zones[MAX_SAVED_SSIDS];
-    int           widx;
-    wifis   = wifi_get_last_ssid_list();
+    int           best       = -1;
+    int           best_score = 0;
+
+    // Makes sure the known SSIDs have been read from the DA
     int ret = wifi_get_ap_list(zones, K_SECONDS(1));
     if (ret < 0) {
         LOG_ERR("Failed to get the SSID list");
         return -1;
     }
+    if (!scan_zones_valid) {
+        scan_match_zones();
+    }
 
-    // Make a copy of the known SSIDs list that are also in the last
-    // ssid scan
-
-    // Set the comparison score to the rssi found and add 100 to that
-    // so that the safe known SSIDs will have a higher score then
-    // non-safe ones
-
-    // We call qsort() to sort based on comparison_score
-
-    // Once sorted, the SSID at the top of the sorted list is the
-    // the safest known SSID with the strongest RSSI.
-    int ssids_in_scan = 0;
-    for (int i = 0; i < MAX_SAVED_SSIDS; i++) {
-        if (zones[i].ssid[0] != 0) {
-            widx = wifi_find_ssid_in_scan(zones[i].ssid);
-            if (widx >= 0) {
-                sorted_ssids[ssids_in_scan].scan_idx         = widx;
-                sorted_ssids[ssids_in_scan].comparison_score = wifis->wifi[widx].rssi;
-                if (zones[i].safe) {
-                    sorted_ssids[ssids_in_scan].comparison_score += 100;
-                }
-                ssids_in_scan++;
+    // Every AP already knows which known SSID it is. Score them by
+    // rssi, adding 100 for the safe ones so that they win over
+    // non-safe ones, and take the highest
+    for (int i = 0; i < g_last_ssid_list.count; i++) {
+        int zone = scan_meta[i].zone;
+        if (zone >= 0) {
+            int score = g_last_ssid_list.wifi[i].rssi + (cached_zones[zone].safe ? 100 : 0);
+            if (best < 0 || score > best_score) {
+                best       = zone;
+                best_score = score;
             }
         }
     }
-
-    // Sort by is_safe and rssi
-    qsort(sorted_ssids, ssids_in_scan, sizeof(qsort_ssids_t), comp);
-
-    // return the index into the known ssid list of the first entry in the
-    // sorted ssid list
-    if (ssids_in_scan > 0) {
-        widx = sorted_ssids[0].scan_idx;
-        return wifi_find_saved_ssid(wifis->wifi[widx].ssid);
-    }
-
-    // No known SSIDs were found in the scan
-    return -1;
+    return best;
 }
 
 static void add_to_list(char *line, shadow_zone_t *zones)
@@ -2689,13 +2840,12 @@ static void add_to_list(char *line, shadow_zone_t *zones)
     }
 }
 
-static shadow_zone_t cached_zones[MAX_SAVED_SSIDS];
-static bool          cached_zones_valid = false;
 /////////////////////////////////////////////////////////
 int wifi_add_SSID_to_cached_list(char *line)
 {
     add_to_list(line, cached_zones);
     cached_zones_valid = true;
+    scan_zones_valid   = false;
     return 0;
 }
 /////////////////////////////////////////////////////////
@@ -2807,6 +2957,7 @@ int wifi_get_ap_list(shadow_zone_t *zones, k_timeout_t timeout)
     if (got_list) {
         memcpy(cached_zones, zones, sizeof(shadow_zone_t) * MAX_SAVED_SSIDS);
         cached_zones_valid = true;
+        scan_zones_valid   = false;
     }
 aplist_exit:
     wifi_release_mutex();
@@ -2950,6 +3101,7 @@ int wifi_saved_ssids_add(
     cached_zones[idx].safe = safe;
     strncpy(cached_zones[idx].ssid, name, 32);
     cached_zones[idx].ssid[32] = 0;
+    scan_zones_valid           = false;
 
     return 0;
 }
@@ -2985,6 +3137,7 @@ int wifi_saved_ssids_del(int idx, k_timeout_t timeout)
 
     cached_zones[idx].ssid[0] = 0;
     cached_zones[idx].safe    = false;
+    scan_zones_valid          = false;
 
     return 0;
 }
@@ -3021,6 +3174,7 @@ void wifi_clear_local_ssid_list()
     for (int idx = 0; idx < MAX_SAVED_SSIDS; idx++) {
         cached_zones[idx].ssid[0] = 0;
         cached_zones[idx].safe    = false;
+        scan_zones_valid          = false;
     }
 }
 
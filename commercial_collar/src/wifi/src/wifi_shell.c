@@ -493,26 +493,17 @@ static int do_heap(const struct shell *sh, size_t argc, char **argv)
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
 
-#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
-    extern struct k_heap    wifi_heap;
-    int                     err;
-    struct sys_memory_stats stats;
+    wifi_rx_stats_t stats;
 
-    err = sys_heap_runtime_stats_get(&wifi_heap.heap, &stats);
-    if (err) {
-        shell_error(sh, "Failed to read kernel system heap statistics (err %d)", err);
-        return -ENOEXEC;
-    }
-
-    shell_print(sh, "free:           %zu", stats.free_bytes);
-    shell_print(sh, "allocated:      %zu", stats.allocated_bytes);
-    shell_print(sh, "max. allocated: %zu", stats.max_allocated_bytes);
+    wifi_get_rx_stats(&stats);
+    shell_print(sh, "ring size:      %d", WIFI_RX_RING_SIZE);
+    shell_print(sh, "in use:         %u", stats.ring_used);
+    shell_print(sh, "max. in use:    %u", stats.ring_peak);
+    shell_print(sh, "dropped:        %u", stats.dropped);
+    shell_print(sh, "evicted:        %u", stats.evicted);
+    shell_print(sh, "stale:          %u", stats.stale);
 
     return 0;
-#else
-    shell_error(sh, "Unable to get heap statistics: enable CONFIG_SYS_HEAP_RUNTIME_STATS");
-    return 1;
-#endif
 }
 
 /////////////////////////////////////////////////////////
@@ -1073,11 +1064,13 @@ void do_json_print(const struct shell *sh, size_t argc, char **argv)
             k_fifo_put(&ssids_fifo, &(list->wifi[i]));
         }
 
-        int loop_count = 0;
-        int ret        = 1;    // just wait, you'll see
+        size_t json_len   = 0;
+        int    loop_count = 0;
+        int    ret        = 1;    // just wait, you'll see
         while (ret > 0) {
             ret = json_telemetry(
                 &json,
+                &json_len,
                 machine_id,
                 fuel,
                 get_charging_active(),
@@ -1091,7 +1084,8 @@ void do_json_print(const struct shell *sh, size_t argc, char **argv)
                 -1);
             loop_count++;
             if (json != NULL) {
-                shell_print(sh, "telemetry json is %s", json);
+                shell_print(sh, "telemetry json is (%zu bytes) %s", json_len, json);
+                json_telemetry_commit(json_telemetry_hold());
             } else {
                 shell_error(sh, "Failed to create json");
             }
@@ -1545,6 +1539,7 @@ void do_sort_test(const struct shell *sh, size_t argc, char **argv)
     set_wo(6, "SSID7", "M7", -110.0, "F", 4);
     set_wo(7, "SSID8", "M8", -120.0, "F", 4);
     g_last_ssid_list.count = 8;
+    wifi_scan_reindex();
     print_wo_list(sh, "Scan results 1");
     ret = wifi_check_for_known_ssid();
     if (ret != 0) {
@@ -86,26 +86,30 @@ static const struct device *spidev;
 // Write a at AT/ESC request to the DA16200.
 //
 //  @param type - command type
-//  @param data - pointer to buffer containing the data to write
-//  @param size - size of the data to write
+//  @param iov - the pieces of the data to write, in order
+//  @param iov_cnt - number of pieces
 static int
-da_spi_write_rqst(uint32_t type, char *data, uint32_t len)
+da_spi_write_rqst(uint32_t type, const wifi_iov_t *iov, int iov_cnt)
 {
-    int      err;
-    char    *four_byte_align_buf[4];
-    uint32_t len_aligned  = ((len / 4) + 1) * 4;
-    uint32_t len_trucated = len_aligned - 4;
-    if (len_trucated != len_aligned) {
-        // The data needs to be 4 byte aligned and if it isn't the
-        // data needs to be 0 terminated so the da can tell where
-        // it ends. However the data ptr passed in may be on the stack
-        // and so we can't just write 0s after it's end.  Since spi_write()
-        // sends a array of buffers, we copy the last 1-3 bytes of the
-        // data to a zero filled 4 byte buffer and send the original
-        // data, less 1-3 bytes, followed by our 4 byte buffer
-        memset(four_byte_align_buf, 0, 4);
-        memcpy(four_byte_align_buf, &data[len_trucated], len - len_trucated);
+    int                  err;
+    static const uint8_t zeros[4] = { 0 };
+    struct spi_buf       tx_buf[WIFI_MAX_IOV + 2];
+    uint32_t             len = 0;
+
+    if (iov_cnt < 1 || iov_cnt > WIFI_MAX_IOV) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < iov_cnt; i++) {
+        tx_buf[i + 1].buf = (void *)iov[i].data;
+        tx_buf[i + 1].len = iov[i].len;
+        len += iov[i].len;
     }
+    // The data needs to be 4 byte aligned and 0 terminated so the
+    // da can tell where it ends. However the data may be on the
+    // stack or part of something bigger, so we can't just write 0s
+    // after its end.  Since spi_write() sends a array of buffers,
+    // the 1-4 zeros go out from a buffer of our own.
+    uint32_t len_aligned = ((len / 4) + 1) * 4;
 
     da_header_t header = {
         .addr_type =
@@ -116,39 +120,16 @@ da_spi_write_rqst(uint32_t type, char *data, uint32_t len)
         .length[2] = len_aligned & 0xFF,
     };
 
-    const struct spi_buf tx_buf_exact[] = {
-        {
-            .buf = &header,
-            .len = sizeof(da_header_t),
-        },
-        {
-            .buf = data,
-            .len = len_aligned,
-        },
+    tx_buf[0].buf                = &header;
+    tx_buf[0].len                = sizeof(da_header_t);
+    tx_buf[iov_cnt + 1].buf      = (void *)zeros;
+    tx_buf[iov_cnt + 1].len      = len_aligned - len;
+    const struct spi_buf_set tx = {
+        .buffers = tx_buf,
+        .count   = iov_cnt + 2,
     };
-    const struct spi_buf tx_buf[] = {
-        {
-            .buf = &header,
-            .len = sizeof(da_header_t),
-        },
-        {
-            .buf = data,
-            .len = len_trucated,
-        },
-        {
-            .buf = four_byte_align_buf,
-            .len = len_aligned - len_trucated,
-        },
-    };
-
-    DEF_BUF_SET(tx, tx_buf);
-    DEF_BUF_SET(txe, tx_buf_exact);
 
-    if (len == len_aligned) {
-        err = spi_write(spidev, &spi_cfg, &txe);
-    } else {
-        err = spi_write(spidev, &spi_cfg, &tx);
-    }
+    err = spi_write(spidev, &spi_cfg, &tx);
     if (err) {
         LOG_ERR("'%s'(%d) on SPI write", wstrerr(-err), err);
         return err;
@@ -473,8 +454,26 @@ wifi_spi_init(void)
 int
 wifi_spi_send(char *data)
 {
-    int len = strlen(data);
-    int err = da_spi_write_rqst(ATCMD_ADDR, data, len);
+    wifi_iov_t iov = { .data = data, .len = strlen(data) };
+
+    return wifi_spi_sendv(&iov, 1);
+}
+
+//////////////////////////////////////////////////////////
+// wifi_spi_sendv
+//
+// Write an AT command made of several pieces to the
+// DA16200 in one transfer.
+//
+//  @param iov - the pieces of the command, in order
+//  @param iov_cnt - number of pieces, at most WIFI_MAX_IOV
+//
+//  @return - 0 on success,
+//           -errno on error
+int
+wifi_spi_sendv(const wifi_iov_t *iov, int iov_cnt)
+{
+    int err = da_spi_write_rqst(ATCMD_ADDR, iov, iov_cnt);
     if (err) {
         LOG_ERR("failed to write AT_cmd");
         return err;
@@ -32,6 +32,16 @@ typedef struct
     modem_status_t status;
 } modem_status_update_t;
 
+// What a listener did with the messages of one channel.  Listeners
+// copy into preallocated slots, so a burst either merges into the
+// slot still waiting for its work item or is dropped.
+typedef struct
+{
+    uint32_t published;    // times the listener was called
+    uint32_t coalesced;    // merged into a message not yet handled
+    uint32_t dropped;      // lost because the queue was full
+} zbus_listener_stats_t;
+
 ZBUS_CHAN_DECLARE(
     MQTT_DEV_TO_CLOUD_MESSAGE,
     MQTT_CLOUD_TO_DEV_MESSAGE,
@@ -0,0 +1,64 @@
+/* Public extensions of the LSM6DSV16X_D1 6-axis IMU sensor driver
+ *
+ * Copyright (c) 2024 Culvert Engineering
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_DRIVERS_SENSOR_LSM6DSV16X_D1_H_
+#define ZEPHYR_INCLUDE_DRIVERS_SENSOR_LSM6DSV16X_D1_H_
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* current activity/inactivity state (val1 != 0 means sleeping) */
+#define SENSOR_ATTR_SLEEP_STATE		(SENSOR_ATTR_PRIV_START + 1)
+
+/* FIFO watermark, in accel+gyro frames (val1) */
+#define SENSOR_ATTR_FIFO_WATERMARK	(SENSOR_ATTR_PRIV_START + 2)
+
+/* FIFO level reached the watermark */
+#define SENSOR_TRIG_FIFO_WTM		(SENSOR_TRIG_PRIV_START + 1)
+
+/* one accel+gyro sample pair, in raw sensor counts */
+struct lsm6dsv16x_frame {
+	int16_t acc[3];
+	int16_t gyro[3];
+};
+
+/**
+ * lsm6dsv16x_sample_read - read the latest accel and gyro output in one transfer
+ *
+ * Equivalent to fetching SENSOR_CHAN_ACCEL_XYZ and SENSOR_CHAN_GYRO_XYZ, but the
+ * counts are returned raw rather than as struct sensor_value.
+ */
+int lsm6dsv16x_sample_read(const struct device *dev, struct lsm6dsv16x_frame *frame);
+
+/**
+ * lsm6dsv16x_fifo_read - drain up to max_frames from the on-die FIFO
+ *
+ * The FIFO words are read in bursts, so a full watermark costs a couple of
+ * bus transactions instead of two per sample.
+ *
+ * @return number of frames written to frames, or a negative errno
+ */
+int lsm6dsv16x_fifo_read(const struct device *dev, struct lsm6dsv16x_frame *frames,
+			 uint16_t max_frames);
+
+/**
+ * lsm6dsv16x_sensitivity_get - current scale of the raw counts
+ *
+ * @param acc_ug   accelerometer sensitivity in ug/LSB
+ * @param gyro_udps gyroscope sensitivity in udps/LSB
+ */
+int lsm6dsv16x_sensitivity_get(const struct device *dev, uint32_t *acc_ug, uint32_t *gyro_udps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZEPHYR_INCLUDE_DRIVERS_SENSOR_LSM6DSV16X_D1_H_ */
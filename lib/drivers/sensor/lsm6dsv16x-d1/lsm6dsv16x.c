@@ -145,6 +145,14 @@ static int lsm6dsv16x_accel_set_odr_raw(const struct device *dev, uint8_t odr)
 
 	data->accel_freq = odr;
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	/* keep batching in step with the output data rate */
+	if (data->fifo_enabled &&
+	    lsm6dsv16x_fifo_xl_batch_set(ctx, (lsm6dsv16x_fifo_xl_batch_t)odr) < 0) {
+		return -EIO;
+	}
+#endif
+
 	return 0;
 }
 
@@ -164,11 +172,21 @@ static int lsm6dsv16x_gyro_set_odr_raw(const struct device *dev, uint8_t odr)
 {
 	const struct lsm6dsv16x_config *cfg = dev->config;
 	stmdev_ctx_t *ctx = (stmdev_ctx_t *)&cfg->ctx;
+	struct lsm6dsv16x_data *data = dev->data;
 
 	if (lsm6dsv16x_gy_data_rate_set(ctx, odr) < 0) {
 		return -EIO;
 	}
 
+	data->gyro_freq = odr;
+
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	if (data->fifo_enabled &&
+	    lsm6dsv16x_fifo_gy_batch_set(ctx, (lsm6dsv16x_fifo_gy_batch_t)odr) < 0) {
+		return -EIO;
+	}
+#endif
+
 	return 0;
 }
 
@@ -218,6 +236,18 @@ static int lsm6dsv16x_accel_config(const struct device *dev,
 	stmdev_ctx_t *ctx = (stmdev_ctx_t *)&cfg->ctx;
 	lsm6dsv16x_xl_mode_t mode;
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	if ((int)attr == SENSOR_ATTR_FIFO_WATERMARK) {
+		data->fifo_wtm = CLAMP(val->val1, 1, 127);
+		/* the watermark counts FIFO words: one for accel and one for gyro */
+		if (data->fifo_enabled &&
+		    lsm6dsv16x_fifo_watermark_set(ctx, data->fifo_wtm * 2) < 0) {
+			return -EIO;
+		}
+		return 0;
+	}
+#endif
+
 	switch (attr) {
 	case SENSOR_ATTR_FULL_SCALE:
 		return lsm6dsv16x_accel_range_set(dev, sensor_ms2_to_g(val));
@@ -455,6 +485,29 @@ static int lsm6dsv16x_sample_fetch_gyro(const struct device *dev)
 	return 0;
 }
 
+int lsm6dsv16x_sample_read(const struct device *dev, struct lsm6dsv16x_frame *frame)
+{
+	const struct lsm6dsv16x_config *cfg = dev->config;
+	stmdev_ctx_t *ctx = (stmdev_ctx_t *)&cfg->ctx;
+	struct lsm6dsv16x_data *data = dev->data;
+	uint8_t buf[12];
+
+	/* OUTX_L_G .. OUTZ_H_A are contiguous: gyro x/y/z followed by accel x/y/z */
+	if (lsm6dsv16x_read_reg(ctx, LSM6DSV16X_OUTX_L_G, buf, sizeof(buf)) < 0) {
+		LOG_DBG("Failed to read sample");
+		return -EIO;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		data->gyro[i] = (int16_t)sys_get_le16(&buf[2 * i]);
+		data->acc[i] = (int16_t)sys_get_le16(&buf[6 + 2 * i]);
+		frame->gyro[i] = data->gyro[i];
+		frame->acc[i] = data->acc[i];
+	}
+
+	return 0;
+}
+
 #if defined(CONFIG_LSM6DSV16X_D1_ENABLE_TEMP)
 static int lsm6dsv16x_sample_fetch_temp(const struct device *dev)
 {
@@ -521,6 +574,108 @@ static int lsm6dsv16x_sample_fetch(const struct device *dev,
 	return 0;
 }
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+/* FIFO_DATA_OUT_TAG followed by 6 bytes of data */
+#define LSM6DSV16X_D1_FIFO_WORD_SIZE	7
+/* words per burst read; bounds the stack used by lsm6dsv16x_fifo_read() */
+#define LSM6DSV16X_D1_FIFO_BURST_WORDS	32
+
+static void lsm6dsv16x_fifo_emit(struct lsm6dsv16x_data *data,
+				 struct lsm6dsv16x_frame *frames, uint16_t *count)
+{
+	frames[(*count)++] = data->fifo_pending;
+	memset(&data->fifo_pending, 0, sizeof(data->fifo_pending));
+	data->fifo_pending_acc = false;
+	data->fifo_pending_gyro = false;
+}
+
+int lsm6dsv16x_fifo_read(const struct device *dev, struct lsm6dsv16x_frame *frames,
+			 uint16_t max_frames)
+{
+	const struct lsm6dsv16x_config *cfg = dev->config;
+	stmdev_ctx_t *ctx = (stmdev_ctx_t *)&cfg->ctx;
+	struct lsm6dsv16x_data *data = dev->data;
+	uint8_t buf[LSM6DSV16X_D1_FIFO_BURST_WORDS * LSM6DSV16X_D1_FIFO_WORD_SIZE];
+	lsm6dsv16x_fifo_status_t status;
+	uint16_t count = 0;
+	uint16_t level;
+
+	if (lsm6dsv16x_fifo_status_get(ctx, &status) < 0) {
+		LOG_DBG("failed reading fifo status");
+		return -EIO;
+	}
+
+	if (status.fifo_ovr) {
+		LOG_WRN("fifo overrun, samples lost");
+	}
+
+	level = status.fifo_level;
+	while (level > 0 && count < max_frames) {
+		/* every word completes at most one frame, so this can't overflow frames */
+		uint16_t words = MIN(level, MIN(LSM6DSV16X_D1_FIFO_BURST_WORDS,
+						max_frames - count));
+
+		/* the word address wraps back to FIFO_DATA_OUT_TAG, so one read drains
+		 * several words
+		 */
+		if (lsm6dsv16x_read_reg(ctx, LSM6DSV16X_FIFO_DATA_OUT_TAG, buf,
+					words * LSM6DSV16X_D1_FIFO_WORD_SIZE) < 0) {
+			LOG_DBG("failed reading fifo");
+			return -EIO;
+		}
+		level -= words;
+
+		for (uint16_t w = 0; w < words; w++) {
+			const uint8_t *word = &buf[w * LSM6DSV16X_D1_FIFO_WORD_SIZE];
+			int16_t *axis;
+
+			switch (word[0] >> 3) {
+			case LSM6DSV16X_XL_NC_TAG:
+				/* gyro is powered down while asleep, so frames can be
+				 * accel only
+				 */
+				if (data->fifo_pending_acc) {
+					lsm6dsv16x_fifo_emit(data, frames, &count);
+				}
+				axis = data->fifo_pending.acc;
+				data->fifo_pending_acc = true;
+				break;
+			case LSM6DSV16X_GY_NC_TAG:
+				if (data->fifo_pending_gyro) {
+					lsm6dsv16x_fifo_emit(data, frames, &count);
+				}
+				axis = data->fifo_pending.gyro;
+				data->fifo_pending_gyro = true;
+				break;
+			default:
+				/* timestamp, temperature, ... are not batched */
+				continue;
+			}
+
+			for (int i = 0; i < 3; i++) {
+				axis[i] = (int16_t)sys_get_le16(&word[1 + 2 * i]);
+			}
+
+			if (data->fifo_pending_acc && data->fifo_pending_gyro) {
+				lsm6dsv16x_fifo_emit(data, frames, &count);
+			}
+		}
+	}
+
+	return count;
+}
+#endif /* CONFIG_LSM6DSV16X_D1_FIFO */
+
+int lsm6dsv16x_sensitivity_get(const struct device *dev, uint32_t *acc_ug, uint32_t *gyro_udps)
+{
+	struct lsm6dsv16x_data *data = dev->data;
+
+	*acc_ug = data->acc_gain;
+	*gyro_udps = data->gyro_gain;
+
+	return 0;
+}
+
 static inline void lsm6dsv16x_accel_convert(struct sensor_value *val, int raw_val,
 					 uint32_t sensitivity)
 {
@@ -936,6 +1091,9 @@ static int lsm6dsv16x_init(const struct device *dev)
 	data->sleep_thresh = CONFIG_LSM6DSV16X_D1_SLEEP_THRESHOLD;
 	data->sleep_dur = CONFIG_LSM6DSV16X_D1_SLEEP_DURATION;
 #endif
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	data->fifo_wtm = CONFIG_LSM6DSV16X_D1_FIFO_WATERMARK;
+#endif
 
 #ifdef CONFIG_LSM6DSV16X_D1_TRIGGER
 	if (cfg->trig_enabled) {
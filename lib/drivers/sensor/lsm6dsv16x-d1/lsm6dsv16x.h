@@ -16,6 +16,7 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/sys/util.h>
 #include <stmemsc.h>
+#include <drivers/sensor/lsm6dsv16x_d1.h>
 #include "lsm6dsv16x_reg.h"
 
 #if DT_ANY_INST_ON_BUS_STATUS_OKAY(spi)
@@ -103,11 +104,19 @@ struct lsm6dsv16x_data {
 	uint8_t gyro_fs;
 #if defined(CONFIG_LSM6DSV16X_D1_ENABLE_MOTION)
 	uint8_t sleep_state;
-#define SENSOR_ATTR_SLEEP_STATE (SENSOR_ATTR_PRIV_START + 1)
 	uint8_t sleep_dur;
 	uint8_t sleep_thresh;
 #endif
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	bool fifo_enabled;
+	uint8_t fifo_wtm;
+	/* half of a frame left over from the previous fifo read */
+	struct lsm6dsv16x_frame fifo_pending;
+	bool fifo_pending_acc;
+	bool fifo_pending_gyro;
+#endif
+
 #ifdef CONFIG_LSM6DSV16X_D1_TRIGGER
 	struct gpio_dt_spec *drdy_gpio;
 
@@ -120,6 +129,10 @@ struct lsm6dsv16x_data {
 	const struct sensor_trigger *trig_drdy_temp;
 	sensor_trigger_handler_t handler_motion;
 	const struct sensor_trigger *trig_motion;
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	sensor_trigger_handler_t handler_fifo;
+	const struct sensor_trigger *trig_fifo;
+#endif
 
 #if defined(CONFIG_LSM6DSV16X_D1_TRIGGER_OWN_THREAD)
 	K_KERNEL_STACK_MEMBER(thread_stack, CONFIG_LSM6DSV16X_D1_THREAD_STACK_SIZE);
@@ -14,6 +14,7 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
+#include <string.h>
 
 #include "lsm6dsv16x.h"
 
@@ -83,7 +84,7 @@ static int lsm6dsv16x_enable_xl_int(const struct device *dev, int enable)
 			return ret;
 		}
 
-		val.drdy_xl = 1;
+		val.drdy_xl = enable;
 
 		ret = lsm6dsv16x_pin_int1_route_set(ctx, &val);
 	} else {
@@ -95,7 +96,7 @@ static int lsm6dsv16x_enable_xl_int(const struct device *dev, int enable)
 			return ret;
 		}
 
-		val.drdy_xl = 1;
+		val.drdy_xl = enable;
 
 		ret = lsm6dsv16x_pin_int2_route_set(ctx, &val);
 	}
@@ -129,7 +130,7 @@ static int lsm6dsv16x_enable_g_int(const struct device *dev, int enable)
 			return ret;
 		}
 
-		val.drdy_g = 1;
+		val.drdy_g = enable;
 
 		ret = lsm6dsv16x_pin_int1_route_set(ctx, &val);
 	} else {
@@ -141,7 +142,7 @@ static int lsm6dsv16x_enable_g_int(const struct device *dev, int enable)
 			return ret;
 		}
 
-		val.drdy_g = 1;
+		val.drdy_g = enable;
 
 		ret = lsm6dsv16x_pin_int2_route_set(ctx, &val);
 	}
@@ -149,6 +150,64 @@ static int lsm6dsv16x_enable_g_int(const struct device *dev, int enable)
 	return ret;
 }
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+/**
+ * lsm6dsv16x_enable_fifo_int - FIFO watermark enable selected int pin to generate interrupt
+ */
+static int lsm6dsv16x_enable_fifo_int(const struct device *dev, int enable)
+{
+	const struct lsm6dsv16x_config *cfg = dev->config;
+	struct lsm6dsv16x_data *lsm6dsv16x = dev->data;
+	stmdev_ctx_t *ctx = (stmdev_ctx_t *)&cfg->ctx;
+	lsm6dsv16x_pin_int_route_t val;
+	int ret;
+
+	if (enable) {
+		/* batch both sensors at their current rate, stream mode keeps the newest data */
+		CHECK_OK(lsm6dsv16x_fifo_watermark_set(ctx, lsm6dsv16x->fifo_wtm * 2));
+		CHECK_OK(lsm6dsv16x_fifo_xl_batch_set(ctx,
+			(lsm6dsv16x_fifo_xl_batch_t)lsm6dsv16x->accel_freq));
+		CHECK_OK(lsm6dsv16x_fifo_gy_batch_set(ctx,
+			(lsm6dsv16x_fifo_gy_batch_t)lsm6dsv16x->gyro_freq));
+		CHECK_OK(lsm6dsv16x_fifo_mode_set(ctx, LSM6DSV16X_STREAM_MODE));
+	} else {
+		/* bypass mode also empties the fifo */
+		CHECK_OK(lsm6dsv16x_fifo_mode_set(ctx, LSM6DSV16X_BYPASS_MODE));
+		CHECK_OK(lsm6dsv16x_fifo_xl_batch_set(ctx, LSM6DSV16X_XL_NOT_BATCHED));
+		CHECK_OK(lsm6dsv16x_fifo_gy_batch_set(ctx, LSM6DSV16X_GY_NOT_BATCHED));
+	}
+	lsm6dsv16x->fifo_enabled = enable;
+	memset(&lsm6dsv16x->fifo_pending, 0, sizeof(lsm6dsv16x->fifo_pending));
+	lsm6dsv16x->fifo_pending_acc = false;
+	lsm6dsv16x->fifo_pending_gyro = false;
+
+	/* set interrupt */
+	if (cfg->drdy_pin == 1) {
+		ret = lsm6dsv16x_pin_int1_route_get(ctx, &val);
+		if (ret < 0) {
+			LOG_ERR("pint_int1_route_get error");
+			return ret;
+		}
+
+		val.fifo_th = enable;
+
+		ret = lsm6dsv16x_pin_int1_route_set(ctx, &val);
+	} else {
+		ret = lsm6dsv16x_pin_int2_route_get(ctx, &val);
+		if (ret < 0) {
+			LOG_ERR("pint_int2_route_get error");
+			return ret;
+		}
+
+		val.fifo_th = enable;
+
+		ret = lsm6dsv16x_pin_int2_route_set(ctx, &val);
+	}
+
+	return ret;
+}
+#endif
+
 int lsm6dsv16x_cfg_access(const struct device *dev, uint8_t access)
 {
 	int ret = 0;
@@ -308,6 +367,17 @@ int lsm6dsv16x_trigger_set(const struct device *dev,
 		return lsm6dsv16x_set_motion(dev, handler);
 	}
 #endif
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	else if ((int)trig->type == SENSOR_TRIG_FIFO_WTM) {
+		lsm6dsv16x->handler_fifo = handler;
+		lsm6dsv16x->trig_fifo = trig;
+		if (handler) {
+			return lsm6dsv16x_enable_fifo_int(dev, LSM6DSV16X_D1_EN_BIT);
+		} else {
+			return lsm6dsv16x_enable_fifo_int(dev, LSM6DSV16X_D1_DIS_BIT);
+		}
+	}
+#endif
 
 	return -ENOTSUP;
 }
@@ -326,6 +396,10 @@ static void lsm6dsv16x_handle_interrupt(const struct device *dev)
 		uint8_t val;
 		lsm6dsv16x_data_ready_t bits;
 	} status;
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+	/* fifo level when the fifo handler was last called */
+	uint16_t fifo_level = UINT16_MAX;
+#endif
 
 	while (1) {
 		if (lsm6dsv16x_flag_data_ready_get(ctx, &status.bits) < 0) {
@@ -342,6 +416,46 @@ static void lsm6dsv16x_handle_interrupt(const struct device *dev)
 		lsm6dsv16x_read_reg(ctx, LSM6DSV16X_ALL_INT_SRC, (uint8_t *)&all_status, 1);
 		is_motion_interrupt = all_status.bits.sleep_change_ia;
 #endif
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+		bool is_fifo_interrupt = false;
+
+		if (lsm6dsv16x->handler_fifo != NULL) {
+			lsm6dsv16x_fifo_status_t fifo_status;
+
+			if (lsm6dsv16x_fifo_status_get(ctx, &fifo_status) < 0) {
+				LOG_DBG("failed reading fifo status reg");
+				return;
+			}
+			is_fifo_interrupt = fifo_status.fifo_th;
+			if (is_fifo_interrupt && fifo_status.fifo_level >= fifo_level) {
+				/* the handler drained nothing, its lsm6dsv16x_fifo_read()
+				 * failed. Empty the fifo (bypass mode does that) so the
+				 * watermark is cleared and the next one gives a new edge,
+				 * rather than calling the handler again and again
+				 */
+				LOG_ERR("fifo not drained, dropping %d words",
+					fifo_status.fifo_level);
+				lsm6dsv16x_fifo_mode_set(ctx, LSM6DSV16X_BYPASS_MODE);
+				lsm6dsv16x_fifo_mode_set(ctx, LSM6DSV16X_STREAM_MODE);
+				memset(&lsm6dsv16x->fifo_pending, 0,
+				       sizeof(lsm6dsv16x->fifo_pending));
+				lsm6dsv16x->fifo_pending_acc = false;
+				lsm6dsv16x->fifo_pending_gyro = false;
+				is_fifo_interrupt = false;
+			}
+			fifo_level = is_fifo_interrupt ? fifo_status.fifo_level : UINT16_MAX;
+		}
+
+		/* while batching nobody reads the output registers, so the data ready
+		 * flags stay set and must not keep us in this loop
+		 */
+		if (lsm6dsv16x->handler_drdy_acc == NULL) {
+			status.bits.drdy_xl = 0;
+		}
+		if (lsm6dsv16x->handler_drdy_gyr == NULL) {
+			status.bits.drdy_gy = 0;
+		}
+#endif
 
 		if ((status.bits.drdy_xl == 0) && (status.bits.drdy_gy == 0)
 #if defined(CONFIG_LSM6DSV16X_D1_ENABLE_TEMP)
@@ -349,6 +463,9 @@ static void lsm6dsv16x_handle_interrupt(const struct device *dev)
 #endif
 #if defined(CONFIG_LSM6DSV16X_D1_ENABLE_MOTION)
 					&& !is_motion_interrupt
+#endif
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+					&& !is_fifo_interrupt
 #endif
 					) {
 			break;
@@ -377,6 +494,13 @@ static void lsm6dsv16x_handle_interrupt(const struct device *dev)
 			lsm6dsv16x->handler_drdy_gyr(dev, lsm6dsv16x->trig_drdy_gyr);
 		}
 
+#if defined(CONFIG_LSM6DSV16X_D1_FIFO)
+		if (is_fifo_interrupt) {
+			/* handler is expected to drain the fifo with lsm6dsv16x_fifo_read() */
+			lsm6dsv16x->handler_fifo(dev, lsm6dsv16x->trig_fifo);
+		}
+#endif
+
 	}
 
 	gpio_pin_interrupt_configure_dt(lsm6dsv16x->drdy_gpio,
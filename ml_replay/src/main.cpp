@@ -0,0 +1,334 @@
+/* Copyright (c) 2024, Nestle Purina Pet Care. All rights reserved */
+
+/*
+ * Replay IMU captures through the ML library on the build host.
+ *
+ * The captures are the /lfs1/imuN.dat files the collar writes with CONFIG_ML_CAPTURE_IMU_DATA:
+ * a plain sequence of IMUData records. They are fed to processIMUData() back to back, as
+ * fast as the host allows, and the run reports throughput, inference latency, the heap
+ * high-water mark of the library and, given a golden file, how the results differ from it.
+ *
+ *   zephyr.exe -testargs [-w golden.csv | -g golden.csv] [-n repeat] imu0.dat [imu1.dat ...]
+ *
+ * -w writes the results of this run as the new golden file, -g compares against one.
+ */
+
+#include <zephyr/kernel.h>
+#include <posix_board_if.h>
+#include <cmdline.h>
+
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "baseLib.hpp"
+
+// the captures are written straight from the target's IMUData, which has no padding there
+static_assert(sizeof(IMUData) == 32, "IMUData layout does not match the capture files");
+
+typedef struct
+{
+    int      activity;
+    float    probability;
+    float    reps;
+    uint64_t start;
+    uint64_t end;
+} replay_result_t;
+
+static std::vector<replay_result_t> m_results;
+static std::vector<uint32_t>        m_infer_us;    // latency of the calls that produced a result
+static bool                         m_got_result;
+
+static size_t m_heap_used;
+static size_t m_heap_peak;
+static size_t m_heap_allocs;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+*****************************
+Required functions for ML library
+*****************************
+*/
+// every block carries its size in front, so ei_free() can keep the count right
+typedef union
+{
+    size_t      size;
+    max_align_t align;
+} heap_hdr_t;
+
+void *ei_malloc(size_t size)
+{
+    heap_hdr_t *hdr = (heap_hdr_t *)malloc(sizeof(heap_hdr_t) + size);
+
+    if (hdr == NULL) {
+        return NULL;
+    }
+    hdr->size = size;
+    m_heap_used += size;
+    m_heap_allocs++;
+    m_heap_peak = std::max(m_heap_peak, m_heap_used);
+    return hdr + 1;
+}
+
+void *ei_calloc(size_t nitems, size_t size)
+{
+    void *ptr = ei_malloc(nitems * size);
+
+    if (ptr) {
+        memset(ptr, 0, nitems * size);
+    }
+    return ptr;
+}
+
+void ei_free(void *ptr)
+{
+    if (ptr) {
+        heap_hdr_t *hdr = (heap_hdr_t *)ptr - 1;
+        m_heap_used -= hdr->size;
+        free(hdr);
+    }
+}
+
+uint64_t ei_read_timer_ms()
+{
+    return now_us() / 1000;
+}
+
+uint64_t ei_read_timer_us()
+{
+    return now_us();
+}
+
+static void handle_result(InferResult result)
+{
+    replay_result_t r = {
+        .activity    = result.pred_class,
+        .probability = result.pred_probability,
+        .reps        = result.pred_reps,
+        .start       = result.start_timestamp,
+        .end         = result.end_timestamp,
+    };
+
+    m_results.push_back(r);
+    m_got_result = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// feed one capture file, returns the number of samples or -1
+static long replay_file(const char *fname, uint64_t *busy_us)
+{
+    FILE   *fp = fopen(fname, "rb");
+    IMUData sample;
+    long    count = 0;
+
+    if (fp == NULL) {
+        printf("Unable to open %s\n", fname);
+        return -1;
+    }
+    // a capture starts a new recording, so don't let windows run across files
+    resetActivityWindowCounter();
+    while (fread(&sample, sizeof(sample), 1, fp) == 1) {
+        uint64_t start = now_us();
+
+        m_got_result = false;
+        processIMUData(sample);
+        uint64_t took = now_us() - start;
+        *busy_us += took;
+        if (m_got_result) {
+            m_infer_us.push_back((uint32_t)took);
+        }
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, int pct)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[(sorted.size() - 1) * pct / 100];
+}
+
+static int write_golden(const char *fname)
+{
+    FILE *fp = fopen(fname, "w");
+
+    if (fp == NULL) {
+        printf("Unable to create %s\n", fname);
+        return -1;
+    }
+    fprintf(fp, "# %s\n", getVersion());
+    for (const replay_result_t &r : m_results) {
+        fprintf(fp, "%llu,%llu,%d,%f,%f\n", (unsigned long long)r.start, (unsigned long long)r.end, r.activity, r.probability, r.reps);
+    }
+    fclose(fp);
+    printf("Wrote %zu results to %s\n", m_results.size(), fname);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compare the results with a golden file, window by window in order
+static int compare_golden(const char *fname)
+{
+    FILE                        *fp = fopen(fname, "r");
+    std::vector<replay_result_t> golden;
+    char                         line[128];
+    int                          golden_count[ACTIVITY_CLASS_COUNT] = { 0 };
+    int                          replay_count[ACTIVITY_CLASS_COUNT] = { 0 };
+    int                          match_count[ACTIVITY_CLASS_COUNT]  = { 0 };
+    float                        max_prob_diff                      = 0;
+    float                        max_reps_diff                      = 0;
+    int                          mismatches                         = 0;
+
+    if (fp == NULL) {
+        printf("Unable to open %s\n", fname);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long start, end;
+        replay_result_t    r;
+
+        if (line[0] == '#') {
+            printf("Golden results from %s", line + 2);
+            continue;
+        }
+        if (sscanf(line, "%llu,%llu,%d,%f,%f", &start, &end, &r.activity, &r.probability, &r.reps) == 5) {
+            r.start = start;
+            r.end   = end;
+            golden.push_back(r);
+        }
+    }
+    fclose(fp);
+
+    size_t common = std::min(golden.size(), m_results.size());
+    for (size_t i = 0; i < common; i++) {
+        const replay_result_t &g = golden[i];
+        const replay_result_t &r = m_results[i];
+
+        if (g.activity == r.activity) {
+            match_count[g.activity % ACTIVITY_CLASS_COUNT]++;
+            max_prob_diff = std::max(max_prob_diff, fabsf(g.probability - r.probability));
+            max_reps_diff = std::max(max_reps_diff, fabsf(g.reps - r.reps));
+        } else {
+            if (mismatches++ < 20) {
+                printf(
+                    "  window %zu [%llu - %llu]: %s -> %s\n",
+                    i,
+                    (unsigned long long)g.start,
+                    (unsigned long long)g.end,
+                    ACTIVITY_STR(g.activity),
+                    ACTIVITY_STR(r.activity));
+            }
+        }
+    }
+    for (const replay_result_t &g : golden) {
+        golden_count[g.activity % ACTIVITY_CLASS_COUNT]++;
+    }
+    for (const replay_result_t &r : m_results) {
+        replay_count[r.activity % ACTIVITY_CLASS_COUNT]++;
+    }
+
+    printf("%-8s %8s %8s %8s\n", "class", "golden", "replay", "same");
+    for (int c = 0; c < ACTIVITY_CLASS_COUNT; c++) {
+        printf("%-8s %8d %8d %8d\n", ACTIVITY_STR(c), golden_count[c], replay_count[c], match_count[c]);
+    }
+    printf("windows: golden %zu, replay %zu, %d differ\n", golden.size(), m_results.size(), mismatches);
+    printf("max diff where the class matches: probability %f, reps %f\n", max_prob_diff, max_reps_diff);
+
+    return (mismatches || golden.size() != m_results.size()) ? 1 : 0;
+}
+
+int main(void)
+{
+    int         argc;
+    char      **argv;
+    const char *golden  = NULL;
+    bool        write   = false;
+    int         repeat  = 1;
+    long        samples = 0;
+    uint64_t    busy_us = 0;
+    int         opt;
+    int         ret = 0;
+
+    native_get_test_cmd_line_args(&argc, &argv);
+    // getopt() wants the program name in front
+    std::vector<char *> args(argv, argv + argc);
+    args.insert(args.begin(), (char *)"ml_replay");
+    argc = args.size();
+    argv = args.data();
+    while ((opt = getopt(argc, argv, "g:w:n:")) != -1) {
+        switch (opt) {
+        case 'w':
+            write = true;
+            /* fall through */
+        case 'g':
+            golden = optarg;
+            break;
+        case 'n':
+            repeat = atoi(optarg);
+            break;
+        default:
+            posix_exit(2);
+        }
+    }
+    if (optind >= argc) {
+        printf("usage: zephyr.exe -testargs [-w golden.csv | -g golden.csv] [-n repeat] imu0.dat ...\n");
+        posix_exit(2);
+    }
+
+    initiate(handle_result, false);
+    printf("ML library %s\n", getVersion());
+
+    uint64_t start = now_us();
+    for (int i = 0; i < repeat; i++) {
+        for (int f = optind; f < argc; f++) {
+            long count = replay_file(argv[f], &busy_us);
+            if (count < 0) {
+                posix_exit(2);
+            }
+            samples += count;
+        }
+    }
+    uint64_t elapsed = now_us() - start;
+
+    std::sort(m_infer_us.begin(), m_infer_us.end());
+    printf("samples %ld in %llu ms, %.0f samples/s (%.0fx real time at %d Hz)\n",
+           samples,
+           (unsigned long long)elapsed / 1000,
+           busy_us ? samples * 1e6 / busy_us : 0.0,
+           busy_us ? samples * 1e6 / busy_us / IMU_SAMPLE_FREQUENCY : 0.0,
+           IMU_SAMPLE_FREQUENCY);
+    printf("inferences %zu, latency us p50 %u p90 %u p99 %u max %u\n",
+           m_infer_us.size(),
+           percentile(m_infer_us, 50),
+           percentile(m_infer_us, 90),
+           percentile(m_infer_us, 99),
+           percentile(m_infer_us, 100));
+    printf("heap peak %zu bytes, %zu allocations, %zu bytes still held\n", m_heap_peak, m_heap_allocs, m_heap_used);
+
+    if (golden && write) {
+        ret = write_golden(golden) ? 2 : 0;
+    } else if (golden) {
+        ret = compare_golden(golden);
+        if (ret < 0) {
+            ret = 2;
+        }
+    }
+    posix_exit(ret);
+    return ret;
+}
@@ -18,10 +18,27 @@ K_THREAD_STACK_DEFINE(fota_work_stack_area, 4096);
 
 enum fota_task_types {
     FOTA_DOWNLOAD,
-    FOTA_CANCEL,
-    FOTA_UPLOAD
+    FOTA_CANCEL
 };
 
+// Firmware relayed from the 5340 arrives in chunks, with up to UPLOAD_WINDOW of them
+// outstanding.  They come straight from the spis work queue through fota_upload_q,
+// not a zbus channel, since a channel only holds the latest message and chunks can
+// arrive back to back.  Chunks ahead of the next one to write wait in upload.held.
+#define UPLOAD_WINDOW CONFIG_PURINA_D1_LTE_FOTA_UPLOAD_WINDOW
+
+K_MEM_SLAB_DEFINE_STATIC(fota_chunk_slab, ROUND_UP(CONFIG_PURINA_D1_LTE_FOTA_CHUNK_SIZE_MAX, 4), 2 * UPLOAD_WINDOW, 4);
+K_MSGQ_DEFINE(fota_upload_q, sizeof(firmware_upload_data_t), 2 * UPLOAD_WINDOW, 4);
+static void fota_upload_work_handler(struct k_work *work);
+K_WORK_DEFINE(fota_upload_work, fota_upload_work_handler);
+
+static struct {
+    bool active;
+    nrf91_upgrade_id_t id;
+    uint16_t next_chunk;    // next one to go to flash
+    firmware_upload_data_t held[UPLOAD_WINDOW];    // by chunk_num % UPLOAD_WINDOW, data is NULL when empty
+} upload;
+
 typedef struct fota_work_info {
     workref_t *fota_work;
     enum fota_task_types type;
@@ -212,37 +229,6 @@ void fota_work_handler(struct k_work *work) {
             }
             k_free(url_data);
             break;
-        case FOTA_UPLOAD:
-            firmware_upload_data_t* upload_data = (firmware_upload_data_t*)task->data;
-            LOG_DBG("FOTA_UPLOAD: chunk_num: %d, chunk_total: %d, data_len: %d, handle: %d, crc: 0x%08x", upload_data->chunk_num, upload_data->chunk_total, upload_data->data_len, upload_data->handle, upload_data->crc);
-
-            if (upload_data->chunk_num == 0) {
-                nrf91_start_upgrade();
-            }
-            
-            nrf91_upgrade_with_mem_chunk(upload_data->data, upload_data->data_len);
-
-            if (upload_data->chunk_num == upload_data->chunk_total) {
-                nrf91_finish_upgrade();
-            }
-
-            k_free(upload_data->data);
-            k_free(task->data);
-            firmware_upload_data_t reply = {
-                .chunk_num = upload_data->chunk_num,
-                .chunk_total = upload_data->chunk_total,
-                .crc = upload_data->crc,
-                .data_len = 0,
-                .return_code = 0,
-                .handle = upload_data->handle
-            };
-            //LOG_DBG("response: %d %d %d %d %d", reply.chunk_num, reply.chunk_total, reply.data_len, reply.crc, reply.return_code);
-            int err = zbus_chan_pub(&FW_UPLOAD_RESP_CHANNEL, &reply, K_SECONDS(1));
-            if (err) {
-                LOG_ERR("zbus_chan_pub, error:%d", err);
-                //SEND_FATAL_ERROR();
-            }
-            break;
         case FOTA_CANCEL:
             fotaCancel();
             break;
@@ -255,6 +241,181 @@ void fota_work_handler(struct k_work *work) {
 }
 
 
+uint8_t *fota_upload_buf_alloc(void) {
+    uint8_t *buf;
+
+    if (k_mem_slab_alloc(&fota_chunk_slab, (void **)&buf, K_NO_WAIT) != 0) {
+        return NULL;
+    }
+    return buf;
+}
+
+void fota_upload_buf_free(uint8_t *buf) {
+    k_mem_slab_free(&fota_chunk_slab, (void *)buf);
+}
+
+int fota_upload_chunk(const firmware_upload_data_t *chunk) {
+    int err = k_msgq_put(&fota_upload_q, chunk, K_NO_WAIT);
+
+    if (err == 0) {
+        k_work_submit_to_queue(&fota_work_q, &fota_upload_work);
+    }
+    return err;
+}
+
+static void upload_reply(const firmware_upload_data_t *chunk, uint16_t chunk_num, uint8_t return_code) {
+    firmware_upload_data_t reply = {
+        .chunk_num = chunk_num,
+        .chunk_total = chunk->chunk_total,
+        .crc = chunk->crc,
+        .data_len = 0,
+        .return_code = return_code,
+        .handle = chunk->handle
+    };
+    //LOG_DBG("response: %d %d %d %d %d", reply.chunk_num, reply.chunk_total, reply.data_len, reply.crc, reply.return_code);
+    int err = zbus_chan_pub(&FW_UPLOAD_RESP_CHANNEL, &reply, K_SECONDS(1));
+    if (err) {
+        LOG_ERR("zbus_chan_pub, error:%d", err);
+        //SEND_FATAL_ERROR();
+    }
+}
+
+static void upload_drop_held(void) {
+    for (int i = 0; i < UPLOAD_WINDOW; i++) {
+        if (upload.held[i].data != NULL) {
+            fota_upload_buf_free(upload.held[i].data);
+            upload.held[i].data = NULL;
+        }
+    }
+}
+
+///////////////////////////////
+/// 
+///     upload_begin
+/// 
+/// chunk 0 (re)starts an upload.  If the same image is already part way in, either
+/// still in progress or from before a reboot, the reply tells the 5340 where to carry on.
+static uint8_t upload_begin(const firmware_upload_data_t *chunk) {
+    nrf91_upgrade_id_t id = {
+        .image_id = chunk->crc,
+        .chunk_total = chunk->chunk_total,
+        .chunk_size = chunk->data_len
+    };
+    uint32_t offset;
+
+    if (upload.active && memcmp(&upload.id, &id, sizeof(id)) == 0) {
+        LOG_INF("upload restarted by the 5340, at chunk %d", upload.next_chunk);
+        return upload.next_chunk > 0 ? 7 : 0;
+    }
+    if (upload.active) {
+        nrf91_cancel_upgrade();
+    }
+    upload_drop_held();
+    upload.active = false;
+    upload.id = id;
+    upload.next_chunk = 0;
+    if (nrf91_resume_upgrade(&id, &offset) == 0) {
+        upload.next_chunk = offset / id.chunk_size;
+        upload.active = true;
+        return 7;
+    }
+    if (nrf91_start_upgrade(&id) != 0) {
+        return 5;
+    }
+    upload.active = true;
+    return 0;
+}
+
+///////////////////////////////
+/// 
+///     upload_write
+/// 
+/// write one chunk, and then any held ones that follow it
+static int upload_write(firmware_upload_data_t *chunk) {
+    int rc = nrf91_upgrade_with_mem_chunk(chunk->data, chunk->data_len);
+
+    fota_upload_buf_free(chunk->data);
+    chunk->data = NULL;
+    while (rc == 0) {
+        upload.next_chunk++;
+        firmware_upload_data_t *next = &upload.held[upload.next_chunk % UPLOAD_WINDOW];
+        if (next->data == NULL || next->chunk_num != upload.next_chunk) {
+            break;
+        }
+        rc = nrf91_upgrade_with_mem_chunk(next->data, next->data_len);
+        fota_upload_buf_free(next->data);
+        next->data = NULL;
+    }
+    return rc;
+}
+
+///////////////////////////////
+/// 
+///     upload_handle_chunk
+/// 
+static void upload_handle_chunk(firmware_upload_data_t *chunk) {
+    uint16_t reply_num = chunk->chunk_num;
+    uint8_t return_code = 0;
+
+    //LOG_DBG("FOTA_UPLOAD: chunk_num: %d, chunk_total: %d, data_len: %d, handle: %d, crc: 0x%08x", chunk->chunk_num, chunk->chunk_total, chunk->data_len, chunk->handle, chunk->crc);
+    if (chunk->chunk_num == 0) {
+        return_code = upload_begin(chunk);
+        if (return_code == 7) {
+            reply_num = upload.next_chunk;
+        }
+    }
+    if (return_code != 0) {
+        fota_upload_buf_free(chunk->data);
+    }
+    else if (!upload.active) {
+        return_code = 5;    // not ready for data, chunk 0 has to come first
+        fota_upload_buf_free(chunk->data);
+    }
+    else if (chunk->chunk_num < upload.next_chunk) {
+        fota_upload_buf_free(chunk->data);    // a resend of one already written
+    }
+    else if (chunk->chunk_num >= upload.next_chunk + UPLOAD_WINDOW) {
+        return_code = 1;    // beyond the window, send it again later
+        fota_upload_buf_free(chunk->data);
+    }
+    else if (chunk->chunk_num > upload.next_chunk) {
+        firmware_upload_data_t *slot = &upload.held[chunk->chunk_num % UPLOAD_WINDOW];
+        if (slot->data != NULL) {
+            fota_upload_buf_free(slot->data);    // a resend of one already held
+        }
+        *slot = *chunk;
+    }
+    else if (upload_write(chunk) != 0) {
+        return_code = 6;
+        upload_drop_held();
+        nrf91_cancel_upgrade();
+        upload.active = false;
+    }
+
+    // chunk_total is the number of the last chunk
+    bool complete = upload.active && upload.next_chunk > upload.id.chunk_total;
+    if (complete && return_code == 0) {
+        return_code = 8;    // this chunk finished the image, the 5340 waits for this before it is done
+    }
+    upload_reply(chunk, reply_num, return_code);
+
+    if (complete) {
+        LOG_INF("upload complete, installing");
+        upload.active = false;
+        k_sleep(K_MSEC(2000));    // let the last reply get to the 5340
+        nrf91_finish_upgrade();
+    }
+}
+
+static void fota_upload_work_handler(struct k_work *work) {
+    firmware_upload_data_t chunk;
+
+    while (k_msgq_get(&fota_upload_q, &chunk, K_NO_WAIT) == 0) {
+        upload_handle_chunk(&chunk);
+    }
+}
+
+
 ///////////////////////////////
 /// 
 ///     fota_task 
@@ -273,34 +434,6 @@ static void fota_task(void) {
     while(true) {
 		if (zbus_sub_wait(&fota_client, &chan, K_FOREVER) == 0) {
             
-			if (&FW_UPLOAD_CHANNEL == chan) {
-                firmware_upload_data_t ztask;
-				err = zbus_chan_read(&FW_UPLOAD_CHANNEL, &ztask, K_SECONDS(1));
-				if (err) {
-					LOG_ERR("zbus_chan_read, error: %d", err);
-					SEND_FATAL_ERROR();
-					return;
-				}   
-                fota_work_info_t *work_details = k_malloc(sizeof(fota_work_info_t));
-                if (work_details == NULL) {
-                    LOG_ERR("Failed to allocate memory for firmware upload");
-                    return;
-                }
-                firmware_upload_data_t* task = k_malloc(sizeof(firmware_upload_data_t));
-                if (task == NULL) {
-                    LOG_ERR("Failed to allocate memory for firmware upload");
-                    k_free(work_details);
-                    return;
-                }
-                memcpy(task, &ztask, sizeof(firmware_upload_data_t));
-
-                //LOG_DBG("FOTA_UPLOAD: chunk_num: %d, chunk_total: %d, data_len: %d, handle: %d, crc: %d", task->chunk_num, task->chunk_total, task->data_len, task->handle, task->crc);
-                work_details->fota_work = wr_get(work_details, __LINE__);
-                k_work_init(&work_details->fota_work->work, fota_work_handler);
-                work_details->type = FOTA_UPLOAD;
-                work_details->data = task;
-                k_work_submit_to_queue(&fota_work_q, &work_details->fota_work->work);
-            }
             if (&FOTA_DL_CHANNEL == chan) {
                 download_request_t url_data;
                 err = zbus_chan_read(&FOTA_DL_CHANNEL, &url_data, K_SECONDS(1));
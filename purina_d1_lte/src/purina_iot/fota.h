@@ -3,9 +3,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "zbus_msgs.h"
 
 
 int handleFotaMQTTMessage(char *topic, int topicLength, char *message, int messageLength);
 void fotaSendCheckForUpdate();
 int handleFotaDownloadHTTPsMessage(char *url, int sec_tag);
-int fotaCancel();
\ No newline at end of file
+int fotaCancel();
+
+uint8_t *fota_upload_buf_alloc(void);
+void fota_upload_buf_free(uint8_t *buf);
+int fota_upload_chunk(const firmware_upload_data_t *chunk);
@@ -8,16 +8,27 @@
 
 
 #include <zephyr/fs/fs.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/settings/settings.h>
 #include "nrf91_upgrade.h"
 
 LOG_MODULE_REGISTER(nrf91_upgrade, LOG_LEVEL_DBG);
 
 struct flash_img_context _flash_img_context;
-#define BLOCKSIZE (512)
-static uint8_t extra_data[BLOCKSIZE];
-static int extra_data_size = 0;
 static bool upgrade_started = false;
-static uint16_t fw_offset = 0;
+
+// how far an interrupted upgrade got, so it can carry on after a reboot
+#define RESUME_SETTINGS_KEY "nrf91_upgrade/resume"
+
+typedef struct {
+	nrf91_upgrade_id_t id;
+	uint32_t offset;	// bytes already in flash, on a page boundary
+} upgrade_resume_t;
+
+static nrf91_upgrade_id_t upgrade_id;
+static uint32_t base_offset;	// where the stream started in the slot
+static uint32_t saved_offset;	// offset in the last saved resume record
+static size_t page_size;
 /*
  * @note This is a copy of ERASED_VAL_32() from mcumgr.
  */
@@ -146,6 +157,48 @@ static int flash_img_prepare(struct flash_img_context *flash)
 	return 0;
 }
 
+static int resume_load_cb(const char *key, size_t len, settings_read_cb read_cb,
+			  void *cb_arg, void *param)
+{
+	upgrade_resume_t *resume = param;
+
+	if (len != sizeof(upgrade_resume_t)) {
+		return 0;
+	}
+	if (read_cb(cb_arg, resume, len) != len) {
+		memset(resume, 0, sizeof(upgrade_resume_t));
+	}
+	return 0;
+}
+
+static void resume_clear(void)
+{
+	saved_offset = 0;
+	settings_delete(RESUME_SETTINGS_KEY);
+}
+
+/**
+ * Save the resume point once enough has reached flash since the last save.
+ *
+ * Only whole pages count: the first write after a resume erases its page, so
+ * resuming part way into one would lose what is already there.  The offset
+ * must also start a chunk, which is what the sender retransmits from.
+ */
+static void resume_save(void)
+{
+	uint32_t committed = base_offset + stream_flash_bytes_written(&_flash_img_context.stream);
+	upgrade_resume_t resume = { .id = upgrade_id };
+
+	resume.offset = committed - committed % page_size;
+	if (upgrade_id.chunk_size == 0 || resume.offset % upgrade_id.chunk_size != 0 ||
+	    resume.offset < saved_offset + CONFIG_PURINA_D1_LTE_FOTA_RESUME_INTERVAL) {
+		return;
+	}
+	if (settings_save_one(RESUME_SETTINGS_KEY, &resume, sizeof(resume)) == 0) {
+		saved_offset = resume.offset;
+	}
+}
+
 static int fw_update_write_block(const uint8_t *block, size_t block_size)
 {
 	int err;
@@ -173,6 +226,20 @@ static void fw_update_finish(void)
 	}
 }
 
+static int upgrade_page_size(void)
+{
+	struct flash_pages_info info;
+	const struct flash_area *fa = _flash_img_context.flash_area;
+	int rc = flash_get_page_info_by_offs(flash_area_get_device(fa), fa->fa_off, &info);
+
+	if (rc) {
+		LOG_ERR("flash_get_page_info_by_offs: %d", rc);
+		return rc;
+	}
+	page_size = info.size;
+	return 0;
+}
+
 int nrf91_cancel_upgrade() {
 	if (!upgrade_started) {
 		LOG_ERR("No upgrade in progress!");
@@ -183,7 +250,7 @@ int nrf91_cancel_upgrade() {
 	return 0;
 }
 
-int nrf91_start_upgrade() {
+int nrf91_start_upgrade(const nrf91_upgrade_id_t *id) {
 	
 	if (upgrade_started) {
 		LOG_ERR("Upgrade already started!");
@@ -199,84 +266,81 @@ int nrf91_start_upgrade() {
 		LOG_ERR("FAIL: flash_img_prepare: %d", rc);
 		return rc;
 	}
+	rc = upgrade_page_size();
+	if (rc) {
+		return rc;
+	}
+	resume_clear();
+	upgrade_id = *id;
+	base_offset = 0;
 	upgrade_started = true;
 	LOG_DBG("ready to write image to secondary...");
 
 	return 0;
 }
 
-int nrf91_upgrade_with_mem_chunk(uint8_t *chunk, uint16_t chunk_size)
+int nrf91_resume_upgrade(const nrf91_upgrade_id_t *id, uint32_t *offset)
 {
-	int rc; 
-	int offset = 0;
-
-	if (extra_data_size > 0) {
-		// fill remaining extra_data from chunk and set offset for how much was used
-		int remaining = BLOCKSIZE - extra_data_size;
-		if (remaining > chunk_size) {
-			// chunk fits in extra_data
-			memcpy(extra_data + extra_data_size, chunk, chunk_size);
-			extra_data_size += chunk_size;
-			return 0;
-		}
-		else {
-			// chunk does not fit in extra_data
-			memcpy(extra_data + extra_data_size, chunk, remaining);
-			rc = fw_update_write_block(extra_data, BLOCKSIZE);
-			fw_offset += BLOCKSIZE;
-			if (rc) {
-				LOG_ERR("Failed to write block: %d", rc);
-				return rc;
-			}
-			else {
-				//LOG_DBG("wrote block: %d", offset);
-			}
-			offset += remaining;
-			extra_data_size = 0;
-		}
-		
+	upgrade_resume_t resume = { 0 };
+	int rc;
+
+	if (upgrade_started) {
+		LOG_ERR("Upgrade already started!");
+		return -EBUSY;
+	}
+	rc = settings_subsys_init();
+	if (rc) {
+		LOG_ERR("settings_subsys_init: %d", rc);
+		return rc;
+	}
+	settings_load_subtree_direct(RESUME_SETTINGS_KEY, resume_load_cb, &resume);
+	if (resume.offset == 0 || memcmp(&resume.id, id, sizeof(nrf91_upgrade_id_t)) != 0) {
+		return -ENOENT;
 	}
 
-	// for every BLOCKSIZE bytes in chunk, write to flash
-	for (int i = offset; i < chunk_size; i += BLOCKSIZE) {
-		if (i + BLOCKSIZE > chunk_size) {
-			// partial block
-			// save it for next time
-			memcpy(extra_data, chunk + i, chunk_size - i);
-			extra_data_size = chunk_size - i;
-			break;
-		}
-		uint8_t block[BLOCKSIZE];
-		memcpy(block, chunk + i, BLOCKSIZE);
-		rc = fw_update_write_block(block, BLOCKSIZE);
-		fw_offset += BLOCKSIZE;
-		if (rc) {
-			LOG_ERR("Failed to write block: %d", rc);
-			return rc;
-		}
-		else {
-			//LOG_DBG("wrote block: %d", i);
-		}
+	rc = flash_img_init(&_flash_img_context);
+	if (rc) {
+		LOG_ERR("failed to init: %d", rc);
+		return rc;
+	}
+	// carry on streaming from the resume point, the slot below it is already written
+	const struct flash_area *fa = _flash_img_context.flash_area;
+	rc = stream_flash_init(&_flash_img_context.stream, flash_area_get_device(fa),
+			       _flash_img_context.buf, sizeof(_flash_img_context.buf),
+			       fa->fa_off + resume.offset, fa->fa_size - resume.offset, NULL);
+	if (rc == 0) {
+		rc = upgrade_page_size();
+	}
+	if (rc) {
+		LOG_ERR("failed to resume at %u: %d", resume.offset, rc);
+		return rc;
 	}
+	upgrade_id = *id;
+	base_offset = resume.offset;
+	saved_offset = resume.offset;
+	upgrade_started = true;
+	*offset = resume.offset;
+	LOG_INF("resuming upgrade at %u", resume.offset);
+
 	return 0;
 }
 
-int nrf91_finish_upgrade() {
-	int rc; 
+int nrf91_upgrade_with_mem_chunk(const uint8_t *chunk, uint16_t chunk_size)
+{
+	// the stream buffers up to the flash write size itself, so chunks go straight in
+	int rc = fw_update_write_block(chunk, chunk_size);
 
-	if (extra_data_size > 0) {
-		// if there is anything left in extra_data, write it to flash
-		int rc = fw_update_write_block(extra_data, extra_data_size);	
-		if (rc) {
-			LOG_ERR("Failed to write block: %d", rc);
-			return rc;
-		}
-		else {
-			//LOG_DBG("wrote final block");
-		}
+	if (rc == 0) {
+		resume_save();
 	}
+	return rc;
+}
+
+int nrf91_finish_upgrade() {
+	int rc; 
 
 	fw_update_finish();
+	resume_clear();
 
 	rc = boot_write_img_confirmed();
 	if (rc) {
@@ -1,6 +1,16 @@
 #pragma once
 
-int nrf91_start_upgrade();
-int nrf91_upgrade_with_mem_chunk(uint8_t *chunk, uint16_t chunk_size);
+#include <stdint.h>
+
+// identifies the image being written, a resume point only applies to the same one
+typedef struct {
+	uint32_t image_id;	// crc of the first chunk
+	uint16_t chunk_total;
+	uint16_t chunk_size;
+} nrf91_upgrade_id_t;
+
+int nrf91_start_upgrade(const nrf91_upgrade_id_t *id);
+int nrf91_resume_upgrade(const nrf91_upgrade_id_t *id, uint32_t *offset);
+int nrf91_upgrade_with_mem_chunk(const uint8_t *chunk, uint16_t chunk_size);
 int nrf91_finish_upgrade();
 int nrf91_cancel_upgrade();
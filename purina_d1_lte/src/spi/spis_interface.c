@@ -27,7 +27,6 @@
 #include "fota.h"
 #include "modem_interface_types.h"  // from c_modules/modem/include so its shared with the 5340
 #include "network.h"
-#include "wi.h"
 
 LOG_MODULE_REGISTER(spis, CONFIG_PURINA_D1_SPIS_LOG_LEVEL); 
 
@@ -65,18 +64,31 @@ static const struct gpio_dt_spec DataReady = GPIO_DT_SPEC_GET(DT_ALIAS(dataready
 
 #define MAX_RESPONSES 8
 
-#define MAX_INCOMING_BUFS MAX_RESPONSES
-struct incoming_data_item_t {
-    bool in_use;
-    uint8_t data[CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE];
-    uint16_t len;
-} __attribute__((__packed__));
-
+// The SPIS DMA writes straight into one of these blocks. When a message lands the ISR
+// swaps a free block in, and hands the full one to spi_recv_action_work_handler(),
+// which gives it back when done. Nothing is copied or taken from the heap in the ISR.
 typedef struct {
-    workref_t *work;
-    void* data;
+    struct k_work work;
+    uint32_t received_at;    // cycle count when the transfer finished
     uint16_t len;
-} incoming_data_item_t;
+    uint8_t data[CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE];
+} spis_rx_block_t;
+
+K_MEM_SLAB_DEFINE_STATIC(spis_rx_slab, ROUND_UP(sizeof(spis_rx_block_t), 4), CONFIG_PURINA_D1_SPIS_RX_BLOCKS, 4);
+
+static spis_rx_block_t *m_rx_block;    // block armed for the next transfer
+static struct k_spinlock spis_rx_lock;
+
+static struct spis_rx_stats {
+    uint32_t received;
+    uint32_t pool_empty;       // messages dropped because every rx block was in use
+    uint32_t naks;             // failure responses sent to the 5340
+    uint32_t max_latency_us;   // transfer done to handler start
+} spis_rx_stats;
+
+// handles of dropped messages, NAKed from the work queue since that takes the heap
+K_MSGQ_DEFINE(spis_nak_q, sizeof(uint8_t), 8, 1);
+static struct k_work spis_nak_work;
 
 typedef struct {
     void* reserved;
@@ -91,10 +103,12 @@ typedef struct {
 K_FIFO_DEFINE(outgoing_fifo);
 bool spi_buffer_is_generic_or_empty = true;
 
+static volatile bool link_v2;       // the 5340 talks v2, so pack everything queued into each transfer
+static bool          status_owed;   // a status update is waiting to go out in a batch
+
 
 static nrfx_spis_config_t spis_config =
     NRFX_SPIS_DEFAULT_CONFIG(APP_SPIS_SCK_PIN, APP_SPIS_MOSI_PIN, APP_SPIS_MISO_PIN, APP_SPIS_CS_PIN);
-static uint8_t m_rx_buf[CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE]; // RX buffer.
 
 int64_t last_ssids_received_ts=0;
 void set_next_response();
@@ -170,6 +184,9 @@ void prepare_basic_response_simple(uint8_t handle, int8_t data) {
         SEND_FATAL_ERROR();
         return;
     }
+    if (data != 0) {
+        spis_rx_stats.naks++;
+    }
 
     outgoing_data_item->messageType = MESSAGE_TYPE_RESPONSE;
     outgoing_data_item->messageHandle = handle;
@@ -238,6 +255,158 @@ void prepare_response(uint8_t type, uint8_t handle, uint8_t* data, uint16_t data
 
 
 
+///////////////////////////////
+/// 
+///     spis_arm
+/// 
+/// The ISR swaps m_rx_block, so read it and hand it to the peripheral in one go
+static void spis_arm(uint8_t *tx, uint16_t tx_len) {
+    k_spinlock_key_t key = k_spin_lock(&spis_rx_lock);
+    nrfx_spis_buffers_set(&spis, tx, tx_len, m_rx_block->data, CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE);
+    k_spin_unlock(&spis_rx_lock, key);
+}
+
+
+
+///////////////////////////////
+/// 
+///     spis_put_record
+/// 
+static void spis_put_record(uint16_t *used, outgoing_data_item_t *item, const void *data) {
+    message_command_v1_t hdr = {
+        .version = MESSAGE_VERSION_V1,
+        .messageType = item->messageType,
+        .messageHandle = item->messageHandle,
+        .dataLen = item->dataLen,
+        .chunkNum = item->chunkNum,
+        .chunkTotal = item->chunkTotal
+    };
+
+    memcpy(m_important_tx_buf + *used, &hdr, sizeof(hdr));
+    memcpy(m_important_tx_buf + *used + sizeof(hdr), data, item->dataLen);
+    *used += sizeof(hdr) + item->dataLen;
+}
+
+
+
+///////////////////////////////
+/// 
+///     spis_send_v1
+/// 
+/// send one queued message on its own, in a v1 frame.  It has to fit m_important_tx_buf
+static void spis_send_v1(outgoing_data_item_t *item) {
+    important_response.version = 0x01;
+    important_response.messageType = item->messageType;
+    important_response.messageHandle = item->messageHandle;
+    important_response.dataLen = item->dataLen;
+    important_response.chunkNum = item->chunkNum;
+    important_response.chunkTotal = item->chunkTotal;
+
+    memcpy(m_important_tx_buf, (uint8_t*)(&important_response), sizeof(message_command_v1_t));
+    if (item->data == NULL) {
+        uint8_t* data = ((uint8_t*)m_important_tx_buf + sizeof(message_command_v1_t));
+        data[0] = item->simpleData;
+    }
+    else {
+        memcpy(m_important_tx_buf + sizeof(message_command_v1_t), item->data, item->dataLen);
+    }
+
+    spis_actual_response_tx_len = sizeof(message_command_v1_t) + item->dataLen;
+
+    spis_arm(m_important_tx_buf, spis_actual_response_tx_len);
+    gpio_pin_set(DataReady.port, DataReady.pin, 1);
+    time_last_message_sent         = k_uptime_get();
+    spi_buffer_is_generic_or_empty = false;
+    if (item->data != NULL) {
+        k_free(item->data);
+    }
+    k_free(item);
+}
+
+
+
+///////////////////////////////
+/// 
+///     set_next_batch
+/// 
+/// v2 version of set_next_response: everything queued that fits goes in one transfer.
+/// Status updates are coalesced, only the newest is sent, after the rest.  With nothing
+/// queued the batch just carries the current status, like the v1 default response.
+static void set_next_batch() {
+    if (spi_buffer_is_generic_or_empty == false) {
+        LOG_DBG("waiting for last message to finish sending over spi");
+        return;
+    }
+
+    message_command_v1_t batch = {
+        .version = MESSAGE_VERSION_V2,
+        .messageType = MESSAGE_TYPE_BATCH,
+        .messageHandle = 255,
+        .dataLen = 0,
+        .chunkNum = 0,
+        .chunkTotal = 0
+    };
+    uint16_t used = sizeof(message_command_v1_t);
+    outgoing_data_item_t* item;
+
+    while ((item = k_fifo_peek_head(&outgoing_fifo)) != NULL) {
+        bool is_status = (item->messageType == MESSAGE_TYPE_DEVICE_STATUS) && (item->messageHandle == 255);
+        uint16_t len = sizeof(message_command_v1_t) + item->dataLen;
+
+        if (!is_status && (batch.chunkTotal > 0) && (used + len > m_important_tx_buf_size)) {
+            break;  // next transfer
+        }
+        if (!is_status && (used + len > m_important_tx_buf_size) && (len <= m_important_tx_buf_size)) {
+            // fits a v1 frame, but not behind the batch header, so it goes on its own
+            k_fifo_get(&outgoing_fifo, K_NO_WAIT);
+            spis_send_v1(item);
+            return;
+        }
+        k_fifo_get(&outgoing_fifo, K_NO_WAIT);
+        if (is_status) {
+            status_owed = true;
+        }
+        else if (used + len > m_important_tx_buf_size) {
+            LOG_ERR("dataLen > m_important_tx_buf_size: %d > %d", item->dataLen, m_important_tx_buf_size);
+        }
+        else {
+            spis_put_record(&used, item, item->data != NULL ? (const void*)item->data : (const void*)&item->simpleData);
+            batch.chunkTotal++;
+        }
+        if (item->data != NULL) {
+            k_free(item->data);
+        }
+        k_free(item);
+    }
+
+    bool idle = (batch.chunkTotal == 0) && !status_owed;
+    if (used + sizeof(message_command_v1_t) + sizeof(modem_status_t) <= m_important_tx_buf_size) {
+        outgoing_data_item_t status = {
+            .messageType = MESSAGE_TYPE_DEVICE_STATUS,
+            .messageHandle = 255,
+            .dataLen = sizeof(modem_status_t),
+            .chunkNum = 0,
+            .chunkTotal = 1
+        };
+        last_modem_status.uptime = k_uptime_get();
+        spis_put_record(&used, &status, &last_modem_status);
+        batch.chunkTotal++;
+        status_owed = false;
+    }
+
+    batch.dataLen = used - sizeof(message_command_v1_t);
+    memcpy(m_important_tx_buf, &batch, sizeof(batch));
+    spis_actual_response_tx_len = used;
+    spis_arm(m_important_tx_buf, used);
+    if (!idle) {
+        gpio_pin_set(DataReady.port, DataReady.pin, 1);
+        time_last_message_sent = k_uptime_get();
+    }
+    spi_buffer_is_generic_or_empty = idle;
+}
+
+
+
 ///////////////////////////////
 /// 
 ///     set_next_response
@@ -247,6 +416,10 @@ void set_next_response() {
         LOG_DBG("spis not initialized or first msg not received");
         return;
     }
+    if (link_v2) {
+        set_next_batch();
+        return;
+    }
     if (k_fifo_is_empty(&outgoing_fifo) && spi_buffer_is_generic_or_empty) {
         modem_status_t* currStatus = &last_modem_status;
         // one change to the status is to set the uptime again
@@ -257,9 +430,7 @@ void set_next_response() {
         memcpy(m_important_tx_buf, (uint8_t*)(&default_response), sizeof(message_command_v1_t));
         memcpy(m_important_tx_buf + sizeof(message_command_v1_t), (uint8_t*)(currStatus), sizeof(modem_status_t));
         spis_actual_response_tx_len = sizeof(message_command_v1_t) + sizeof(modem_status_t);
-        nrfx_spis_buffers_set(&spis, ((uint8_t*)m_important_tx_buf),
-            sizeof(message_command_v1_t) + sizeof(modem_status_t), m_rx_buf,
-            CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE); 
+        spis_arm(m_important_tx_buf, sizeof(message_command_v1_t) + sizeof(modem_status_t));
         spi_buffer_is_generic_or_empty = true;
     }
     else {
@@ -284,34 +455,7 @@ void set_next_response() {
                 return;
             }
 
-            important_response.version = 0x01;
-            important_response.messageType = outgoing_data_item->messageType;
-            important_response.messageHandle = outgoing_data_item->messageHandle;
-            important_response.dataLen = outgoing_data_item->dataLen;
-            important_response.chunkNum = outgoing_data_item->chunkNum;
-            important_response.chunkTotal = outgoing_data_item->chunkTotal;
-
-            memcpy(m_important_tx_buf, (uint8_t*)(&important_response), sizeof(message_command_v1_t));
-            if (outgoing_data_item->data == NULL) {
-                uint8_t* data = ((uint8_t*)m_important_tx_buf + sizeof(message_command_v1_t));
-                data[0] = outgoing_data_item->simpleData;
-            }
-            else {
-                memcpy(m_important_tx_buf + sizeof(message_command_v1_t), outgoing_data_item->data, outgoing_data_item->dataLen);
-            }
-
-            spis_actual_response_tx_len = sizeof(message_command_v1_t) + outgoing_data_item->dataLen;
-
-            nrfx_spis_buffers_set(&spis, ((uint8_t*)m_important_tx_buf),
-                spis_actual_response_tx_len, m_rx_buf,
-                CONFIG_PURINA_D1_SPIS_RX_BUFFER_SIZE);
-            gpio_pin_set(DataReady.port, DataReady.pin, 1);
-            time_last_message_sent         = k_uptime_get();
-            spi_buffer_is_generic_or_empty = false;
-            if (outgoing_data_item->data != NULL) {
-                k_free(outgoing_data_item->data);
-            }
-            if (outgoing_data_item) k_free(outgoing_data_item);
+            spis_send_v1(outgoing_data_item);
         }
     }
 }
@@ -731,15 +875,8 @@ void nrf5340_recv_callback(uint8_t *data, size_t len, void *user_data) {
                                 prepare_response(MESSAGE_TYPE_FW_UPLOAD, msg->messageHandle, (uint8_t*)&reply, sizeof(firmware_upload_t));
                                 break;
                             }
-                            uint8_t* fw_data_ptr = k_malloc(fw_data_len);
-                            if (fw_data_ptr == NULL) {
-                                LOG_ERR("fw_data_ptr - malloc failed");
-                                SEND_FATAL_ERROR();
-                            }
-                            memcpy(fw_data_ptr, fw_data, fw_data_len);
-                            firmware_upload_data_t fw_upload_data;
                             uint32_t crc32 = 0;
-                            crc32 = crc32_ieee_update(crc32, fw_data_ptr, fw_data_len);
+                            crc32 = crc32_ieee_update(crc32, fw_data, fw_data_len);
                             //LOG_DBG("crc32 = 0x%08x", crc32);
                             if (crc32 != my_fw_upload->crc) {
                                 LOG_ERR("crc32 != my_fw_upload->crc: 0x%08x != 0x%08x", crc32, my_fw_upload->crc);
@@ -753,17 +890,31 @@ void nrf5340_recv_callback(uint8_t *data, size_t len, void *user_data) {
                                 prepare_response(MESSAGE_TYPE_FW_UPLOAD, msg->messageHandle, (uint8_t*)&reply, sizeof(firmware_upload_t));
                                 break;
                             }
-                            fw_upload_data.data = fw_data_ptr;
-                            fw_upload_data.data_len = fw_data_len;
-                            fw_upload_data.chunk_num = my_fw_upload->chunk_num;
-                            fw_upload_data.chunk_total = my_fw_upload->chunk_total;
-                            fw_upload_data.crc = my_fw_upload->crc;
-                            fw_upload_data.handle = msg->messageHandle;
-                            err = zbus_chan_pub(&FW_UPLOAD_CHANNEL, &fw_upload_data, K_SECONDS(1));
-                            if (err) {
-                                LOG_ERR("zbus_chan_pub, error:%d", err);
-                                SEND_FATAL_ERROR();
+                            // the rx block goes back to the pool after this, so the chunk moves to a fota buffer
+                            firmware_upload_data_t fw_upload_data = {
+                                .data = fota_upload_buf_alloc(),
+                                .data_len = fw_data_len,
+                                .chunk_num = my_fw_upload->chunk_num,
+                                .chunk_total = my_fw_upload->chunk_total,
+                                .crc = my_fw_upload->crc,
+                                .handle = msg->messageHandle
+                            };
+                            if (fw_upload_data.data != NULL) {
+                                memcpy(fw_upload_data.data, fw_data, fw_data_len);
+                                if (fota_upload_chunk(&fw_upload_data) == 0) {
+                                    break;
+                                }
+                                fota_upload_buf_free(fw_upload_data.data);
                             }
+                            // every buffer is in use, the 5340 sends it again
+                            firmware_upload_t reply = {
+                                .chunk_num = my_fw_upload->chunk_num,
+                                .chunk_total = my_fw_upload->chunk_total,
+                                .crc = my_fw_upload->crc,
+                                .data_len = 0,
+                                .return_code = 0x05
+                            };
+                            prepare_response(MESSAGE_TYPE_FW_UPLOAD, msg->messageHandle, (uint8_t*)&reply, sizeof(firmware_upload_t));
                             break;
                     default:
                             LOG_DBG("MESSAGE_TYPE_UNKNOWN");
@@ -786,16 +937,80 @@ void spi_recv_action_work_handler(struct k_work *work) {
     if (work == NULL) {
         return;
     }
-    workref_t *wr = CONTAINER_OF(work, workref_t, work);
-    incoming_data_item_t *rx_data = (incoming_data_item_t*)wr->reference;
+    spis_rx_block_t *block = CONTAINER_OF(work, spis_rx_block_t, work);
+    message_command_v1_t *hdr = (message_command_v1_t *)block->data;
+    uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - block->received_at);
+
+    if (latency_us > spis_rx_stats.max_latency_us) {
+        spis_rx_stats.max_latency_us = latency_us;
+    }
+    if (hdr->version == MESSAGE_VERSION_V2) {
+        // each record is a whole v1 message
+        uint16_t end = MIN(block->len, sizeof(message_command_v1_t) + hdr->dataLen);
+        uint16_t pos = sizeof(message_command_v1_t);
+
+        for (int i = 0; (i < hdr->chunkTotal) && (pos + sizeof(message_command_v1_t) <= end); i++) {
+            message_command_v1_t *rec = (message_command_v1_t *)(block->data + pos);
+            uint16_t len = sizeof(message_command_v1_t) + rec->dataLen;
+
+            if (pos + len > end) {
+                LOG_ERR("batch record %d overruns the transfer", i);
+                break;
+            }
+            nrf5340_recv_callback(block->data + pos, len, NULL);
+            pos += len;
+        }
+    }
+    else {
+        nrf5340_recv_callback(block->data, block->len, NULL);
+    }
+    k_mem_slab_free(&spis_rx_slab, (void *)block);
+}
+
+
+
+///////////////////////////////
+/// 
+///     spis_nak_work_handler
+/// 
+static void spis_nak_work_handler(struct k_work *work) {
+    uint8_t handle;
 
-    if (rx_data) {
-        nrf5340_recv_callback(rx_data->data, rx_data->len, NULL);
-        if (rx_data->data) k_free(rx_data->data);
-        if (rx_data) k_free(rx_data);
+    while (k_msgq_get(&spis_nak_q, &handle, K_NO_WAIT) == 0) {
+        prepare_basic_response_simple(handle, 1);
     }
+}
+
 
-    if (wr) wr_put(wr);
+
+///////////////////////////////
+/// 
+///     spis_report_rx_stats
+/// 
+/// Tell the 5340 when any of the counters moved, at most once a minute.  It is only a
+/// warning if messages were dropped or NAKed since the last report
+static void spis_report_rx_stats(void) {
+    static struct spis_rx_stats reported;
+    static int64_t reported_at;
+    struct spis_rx_stats now = spis_rx_stats;
+    char stats[96];
+
+    if (memcmp(&now, &reported, sizeof(now)) == 0 || k_uptime_get() - reported_at < 60000) {
+        return;
+    }
+    bool trouble = now.naks != reported.naks || now.pool_empty != reported.pool_empty;
+    reported    = now;
+    reported_at = k_uptime_get();
+    snprintf(stats, sizeof(stats), "spis rx: %u msgs, %u pool empty, %u nak, max latency %u us",
+        now.received, now.pool_empty, now.naks, now.max_latency_us);
+    if (trouble) {
+        LOG_WRN("%s", stats);
+        LOG_5340_WRN(MODEM_ERROR_NONE, stats);
+    }
+    else {
+        LOG_INF("%s", stats);
+        LOG_5340_INF(MODEM_ERROR_NONE, stats);
+    }
 }
 
 
@@ -811,6 +1026,32 @@ static void manual_isr_setup()
     irq_enable(SPIM3_SPIS3_TWIM3_TWIS3_UARTE3_IRQn);
 }
 
+///////////////////////////////
+/// 
+///     spis_queue_naks
+/// 
+/// NAK a dropped transfer, or every record of it if it is a batch
+static void spis_queue_naks(const uint8_t *frame, uint16_t len) {
+    const message_command_v1_t *msg = (const message_command_v1_t *)frame;
+    uint16_t pos = 0;
+    int count = 1;
+
+    if (msg->version == MESSAGE_VERSION_V2) {
+        pos = sizeof(message_command_v1_t);
+        count = msg->chunkTotal;
+    }
+    for (int i = 0; (i < count) && (pos + sizeof(message_command_v1_t) <= len); i++) {
+        msg = (const message_command_v1_t *)(frame + pos);
+        if ((msg->messageHandle != 255) && (k_msgq_put(&spis_nak_q, &msg->messageHandle, K_NO_WAIT) != 0)) {
+            break;
+        }
+        pos += sizeof(message_command_v1_t) + msg->dataLen;
+    }
+    k_work_submit_to_queue(&spi_recv_work_q, &spis_nak_work);
+}
+
+
+
 ///////////////////////////////
 /// 
 ///     spis_event_handler
@@ -846,27 +1087,34 @@ void spis_event_handler(nrfx_spis_evt_t const *event, void *p_context)
         }
 
         if (event->rx_amount > 0) {
-            message_command_v1_t *msg = (message_command_v1_t *)m_rx_buf;
-            if ((msg->version == 1) && (msg->messageType != MESSAGE_TYPE_NO_OP)) {         
-                incoming_data_item_t* fifo_item = k_malloc(sizeof(incoming_data_item_t));
-                if (fifo_item == NULL) {
-                    LOG_ERR("fifo_item - malloc failed - no room for more incoming data at this time");
-                    prepare_basic_response_simple(msg->messageHandle, 1);
+            message_command_v1_t *msg = (message_command_v1_t *)m_rx_block->data;
+            bool is_v1 = (msg->version == MESSAGE_VERSION_V1) && (msg->messageType != MESSAGE_TYPE_NO_OP);
+            bool is_v2 = (msg->version == MESSAGE_VERSION_V2) && (msg->chunkTotal > 0);
+
+            // answer in whatever the 5340 last spoke
+            if ((msg->version == MESSAGE_VERSION_V1) || (msg->version == MESSAGE_VERSION_V2)) {
+                link_v2 = msg->version == MESSAGE_VERSION_V2;
+            }
+            if (is_v1 || is_v2) {
+                spis_rx_block_t *next;
+
+                if (k_mem_slab_alloc(&spis_rx_slab, (void **)&next, K_NO_WAIT) != 0) {
+                    // keep the armed block, the message in it is dropped
+                    spis_rx_stats.pool_empty++;
+                    spis_queue_naks(m_rx_block->data, event->rx_amount);
+                    set_next_response();
                     return;
                 }
-                fifo_item->data = k_malloc(event->rx_amount);
-                if (fifo_item->data == NULL) {
-                    LOG_ERR("fifo_item->data - no room for more incoming data at this time");
-                    prepare_basic_response_simple(msg->messageHandle, 1);
-                    k_free(fifo_item);
-                    return;
-                }                
-
-                fifo_item->work = wr_get(fifo_item, __LINE__);
-                k_work_init(&fifo_item->work->work, spi_recv_action_work_handler);
-                memcpy(fifo_item->data, m_rx_buf, event->rx_amount);
-                fifo_item->len = event->rx_amount;
-                k_work_submit_to_queue(&spi_recv_work_q, &fifo_item->work->work);
+                k_spinlock_key_t key = k_spin_lock(&spis_rx_lock);
+                spis_rx_block_t *full = m_rx_block;
+                m_rx_block = next;
+                k_spin_unlock(&spis_rx_lock, key);
+
+                full->len = event->rx_amount;
+                full->received_at = k_cycle_get_32();
+                k_work_init(&full->work, spi_recv_action_work_handler);
+                k_work_submit_to_queue(&spi_recv_work_q, &full->work);
+                spis_rx_stats.received++;
             }
         }
         set_next_response();
@@ -887,6 +1135,12 @@ int spis_setup() {
 
     nrf_spis_disable(spis.p_reg);
 
+    k_work_init(&spis_nak_work, spis_nak_work_handler);
+    if (k_mem_slab_alloc(&spis_rx_slab, (void **)&m_rx_block, K_NO_WAIT) != 0) {
+        LOG_ERR("no spis rx block");
+        return -ENOMEM;
+    }
+
     if (gpio_pin_configure_dt(&DataReady, GPIO_OUTPUT) != 0)
     {
         LOG_ERR("Error: failed to configure %s pin %d\n",
@@ -977,6 +1231,18 @@ void spis_zbus_mgr_listener(const struct zbus_channel *chan)
                 //LOG_HEXDUMP_WRN(&cell_data, sizeof(cell_info_t), "Cell Info:");
                 prepare_response(MESSAGE_TYPE_CELL_INFO, 255, (uint8_t*)cell_data, sizeof(cell_info_t));
             }
+            if (&FW_UPLOAD_RESP_CHANNEL == chan) {
+                const firmware_upload_data_t *upload = zbus_chan_const_msg(chan);
+                firmware_upload_t reply = {
+                    .chunk_num = upload->chunk_num,
+                    .chunk_total = upload->chunk_total,
+                    .crc = upload->crc,
+                    .data_len = 0,
+                    .return_code = upload->return_code
+                };
+                LOG_DBG("zbus FW_UPLOAD_RESP_CHANNEL: %d %d", upload->chunk_num, upload->return_code);
+                prepare_response(MESSAGE_TYPE_FW_UPLOAD, upload->handle, (uint8_t*)&reply, sizeof(firmware_upload_t));
+            }
         
 
         //k_sleep(K_MSEC(1));
@@ -1007,6 +1273,7 @@ static void spis_module_thread_fn(void)
 	while (true) {
         // kick the queue now and then as a backup, almost certainly not needed, need to verify
         spi_recv_action_work_handler(NULL);
+        spis_report_rx_stats();
         k_sleep(K_MSEC(100));
 	}
 }
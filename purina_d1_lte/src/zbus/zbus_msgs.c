@@ -124,14 +124,6 @@ ZBUS_CHAN_DEFINE(DOWNLOAD_REQUEST_CHANNEL,
 		 ZBUS_MSG_INIT(.download_handle = 0, .download_url = {0})
 );
 
-ZBUS_CHAN_DEFINE(FW_UPLOAD_CHANNEL,
-		 firmware_upload_data_t,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS(fota_client),
-		 ZBUS_MSG_INIT(.chunk_num = 0, .chunk_total = 0, .data_len = 0, .handle = 255, .data = NULL, .crc = 0, .return_code = 0)
-);
-
 ZBUS_CHAN_DEFINE(FW_UPLOAD_RESP_CHANNEL,
 		 firmware_upload_data_t,
 		 NULL,
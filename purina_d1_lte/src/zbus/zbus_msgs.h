@@ -136,7 +136,6 @@ ZBUS_CHAN_DECLARE(MQTT_CLOUD_TO_DEV_MESSAGE,
 				DOWNLOAD_REQUEST_CHANNEL,
 				CELL_INFO_CHANNEL,
 				CELL_NEIGHBOR_INFO_CHANNEL,
-				FW_UPLOAD_CHANNEL,
 				FOTA_DL_CHANNEL,
 				FW_UPLOAD_RESP_CHANNEL
 				);